@@ -0,0 +1,466 @@
+﻿#include "AddonInstance.h"
+#include "Logger.h"
+#include "PipelineStats.h"
+#include "FileHasher.h"
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Node-API 10 起外部字符串进入稳定版本，更早的头文件需要定义 NAPI_EXPERIMENTAL
+#if NAPI_VERSION >= 10 || defined(NODE_API_EXPERIMENTAL_HAS_EXTERNAL_STRINGS)
+#define FILE_DROP_EXTERNAL_STRINGS 1
+#endif
+
+// Node-API 10 起可以用 node_api_create_property_key_latin1 创建内部化的属性名，并缓存为引用
+// （更早的版本不能引用字符串）；否则在属性描述符里直接给出 utf8name，由 Node 每次查找内部化字符串
+#if NAPI_VERSION >= 10 || defined(NODE_API_EXPERIMENTAL_HAS_PROPERTY_KEYS)
+#define FILE_DROP_PROPERTY_KEYS 1
+#endif
+
+// 每次唤醒最多投递的拖拽事件数和日志条数，剩余的在下一次唤醒时继续投递
+static const size_t kMaxEventBatch = 64;
+static const size_t kMaxLogBatch = 1024;
+
+static const char* const kEventKeyNames[] = {
+	"kind", "timestamp", "x", "y", "shell", "matchCount", "paths", "files",
+};
+
+// Logger 是进程级的，日志只投递给最近一次调用 AwareInitialize 的实例
+// 写日志的线程只读原子指针，不加锁；g_logMutex 只串行化绑定与解绑
+static std::mutex g_logMutex;
+static std::atomic<AddonInstance*> g_logInstance(nullptr);
+// 正在通知的线程数，按 g_logEpoch 的奇偶分两组：解绑时切换分组，只等待切换前登记的一组结束，
+// 之后才能释放线程安全函数；持续写日志的线程只会登记到新的一组，不会让解绑一直等待
+static std::atomic<unsigned> g_logEpoch(0);
+static std::atomic<unsigned> g_logNotifiers[2];
+
+static const char* LogLevelName(LogLevel level) {
+	switch (level) {
+	case LogLevel::Debug: return "debug";
+	case LogLevel::Info: return "info";
+	case LogLevel::Error: return "error";
+	default: return "off";
+	}
+}
+
+// 回调抛出的异常不向上传播，只记录日志
+static bool CallFunction(napi_env env, napi_ref function, napi_value argument) {
+	napi_value callback;
+	napi_value global;
+	if (function == nullptr || napi_get_reference_value(env, function, &callback) != napi_ok || callback == nullptr
+		|| napi_get_global(env, &global) != napi_ok) {
+		return false;
+	}
+	if (napi_call_function(env, global, callback, 1, &argument, nullptr) == napi_ok) {
+		return true;
+	}
+	bool pending = false;
+	if (napi_is_exception_pending(env, &pending) == napi_ok && pending) {
+		napi_value exception;
+		napi_get_and_clear_last_exception(env, &exception);
+	}
+	return false;
+}
+
+#ifdef FILE_DROP_EXTERNAL_STRINGS
+// 每个外部字符串持有一份 MatchedPaths 的引用，字符串被回收时释放
+static void ReleasePaths(node_api_basic_env env, void* data, void* hint) {
+	delete static_cast<std::shared_ptr<const MatchedPaths>*>(hint);
+}
+#endif
+
+static napi_value NewPathString(napi_env env, const std::shared_ptr<const MatchedPaths>& paths, const MatchedPaths::Span& span) {
+	napi_value value = nullptr;
+#ifdef FILE_DROP_EXTERNAL_STRINGS
+	std::shared_ptr<const MatchedPaths>* owner = new std::shared_ptr<const MatchedPaths>(paths);
+	bool copied = false;
+	napi_status status = span.oneByte
+		? node_api_create_external_string_latin1(env, const_cast<char*>(paths->OneByteData(span)), span.length,
+			ReleasePaths, owner, &value, &copied)
+		: node_api_create_external_string_utf16(env, reinterpret_cast<char16_t*>(const_cast<uint16_t*>(paths->TwoByteData(span))),
+			span.length, ReleasePaths, owner, &value, &copied);
+	// 被复制时 finalize 已经执行过，失败时需要自行释放
+	if (status != napi_ok) {
+		delete owner;
+		return nullptr;
+	}
+#else
+	// 不支持外部字符串时复制一次
+	napi_status status = span.oneByte
+		? napi_create_string_latin1(env, paths->OneByteData(span), span.length, &value)
+		: napi_create_string_utf16(env, reinterpret_cast<const char16_t*>(paths->TwoByteData(span)), span.length, &value);
+	if (status != napi_ok) {
+		return nullptr;
+	}
+#endif
+	return value;
+}
+
+static napi_value NewPathArray(napi_env env, const std::shared_ptr<const MatchedPaths>& paths) {
+	size_t count = paths ? paths->Count() : 0;
+	napi_value array;
+	if (napi_create_array_with_length(env, count, &array) != napi_ok) {
+		return nullptr;
+	}
+	for (size_t i = 0; i < count; i++) {
+		napi_value path = NewPathString(env, paths, paths->At(i));
+		if (path == nullptr) {
+			LOG_ERROR(L"Failed to create external path string.");
+			break;
+		}
+		napi_set_element(env, array, (uint32_t)i, path);
+	}
+	return array;
+}
+
+static const char* HashStatusName(HashStatus status) {
+	switch (status) {
+	case HashStatus::Done: return "done";
+	case HashStatus::Failed: return "failed";
+	case HashStatus::Cancelled: return "cancelled";
+	default: return "pending";
+	}
+}
+
+// 哈希结果数组，与 paths 按下标一一对应：{ size, mtime, digest, status }
+// 尚未取得元数据时 size、mtime 为 null；digest 为 16 位十六进制的 XXH64，未完成时为 null
+static napi_value NewFileArray(napi_env env, const std::shared_ptr<const HashJob>& hashes) {
+	napi_value array;
+	if (!hashes) {
+		napi_get_null(env, &array);
+		return array;
+	}
+	size_t count = hashes->Count();
+	if (napi_create_array_with_length(env, count, &array) != napi_ok) {
+		return nullptr;
+	}
+	napi_value null;
+	napi_get_null(env, &null);
+	for (size_t i = 0; i < count; i++) {
+		FileHashResult result = hashes->Get(i);
+		napi_value item;
+		napi_value size = null;
+		napi_value mtime = null;
+		napi_value digest = null;
+		napi_value status;
+		napi_create_object(env, &item);
+		if (result.status != HashStatus::Pending && result.mtime != 0.0) {
+			napi_create_double(env, (double)result.size, &size);
+			napi_create_double(env, result.mtime, &mtime);
+		}
+		if (result.status == HashStatus::Done) {
+			char hex[17];
+			snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)result.digest);
+			napi_create_string_latin1(env, hex, 16, &digest);
+		}
+		napi_create_string_latin1(env, HashStatusName(result.status), NAPI_AUTO_LENGTH, &status);
+		napi_set_named_property(env, item, "size", size);
+		napi_set_named_property(env, item, "mtime", mtime);
+		napi_set_named_property(env, item, "digest", digest);
+		napi_set_named_property(env, item, "status", status);
+		napi_set_element(env, array, (uint32_t)i, item);
+	}
+	return array;
+}
+
+AddonInstance::AddonInstance()
+	: m_bound(false), m_closed(false), m_fileDropCallback(nullptr), m_logCallback(nullptr),
+	m_dragFunction(nullptr), m_logFunction(nullptr),
+	m_dragWakePending(false), m_logWakePending(false), m_droppedEvents(0) {
+	for (int i = 0; i < kEventPropertyCount; i++) {
+		m_eventKeys[i] = nullptr;
+	}
+}
+
+AddonInstance* AddonInstance::Create(napi_env env) {
+	std::unique_ptr<AddonInstance> instance(new AddonInstance());
+
+#ifdef FILE_DROP_PROPERTY_KEYS
+	for (int i = 0; i < kEventPropertyCount; i++) {
+		napi_value key;
+		if (node_api_create_property_key_latin1(env, kEventKeyNames[i], NAPI_AUTO_LENGTH, &key) != napi_ok
+			|| napi_create_reference(env, key, 1, &instance->m_eventKeys[i]) != napi_ok) {
+			return nullptr;
+		}
+	}
+#endif
+
+	// 线程安全函数不绑定 JS 函数，回调通过引用在 call_js 中取得，替换回调时无需重建
+	napi_value dragName;
+	napi_value logName;
+	napi_create_string_utf8(env, "FileDropAware.drag", NAPI_AUTO_LENGTH, &dragName);
+	napi_create_string_utf8(env, "FileDropAware.log", NAPI_AUTO_LENGTH, &logName);
+	if (napi_create_threadsafe_function(env, nullptr, nullptr, dragName, 0, 1, nullptr, nullptr,
+		instance.get(), CallDragEventJs, &instance->m_dragFunction) != napi_ok) {
+		return nullptr;
+	}
+	if (napi_create_threadsafe_function(env, nullptr, nullptr, logName, 0, 1, nullptr, nullptr,
+		instance.get(), CallLogJs, &instance->m_logFunction) != napi_ok) {
+		napi_release_threadsafe_function(instance->m_dragFunction, napi_tsfn_abort);
+		return nullptr;
+	}
+	napi_unref_threadsafe_function(env, instance->m_dragFunction);
+	napi_unref_threadsafe_function(env, instance->m_logFunction);
+
+	if (napi_set_instance_data(env, instance.get(), Finalize, nullptr) != napi_ok) {
+		napi_release_threadsafe_function(instance->m_dragFunction, napi_tsfn_abort);
+		napi_release_threadsafe_function(instance->m_logFunction, napi_tsfn_abort);
+		return nullptr;
+	}
+	return instance.release();
+}
+
+AddonInstance* AddonInstance::Get(napi_env env) {
+	void* data = nullptr;
+	napi_get_instance_data(env, &data);
+	return static_cast<AddonInstance*>(data);
+}
+
+void AddonInstance::Finalize(napi_env env, void* data, void* hint) {
+	AddonInstance* instance = static_cast<AddonInstance*>(data);
+	instance->Close();
+	napi_delete_reference(env, instance->m_fileDropCallback);
+	napi_delete_reference(env, instance->m_logCallback);
+	for (int i = 0; i < kEventPropertyCount; i++) {
+		if (instance->m_eventKeys[i] != nullptr) {
+			napi_delete_reference(env, instance->m_eventKeys[i]);
+		}
+	}
+	delete instance;
+}
+
+void AddonInstance::ReplaceReference(napi_env env, napi_ref& reference, napi_value value) {
+	if (reference != nullptr) {
+		napi_delete_reference(env, reference);
+		reference = nullptr;
+	}
+	napi_create_reference(env, value, 1, &reference);
+}
+
+bool AddonInstance::Bind(napi_env env, napi_value fileDropCallback, napi_value logCallback) {
+	if (m_closed) {
+		napi_throw_error(env, nullptr, "当前环境正在退出");
+		return false;
+	}
+	ReplaceReference(env, m_fileDropCallback, fileDropCallback);
+	ReplaceReference(env, m_logCallback, logCallback);
+	if (!m_bound) {
+		// 绑定回调后开始监听，保持事件循环存活
+		napi_ref_threadsafe_function(env, m_dragFunction);
+		napi_ref_threadsafe_function(env, m_logFunction);
+		m_bound = true;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(g_logMutex);
+		g_logInstance.store(this);
+	}
+	Logger::SetNotify(NotifyLogAvailable);
+	// 绑定前已有的日志也一并投递
+	NotifyLogAvailable();
+	return true;
+}
+
+void AddonInstance::Close() {
+	if (m_closed) {
+		return;
+	}
+	m_closed = true;
+	{
+		std::lock_guard<std::mutex> lock(g_logMutex);
+		AddonInstance* expected = this;
+		g_logInstance.compare_exchange_strong(expected, nullptr);
+		// 即使已被其它实例接管，也可能有线程在接管前读到了本实例，同样需要等待
+		unsigned epoch = g_logEpoch.fetch_add(1);
+		while (g_logNotifiers[epoch & 1].load() != 0) {
+			std::this_thread::yield();
+		}
+	}
+	// abort 之后的 napi_call_threadsafe_function 返回 napi_closing，队列中未执行的调用以 env 为空的形式执行
+	napi_release_threadsafe_function(m_dragFunction, napi_tsfn_abort);
+	napi_release_threadsafe_function(m_logFunction, napi_tsfn_abort);
+}
+
+void AddonInstance::Wake(napi_threadsafe_function function, std::atomic<bool>& pending) {
+	if (pending.exchange(true, std::memory_order_acq_rel)) {
+		return;
+	}
+	napi_status status = napi_call_threadsafe_function(function, nullptr, napi_tsfn_nonblocking);
+	if (status != napi_ok && status != napi_queue_full) {
+		pending.store(false, std::memory_order_release);
+	}
+}
+
+void AddonInstance::OnDragEvent(void* context, const DragEvent& event) {
+	AddonInstance* instance = static_cast<AddonInstance*>(context);
+	// 队列已满说明 JS 线程处理不过来，丢弃事件而不是阻塞钩子线程
+	if (!instance->m_events.Push(event)) {
+		instance->m_droppedEvents.fetch_add(1, std::memory_order_relaxed);
+		LOG_ERROR(L"Drag event queue is full, event dropped.");
+		return;
+	}
+	Wake(instance->m_dragFunction, instance->m_dragWakePending);
+}
+
+napi_value AddonInstance::NewEventObject(napi_env env, const DragEvent& event) {
+	napi_value object;
+	if (napi_create_object(env, &object) != napi_ok) {
+		return nullptr;
+	}
+	napi_value values[kEventPropertyCount];
+	napi_create_int32(env, (int32_t)event.kind, &values[kEventKind]);
+	napi_create_double(env, PipelineStats::TicksToMillis(event.ticks), &values[kEventTimestamp]);
+	napi_create_int32(env, event.x, &values[kEventX]);
+	napi_create_int32(env, event.y, &values[kEventY]);
+	napi_create_int32(env, (int32_t)event.shell, &values[kEventShell]);
+	napi_create_int32(env, (int32_t)event.matchCount, &values[kEventMatchCount]);
+	values[kEventPaths] = NewPathArray(env, event.paths);
+	values[kEventFiles] = NewFileArray(env, event.hashes);
+	if (values[kEventPaths] == nullptr || values[kEventFiles] == nullptr) {
+		return nullptr;
+	}
+
+	// 一次定义所有属性，属性名都是内部化字符串，同一批对象按相同顺序定义以共享隐藏类
+	napi_property_descriptor properties[kEventPropertyCount];
+	for (int i = 0; i < kEventPropertyCount; i++) {
+		properties[i] = { kEventKeyNames[i], nullptr, nullptr, nullptr, nullptr, values[i],
+			(napi_property_attributes)(napi_writable | napi_enumerable | napi_configurable), nullptr };
+#ifdef FILE_DROP_PROPERTY_KEYS
+		properties[i].utf8name = nullptr;
+		napi_get_reference_value(env, m_eventKeys[i], &properties[i].name);
+#endif
+	}
+	if (napi_define_properties(env, object, kEventPropertyCount, properties) != napi_ok) {
+		return nullptr;
+	}
+	return object;
+}
+
+// 在 JS 线程上执行，一次唤醒最多投递 kMaxEventBatch 个事件，每个事件调用一次回调
+void AddonInstance::CallDragEventJs(napi_env env, napi_value unused, void* context, void* data) {
+	AddonInstance* instance = static_cast<AddonInstance*>(context);
+	// 环境正在销毁，队列中的事件随实例一起释放
+	if (env == nullptr) {
+		return;
+	}
+	// 先清除标记再取事件，之后写入的事件会触发新的唤醒
+	instance->m_dragWakePending.store(false, std::memory_order_release);
+
+	size_t delivered = 0;
+	DragEvent event;
+	while (delivered < kMaxEventBatch && instance->m_events.Pop(event)) {
+		delivered++;
+		napi_handle_scope scope;
+		if (napi_open_handle_scope(env, &scope) != napi_ok) {
+			break;
+		}
+		napi_value object = instance->NewEventObject(env, event);
+		if (object == nullptr) {
+			LOG_ERROR(L"Failed to create drag event object.");
+		}
+		else {
+			int64_t callTicks = PipelineStats::Now();
+			PipelineStats::Record(PipelineStage::Delivery, event.ticks, callTicks);
+			PipelineStats::Record(PipelineStage::EndToEnd, event.originTicks, callTicks);
+			if (!CallFunction(env, instance->m_fileDropCallback, object)) {
+				LOG_ERROR(L"File drop callback threw an exception.");
+			}
+			PipelineStats::Record(PipelineStage::Callback, callTicks, PipelineStats::Now());
+		}
+		napi_close_handle_scope(env, scope);
+		event.paths.reset();
+		event.hashes.reset();
+	}
+
+	// 本批已满，让出事件循环，剩余事件在下一次唤醒时投递
+	if (!instance->m_events.Empty()) {
+		Wake(instance->m_dragFunction, instance->m_dragWakePending);
+	}
+}
+
+struct LogBatch {
+	napi_env env;
+	napi_value records;
+	uint32_t count;
+};
+
+static void SetProperty(napi_env env, napi_value object, const char* name, napi_value value) {
+	napi_set_named_property(env, object, name, value);
+}
+
+static void AppendLogRecord(void* batchPtr, const LogRecord& record) {
+	LogBatch* batch = static_cast<LogBatch*>(batchPtr);
+	napi_env env = batch->env;
+	napi_value item;
+	napi_value level;
+	napi_value timestamp;
+	napi_value message;
+	napi_create_object(env, &item);
+	napi_create_string_utf8(env, LogLevelName(record.level), NAPI_AUTO_LENGTH, &level);
+	napi_create_double(env, (double)record.timestamp, &timestamp);
+	napi_create_string_utf8(env, record.text, record.length, &message);
+	SetProperty(env, item, "level", level);
+	SetProperty(env, item, "timestamp", timestamp);
+	SetProperty(env, item, "message", message);
+	napi_set_element(env, batch->records, batch->count++, item);
+}
+
+// 在 JS 线程上执行，一次唤醒只调用一次 JS 日志回调
+void AddonInstance::CallLogJs(napi_env env, napi_value unused, void* context, void* data) {
+	AddonInstance* instance = static_cast<AddonInstance*>(context);
+	if (env == nullptr) {
+		return;
+	}
+	instance->m_logWakePending.store(false, std::memory_order_release);
+	// 其它实例已接管日志，由它负责取出
+	if (g_logInstance.load(std::memory_order_acquire) != instance) {
+		return;
+	}
+
+	LogBatch batch = { env, nullptr, 0 };
+	if (napi_create_array(env, &batch.records) != napi_ok) {
+		return;
+	}
+	unsigned long long dropped = Logger::TakeDroppedCount();
+	if (dropped > 0) {
+		std::string text = "Log queue is full, " + std::to_string(dropped) + " records dropped.";
+		LogRecord record;
+		record.level = LogLevel::Error;
+		record.timestamp = 0;
+		record.length = (uint32_t)text.copy(record.text, LogRecord::kMaxText);
+		AppendLogRecord(&batch, record);
+	}
+	size_t drained = Logger::Drain(AppendLogRecord, &batch, kMaxLogBatch);
+	if (batch.count == 0) {
+		return;
+	}
+
+	if (!CallFunction(env, instance->m_logCallback, batch.records)) {
+		fprintf(stderr, "log callback threw an exception\n");
+	}
+
+	// 本批已满，说明队列里可能还有日志，再唤醒一次，避免长时间占用事件循环
+	if (drained == kMaxLogBatch) {
+		NotifyLogAvailable();
+	}
+}
+
+// Logger 的通知函数，可在任意线程执行
+void AddonInstance::NotifyLogAvailable() {
+	// 先登记到当前分组再确认分组未切换，否则解绑方可能已经错过这次登记，重新登记
+	unsigned epoch;
+	for (;;) {
+		epoch = g_logEpoch.load();
+		g_logNotifiers[epoch & 1].fetch_add(1);
+		if (g_logEpoch.load() == epoch) {
+			break;
+		}
+		g_logNotifiers[epoch & 1].fetch_sub(1);
+	}
+	AddonInstance* instance = g_logInstance.load();
+	if (instance != nullptr) {
+		Wake(instance->m_logFunction, instance->m_logWakePending);
+	}
+	g_logNotifiers[epoch & 1].fetch_sub(1, std::memory_order_release);
+}
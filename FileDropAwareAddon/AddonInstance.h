@@ -0,0 +1,73 @@
+﻿#pragma once
+#include <node_api.h>
+#include <atomic>
+#include <string>
+#include "DragEvents.h"
+#include "SpscRing.h"
+
+// 每个 JS 环境（主线程、worker_threads 或独立的 Context）一个实例，通过 napi_set_instance_data 关联，
+// 不再使用全局的 Isolate 和 Persistent 句柄
+// 事件由钩子线程写入有界队列，再通过 napi_threadsafe_function 唤醒 JS 线程批量取出：
+// 队列满时丢弃并计数，钩子线程永远不会等待 JS；每次唤醒最多投递一批，剩余的在下一次唤醒时继续
+class AddonInstance
+{
+public:
+	// 模块加载时创建，两个线程安全函数在绑定回调前不会阻止事件循环退出
+	static AddonInstance* Create(napi_env env);
+	static AddonInstance* Get(napi_env env);
+
+	// 绑定文件拖拽回调和日志回调，可重复调用以替换回调；返回 false 时已抛出 JS 异常
+	bool Bind(napi_env env, napi_value fileDropCallback, napi_value logCallback);
+	bool IsBound() const { return m_bound; }
+	// 环境销毁时调用：停止接收日志并释放线程安全函数，之后不会再调用 JS
+	void Close();
+
+	// 拖拽事件的接收方 (DragEventSink)，在钩子线程上调用
+	static void OnDragEvent(void* context, const DragEvent& event);
+	// 队列已满而丢弃的拖拽事件数量
+	unsigned long long DroppedEvents() const { return m_droppedEvents.load(std::memory_order_relaxed); }
+
+	// StartRecording 指定的录制文件路径，StopRecording 时写入
+	std::wstring& RecordingPath() { return m_recordingPath; }
+
+private:
+	enum EventProperty {
+		kEventKind,
+		kEventTimestamp,
+		kEventX,
+		kEventY,
+		kEventShell,
+		kEventMatchCount,
+		kEventPaths,
+		kEventFiles,
+		kEventPropertyCount,
+	};
+
+	AddonInstance();
+	static void Finalize(napi_env env, void* data, void* hint);
+	static void CallDragEventJs(napi_env env, napi_value unused, void* context, void* data);
+	static void CallLogJs(napi_env env, napi_value unused, void* context, void* data);
+	static void NotifyLogAvailable();
+	// 唤醒 JS 线程，已有未处理的唤醒时不重复发送
+	static void Wake(napi_threadsafe_function function, std::atomic<bool>& pending);
+	static void ReplaceReference(napi_env env, napi_ref& reference, napi_value value);
+	napi_value NewEventObject(napi_env env, const DragEvent& event);
+
+private:
+	bool m_bound;
+	bool m_closed;
+	napi_ref m_fileDropCallback;
+	napi_ref m_logCallback;
+	// 事件对象的属性名，只创建一次；Node-API 10 以下不能引用字符串，保持为空
+	napi_ref m_eventKeys[kEventPropertyCount];
+	napi_threadsafe_function m_dragFunction;
+	napi_threadsafe_function m_logFunction;
+
+	// 钩子线程生产、JS 线程消费
+	SpscRing<DragEvent, 256> m_events;
+	std::atomic<bool> m_dragWakePending;
+	std::atomic<bool> m_logWakePending;
+	std::atomic<unsigned long long> m_droppedEvents;
+
+	std::wstring m_recordingPath;
+};
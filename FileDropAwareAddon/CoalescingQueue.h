@@ -0,0 +1,52 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+// 只关心最新请求的有界队列：超出 Capacity 时淘汰最旧的请求，取出时积压的请求合并为最新的一条，
+// 被淘汰或合并的请求计入 CoalescedCount；唤醒消费者由调用方负责（例如 Windows 事件或条件变量）
+template <typename T, size_t Capacity>
+class CoalescingQueue
+{
+	static_assert(Capacity >= 1, "Capacity must be at least one");
+public:
+	CoalescingQueue() : m_coalesced(0) {}
+	CoalescingQueue(const CoalescingQueue&) = delete;
+	CoalescingQueue& operator=(const CoalescingQueue&) = delete;
+
+	void Push(const T& item) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_items.size() >= Capacity) {
+			m_items.pop_front();
+			m_coalesced.fetch_add(1, std::memory_order_relaxed);
+		}
+		m_items.push_back(item);
+	}
+
+	// 取出最新的请求，其余积压请求合并丢弃；队列为空时返回 false
+	bool TakeLatest(T& item) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_items.empty()) {
+			return false;
+		}
+		item = m_items.back();
+		m_coalesced.fetch_add(m_items.size() - 1, std::memory_order_relaxed);
+		m_items.clear();
+		return true;
+	}
+
+	void Clear() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_items.clear();
+	}
+
+	unsigned long long CoalescedCount() const {
+		return m_coalesced.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::mutex m_mutex;
+	std::deque<T> m_items;
+	std::atomic<unsigned long long> m_coalesced;
+};
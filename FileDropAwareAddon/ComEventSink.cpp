@@ -0,0 +1,51 @@
+﻿#include "ComEventSink.h"
+
+ComEventSink::ComEventSink(REFIID eventsIid, Handler handler, void* context)
+	: m_refCount(1), m_eventsIid(eventsIid), m_handler(handler), m_context(context) {}
+
+void ComEventSink::Detach() {
+	m_handler = NULL;
+	m_context = NULL;
+}
+
+STDMETHODIMP ComEventSink::QueryInterface(REFIID riid, void** ppv) {
+	if (ppv == NULL) return E_POINTER;
+	if (riid == IID_IUnknown || riid == IID_IDispatch || riid == m_eventsIid) {
+		*ppv = static_cast<IDispatch*>(this);
+		AddRef();
+		return S_OK;
+	}
+	*ppv = NULL;
+	return E_NOINTERFACE;
+}
+
+STDMETHODIMP_(ULONG) ComEventSink::AddRef() {
+	return InterlockedIncrement(&m_refCount);
+}
+
+STDMETHODIMP_(ULONG) ComEventSink::Release() {
+	ULONG count = InterlockedDecrement(&m_refCount);
+	if (count == 0) delete this;
+	return count;
+}
+
+STDMETHODIMP ComEventSink::GetTypeInfoCount(UINT* pctinfo) {
+	if (pctinfo) *pctinfo = 0;
+	return S_OK;
+}
+
+STDMETHODIMP ComEventSink::GetTypeInfo(UINT, LCID, ITypeInfo**) {
+	return E_NOTIMPL;
+}
+
+STDMETHODIMP ComEventSink::GetIDsOfNames(REFIID, LPOLESTR*, UINT, LCID, DISPID*) {
+	return E_NOTIMPL;
+}
+
+STDMETHODIMP ComEventSink::Invoke(DISPID dispIdMember, REFIID, LCID, WORD,
+	DISPPARAMS*, VARIANT*, EXCEPINFO*, UINT*) {
+	if (m_handler != NULL) {
+		m_handler(m_context, dispIdMember);
+	}
+	return S_OK;
+}
@@ -0,0 +1,31 @@
+﻿#pragma once
+#include <windows.h>
+#include <oaidl.h>
+
+// 通用的 COM 事件接收器（dispinterface），收到事件后转发给处理函数
+// 通过 AtlAdvise 连接；断开后调用 Detach，避免迟到的回调访问已释放的对象
+class ComEventSink : public IDispatch
+{
+public:
+	typedef void (*Handler)(void* context, DISPID dispId);
+
+	ComEventSink(REFIID eventsIid, Handler handler, void* context);
+
+	void Detach();
+
+	STDMETHODIMP QueryInterface(REFIID riid, void** ppv) override;
+	STDMETHODIMP_(ULONG) AddRef() override;
+	STDMETHODIMP_(ULONG) Release() override;
+	STDMETHODIMP GetTypeInfoCount(UINT* pctinfo) override;
+	STDMETHODIMP GetTypeInfo(UINT iTInfo, LCID lcid, ITypeInfo** ppTInfo) override;
+	STDMETHODIMP GetIDsOfNames(REFIID riid, LPOLESTR* rgszNames, UINT cNames, LCID lcid, DISPID* rgDispId) override;
+	STDMETHODIMP Invoke(DISPID dispIdMember, REFIID riid, LCID lcid, WORD wFlags,
+		DISPPARAMS* pDispParams, VARIANT* pVarResult, EXCEPINFO* pExcepInfo, UINT* puArgErr) override;
+private:
+	~ComEventSink() {}
+private:
+	ULONG m_refCount;
+	IID m_eventsIid;
+	Handler m_handler;
+	void* m_context;
+};
@@ -0,0 +1,258 @@
+﻿#include "ContentSniffer.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+// 一次 VerifyAll 提交的文件，由调用线程和线程池共同持有；调用线程超时返回后，线程池仍可能在读取
+struct SniffBatch {
+	std::vector<std::wstring> paths;
+	std::unique_ptr<std::atomic<uint8_t>[]> results;
+	// 下一个待领取的下标
+	std::atomic<size_t> next;
+	// 已完成（或被跳过）的项数，受 g_poolMutex 保护
+	size_t done;
+	// 调用线程已超时返回或线程池正在停止，尚未开始的项直接跳过，等待方随之返回
+	std::atomic<bool> abandoned;
+};
+
+struct SniffCacheEntry {
+	std::wstring path;
+	FileStamp stamp;
+	FileKind kind;
+};
+
+static std::mutex g_poolMutex;
+static std::condition_variable g_workAvailable;
+static std::condition_variable g_batchDone;
+static std::deque<std::shared_ptr<SniffBatch>> g_queue;
+// 线程对象只在 join 之后释放：停止超时时线程可能仍卡在 IO 上，进程退出时不能析构可 join 的 std::thread
+static std::vector<std::thread*> g_threads;
+// RequestStop 置位，Stop join 所有线程后复位
+static bool g_stopping = false;
+
+// LRU 缓存：链表头部为最近使用的条目
+static std::mutex g_cacheMutex;
+static std::list<SniffCacheEntry> g_cacheOrder;
+static std::unordered_map<std::wstring, std::list<SniffCacheEntry>::iterator> g_cacheIndex;
+
+static std::atomic<unsigned long long> g_cacheHits(0);
+static std::atomic<unsigned long long> g_cacheMisses(0);
+static std::atomic<unsigned long long> g_rejected(0);
+static std::atomic<unsigned long long> g_timedOut(0);
+
+// 文件读取以等待 IO 为主，少量线程即可，避免同时读取大量网络路径
+static unsigned PoolSize() {
+	unsigned count = std::thread::hardware_concurrency() / 2;
+	return count < 2 ? 2 : (count > 4 ? 4 : count);
+}
+
+bool ContentSniffer::LookupKind(const std::wstring& path, const FileStamp& stamp, FileKind& kind) {
+	std::lock_guard<std::mutex> lock(g_cacheMutex);
+	auto it = g_cacheIndex.find(path);
+	if (it == g_cacheIndex.end()) {
+		return false;
+	}
+	if (it->second->stamp != stamp) {
+		// 文件已被修改，旧结果作废
+		g_cacheOrder.erase(it->second);
+		g_cacheIndex.erase(it);
+		return false;
+	}
+	g_cacheOrder.splice(g_cacheOrder.begin(), g_cacheOrder, it->second);
+	kind = it->second->kind;
+	return true;
+}
+
+void ContentSniffer::StoreKind(const std::wstring& path, const FileStamp& stamp, FileKind kind) {
+	std::lock_guard<std::mutex> lock(g_cacheMutex);
+	auto it = g_cacheIndex.find(path);
+	if (it != g_cacheIndex.end()) {
+		it->second->stamp = stamp;
+		it->second->kind = kind;
+		g_cacheOrder.splice(g_cacheOrder.begin(), g_cacheOrder, it->second);
+		return;
+	}
+	if (g_cacheOrder.size() >= kCacheCapacity) {
+		g_cacheIndex.erase(g_cacheOrder.back().path);
+		g_cacheOrder.pop_back();
+	}
+	g_cacheOrder.push_front(SniffCacheEntry{ path, stamp, kind });
+	g_cacheIndex.emplace(path, g_cacheOrder.begin());
+}
+
+void ContentSniffer::ClearCache() {
+	std::lock_guard<std::mutex> lock(g_cacheMutex);
+	g_cacheIndex.clear();
+	g_cacheOrder.clear();
+}
+
+SniffResult ContentSniffer::Verify(const std::wstring& path) {
+	// 没有已知特征的扩展名不需要读取文件
+	uint32_t expected = SignatureTable::ExpectedKinds(path.c_str(), path.size());
+	if (expected == 0) {
+		return SniffResult::Accepted;
+	}
+	// 无法读取的文件、仅联机文件和空文件（例如刚新建的文档）没有可比较的内容，按扩展名结果处理
+	FileStamp stamp;
+	bool offline = false;
+	if (!MappedFile::Stat(path, stamp, offline) || offline || stamp.size == 0) {
+		return SniffResult::Accepted;
+	}
+
+	FileKind kind = FileKind::Unknown;
+	if (LookupKind(path, stamp, kind)) {
+		g_cacheHits++;
+	}
+	else {
+		g_cacheMisses++;
+		MappedFile reader;
+		if (!reader.Open(path) || !reader.Map(0, SignatureTable::kHeaderBytes)) {
+			return SniffResult::Accepted;
+		}
+		kind = SignatureTable::Instance().Identify(reader.Data(), reader.Size());
+		// 以打开后读到的元数据为准，Stat 之后文件可能又被修改
+		StoreKind(path, reader.Stamp(), kind);
+	}
+
+	if (SignatureTable::Accepts(expected, kind)) {
+		return SniffResult::Accepted;
+	}
+	g_rejected++;
+	return SniffResult::Rejected;
+}
+
+void ContentSniffer::WorkerProc() {
+	std::unique_lock<std::mutex> lock(g_poolMutex);
+	for (;;) {
+		g_workAvailable.wait(lock, []() { return g_stopping || !g_queue.empty(); });
+		if (g_stopping) {
+			break;
+		}
+		std::shared_ptr<SniffBatch> batch = g_queue.front();
+		size_t index = batch->next.fetch_add(1);
+		if (index >= batch->paths.size()) {
+			// 这一批已全部领取，让出队首
+			if (!g_queue.empty() && g_queue.front() == batch) {
+				g_queue.pop_front();
+			}
+			continue;
+		}
+
+		lock.unlock();
+		if (!batch->abandoned.load(std::memory_order_acquire)) {
+			SniffResult result = SniffResult::Accepted;
+			try {
+				result = Verify(batch->paths[index]);
+			}
+			catch (...) {
+			}
+			batch->results[index].store((uint8_t)result, std::memory_order_release);
+		}
+		lock.lock();
+
+		if (++batch->done == batch->paths.size()) {
+			g_batchDone.notify_all();
+		}
+	}
+}
+
+bool ContentSniffer::VerifyAll(std::vector<std::wstring> paths, unsigned long maxMillis, std::vector<SniffResult>& results) {
+	results.assign(paths.size(), SniffResult::Pending);
+	if (paths.empty()) {
+		return true;
+	}
+
+	std::shared_ptr<SniffBatch> batch = std::make_shared<SniffBatch>();
+	size_t count = paths.size();
+	batch->paths = std::move(paths);
+	batch->results.reset(new std::atomic<uint8_t>[count]);
+	for (size_t i = 0; i < count; i++) {
+		batch->results[i].store((uint8_t)SniffResult::Pending, std::memory_order_relaxed);
+	}
+	batch->next = 0;
+	batch->done = 0;
+	batch->abandoned = false;
+
+	// 调用线程不做 IO，只等待结果，单个文件读取缓慢（例如网络路径）也不会拖过截止时间
+	bool finished;
+	{
+		std::unique_lock<std::mutex> lock(g_poolMutex);
+		if (g_stopping) {
+			return false;
+		}
+		if (g_threads.empty()) {
+			unsigned threads = PoolSize();
+			for (unsigned i = 0; i < threads; i++) {
+				g_threads.push_back(new std::thread(WorkerProc));
+			}
+		}
+		g_queue.push_back(batch);
+		g_workAvailable.notify_all();
+
+		// Stop 清空队列时把排队的批次标记为放弃，未领取的项不会再计入 done，这里以批次自身的标记为准；
+		// 不能看 g_stopping，Stop 在 join 之后会把它复位，等待方可能错过这段时间
+		auto isDone = [&batch]() { return batch->abandoned.load(std::memory_order_acquire) || batch->done == batch->paths.size(); };
+		if (maxMillis == 0) {
+			g_batchDone.wait(lock, isDone);
+		}
+		else {
+			g_batchDone.wait_for(lock, std::chrono::milliseconds(maxMillis), isDone);
+		}
+		finished = batch->done == batch->paths.size();
+		if (!finished) {
+			batch->abandoned.store(true, std::memory_order_release);
+		}
+	}
+
+	size_t pending = 0;
+	for (size_t i = 0; i < count; i++) {
+		results[i] = (SniffResult)batch->results[i].load(std::memory_order_acquire);
+		if (results[i] == SniffResult::Pending) pending++;
+	}
+	g_timedOut += pending;
+	return pending == 0;
+}
+
+void ContentSniffer::RequestStop() {
+	{
+		std::lock_guard<std::mutex> lock(g_poolMutex);
+		g_stopping = true;
+		// 在锁内标记，等待方检查谓词时一定能看到
+		for (const std::shared_ptr<SniffBatch>& batch : g_queue) {
+			batch->abandoned.store(true, std::memory_order_release);
+		}
+		g_queue.clear();
+	}
+	g_workAvailable.notify_all();
+	g_batchDone.notify_all();
+}
+
+void ContentSniffer::Stop() {
+	RequestStop();
+	std::vector<std::thread*> threads;
+	{
+		std::lock_guard<std::mutex> lock(g_poolMutex);
+		threads.swap(g_threads);
+	}
+	for (std::thread* thread : threads) {
+		thread->join();
+		delete thread;
+	}
+	std::lock_guard<std::mutex> lock(g_poolMutex);
+	g_stopping = false;
+}
+
+SniffStats ContentSniffer::GetStats() {
+	SniffStats stats;
+	stats.cacheHits = g_cacheHits.load();
+	stats.cacheMisses = g_cacheMisses.load();
+	stats.rejected = g_rejected.load();
+	stats.timedOut = g_timedOut.load();
+	return stats;
+}
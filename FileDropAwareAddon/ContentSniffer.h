@@ -0,0 +1,53 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "FileSignature.h"
+#include "MappedFile.h"
+
+// 单个文件的内容校验结果
+enum class SniffResult : uint8_t {
+	// 截止时间前未完成
+	Pending,
+	// 文件头与扩展名相符，或扩展名没有已知特征、文件无法读取（按扩展名结果处理）
+	Accepted,
+	// 文件头与扩展名不符，例如改名为 .pdf 的可执行文件
+	Rejected,
+};
+
+struct SniffStats {
+	unsigned long long cacheHits;
+	unsigned long long cacheMisses;
+	unsigned long long rejected;
+	// 因截止时间被放弃的文件数
+	unsigned long long timedOut;
+};
+
+// 按文件头校验候选文件的内容类型
+// 每个文件只映射开头 SignatureTable::kHeaderBytes 字节；识别结果按 (路径, 大小, 修改时间) 缓存，文件变化后自动失效
+// 读取在一个小的 IO 线程池上进行，调用线程只等待结果，超过截止时间后立即返回，
+// 尚未开始的文件被跳过，正在读取的文件完成后仍会写入缓存，供下一次拖拽使用
+class ContentSniffer
+{
+public:
+	// 缓存的文件数上限，超出时淘汰最久未使用的条目
+	static const size_t kCacheCapacity = 4096;
+
+	// 校验 paths，results[i] 对应 paths[i]；maxMillis 为 0 表示不限时
+	// 全部完成返回 true，超时返回 false（未完成的项为 Pending）
+	// 线程池在第一次调用时启动
+	static bool VerifyAll(std::vector<std::wstring> paths, unsigned long maxMillis, std::vector<SniffResult>& results);
+	// 在调用线程上同步校验单个文件
+	static SniffResult Verify(const std::wstring& path);
+	// 请求线程池停止：放弃排队的文件并唤醒等待方，不等待线程退出；之后的 VerifyAll 直接返回，直到 Stop 完成
+	static void RequestStop();
+	// 停止线程池并等待正在读取的文件完成，可重复调用
+	static void Stop();
+	static void ClearCache();
+	static SniffStats GetStats();
+private:
+	static void WorkerProc();
+	static bool LookupKind(const std::wstring& path, const FileStamp& stamp, FileKind& kind);
+	static void StoreKind(const std::wstring& path, const FileStamp& stamp, FileKind kind);
+};
@@ -0,0 +1,80 @@
+﻿#pragma once
+#include <cstdint>
+#include <memory>
+
+class MatchRules;
+class MatchedPaths;
+struct SelectionMatch;
+
+// 与平台无关的窗口句柄，Windows 后端中即 HWND，0 表示没有窗口
+typedef uintptr_t DesktopWindow;
+
+// 屏幕坐标
+struct DesktopPoint {
+	int32_t x;
+	int32_t y;
+};
+
+// 一次祖先链遍历的结果
+struct WindowAncestry {
+	// Explorer 主窗口或桌面窗口，未找到时为 0
+	DesktopWindow shellWindow;
+	bool isDesktop;
+	// 鼠标是否位于文件显示区域
+	bool isContentArea;
+};
+
+// 选中项扫描结果
+enum class ScanVerdict {
+	NoMatch,
+	Match,
+	// 超出扫描预算仍未找到匹配项，无法给出结论
+	Inconclusive,
+};
+
+// 单次扫描的预算，任一项为 0 表示不限制
+struct ScanBudget {
+	long maxItems;
+	unsigned long maxMillis;
+};
+
+// 单次选中项扫描的统计
+struct SelectionScanSummary {
+	// 实际检查的项数
+	long scanned;
+	// 已检查的项中匹配的文件数
+	long matched;
+	// 是否因预算耗尽而提前结束，此时 matched 只是下限
+	bool truncated;
+};
+
+// 后端解析出的文件视图（Explorer 窗口或桌面），具体内容由后端决定
+class DesktopView
+{
+public:
+	virtual ~DesktopView() {}
+};
+
+// FileDetector 依赖的桌面接口：窗口查找与分类、UIA 命中测试、Shell 窗口查找和选中项查询
+// Windows 上由 Win32DesktopBackend 实现；SimulatedDesktop 提供可配置的模拟桌面，
+// 便于在没有真实桌面的环境中端到端地运行检测流程
+// 每个检测线程使用自己的后端实例，所有方法只在该线程上调用
+class IDesktopBackend
+{
+public:
+	virtual ~IDesktopBackend() {}
+	// 鼠标位置下的窗口
+	virtual DesktopWindow WindowFromPoint(const DesktopPoint& pt) = 0;
+	// 沿祖先链找出 Shell 父窗口并判定是否位于文件显示区域
+	virtual void Classify(DesktopWindow window, WindowAncestry& ancestry) = 0;
+	// 鼠标是否位于文件视图中的某个文件项上（桌面不做此检查）
+	virtual bool IsOverFileItem(const DesktopPoint& pt) = 0;
+	// 查找 Shell 窗口对应的文件视图，未找到返回空
+	virtual std::shared_ptr<DesktopView> FindView(DesktopWindow shellWindow, bool isDesktop) = 0;
+	// 选中项结果缓存，选中项变化后由后端自行失效；rulesVersion 不一致视为未命中
+	virtual bool LookupSelection(DesktopView& view, unsigned int rulesVersion, SelectionMatch& match) = 0;
+	virtual void StoreSelection(DesktopView& view, unsigned int rulesVersion, const SelectionMatch& match) = 0;
+	// 在预算内扫描选中项，paths 不为空时收集匹配文件的路径
+	virtual ScanVerdict ScanSelection(DesktopView& view, const MatchRules& matcher, const ScanBudget& budget,
+		MatchedPaths* paths, SelectionScanSummary& summary) = 0;
+};
@@ -0,0 +1,219 @@
+﻿#include "DetectorWorker.h"
+#include "FileDetector.h"
+#include "Win32DesktopBackend.h"
+#include "MouseHook.h"
+#include "Logger.h"
+#include "PipelineStats.h"
+#include "CoalescingQueue.h"
+#include <string>
+#include <thread>
+
+// 队列上限：检测只关心最新的拖拽，超出时淘汰最旧的请求
+static const size_t kMaxPendingRequests = 8;
+
+// 与钩子线程相同，join 后才释放：卡在 COM 调用上的检测线程在进程退出时不会触发 std::terminate
+static std::thread*		g_workerThread		= NULL;
+static DWORD			g_notifyThreadId	= 0;
+static HANDLE			g_requestEvent		= NULL;
+static std::atomic<bool> g_stopRequested(false);
+static CoalescingQueue<DetectRequest, kMaxPendingRequests> g_pendingRequests;
+static std::atomic<unsigned long long> g_speculationUsed(0);
+static std::atomic<unsigned long long> g_speculationWasted(0);
+
+// 最近一次预测的结果，只在检测线程访问
+struct Speculation {
+	bool pending;
+	unsigned long long sequence;
+	// 起点是否位于文件视图中的文件项上
+	bool resolved;
+	DragTarget target;
+};
+static Speculation g_speculation = { false, 0, false };
+
+
+bool DetectorWorker::Start(DWORD notifyThreadId) {
+	if (g_workerThread != NULL) {
+		return true;
+	}
+	g_notifyThreadId = notifyThreadId;
+	g_stopRequested = false;
+	// 自动重置事件，Submit 时置位
+	g_requestEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+	if (g_requestEvent == NULL) {
+		LOG_ERROR(L"Failed to create detector event! Error: " + std::to_wstring(GetLastError()));
+		return false;
+	}
+	g_workerThread = new std::thread(WorkerProc);
+	return true;
+}
+
+void DetectorWorker::Stop() {
+	if (g_workerThread == NULL) {
+		return;
+	}
+	g_stopRequested = true;
+	SetEvent(g_requestEvent);
+	g_workerThread->join();
+	delete g_workerThread;
+	g_workerThread = NULL;
+
+	CloseHandle(g_requestEvent);
+	g_requestEvent = NULL;
+
+	g_pendingRequests.Clear();
+}
+
+void DetectorWorker::Submit(const DetectRequest& request) {
+	DetectRequest queued = request;
+	queued.submitTicks = PipelineStats::Now();
+	g_pendingRequests.Push(queued);
+	SetEvent(g_requestEvent);
+}
+
+unsigned long long DetectorWorker::CoalescedCount() {
+	return g_pendingRequests.CoalescedCount();
+}
+
+SpeculationStats DetectorWorker::GetSpeculationStats() {
+	return {
+		g_speculationUsed.load(std::memory_order_relaxed),
+		g_speculationWasted.load(std::memory_order_relaxed)
+	};
+}
+
+static void PumpPendingMessages() {
+	MSG msg;
+	while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+	{
+		TranslateMessage(&msg);
+		DispatchMessage(&msg);
+	}
+}
+
+static DesktopPoint ToDesktopPoint(const POINT& pt) {
+	return { (int32_t)pt.x, (int32_t)pt.y };
+}
+
+// 丢弃尚未使用的预测结果
+static void DiscardSpeculation() {
+	if (g_speculation.pending) {
+		g_speculationWasted++;
+	}
+	g_speculation.pending = false;
+	g_speculation.resolved = false;
+	g_speculation.target.view.reset();
+}
+
+void DetectorWorker::Process(const DetectRequest& request) {
+	switch (request.kind)
+	{
+	case DetectRequestKind::Prefetch:
+	{
+		DiscardSpeculation();
+		g_speculation.pending = true;
+		g_speculation.sequence = request.sequence;
+		g_speculation.resolved = FileDetector::ResolveDragTarget(ToDesktopPoint(request.pt), g_speculation.target);
+		break;
+	}
+	case DetectRequestKind::Cancel:
+	{
+		if (g_speculation.sequence == request.sequence) {
+			DiscardSpeculation();
+		}
+		break;
+	}
+	case DetectRequestKind::Check:
+	{
+		LONGLONG startTicks = PipelineStats::Now();
+		PipelineStats::Record(PipelineStage::DetectorQueue, request.submitTicks, startTicks);
+		ScanVerdict verdict = ScanVerdict::NoMatch;
+		SelectionMatch match = { 0 };
+		bool isDesktop = false;
+		if (g_speculation.pending && g_speculation.sequence == request.sequence)
+		{
+			// 起点已在按下左键时解析完成，只需查询选中项
+			g_speculationUsed++;
+			g_speculation.pending = false;
+			if (g_speculation.resolved) {
+				verdict = FileDetector::IsDraggingSupportedFile(g_speculation.target, match);
+				isDesktop = g_speculation.target.isDesktop;
+			}
+			g_speculation.target.view.reset();
+		}
+		else
+		{
+			DiscardSpeculation();
+			DragTarget target;
+			verdict = FileDetector::IsDraggingSupportedFile(ToDesktopPoint(request.pt), target, match);
+			isDesktop = target.isDesktop;
+		}
+
+		UINT message = 0;
+		if (verdict == ScanVerdict::Match)
+		{
+			// 检测成功，通知钩子线程，由钩子线程写入事件队列
+			message = WM_DRAG_CHECK_SUCCESS;
+		}
+		else if (verdict == ScanVerdict::Inconclusive)
+		{
+			// 选中项过多，预算内未能得出结论，交给 JS 自行决定
+			message = WM_DRAG_CHECK_INCONCLUSIVE;
+		}
+		if (message != 0)
+		{
+			// 结果随消息转交钩子线程，投递失败时在这里释放
+			DetectResult* result = new DetectResult{ isDesktop, std::move(match), request.originTicks };
+			if (!PostThreadMessage(g_notifyThreadId, message, (WPARAM)request.sequence, (LPARAM)result)) {
+				delete result;
+			}
+		}
+		PipelineStats::Record(PipelineStage::Detect, startTicks, PipelineStats::Now());
+		break;
+	}
+	}
+}
+
+// 取出最新的请求，其余积压请求合并丢弃
+bool DetectorWorker::TakeLatest(DetectRequest& request) {
+	return g_pendingRequests.TakeLatest(request);
+}
+
+void DetectorWorker::WorkerProc() {
+	// COM 是线程相关的 (STA)，整个线程生命周期内只初始化一次
+	Win32DesktopBackend backend;
+	if (!backend.Initialize())
+	{
+		LOG_ERROR(L"Failed to initialize COM! Error: " + std::to_wstring(GetLastError()));
+		return;
+	}
+	FileDetector::SetThreadBackend(&backend);
+
+	while (!g_stopRequested)
+	{
+		// STA 线程在等待时必须继续分发消息，否则 COM 调用和事件回调会被阻塞
+		DWORD waitResult = MsgWaitForMultipleObjects(1, &g_requestEvent, FALSE, INFINITE, QS_ALLINPUT);
+		if (waitResult == WAIT_OBJECT_0 + 1)
+		{
+			PumpPendingMessages();
+			continue;
+		}
+		if (waitResult != WAIT_OBJECT_0)
+		{
+			LOG_ERROR(L"Detector wait failed! Error: " + std::to_wstring(GetLastError()));
+			break;
+		}
+
+		DetectRequest request;
+		while (!g_stopRequested && TakeLatest(request))
+		{
+			// 先处理已到达的 COM 事件（例如 SelectionChanged），保证缓存状态是最新的
+			PumpPendingMessages();
+			Process(request);
+		}
+	}
+
+	// 预测结果持有 COM 对象，必须在 CoUninitialize 之前释放
+	DiscardSpeculation();
+	FileDetector::SetThreadBackend(NULL);
+	backend.Uninitialize();
+}
@@ -0,0 +1,59 @@
+﻿#pragma once
+#include <windows.h>
+#include "MatchedPaths.h"
+
+enum class DetectRequestKind {
+	// 拖拽已超过阈值，需要给出检测结果
+	Check,
+	// 按下左键时的预测请求，提前解析拖拽起点的文件视图窗口
+	Prefetch,
+	// 未拖拽就松开了左键，丢弃本次预测
+	Cancel,
+};
+
+// 一次拖拽检测请求
+struct DetectRequest {
+	DetectRequestKind kind;
+	// 拖拽序号，由钩子线程递增
+	unsigned long long sequence;
+	POINT pt;
+	// 越过拖拽阈值的时间 (QueryPerformanceCounter)，仅 Check 请求有效
+	LONGLONG originTicks;
+	// 提交时间，由 Submit 填写
+	LONGLONG submitTicks;
+};
+
+// 检测结果，作为 WM_DRAG_CHECK_SUCCESS / WM_DRAG_CHECK_INCONCLUSIVE 的 lParam 交给钩子线程，
+// 由钩子线程负责释放
+struct DetectResult {
+	bool isDesktop;
+	SelectionMatch match;
+	// 对应请求的 originTicks
+	LONGLONG originTicks;
+};
+
+// 预测命中统计
+struct SpeculationStats {
+	// 拖拽开始时直接使用了预测结果
+	unsigned long long used;
+	// 预测结果未被使用（松开左键或被新的拖拽替换）
+	unsigned long long wasted;
+};
+
+// 常驻的 STA 检测线程：只初始化一次 COM，通过有界队列接收检测请求，
+// 积压的请求会合并为最新的一条，而不是被丢弃
+class DetectorWorker
+{
+public:
+	// notifyThreadId: 检测成功后接收 WM_DRAG_CHECK_SUCCESS 的线程
+	static bool Start(DWORD notifyThreadId);
+	static void Stop();
+	static void Submit(const DetectRequest& request);
+	// 被合并（跳过）的请求数量
+	static unsigned long long CoalescedCount();
+	static SpeculationStats GetSpeculationStats();
+private:
+	static void WorkerProc();
+	static bool TakeLatest(DetectRequest& request);
+	static void Process(const DetectRequest& request);
+};
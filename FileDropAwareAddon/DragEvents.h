@@ -0,0 +1,47 @@
+﻿#pragma once
+#include <cstdint>
+#include <memory>
+#include "MatchedPaths.h"
+
+class HashJob;
+
+// 投递给 JS 的事件类型，数值与导出的 DragEventKind 常量一致
+enum class DragEventKind {
+	// 拖拽的选中项中包含支持的文件
+	Supported = 0,
+	// 已通知 Supported/Inconclusive 的拖拽被释放
+	Released = 1,
+	// 选中项过多，预算内无法确定
+	Inconclusive = 2,
+	// 释放时尚未完成的后台哈希已全部结束
+	Hashed = 3,
+};
+
+// 拖拽来源，数值与导出的 ShellKind 常量一致
+enum class DragShellKind {
+	Unknown = 0,
+	Desktop = 1,
+	Explorer = 2,
+	// X11 下通过 XDND 拖拽的文件
+	Xdnd = 3,
+};
+
+// 钩子线程投递给 JS 的拖拽事件
+struct DragEvent {
+	DragEventKind kind;
+	// 产生事件的时间 (PipelineStats::Now)，同时作为事件的时间戳
+	int64_t ticks;
+	// 越过拖拽阈值的时间，释放事件为 0
+	int64_t originTicks;
+	int32_t x;
+	int32_t y;
+	DragShellKind shell;
+	long matchCount;
+	// 匹配的路径，可能为空；Supported 与 Released 事件共享同一份
+	std::shared_ptr<const MatchedPaths> paths;
+	// 后台哈希任务，只有启用 hashContent 时的 Released 与 Hashed 事件才有
+	std::shared_ptr<const HashJob> hashes;
+};
+
+// 拖拽事件的接收方，在钩子线程上调用，不能阻塞
+typedef void (*DragEventSink)(void* context, const DragEvent& event);
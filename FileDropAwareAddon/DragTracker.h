@@ -0,0 +1,185 @@
+﻿#pragma once
+#include <cstdint>
+
+// 可参与拖拽的按键，Policy::kButtons 为这些值的组合
+enum DragButton : uint32_t {
+	kDragButtonLeft = 1u << 0,
+	kDragButtonRight = 1u << 1,
+	kDragButtonMiddle = 1u << 2,
+	// 触控笔模拟的左键（由适配层根据附加信息识别）
+	kDragButtonPen = 1u << 3,
+};
+
+enum class PointerAction : uint8_t {
+	Move,
+	Down,
+	Up,
+};
+
+// 与平台无关的指针输入
+struct PointerInput {
+	PointerAction action;
+	// 对 Move 无意义
+	DragButton button;
+	int32_t x;
+	int32_t y;
+};
+
+// 把低级鼠标消息 (WM_*) 转换为指针输入，不关心的消息返回 false
+// 数值与 winuser.h 一致，便于在其它平台上回放录制的事件流
+inline bool DecodeMouseMessage(uint32_t message, int32_t x, int32_t y, PointerInput& input) {
+	input.x = x;
+	input.y = y;
+	input.button = kDragButtonLeft;
+	switch (message)
+	{
+	case 0x0200: input.action = PointerAction::Move; return true;
+	case 0x0201: input.action = PointerAction::Down; return true;
+	case 0x0202: input.action = PointerAction::Up; return true;
+	case 0x0204: input.action = PointerAction::Down; input.button = kDragButtonRight; return true;
+	case 0x0205: input.action = PointerAction::Up; input.button = kDragButtonRight; return true;
+	case 0x0207: input.action = PointerAction::Down; input.button = kDragButtonMiddle; return true;
+	case 0x0208: input.action = PointerAction::Up; input.button = kDragButtonMiddle; return true;
+	default: return false;
+	}
+}
+
+// 拖拽状态机：按下 -> 越过阈值开始拖拽 -> 释放
+// 阈值、参与的按键和各状态下的动作由 Policy 在编译期决定，状态压缩在一个 64 位字中，不分配内存
+//
+// Policy 需要提供：
+//   static const uint32_t kButtons;                         参与拖拽的 DragButton 组合
+//   int ThresholdX() const; int ThresholdY() const;          拖拽阈值（像素）
+//   void OnPress(uint32_t sequence, int32_t x, int32_t y);   按下
+//   void OnDragStart(uint32_t sequence, int32_t x, int32_t y); 越过阈值，每次拖拽只调用一次
+//   void OnRelease(uint32_t sequence, int32_t x, int32_t y);  已确认的拖拽被释放
+//   void OnCancel(uint32_t sequence);                         未开始拖拽就松开了按键
+//
+// 钩子过程只负责把 MSLLHOOKSTRUCT 转换为 PointerInput；离线回放时用 MouseStream::Replay 解码录制的事件流，
+// 经 DecodeMouseMessage 转换后同样交给 Feed，两者走同一套状态机
+template <typename Policy>
+class DragTracker
+{
+public:
+	// 拖拽序号只保留低 kSequenceBits 位，回绕后仍可用于判断结果是否过期
+	static const unsigned kSequenceBits = 26;
+	static const uint32_t kSequenceMask = (1u << kSequenceBits) - 1;
+
+	explicit DragTracker(const Policy& policy = Policy()) : m_policy(policy), m_state(0) {}
+
+	Policy& GetPolicy() { return m_policy; }
+	const Policy& GetPolicy() const { return m_policy; }
+
+	void Feed(const PointerInput& input) {
+		switch (input.action)
+		{
+		case PointerAction::Down:
+			OnDown(input);
+			break;
+		case PointerAction::Move:
+			OnMove(input);
+			break;
+		case PointerAction::Up:
+			OnUp(input);
+			break;
+		}
+	}
+
+	// 检测结果返回时调用：只有仍在拖拽且序号一致时才接受，之后释放会调用 OnRelease
+	bool AcceptResult(uint32_t sequence) {
+		if ((m_state & kDragging) == 0 || Sequence() != (sequence & kSequenceMask)) {
+			return false;
+		}
+		m_state |= kDetected;
+		return true;
+	}
+
+	// 放弃当前手势（例如暂停监听）：清除按键状态但保留序号，不调用 Policy，之后返回的检测结果会被丢弃
+	void Reset() {
+		m_state &= ~kFlagsMask;
+	}
+
+	uint32_t Sequence() const { return (uint32_t)(m_state >> kSequenceShift); }
+	bool IsPressed() const { return (m_state & kPressed) != 0; }
+	bool IsDragging() const { return (m_state & kDragging) != 0; }
+	bool IsDetected() const { return (m_state & kDetected) != 0; }
+	DragButton Button() const { return (DragButton)(1u << ((m_state >> kButtonShift) & 3)); }
+	int32_t StartX() const { return (int16_t)(uint16_t)(m_state >> kStartXShift); }
+	int32_t StartY() const { return (int16_t)(uint16_t)(m_state >> kStartYShift); }
+
+private:
+	// 状态布局（低位到高位）：
+	//   0..2   按下 / 拖拽中 / 已确认
+	//   3..4   按键序号 (log2 DragButton)
+	//   5..20  起点 x (int16)
+	//   21..36 起点 y (int16)
+	//   38..63 拖拽序号
+	static const uint64_t kPressed = 1ull << 0;
+	static const uint64_t kDragging = 1ull << 1;
+	static const uint64_t kDetected = 1ull << 2;
+	static const unsigned kButtonShift = 3;
+	static const unsigned kStartXShift = 5;
+	static const unsigned kStartYShift = 21;
+	static const unsigned kSequenceShift = 64 - kSequenceBits;
+	static const uint64_t kFlagsMask = kPressed | kDragging | kDetected;
+
+	static unsigned ButtonIndex(DragButton button) {
+		unsigned index = 0;
+		while (index < 3 && (button >> index) != 1u) {
+			index++;
+		}
+		return index;
+	}
+
+	static int32_t Distance(int32_t a, int32_t b) {
+		int32_t d = a - b;
+		return d < 0 ? -d : d;
+	}
+
+	void OnDown(const PointerInput& input) {
+		if ((Policy::kButtons & input.button) == 0) {
+			return;
+		}
+		// 其它按键按下时不打断当前拖拽；同一按键再次按下说明丢失了释放消息，重新开始
+		if ((m_state & kPressed) != 0 && input.button != Button()) {
+			return;
+		}
+		uint32_t sequence = (Sequence() + 1) & kSequenceMask;
+		m_state = ((uint64_t)sequence << kSequenceShift)
+			| ((uint64_t)(uint16_t)input.y << kStartYShift)
+			| ((uint64_t)(uint16_t)input.x << kStartXShift)
+			| ((uint64_t)ButtonIndex(input.button) << kButtonShift)
+			| kPressed;
+		m_policy.OnPress(sequence, input.x, input.y);
+	}
+
+	void OnMove(const PointerInput& input) {
+		// 只有按下且尚未开始拖拽时才需要比较阈值
+		if ((m_state & (kPressed | kDragging)) != kPressed) {
+			return;
+		}
+		if (Distance(input.x, StartX()) >= m_policy.ThresholdX() || Distance(input.y, StartY()) >= m_policy.ThresholdY()) {
+			m_state |= kDragging;
+			m_policy.OnDragStart(Sequence(), input.x, input.y);
+		}
+	}
+
+	void OnUp(const PointerInput& input) {
+		if ((m_state & kPressed) == 0 || input.button != Button()) {
+			return;
+		}
+		uint64_t flags = m_state & kFlagsMask;
+		// 保留序号，清除按键状态
+		m_state &= ~kFlagsMask;
+		if (flags == (kPressed | kDragging | kDetected)) {
+			m_policy.OnRelease(Sequence(), input.x, input.y);
+		}
+		else if ((flags & kDragging) == 0) {
+			m_policy.OnCancel(Sequence());
+		}
+	}
+
+private:
+	Policy m_policy;
+	uint64_t m_state;
+};
@@ -0,0 +1,97 @@
+﻿#include "ExtensionMatcher.h"
+
+ExtensionMatcher::ExtensionMatcher() : m_mask(0), m_count(0), m_lengthMask(0), m_maxDots(0) {}
+
+ExtensionMatcher::ExtensionMatcher(const std::set<std::wstring>& extensions)
+	: m_mask(0), m_count(0), m_lengthMask(0), m_maxDots(0) {
+	// 负载因子不超过 1/2，保证探测链很短
+	size_t capacity = 8;
+	while (capacity < extensions.size() * 2) {
+		capacity <<= 1;
+	}
+	m_slots.assign(capacity, Slot{ 0, 0, 0 });
+	m_mask = capacity - 1;
+
+	for (const std::wstring& extension : extensions) {
+		if (extension.empty()) continue;
+
+		// 统一为带前导 '.' 的形式，例如 "txt" -> ".txt"
+		std::wstring folded;
+		if (extension[0] != L'.') folded.push_back(L'.');
+		for (wchar_t c : extension) {
+			folded.push_back(FoldAscii(c));
+		}
+		if (folded.size() > kMaxExtensionLength) continue;
+		Insert(folded);
+	}
+}
+
+uint32_t ExtensionMatcher::HashFolded(const wchar_t* key, size_t length) {
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < length; i++) {
+		hash ^= (uint32_t)FoldAscii(key[i]);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+void ExtensionMatcher::Insert(const std::wstring& foldedKey) {
+	if (Contains(foldedKey.c_str(), foldedKey.size())) return;
+
+	uint32_t hash = HashFolded(foldedKey.c_str(), foldedKey.size());
+	size_t index = hash & m_mask;
+	while (m_slots[index].length != 0) {
+		index = (index + 1) & m_mask;
+	}
+	m_slots[index] = Slot{ hash, (uint32_t)m_keys.size(), (uint32_t)foldedKey.size() };
+	m_keys.insert(m_keys.end(), foldedKey.begin(), foldedKey.end());
+	m_count++;
+	m_lengthMask |= 1ull << foldedKey.size();
+
+	size_t dots = 0;
+	for (wchar_t c : foldedKey) {
+		if (c == L'.') dots++;
+	}
+	if (dots > m_maxDots) m_maxDots = dots;
+}
+
+bool ExtensionMatcher::Contains(const wchar_t* suffix, size_t length) const {
+	if (m_count == 0 || (m_lengthMask & (1ull << length)) == 0) {
+		return false;
+	}
+	uint32_t hash = HashFolded(suffix, length);
+	size_t index = hash & m_mask;
+	while (m_slots[index].length != 0) {
+		const Slot& slot = m_slots[index];
+		if (slot.hash == hash && slot.length == length) {
+			const wchar_t* key = &m_keys[slot.offset];
+			size_t i = 0;
+			while (i < length && key[i] == FoldAscii(suffix[i])) i++;
+			if (i == length) return true;
+		}
+		index = (index + 1) & m_mask;
+	}
+	return false;
+}
+
+bool ExtensionMatcher::Matches(const wchar_t* path, size_t length) const {
+	if (m_count == 0 || path == nullptr) {
+		return false;
+	}
+
+	// 从末尾向前查找，遇到路径分隔符即停止，只在文件名内取后缀
+	// 每遇到一个 '.'，[dot, end) 就是一个候选扩展名，从最短的开始尝试
+	size_t dots = 0;
+	for (size_t i = length; i > 0; i--) {
+		wchar_t c = path[i - 1];
+		if (c == L'\\' || c == L'/' || c == L':') break;
+		size_t suffixLength = length - (i - 1);
+		if (suffixLength > kMaxExtensionLength) break;
+		if (c != L'.') continue;
+
+		if (Contains(path + i - 1, suffixLength)) return true;
+		if (++dots >= m_maxDots) break;
+	}
+	return false;
+}
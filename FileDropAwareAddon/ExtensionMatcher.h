@@ -0,0 +1,50 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+// 扩展名匹配器：由配置的扩展名列表构建一次，匹配时不分配内存
+// 键预先折叠为小写存入开放寻址哈希表，支持 .tar.gz / .d.ts 这类多段扩展名
+class ExtensionMatcher
+{
+public:
+	// 超过该长度的扩展名不参与匹配
+	static const size_t kMaxExtensionLength = 32;
+
+	ExtensionMatcher();
+	explicit ExtensionMatcher(const std::set<std::wstring>& extensions);
+
+	bool Empty() const { return m_count == 0; }
+	bool Matches(const wchar_t* path, size_t length) const;
+	bool Matches(const std::wstring& path) const { return Matches(path.c_str(), path.size()); }
+
+	// ASCII 大小写折叠，无分支；非 ASCII 字符保持不变
+	static wchar_t FoldAscii(wchar_t c) {
+		return (wchar_t)(c + (((unsigned)c - L'A' < 26u) << 5));
+	}
+
+private:
+	struct Slot {
+		uint32_t hash;
+		uint32_t offset;
+		// 0 表示空槽
+		uint32_t length;
+	};
+
+	static uint32_t HashFolded(const wchar_t* key, size_t length);
+	void Insert(const std::wstring& foldedKey);
+	bool Contains(const wchar_t* suffix, size_t length) const;
+
+private:
+	std::vector<Slot> m_slots;
+	// 所有键连续存放，Slot 通过 offset/length 引用
+	std::vector<wchar_t> m_keys;
+	size_t m_mask;
+	size_t m_count;
+	// 第 i 位表示存在长度为 i 的键，用于快速排除
+	uint64_t m_lengthMask;
+	// 键中最多包含的 '.' 数量，决定需要尝试的后缀个数
+	size_t m_maxDots;
+};
@@ -1,511 +1,233 @@
-#include "FileDetector.h"
-#include <iostream>
-#include <algorithm>
-#include <shlobj.h>
-#include <UIAutomation.h>
+﻿#include "FileDetector.h"
 
-#include "Utils.h"
+#include "Logger.h"
+#include "PipelineStats.h"
+#include "ContentSniffer.h"
 
-// UIA Զȫʵ
-// static CComPtr<IUIAutomation> g_pAutomation = NULL;
+// 当前检测线程使用的桌面后端，由线程的创建者设置
+static thread_local IDesktopBackend* t_pBackend = NULL;
+// 当前检测线程持有的规则快照
+static thread_local SnapshotReader<MatchRules> t_rules;
 
-/**
- * @brief ȡ UIA ԪصĸԪء
- * * @param pElement ǰ UIA Ԫء
- * @param ppParentElement ڽոԪָ
- * @return HRESULT ɹ S_OK򷵻ش롣
- */
-HRESULT GetParentElement(IUIAutomationElement* pElement, CComPtr<IUIAutomation> pAutomation, IUIAutomationElement** ppParentElement) {
-	if (pElement == NULL || ppParentElement == NULL || pAutomation == NULL) {
-		return E_POINTER;
-	}
-
-	*ppParentElement = NULL;
-	CComPtr<IUIAutomationTreeWalker> pWalker = NULL;
-	HRESULT hr = S_OK;
 
-	// 1. ȡ TreeWalker ʵ (ʹ RawViewWalkerΪԪأ)
-	// ҲԿʹ ControlViewWalker (ֻؼ)  ContentViewWalker (ֻ)
-	hr = pAutomation->get_RawViewWalker(&pWalker);
-	if (FAILED(hr)) {
-		return hr;
-	}
-
-	// 2. ʹ GetParentElement ȡԪ
-	// TreeWalker ӿṩֱӵķ
-	hr = pWalker->GetParentElement(pElement, ppParentElement);
-
-	if (hr == S_OK) {
-		// ɹȡԪ
-		return S_OK;
-	}
-	else if (hr == UIA_E_ELEMENTNOTAVAILABLE) {
-		// Ԫزã磬ѹرգ
-		return hr;
-	}
-	else if (hr == S_FALSE) {
-		// Ѿĸ (ͨ)ûиԪ
-		return S_FALSE;
-	}
-	else {
-		// 
-		return hr;
-	}
-}
-
-extern void LogInfo(const std::wstring& info);
-extern void LogError(const std::wstring& error);
-
-std::set<std::wstring> FileDetector::m_Extensions = {};
+SnapshotCell<MatchRules> FileDetector::m_Rules;
+std::atomic<unsigned int> FileDetector::m_RulesVersion(0);
+std::atomic<long> FileDetector::m_ScanMaxItems(2000);
+std::atomic<unsigned long> FileDetector::m_ScanMaxMillis(200);
+std::atomic<long> FileDetector::m_MaxPaths(1000);
+std::atomic<bool> FileDetector::m_VerifyContent(false);
+std::atomic<unsigned long> FileDetector::m_VerifyMaxMillis(50);
 
 FileDetector::FileDetector() {
 }
 
 FileDetector::~FileDetector() {}
 
-bool FileDetector::IsTargetExtension(const std::wstring& path) {
-	LPWSTR ext = PathFindExtensionW(path.c_str());
-	if (ext == NULL) { 
-		LogError(L"there is no extension in the path");
-		return false; 
-	}
-
-	std::wstring extStr(ext);
-	// תΪСдбȽ
-	std::transform(extStr.begin(), extStr.end(), extStr.begin(), ::towlower);
-
-	return m_Extensions.count(extStr) > 0;
+void FileDetector::SetThreadBackend(IDesktopBackend* backend) {
+	t_pBackend = backend;
 }
 
-bool FileDetector::HasValidSelection(IDispatch* pDispWindow) {
-	if (!pDispWindow) {
-		LogError(L"pDispWindow is null");
-		return false;
-	}
+void FileDetector::SetRules(const MatchRuleSet& rules) {
+	// 在调用线程上编译，检测线程只看到完整的新快照
+	m_Rules.Publish(std::make_shared<const MatchRules>(rules));
+	// 规则变化后缓存的选中项结果全部作废
+	m_RulesVersion++;
+}
 
-	CComPtr<IWebBrowser2> pBrowser;
-	HRESULT hr = pDispWindow->QueryInterface(IID_IWebBrowser2, (void**)&pBrowser);
-	if (FAILED(hr)) {
-		LogError(L"Get IWebBrowser2 failed");
-		return false;
-	}
+void FileDetector::SetExtensions(const std::set<std::wstring>& extensions) {
+	MatchRuleSet rules;
+	rules.extensions = extensions;
+	SetRules(rules);
+}
 
-	// ȡ Document
-	CComPtr<IDispatch> pDispDoc;
-	hr = pBrowser->get_Document(&pDispDoc);
-	if (FAILED(hr) || !pDispDoc) {
-		LogError(L"Get Document failed");
-		return false;
-	}
+void FileDetector::SetScanBudget(long maxItems, unsigned long maxMillis) {
+	m_ScanMaxItems = maxItems;
+	m_ScanMaxMillis = maxMillis;
+}
 
-	// ȡ Folder View
-	CComPtr<IShellFolderViewDual> pFolderView;
-	hr = pDispDoc->QueryInterface(IID_IShellFolderViewDual, (void**)&pFolderView);
-	if (FAILED(hr)) {
-        LogError(L"Get Folder View failed");
-		return false;
-	}
+void FileDetector::SetMaxPaths(long maxPaths) {
+	m_MaxPaths = maxPaths < 0 ? 0 : maxPaths;
+	// 缓存的路径列表按旧上限截断，需要失效
+	m_RulesVersion++;
+}
 
-	// ȡ SelectedItems
-	CComPtr<FolderItems> pSelectedItems;
-	hr = pFolderView->SelectedItems(&pSelectedItems);
-	if (FAILED(hr) || !pSelectedItems) {
-		LogError(L"Get Selected Items failed");
-		return false;
-	}
+void FileDetector::SetContentVerification(bool enabled, unsigned long maxMillis) {
+	m_VerifyContent = enabled;
+	m_VerifyMaxMillis = maxMillis;
+	// 缓存的选中项结果是否经过校验与当前设置不一致，需要失效
+	m_RulesVersion++;
+}
 
-	long count = 0;
-	pSelectedItems->get_Count(&count);
-	if (count == 0) {
-		LogError(L"No selected items");
-		return false;
-	}
+ScanVerdict FileDetector::HasValidSelection(IDesktopBackend& backend, DesktopView& view, SelectionMatch& match, bool& complete) {
+	match.matchCount = 0;
+	match.paths.reset();
+	complete = true;
 
-	// ѡ
-	for (long i = 0; i < count; i++)
+	// 遍历选中项，超出预算时返回 Inconclusive 而不是阻塞检测线程
+	ScanBudget budget = { m_ScanMaxItems.load(std::memory_order_relaxed), m_ScanMaxMillis.load(std::memory_order_relaxed) };
+	std::shared_ptr<MatchedPaths> paths = std::make_shared<MatchedPaths>((size_t)m_MaxPaths.load(std::memory_order_relaxed));
+	SelectionScanSummary summary;
+	ScanVerdict verdict;
 	{
-		CComVariant varIndex(i);
-		CComPtr<FolderItem> pItem;
-		hr = pSelectedItems->Item(varIndex, &pItem);
-
-		if (SUCCEEDED(hr) && pItem)
-		{
-			VARIANT_BOOL isFolder = VARIANT_FALSE;
-			pItem->get_IsFolder(&isFolder);
-
-			// ļУ
-			if (isFolder == VARIANT_TRUE) continue;
-
-			BSTR bstrPath = NULL;
-			pItem->get_Path(&bstrPath);
-			if (bstrPath)
-			{
-				std::wstring path(bstrPath, SysStringLen(bstrPath));
-				SysFreeString(bstrPath);
-
-				if (IsTargetExtension(path))
-				{
-					return true;
-				}
-			}
-		}
+		StageTimer timer(PipelineStage::Selection);
+		verdict = backend.ScanSelection(view, t_rules.Get(m_Rules), budget, paths.get(), summary);
 	}
-	return false;
-}
-
-bool FileDetector::IsMouseOverFileItemUIA(const POINT& mousePos) {
-	CComPtr<IUIAutomation> pAutomation = NULL;
-	// 1. ʼ UIA Զ (ֻʼһ)
-	// CLSID_CUIAutomation Ӧ IUIAutomation ӿڵԶ
-	HRESULT hr = CoCreateInstance(
-		CLSID_CUIAutomation,
-		NULL,
-		CLSCTX_INPROC_SERVER,
-		IID_IUIAutomation,
-		(void**)&pAutomation
-	);
-	if (FAILED(hr)) {
-		LogError(L"Failed to CoCreate IUIAutomation.");
-		return false;
+	match.matchCount = summary.matched;
+	complete = !summary.truncated;
+	if (verdict == ScanVerdict::Inconclusive) {
+		LOG_INFO(L"Selection scan is inconclusive after " + std::to_wstring(summary.scanned) + L" items.");
 	}
-	
-	CComPtr<IUIAutomationElement> pElement = NULL;
-	
-	// 2. ȡµ UIA Ԫ
-	hr = pAutomation->ElementFromPoint(mousePos, &pElement);
-	
-	if (FAILED(hr) || pElement == NULL) {
-		// ʧܣͨĻ򲻿ɷ
-		LogError(L"Failed to get element from point.");
-		return false; //  S_FALSE
-	}
-	
-	// 3. ȡԪص ControlType 
-	CONTROLTYPEID controlTypeId;
-	hr = pElement->get_CurrentControlType(&controlTypeId);
-	if (FAILED(hr)) {
-		LogError(L"Failed to get ControlType.");
-		return false;
+	if (m_VerifyContent.load(std::memory_order_relaxed) && paths->Count() > 0) {
+		verdict = VerifyContent(verdict, summary, paths, match.matchCount, complete);
 	}
-	LogInfo(L"ControlType ID: " + std::to_wstring(controlTypeId));
-
-	CComPtr<IUIAutomationElement> pParentElement;
-	// ԻȡԪ
-	hr = GetParentElement(pElement, pAutomation, &pParentElement);
-	if (FAILED(hr) || pParentElement == NULL) {
-		LogError(L"Failed to get parent element.");
-		return false;
+	if (paths->Count() > 0) {
+		match.paths = std::move(paths);
 	}
-
-	// ɹȡԪأڿԼ pParentElement  ControlType  Name 
-	CONTROLTYPEID parentControlType;
-	hr = pParentElement->get_CurrentControlType(&parentControlType);
-	if (FAILED(hr)) {
-		LogError(L"Failed to get parent ControlType.");
-		return false;
-	}
-	LogInfo(L"parent element type id: " + std::to_wstring(parentControlType));
-	// 磺鸸ԪǷб
-	if (parentControlType == UIA_ListItemControlTypeId || controlTypeId == UIA_ListItemControlTypeId) {
-		return true;
-	}
-
-	/*
-	հ
-	UIA_ListControlTypeId 50008
-	UIA_PaneControlTypeId 50033
-
-	ļ
-	UIA_EditControlTypeId 50004
-	UIA_ListItemControlTypeId 50007
-
-	ʱǩ
-	UIA_CustomControlTypeId 50025
-	UIA_GroupControlTypeId 50026
-
-	ͷ
-	UIA_SplitButtonControlTypeId 50031
-	UIA_HeaderControlTypeId 50034
-	*/
-
-	// 4. ˺ͷ
-	//if (controlTypeId == UIA_ListItemControlTypeId) {
-	//	// ļļ
-	//	*pResult = HitType_FileItem;
-	//}
-	//else if (controlTypeId == UIA_GroupControlTypeId || controlTypeId == UIA_HeaderControlTypeId) {
-	//	// ˷ ( "")
-	//	*pResult = HitType_GroupHeader;
-	//}
-	//else {
-	//	// ˹Ԫ
-	//	*pResult = HitType_Other;
-	//}
-
-	return false;
+	return verdict;
 }
 
-/**===============================================================================================================================================================
-Windows ԴExplorerĴڲ㼶ṹͨ£
-
-|CabinetWClass( / )
-|
-|---WorkerW / ReBarWindow32(ַ)
-|
-|---ShellTabWindowClass
-|	|
-|	|---SHELLDLL_DefView < --ǵĿ
-|		|
-|	    |---DirectUIHWND(ʵʾļĿؼ)
-|	
-|---SysTreeView32(ർͨ DefView )
-
-	߼̶Աȣ
-	1. ϶ļʱ DirectUIHWND  -> Ҹ ->  SHELLDLL_DefView -> IsContentArea  true -> ѡ -> ͨ
-
-	2. ϶ʱ CabinetWClass ı -> Ҹ ->  CabinetWClass (û SHELLDLL_DefView) -> IsContentArea  false -> ء
-
-	3. ർʱ SysTreeView32 -> Ҹ ->  CabinetWClass -> IsContentArea  false -> أҲǺģΪͨѡ״̬Ҳͼѡ״̬Ƿģ
-======================================================================================================================================================================*/
-bool FileDetector::IsContentArea(HWND hWnd, const POINT& mousePos, bool isDesktop) {
-	HWND current = hWnd;
-	//RECT contentRect;
-	//std::wstring preClassName;
-
-	while (current != NULL) {
-		wchar_t className[256];
-		GetClassNameW(current, className, 256);
-
-		//==========================WIN10===============================
-		// 1. 
-		if (wcscmp(className, L"SearchEditBoxWrapperClass") == 0) {
-			return false;
-		}
-		// 2. ַ
-		if (wcscmp(className, L"Address Band Root") == 0) {
-			return false;
-		}
-		// 3. TravelBand
-		if (wcscmp(className, L"TravelBand") == 0) {
-			return false;
-		}
-
-		// 1. ļͼĴ࣬˵ļ
-		// SHELLDLL_DefView:  DirectUIHWND  SysListView32 
-		if (wcscmp(className, L"SHELLDLL_DefView") == 0) {
-			// LogInfo(L"class name: " + std::wstring(className) + L", previous class name: " + preClassName);
-			//if (!isDesktop)
-			//{
-			//	// ȡ SHELLDLL_DefView Ļ߽
-			//	if (GetWindowRect(current, &contentRect)) {
-
-			//		// ռжϣ Y Ƿڶ HEADING_HEIGHT Χ
-			//		if (mousePos.y <= contentRect.top + 30) {
-			//			// ڶͷ򣬷 false
-			//			LogInfo(L"Mouse is in the top header area of SHELLDLL_DefView (Y-coordinate check).");
-			//			return false;
-			//		}
-
-			//		// Y ͨ˱ͷ飬ΪЧļб
-			//		return true;
-			//	}
-			//}
-			return true;
+ScanVerdict FileDetector::VerifyContent(ScanVerdict verdict, const SelectionScanSummary& summary,
+	std::shared_ptr<MatchedPaths>& paths, long& matchCount, bool& complete) {
+	StageTimer timer(PipelineStage::Sniff);
+	size_t count = paths->Count();
+	std::vector<std::wstring> candidates;
+	candidates.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		candidates.push_back(paths->PathAt(i));
+	}
+
+	std::vector<SniffResult> results;
+	bool finished = ContentSniffer::VerifyAll(std::move(candidates), m_VerifyMaxMillis.load(std::memory_order_relaxed), results);
+
+	std::shared_ptr<MatchedPaths> verified = std::make_shared<MatchedPaths>((size_t)m_MaxPaths.load(std::memory_order_relaxed));
+	long accepted = 0;
+	long rejected = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (results[i] == SniffResult::Accepted) {
+			std::wstring path = paths->PathAt(i);
+			verified->Add(path.c_str(), path.size());
+			accepted++;
 		}
-
-		// 2. û DefView Ѿ˶Դڣ
-		// ˵˱˵״̬ർ
-		if (wcscmp(className, L"CabinetWClass") == 0) {
-			return false;
-		}
-
-		// 3. ⴦
-		// 汾һ DefViewҲ Progman/WorkerW 
-		if (wcscmp(className, L"Progman") == 0 || wcscmp(className, L"WorkerW") == 0) {
-			return true;
+		else if (results[i] == SniffResult::Rejected) {
+			rejected++;
+			LOG_DEBUG(L"Content does not match extension: " + paths->PathAt(i));
 		}
-
-		current = GetParent(current);
-
-		//preClassName = className;
 	}
-	return false;
-}
-
-HWND FileDetector::FindShellParent(HWND hWnd, bool& isDesktop) {
-	isDesktop = false;
-	HWND current = hWnd;
-	// SHELLDLL_DefView: ͼʵʴڵĸ, ļԴڣCabinetWClass  ExplorerWClassڲ
-	// ʾļļбҲһ SHELLDLL_DefView Ĵʵ
-	// CabinetWClass:  Windows Shell ̣explorer.exeı׼ļļдڵıʶ
-	/*wchar_t firstClassName[256];
-	GetClassNameW(current, firstClassName, 256);
-	LogInfo(L"first window class name: " + std::wstring(firstClassName));
-	if (
-		wcscmp(firstClassName, L"CabinetWClass") == 0 ||
-		wcscmp(firstClassName, L"TITLE_BAR_SCAFFOLDING_WINDOW_CLASS") == 0 ||
-        wcscmp(firstClassName, L"Microsoft.UI.Content.DesktopChildSiteBridge") == 0
-	)
-	{
-		return NULL;
-	}*/
-
-	while (current != NULL)
-	{
-		wchar_t className[256];
-		GetClassNameW(current, className, 256);
-		//LogInfo(L"Drag window class name: " + std::wstring(className));
-		// ǷͨԴ
-		if (wcscmp(className, L"CabinetWClass") == 0)
-		{
-			return current;
-		}
-
-		// Ƿ
-		if (wcscmp(className, L"Progman") == 0 || wcscmp(className, L"WorkerW") == 0)
-		{
-			isDesktop = true;
-			return current;
-		}
-
-		current = GetParent(current);
+	paths = std::move(verified);
+	// 超出路径上限的匹配项没有路径，无法校验，按扩展名结果计数
+	matchCount = accepted + (summary.matched - (long)count);
+	// 超时的结果不完整，不写入选中项缓存；已完成的文件已进入内容缓存，下次拖拽直接命中
+	if (!finished) {
+		complete = false;
+		LOG_INFO(L"Content verification timed out with " + std::to_wstring(count - accepted - rejected) + L" files pending.");
 	}
 
-	// ׼飺ѭûҵ WorkerW ܸ Progman 
-	HWND progman = FindWindowW(L"Progman", NULL);
-	if (progman != NULL)
-	{
-		// 򻯴ҲҲû NULL
-		LogInfo(L"Failed to find shell parent, but found Progman");
+	if (matchCount > 0) {
+		return ScanVerdict::Match;
 	}
-
-	return NULL;
+	// 全部被拒绝且扫描完整时才能给出否定结论
+	return (finished && verdict != ScanVerdict::Inconclusive && !summary.truncated) ? ScanVerdict::NoMatch : ScanVerdict::Inconclusive;
 }
 
-bool FileDetector::ComInitialize() {	
-	HRESULT hr = CoInitialize(NULL);
-	if (hr != S_OK && hr != S_FALSE)
+bool FileDetector::ResolveDragTarget(const DesktopPoint& mousePos, DragTarget& target) {
+	target.shellWindow = 0;
+	target.isDesktop = false;
+	target.view.reset();
+
+	IDesktopBackend* backend = t_pBackend;
+	if (backend == NULL)
 	{
-		LogError(L"COM Initialization failed (HRESULT: " + HResultToHexString(hr) + L"). Shell operations require STA.");
+		LOG_ERROR(L"Desktop backend is not set on this thread.");
 		return false;
 	}
-	return true;
-}
-
-void FileDetector::ComUninitialize() {
-	CoUninitialize();
-}
-
-void FileDetector::SetExtensions(const std::set<std::wstring>& extensions) {
-    m_Extensions = extensions;
-}
-
-bool FileDetector::IsDraggingSupportedFile() {
-	// COM ʼ (ʵʹн߳ڴʼһΣҪںƵ)
-	//CoInitialize(NULL);
-	bool result = false;
 
 	try
 	{
-		// 1. ȡλ
-		POINT mousePos;
-		GetCursorPos(&mousePos);
+		// 1. 获取鼠标下的窗口句柄
+		DesktopWindow targetWindow = backend->WindowFromPoint(mousePos);
+		if (targetWindow == 0) return false;
 
-		// 2. ȡµĴھ
-		HWND targetHwnd = WindowFromPoint(mousePos);
-		if (targetHwnd == NULL) return false;
+		// 2. 向上回溯，一次遍历同时得到 Shell 父窗口和内容区域判定
+		WindowAncestry ancestry;
+		{
+			StageTimer timer(PipelineStage::Classify);
+			backend->Classify(targetWindow, ancestry);
+		}
+		if (ancestry.shellWindow == 0) return false;
 
-		// 3. ϻ
-		bool isDesktop = false;
-		HWND shellHwnd = FindShellParent(targetHwnd, isDesktop);
-		if (shellHwnd == NULL) return false;
-		
-		// ==================  UIA  ==================
-		if (!isDesktop)
+		// ================== 新增检查 ==================
+		// 如果鼠标不在文件显示区域（例如在标题栏），直接返回 false
+		// 判定已随祖先链遍历得出，先于跨进程的 UIA 检查
+		if (!ancestry.isContentArea) {
+			return false;
+		}
+		// =============================================
+
+		// ================== 新增 UIA 检查 ==================
+		if (!ancestry.isDesktop)
 		{
-			bool onFile = IsMouseOverFileItemUIA(mousePos);
+			StageTimer timer(PipelineStage::UiaHitTest);
+			bool onFile = backend->IsOverFileItem(mousePos);
 			if (!onFile)
 			{
 				return false;
 			}
 		}
-		
-		// ==================  ==================
-		// 겻ļʾڱֱӷ false
-		if (!IsContentArea(targetHwnd, mousePos, isDesktop)) {
-			return false;
-		}
-		// =============================================
-		
-		// 4. ʼ ShellWindows
-		CComPtr<IShellWindows> pShellWindows;
-		HRESULT hr = pShellWindows.CoCreateInstance(CLSID_ShellWindows);
-		if (FAILED(hr))
+
+		// 3. 根据类型查找 Shell 窗口对应的文件视图
+		StageTimer timer(PipelineStage::ShellLookup);
+		target.view = backend->FindView(ancestry.shellWindow, ancestry.isDesktop);
+		if (!target.view)
 		{
-			LogError(L"Failed to create IShellWindows instance: " + HResultToHexString(hr));
 			return false;
 		}
-		
-		// 5. Ͳ
-		if (isDesktop)
-		{
-			// Ӧ C#: shellWindows.FindWindowSW(..., SWC_DESKTOP, ..., SWFO_NEEDDISPATCH)
-			// SWC_DESKTOP = 8, SWFO_NEEDDISPATCH = 1
-			CComVariant vMissing;
-			vMissing.vt = VT_ERROR;
-			vMissing.scode = DISP_E_PARAMNOTFOUND;
-			int hwndVal = 0;
-			CComPtr<IDispatch> pDispDesktop;
-
-			hr = pShellWindows->FindWindowSW(
-				&vMissing, &vMissing,
-				SWC_DESKTOP,
-				(long*)&hwndVal,
-				SWFO_NEEDDISPATCH,
-				&pDispDesktop
-			);
+		target.shellWindow = ancestry.shellWindow;
+		target.isDesktop = ancestry.isDesktop;
+		return true;
+	}
+	catch (...)
+	{
+		target.view.reset();
+		return false;
+	}
+}
 
-			if (SUCCEEDED(hr) && pDispDesktop)
-			{
-				result = HasValidSelection(pDispDesktop);
-			}
+ScanVerdict FileDetector::IsDraggingSupportedFile(const DragTarget& target, SelectionMatch& match) {
+	match.matchCount = 0;
+	match.paths.reset();
+	IDesktopBackend* backend = t_pBackend;
+	if (!target.view || backend == NULL) {
+		return ScanVerdict::NoMatch;
+	}
+	try
+	{
+		// 选中项未变化时直接使用上一次的结果（例如重复拖拽同一批文件）
+		unsigned int rulesVersion = m_RulesVersion.load(std::memory_order_acquire);
+		if (backend->LookupSelection(*target.view, rulesVersion, match)) {
+			return match.matchCount > 0 ? ScanVerdict::Match : ScanVerdict::NoMatch;
 		}
-		else
-		{
-			// д򿪵 Explorer 
-			long winCount = 0;
-			pShellWindows->get_Count(&winCount);
-
-			for (long i = 0; i < winCount; i++)
-			{
-				CComVariant index(i);
-				CComPtr<IDispatch> pDisp;
-				hr = pShellWindows->Item(index, &pDisp);
 
-				if (SUCCEEDED(hr) && pDisp)
-				{
-					CComPtr<IWebBrowser2> pBrowser;
-					hr = pDisp->QueryInterface(IID_IWebBrowser2, (void**)&pBrowser);
-					if (SUCCEEDED(hr))
-					{
-						SHANDLE_PTR hWindow = 0;
-						pBrowser->get_HWND(&hWindow);
-
-						if ((HWND)hWindow == shellHwnd)
-						{
-							result = HasValidSelection(pDisp);
-							if (result) break;
-						}
-					}
-				}
-			}
+		bool complete = true;
+		ScanVerdict verdict = HasValidSelection(*backend, *target.view, match, complete);
+		// 超出预算的结果（包括计数不完整的匹配）不缓存，下次重新扫描
+		if (complete) {
+			backend->StoreSelection(*target.view, rulesVersion, match);
 		}
+		return verdict;
 	}
 	catch (...)
 	{
-		result = false;
+		match.matchCount = 0;
+		match.paths.reset();
+		return ScanVerdict::NoMatch;
 	}
+}
 
-	//CoUninitialize();
-	return result;
+ScanVerdict FileDetector::IsDraggingSupportedFile(const DesktopPoint& mousePos, DragTarget& target, SelectionMatch& match) {
+	match.matchCount = 0;
+	match.paths.reset();
+	if (!ResolveDragTarget(mousePos, target)) {
+		return ScanVerdict::NoMatch;
+	}
+	return IsDraggingSupportedFile(target, match);
 }
\ No newline at end of file
@@ -1,28 +1,56 @@
-#pragma once
+﻿#pragma once
 #include <string>
 #include <set>
+#include <atomic>
+#include <memory>
+#include "DesktopBackend.h"
+#include "MatchRules.h"
+#include "Snapshot.h"
+#include "MatchedPaths.h"
 
-//#include <shldisp.h>
-//#include <exdisp.h>
-//#include <shlwapi.h>
-#include <atlbase.h> // ʹ CComPtr  COM ڴ
+// 拖拽起点解析出的 Shell 窗口，可在按下左键时提前解析，拖拽开始后再查询选中项
+struct DragTarget {
+    DesktopWindow shellWindow;
+    bool isDesktop;
+    std::shared_ptr<DesktopView> view;
+};
 
 class FileDetector
 {
 private:
-    static std::set<std::wstring> m_Extensions;
+    // 当前的匹配规则，检测线程通过线程内的 SnapshotReader 读取，更新时不加锁
+    static SnapshotCell<MatchRules> m_Rules;
+    // 每次更新规则或路径上限时递增，用于使缓存的检测结果失效
+    static std::atomic<unsigned int> m_RulesVersion;
+    // 选中项扫描预算，0 表示不限制
+    static std::atomic<long> m_ScanMaxItems;
+    static std::atomic<unsigned long> m_ScanMaxMillis;
+    // 最多返回的匹配路径数，0 表示不限制
+    static std::atomic<long> m_MaxPaths;
+    // 按文件头校验匹配文件的内容，及每次拖拽校验的截止时间（毫秒，0 表示不限时）
+    static std::atomic<bool> m_VerifyContent;
+    static std::atomic<unsigned long> m_VerifyMaxMillis;
 public:
     FileDetector();
     ~FileDetector();
 public:
-    static bool ComInitialize();
-    static void ComUninitialize();
+    // 设置当前线程使用的桌面后端，不转移所有权；检测前必须设置，传 NULL 解除
+    static void SetThreadBackend(IDesktopBackend* backend);
+    // 编译并发布新的匹配规则，正在进行的扫描继续使用旧规则
+    static void SetRules(const MatchRuleSet& rules);
     static void SetExtensions(const std::set<std::wstring>& extensions);
-    static bool IsDraggingSupportedFile();
+    static void SetScanBudget(long maxItems, unsigned long maxMillis);
+    static void SetMaxPaths(long maxPaths);
+    static void SetContentVerification(bool enabled, unsigned long maxMillis);
+    // 解析鼠标位置下的文件视图窗口：窗口分类、UIA 命中测试和 Shell 窗口查找
+    static bool ResolveDragTarget(const DesktopPoint& mousePos, DragTarget& target);
+    // 查询已解析窗口的选中项，match 返回匹配的文件数和路径
+    static ScanVerdict IsDraggingSupportedFile(const DragTarget& target, SelectionMatch& match);
+    static ScanVerdict IsDraggingSupportedFile(const DesktopPoint& mousePos, DragTarget& target, SelectionMatch& match);
 private:
-    static bool IsTargetExtension(const std::wstring& path);
-    static bool HasValidSelection(IDispatch* pDispWindow);
-    static bool IsMouseOverFileItemUIA(const POINT& mousePos);
-    static bool IsContentArea(HWND hWnd, const POINT& mousePos, bool isDesktop);
-    static HWND FindShellParent(HWND hWnd, bool& isDesktop);
+    // complete 为 false 表示扫描因预算耗尽而提前结束
+    static ScanVerdict HasValidSelection(IDesktopBackend& backend, DesktopView& view, SelectionMatch& match, bool& complete);
+    // 校验 paths 中文件的内容，只保留与扩展名相符的路径
+    static ScanVerdict VerifyContent(ScanVerdict verdict, const SelectionScanSummary& summary,
+        std::shared_ptr<MatchedPaths>& paths, long& matchCount, bool& complete);
 };
\ No newline at end of file
@@ -1,195 +1,739 @@
 ﻿// FileDropAwareAddon.cpp : 此文件包含 "main" 函数。程序执行将在此处开始并结束。
 //
-#include <node.h>
-#include <uv.h>
+#include <node_api.h>
 #include <string>
 #include <cstring>
-#include <iostream>
-#include <queue>
+#include <initializer_list>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "AddonInstance.h"
 #include "MouseHook.h"
+#include "DetectorWorker.h"
+#include "FileDetector.h"
+#include "Logger.h"
+#include "SelectionCache.h"
+#include "ContentSniffer.h"
+#include "FileHasher.h"
+#include "FilePrewarmer.h"
+#include "PipelineStats.h"
 #include "Utils.h"
 
-v8::Isolate* isolate = NULL;
+// 已调用 AwareInitialize 的实例数，钩子是进程级的，最后一个实例退出时才卸载
+static std::mutex g_instanceMutex;
+static int g_activeInstances = 0;
+// 是否已调用过 AwareInitialize，受 g_instanceMutex 保护
+static bool g_configured = false;
 
-static v8::Persistent<v8::Function> logCallback;
+// 停止钩子线程（包括等待检测线程退出）的最长时间
+static const DWORD kStopTimeoutMillis = 3000;
 
-static uv_async_t async_log_handle;
-// 存储日志信息 (需要线程安全)
-struct LogMessage {
-	std::wstring message;
-	// 可能还需要一个类型指示器 (Info/Error)
-};
+// Electron 等启用 V8 沙箱的运行时不允许外部 ArrayBuffer：为其编译时会定义该宏，运行时调用失败时同样改为复制
+#ifndef NODE_API_NO_EXTERNAL_BUFFERS_ALLOWED
+#define FILE_DROP_EXTERNAL_BUFFERS 1
+#endif
 
-std::mutex log_mutex;
-std::queue<LogMessage> log_queue;
+static size_t GetArgs(napi_env env, napi_callback_info info, napi_value* args, size_t count) {
+	size_t argc = count;
+	if (napi_get_cb_info(env, info, &argc, args, nullptr, nullptr) != napi_ok) {
+		return 0;
+	}
+	return argc;
+}
 
-static void LogBase(const std::wstring& info) {
-	if (isolate == NULL)
-	{
-		std::wcerr << L"isolate is null" << std::endl;
-		return;
+static bool IsType(napi_env env, napi_value value, napi_valuetype type) {
+	napi_valuetype actual;
+	return napi_typeof(env, value, &actual) == napi_ok && actual == type;
+}
+
+static bool IsArray(napi_env env, napi_value value) {
+	bool result = false;
+	return napi_is_array(env, value, &result) == napi_ok && result;
+}
+
+static bool ToBoolean(napi_env env, napi_value value) {
+	napi_value coerced;
+	bool result = false;
+	if (napi_coerce_to_bool(env, value, &coerced) == napi_ok) {
+		napi_get_value_bool(env, coerced, &result);
 	}
-	// 声明 HandleScope，确保局部 V8 对象的安全创建
-	v8::HandleScope handle_scope(isolate);
+	return result;
+}
 
-	std::string logStr = WcharToUtf8(info.c_str());
-	// 从 Persistent 句柄获取 Local 句柄用于本次调用
-	if (logCallback.IsEmpty())
-	{
-		std::wcerr << L"logCallback is null" << std::endl;
-		return;
+static bool GetUtf8String(napi_env env, napi_value value, std::string& result) {
+	size_t length = 0;
+	if (napi_get_value_string_utf8(env, value, nullptr, 0, &length) != napi_ok) {
+		return false;
 	}
-	v8::Local<v8::Function> localCallback = v8::Local<v8::Function>::New(isolate, logCallback);
-	v8::Local<v8::Value> argv[1] = {
-		v8::String::NewFromUtf8(isolate, logStr.c_str()).ToLocalChecked()
-	};
-	if (localCallback->IsNull() || localCallback->IsUndefined()) {
-		std::wcerr << L"localCallback is null" << std::endl;
-		return;
+	std::vector<char> buffer(length + 1);
+	if (napi_get_value_string_utf8(env, value, buffer.data(), buffer.size(), &length) != napi_ok) {
+		return false;
 	}
-	localCallback->Call(isolate->GetCurrentContext(),
-		Null(isolate),
-		1, argv).ToLocalChecked();
+	result.assign(buffer.data(), length);
+	return true;
 }
 
-// 异步回调：在 Node.js 主线程上执行
-static void AsyncLogCallback(uv_async_t* handle) {
-	// 必须在这里创建 HandleScope 
-	v8::HandleScope handle_scope(isolate);
+// 读取字符串数组，忽略非字符串元素
+template <typename Container>
+static void GetStringArray(napi_env env, napi_value array, Container& result) {
+	uint32_t length = 0;
+	napi_get_array_length(env, array, &length);
+	for (uint32_t i = 0; i < length; i++) {
+		napi_value element;
+		std::string utf8Str;
+		if (napi_get_element(env, array, i, &element) == napi_ok && IsType(env, element, napi_string)
+			&& GetUtf8String(env, element, utf8Str)) {
+			result.insert(result.end(), Utf8ToWstring(utf8Str));
+		}
+	}
+}
 
-	// 从队列中取出所有等待的日志消息
-	std::lock_guard<std::mutex> lock(log_mutex);
+// 读取配置对象中的属性，类型不符时视为未设置
+static bool GetOption(napi_env env, napi_value options, const char* name, napi_valuetype type, napi_value* value) {
+	return napi_get_named_property(env, options, name, value) == napi_ok && IsType(env, *value, type);
+}
 
-	while (!log_queue.empty()) {
-		LogMessage msg = log_queue.front();
-		log_queue.pop();
+static void SetNumber(napi_env env, napi_value object, const char* name, double value) {
+	napi_value number;
+	napi_create_double(env, value, &number);
+	napi_set_named_property(env, object, name, number);
+}
 
-		// 调用原始的 LogFunc (现在它在主线程上是安全的)
-		// 注意：LogFunc 内部需要被修改，不再需要锁和 HandleScope，因为它现在是被主线程调用的。
-		// 为了避免修改 LogFunc，我们在这里直接调用其逻辑：
-		//std::string logStr = WcharToUtf8(msg.message.c_str());
+static void SetBoolean(napi_env env, napi_value object, const char* name, bool value) {
+	napi_value boolean;
+	napi_get_boolean(env, value, &boolean);
+	napi_set_named_property(env, object, name, boolean);
+}
 
-		// ... (V8 调用逻辑，使用 logCallback 和 isolate) ...
-		LogBase(msg.message);
+static napi_value NewNumberObject(napi_env env, const std::initializer_list<std::pair<const char*, double>>& fields) {
+	napi_value object;
+	napi_create_object(env, &object);
+	for (const auto& field : fields) {
+		SetNumber(env, object, field.first, field.second);
 	}
+	return object;
 }
 
-static void LogFunc(const std::wstring& info) {
-	std::wcout << info << std::endl;
-	// 1. 将日志信息放入线程安全队列
+static LogLevel ParseLogLevel(const std::string& name, LogLevel fallback) {
+	if (name == "debug") return LogLevel::Debug;
+	if (name == "info") return LogLevel::Info;
+	if (name == "error") return LogLevel::Error;
+	if (name == "off") return LogLevel::Off;
+	return fallback;
+}
+
+// 环境销毁时执行（进程退出、Worker 结束），注销事件接收并释放线程安全函数
+static void OnEnvCleanup(void* arg) {
+	AddonInstance* instance = static_cast<AddonInstance*>(arg);
+	LOG_INFO(L"Monitoring stopped by process exit");
+	MouseHook::RemoveEventSink(AddonInstance::OnDragEvent, instance);
+	instance->Close();
+
+	bool last = false;
 	{
-		std::lock_guard<std::mutex> lock(log_mutex);
-		log_queue.push({ info });
+		std::lock_guard<std::mutex> lock(g_instanceMutex);
+		last = --g_activeInstances == 0;
+	}
+	if (last) {
+		MouseHook::UninitMouseHook(kStopTimeoutMillis);
 	}
-
-	// 2. 触发 Libuv 事件，通知主线程执行 AsyncLogCallback
-	// 这是安全的，因为它只发送一个信号，不涉及 V8 对象。
-	uv_async_send(&async_log_handle);
 }
 
-void LogError(const std::wstring& error) {
-	std::wstring logInfo = L"[drop file error] " + error;
-	LogFunc(logInfo);
-}
+static napi_value AwareInitialize(napi_env env, napi_callback_info info) {
+	napi_value args[4];
+	size_t argc = GetArgs(env, info, args, 4);
+	// 检查参数是否有效
+	if (argc < 3) {
+		napi_throw_type_error(env, nullptr, "必须传入两个回调函数和一个字符串数组");
+		return nullptr;
+	}
+	if (!IsArray(env, args[0])) {
+		napi_throw_type_error(env, nullptr, "第一个参数必须是字符串数组");
+		return nullptr;
+	}
+	if (!IsType(env, args[1], napi_function)) {
+		napi_throw_type_error(env, nullptr, "第二个参数必须是回调函数");
+		return nullptr;
+	}
+	if (!IsType(env, args[2], napi_function)) {
+		napi_throw_type_error(env, nullptr, "第三个参数必须是回调函数");
+		return nullptr;
+	}
+	AddonInstance* instance = AddonInstance::Get(env);
+	if (instance == nullptr) {
+		napi_throw_error(env, nullptr, "模块未正确加载");
+		return nullptr;
+	}
 
-void LogInfo(const std::wstring& info) {
-	std::wstring logInfo = L"[drop file info] " + info;
-	LogFunc(logInfo);
-}
+	// 第四个参数为可选的配置对象
+	bool speculative = false;
+	long maxScanItems = 2000;
+	uint32_t maxScanMillis = 200;
+	long maxPaths = 1000;
+	bool verifyContent = false;
+	uint32_t verifyMillis = 50;
+	bool hashContent = false;
+	bool prewarm = false;
+	PrewarmLimits prewarmLimits = {
+		FilePrewarmer::kDefaultMaxBytes, FilePrewarmer::kDefaultMaxFileBytes, FilePrewarmer::kDefaultRetainMillis,
+	};
+	LogLevel logLevel = LogLevel::Info;
+	if (argc > 3 && IsType(env, args[3], napi_object)) {
+		napi_value options = args[3];
+		napi_value value;
+		if (napi_get_named_property(env, options, "speculative", &value) == napi_ok) {
+			speculative = ToBoolean(env, value);
+		}
+		// 选中项扫描预算，0 表示不限制
+		int64_t integer;
+		if (GetOption(env, options, "maxScanItems", napi_number, &value) && napi_get_value_int64(env, value, &integer) == napi_ok) {
+			maxScanItems = (long)integer;
+		}
+		if (GetOption(env, options, "maxScanMillis", napi_number, &value)) {
+			napi_get_value_uint32(env, value, &maxScanMillis);
+		}
+		// 事件中最多携带的匹配路径数，0 表示不限制
+		if (GetOption(env, options, "maxPaths", napi_number, &value) && napi_get_value_int64(env, value, &integer) == napi_ok) {
+			maxPaths = (long)integer;
+		}
+		// 按文件头校验匹配文件的内容（例如拒绝改名为 .pdf 的可执行文件），及每次拖拽的校验时限
+		if (napi_get_named_property(env, options, "verifyContent", &value) == napi_ok) {
+			verifyContent = ToBoolean(env, value);
+		}
+		if (GetOption(env, options, "verifyMillis", napi_number, &value)) {
+			napi_get_value_uint32(env, value, &verifyMillis);
+		}
+		// 拖拽期间在后台计算匹配文件的大小、修改时间和 XXH64，随释放事件的 files 交给 JS
+		// 单个文件以一个核心的 XXH64 速度为上限（约 5 GB/s），大文件的哈希通常在释放之后才完成
+		if (napi_get_named_property(env, options, "hashContent", &value) == napi_ok) {
+			hashContent = ToBoolean(env, value);
+		}
+		// 拖拽期间映射并预读匹配的文件，投放后用 TakePrewarmedBuffer 取得不经复制的 ArrayBuffer
+		// 可以是布尔值，或 { maxBytes?, maxFileBytes?, retainMillis? }，各项为 0 表示不限制
+		if (GetOption(env, options, "prewarm", napi_object, &value)) {
+			prewarm = true;
+			napi_value limit;
+			double number;
+			if (GetOption(env, value, "maxBytes", napi_number, &limit) && napi_get_value_double(env, limit, &number) == napi_ok) {
+				prewarmLimits.maxBytes = number > 0 ? (uint64_t)number : 0;
+			}
+			if (GetOption(env, value, "maxFileBytes", napi_number, &limit) && napi_get_value_double(env, limit, &number) == napi_ok) {
+				prewarmLimits.maxFileBytes = number > 0 ? (uint64_t)number : 0;
+			}
+			if (GetOption(env, value, "retainMillis", napi_number, &limit)) {
+				napi_get_value_uint32(env, limit, &prewarmLimits.retainMillis);
+			}
+		}
+		else if (napi_get_named_property(env, options, "prewarm", &value) == napi_ok) {
+			prewarm = ToBoolean(env, value);
+		}
+		// 日志级别："debug" | "info" | "error" | "off"
+		std::string levelName;
+		if (GetOption(env, options, "logLevel", napi_string, &value) && GetUtf8String(env, value, levelName)) {
+			logLevel = ParseLogLevel(levelName, logLevel);
+		}
+	}
+
+	Logger::SetLevel(logLevel);
+
+	// 同一环境重复调用时只替换回调
+	bool firstBind = !instance->IsBound();
+	if (!instance->Bind(env, args[1], args[2])) {
+		return nullptr;
+	}
+	if (firstBind) {
+		MouseHook::AddEventSink(AddonInstance::OnDragEvent, instance);
+		napi_add_env_cleanup_hook(env, OnEnvCleanup, instance);
+		std::lock_guard<std::mutex> lock(g_instanceMutex);
+		g_activeInstances++;
+	}
+
+	std::set<std::wstring> targetExtensions;
+	GetStringArray(env, args[0], targetExtensions);
 
-static void OnExit(void* arg) {
-	LogInfo(L"Monitoring stopped by process exit");
+	if (Logger::IsEnabled(LogLevel::Debug)) {
+		std::wstring setContents;
+		for (const std::wstring& wstr : targetExtensions) {
+			setContents += wstr + L" ";
+		}
+		Logger::Write(LogLevel::Debug, L"Target extensions: " + setContents);
+	}
+	// 扩展名、预测模式和扫描预算是进程级的，以最后一次调用为准
+	{
+		std::lock_guard<std::mutex> lock(g_instanceMutex);
+		g_configured = true;
+	}
+	FileDetector::SetExtensions(targetExtensions);
+	MouseHook::SetSpeculativeMode(speculative);
+	MouseHook::SetContentHashing(hashContent);
+	FilePrewarmer::SetLimits(prewarmLimits);
+	MouseHook::SetPrewarming(prewarm);
+	FileDetector::SetScanBudget(maxScanItems, maxScanMillis);
+	FileDetector::SetMaxPaths(maxPaths);
+	FileDetector::SetContentVerification(verifyContent, verifyMillis);
+	// 钩子运行在独立线程上，这里不再阻塞 Node.js 事件循环
+	if (!MouseHook::InitMouseHook(kStopTimeoutMillis)) {
+		napi_throw_error(env, nullptr, "鼠标钩子安装失败");
+	}
+	return nullptr;
 }
 
-static void HandleExist(uv_signal_s* handle, int signal) {
-	LogInfo(L"Monitoring stopped by user");
+// Start/Stop 在线程池上执行，安装钩子和等待线程退出都不占用 JS 线程
+enum class LifecycleAction {
+	Start,
+	Stop,
+};
+
+struct LifecycleWork {
+	napi_async_work work;
+	napi_deferred deferred;
+	LifecycleAction action;
+	bool succeeded;
+};
+
+static void ExecuteLifecycle(napi_env env, void* data) {
+	LifecycleWork* work = static_cast<LifecycleWork*>(data);
+	if (work->action == LifecycleAction::Start) {
+		work->succeeded = MouseHook::InitMouseHook(kStopTimeoutMillis);
+	}
+	else {
+		work->succeeded = MouseHook::UninitMouseHook(kStopTimeoutMillis);
+		if (work->succeeded) {
+			LOG_INFO(L"Monitoring stopped.");
+		}
+	}
 }
 
-static void AwareInitialize(const v8::FunctionCallbackInfo<v8::Value>& args) {
-	isolate = args.GetIsolate();
-	v8::Local<v8::Context> context = isolate->GetCurrentContext();
-	// 检查参数是否有效
-	if (args.Length() < 3) {
-		isolate->ThrowException(v8::Exception::TypeError(
-			v8::String::NewFromUtf8(isolate, "必须传入两个回调函数和一个字符串数组").ToLocalChecked()));
-		return;
+static void CompleteLifecycle(napi_env env, napi_status status, void* data) {
+	std::unique_ptr<LifecycleWork> work(static_cast<LifecycleWork*>(data));
+	if (status == napi_ok && work->succeeded) {
+		napi_value undefined;
+		napi_get_undefined(env, &undefined);
+		napi_resolve_deferred(env, work->deferred, undefined);
+	}
+	else {
+		const char* message = work->action == LifecycleAction::Start ? "鼠标钩子安装失败" : "鼠标钩子停止超时";
+		napi_value text;
+		napi_value error;
+		napi_create_string_utf8(env, message, NAPI_AUTO_LENGTH, &text);
+		napi_create_error(env, nullptr, text, &error);
+		napi_reject_deferred(env, work->deferred, error);
 	}
-	if (!args[0]->IsArray()) {
-		isolate->ThrowException(v8::Exception::TypeError(
-			v8::String::NewFromUtf8(isolate, "第一个参数必须是字符串数组").ToLocalChecked()));
-		return;
+	napi_delete_async_work(env, work->work);
+}
+
+static napi_value QueueLifecycle(napi_env env, LifecycleAction action) {
+	std::unique_ptr<LifecycleWork> work(new LifecycleWork{ nullptr, nullptr, action, false });
+	napi_value promise;
+	napi_value name;
+	if (napi_create_promise(env, &work->deferred, &promise) != napi_ok) {
+		return nullptr;
 	}
-	if (!args[1]->IsFunction()) {
-		isolate->ThrowException(v8::Exception::TypeError(
-			v8::String::NewFromUtf8(isolate, "第二个参数必须是回调函数").ToLocalChecked()));
-		return;
+	napi_create_string_utf8(env, action == LifecycleAction::Start ? "FileDropAware.start" : "FileDropAware.stop",
+		NAPI_AUTO_LENGTH, &name);
+	if (napi_create_async_work(env, nullptr, name, ExecuteLifecycle, CompleteLifecycle, work.get(), &work->work) != napi_ok) {
+		return nullptr;
 	}
-	if (!args[2]->IsFunction()) {
-		isolate->ThrowException(v8::Exception::TypeError(
-			v8::String::NewFromUtf8(isolate, "第三个参数必须是回调函数").ToLocalChecked()));
-		return;
+	if (napi_queue_async_work(env, work->work) != napi_ok) {
+		napi_delete_async_work(env, work->work);
+		return nullptr;
 	}
+	work.release();
+	return promise;
+}
 
-	uv_async_init(uv_default_loop(), &async_log_handle, AsyncLogCallback);
+static napi_value ResolvedPromise(napi_env env) {
+	napi_deferred deferred;
+	napi_value promise;
+	napi_value undefined;
+	if (napi_create_promise(env, &deferred, &promise) != napi_ok) {
+		return nullptr;
+	}
+	napi_get_undefined(env, &undefined);
+	napi_resolve_deferred(env, deferred, undefined);
+	return promise;
+}
 
-	node::Environment* env = node::GetCurrentEnvironment(isolate->GetCurrentContext());
-	if (env)
+// Start()：按当前的匹配规则和配置重新安装钩子，返回 Promise，已在运行时直接完成
+static napi_value Start(napi_env env, napi_callback_info info) {
 	{
-		node::AtExit(env, OnExit, nullptr);
+		std::lock_guard<std::mutex> lock(g_instanceMutex);
+		if (!g_configured) {
+			napi_throw_error(env, nullptr, "请先调用 AwareInitialize");
+			return nullptr;
+		}
+	}
+	return QueueLifecycle(env, LifecycleAction::Start);
+}
+
+// Stop()：卸载钩子并停止检测线程，返回 Promise；超时未停止时 reject，之后可以再次调用
+// 回调保持绑定，日志仍会投递，之后可以用 Start 重新开始
+static napi_value Stop(napi_env env, napi_callback_info info) {
+	return QueueLifecycle(env, LifecycleAction::Stop);
+}
+
+// Pause()：钩子保持安装但跳过所有检测，Resume() 恢复，无需重新安装；均返回已完成的 Promise
+static napi_value Pause(napi_env env, napi_callback_info info) {
+	MouseHook::SetPaused(true);
+	return ResolvedPromise(env);
+}
+
+static napi_value Resume(napi_env env, napi_callback_info info) {
+	MouseHook::SetPaused(false);
+	return ResolvedPromise(env);
+}
+
+// UpdateRules(rules)：替换匹配规则，不重新安装钩子，正在进行的检测继续使用旧规则
+// rules 为扩展名数组，或 { extensions?: string[], globs?: string[], exclude?: string[] }
+//   globs：文件名通配符，例如 "report_*.xlsx"，'*' 匹配任意个字符，'?' 匹配一个字符
+//   exclude：排除的文件名通配符，例如 "~$*"、"*.tmp"，优先于前两项
+static napi_value UpdateRules(napi_env env, napi_callback_info info) {
+	napi_value args[1];
+	size_t argc = GetArgs(env, info, args, 1);
+	MatchRuleSet rules;
+	if (argc >= 1 && IsArray(env, args[0])) {
+		GetStringArray(env, args[0], rules.extensions);
+	}
+	else if (argc >= 1 && IsType(env, args[0], napi_object)) {
+		napi_value value;
+		if (napi_get_named_property(env, args[0], "extensions", &value) == napi_ok && IsArray(env, value)) {
+			GetStringArray(env, value, rules.extensions);
+		}
+		if (napi_get_named_property(env, args[0], "globs", &value) == napi_ok && IsArray(env, value)) {
+			GetStringArray(env, value, rules.globs);
+		}
+		if (napi_get_named_property(env, args[0], "exclude", &value) == napi_ok && IsArray(env, value)) {
+			GetStringArray(env, value, rules.exclusions);
+		}
 	}
 	else {
-		std::wcerr << L"env is null" << std::endl;
-		// LogError(L"env is null");
+		napi_throw_type_error(env, nullptr, "参数必须是扩展名数组或规则对象");
+		return nullptr;
 	}
 
-	MouseHook::SetIsolate(isolate);
-	v8::Local<v8::Function> callBack = v8::Local<v8::Function>::Cast(args[1]);
-	MouseHook::SetFileDropCallback(callBack);
-	
-	// ❗ 关键修正：存储 Persistent 句柄
-	v8::Local<v8::Function> logFunc = v8::Local<v8::Function>::Cast(args[2]);
-	if (!logCallback.IsEmpty()) {
-		logCallback.Reset(); // 释放旧的引用
+	FileDetector::SetRules(rules);
+	LOG_INFO(L"Match rules updated: " + std::to_wstring(rules.extensions.size()) + L" extensions, "
+		+ std::to_wstring(rules.globs.size()) + L" globs, " + std::to_wstring(rules.exclusions.size()) + L" exclusions.");
+	return nullptr;
+}
+
+// 返回预测模式的命中统计 { used, wasted }
+static napi_value GetSpeculationStats(napi_env env, napi_callback_info info) {
+	SpeculationStats stats = DetectorWorker::GetSpeculationStats();
+	return NewNumberObject(env, {
+		{ "used", (double)stats.used },
+		{ "wasted", (double)stats.wasted },
+	});
+}
+
+// 返回选中项缓存的命中统计 { hits, misses, hitRate }
+static napi_value GetSelectionCacheStats(napi_env env, napi_callback_info info) {
+	SelectionCacheStats stats = SelectionCache::GetStats();
+	unsigned long long total = stats.hits + stats.misses;
+	return NewNumberObject(env, {
+		{ "hits", (double)stats.hits },
+		{ "misses", (double)stats.misses },
+		{ "hitRate", total == 0 ? 0.0 : (double)stats.hits / (double)total },
+	});
+}
+
+// 返回内容校验的统计 { cacheHits, cacheMisses, rejected, timedOut }
+static napi_value GetContentSniffStats(napi_env env, napi_callback_info info) {
+	SniffStats stats = ContentSniffer::GetStats();
+	return NewNumberObject(env, {
+		{ "cacheHits", (double)stats.cacheHits },
+		{ "cacheMisses", (double)stats.cacheMisses },
+		{ "rejected", (double)stats.rejected },
+		{ "timedOut", (double)stats.timedOut },
+	});
+}
+
+// 取消所有进行中的后台哈希，例如投放没有落在应用的窗口上；已取消的文件 status 为 "cancelled"
+static napi_value CancelHashing(napi_env env, napi_callback_info info) {
+	FileHasher::CancelAll();
+	return nullptr;
+}
+
+// 返回后台哈希的统计 { files, bytes, failed, cancelled }
+static napi_value GetHashStats(napi_env env, napi_callback_info info) {
+	HashStats stats = FileHasher::GetStats();
+	return NewNumberObject(env, {
+		{ "files", (double)stats.files },
+		{ "bytes", (double)stats.bytes },
+		{ "failed", (double)stats.failed },
+		{ "cancelled", (double)stats.cancelled },
+	});
+}
+
+#ifdef FILE_DROP_EXTERNAL_BUFFERS
+// 已交给 JS 且尚未释放的外部 ArrayBuffer，以数据指针为键，值为其持有的映射引用；Worker 各自调用，需要加锁
+static std::mutex g_externalMutex;
+static std::unordered_map<void*, std::shared_ptr<MappedFile>*> g_externalBuffers;
+
+// 每个外部 ArrayBuffer 持有一份映射的引用，被回收时释放，最后一份引用释放时解除映射
+// 已被 ReleasePrewarmedBuffer 释放的缓冲区只剩一个空引用；同一地址可能已被新的映射复用，只移除自己的登记
+static void ReleaseMapping(napi_env env, void* data, void* hint) {
+	std::shared_ptr<MappedFile>* owner = static_cast<std::shared_ptr<MappedFile>*>(hint);
+	{
+		std::lock_guard<std::mutex> lock(g_externalMutex);
+		auto it = g_externalBuffers.find(data);
+		if (it != g_externalBuffers.end() && it->second == owner) {
+			g_externalBuffers.erase(it);
+		}
 	}
-	logCallback.Reset(isolate, logFunc); // 存储新的 Persistent 引用
+	delete owner;
+}
+#endif
 
-	v8::Local<v8::Array> jsArray = v8::Local<v8::Array>::Cast(args[0]);
-	uint32_t arrayLength = jsArray->Length();
-	std::set<std::wstring> targetExtensions;
+// TakePrewarmedBuffer(path)：取走预热的文件内容，返回直接指向映射的 ArrayBuffer，不复制到 V8 堆
+// 每个文件只能取走一次；未预热、已淘汰、尚未映射完成或文件在映射后被修改时返回 null，调用方改为自行读取
+// 缓冲区可以写入，写入不会修改文件；不支持外部 ArrayBuffer 的运行时上复制一次
+// 映射一直保留到缓冲区被回收，用完后应调用 ReleasePrewarmedBuffer 立即释放（Windows 上映射期间文件无法被截断或替换）
+static napi_value TakePrewarmedBuffer(napi_env env, napi_callback_info info) {
+	napi_value args[1];
+	size_t argc = GetArgs(env, info, args, 1);
+	std::string path;
+	if (argc < 1 || !IsType(env, args[0], napi_string) || !GetUtf8String(env, args[0], path)) {
+		napi_throw_type_error(env, nullptr, "第一个参数必须是文件路径");
+		return nullptr;
+	}
+	napi_value result;
+	std::shared_ptr<MappedFile> file = FilePrewarmer::Take(Utf8ToWstring(path));
+	if (!file) {
+		napi_get_null(env, &result);
+		return result;
+	}
+	// 写时复制的视图，ArrayBuffer 需要可写的指针
+	void* data = const_cast<uint8_t*>(file->Data());
+	size_t size = file->Size();
+#ifdef FILE_DROP_EXTERNAL_BUFFERS
+	if (size > 0) {
+		std::shared_ptr<MappedFile>* owner = new std::shared_ptr<MappedFile>(file);
+		if (napi_create_external_arraybuffer(env, data, size, ReleaseMapping, owner, &result) == napi_ok) {
+			std::lock_guard<std::mutex> lock(g_externalMutex);
+			g_externalBuffers[data] = owner;
+			return result;
+		}
+		delete owner;
+	}
+#endif
+	void* copy = nullptr;
+	if (napi_create_arraybuffer(env, size, &copy, &result) != napi_ok) {
+		return nullptr;
+	}
+	if (size > 0) {
+		memcpy(copy, data, size);
+	}
+	return result;
+}
 
-	for (uint32_t i = 0; i < arrayLength; i++) {
-		v8::Local<v8::Value> element;
-		if (jsArray->Get(context, i).ToLocal(&element)) {
-			if (element->IsString()) {
-				// 将JavaScript字符串转换为std::string
-				v8::String::Utf8Value utf8Str(isolate, element);
-				if (*utf8Str) {
-					// 转换为std::wstring并添加到集合
-					std::wstring wstr = Utf8ToWstring(*utf8Str);
-					targetExtensions.insert(wstr);
-				}
+// ReleasePrewarmedBuffer(buffer)：立即释放 TakePrewarmedBuffer 返回的缓冲区，不必等待 GC
+// 缓冲区被分离 (detached)，之后长度为 0、不能再访问；Windows 上释放后其他程序才能修改或替换该文件
+// 返回是否释放了映射；复制得到的缓冲区、已释放的缓冲区或其它 ArrayBuffer 返回 false 且不受影响
+static napi_value ReleasePrewarmedBuffer(napi_env env, napi_callback_info info) {
+	napi_value args[1];
+	size_t argc = GetArgs(env, info, args, 1);
+	bool isArrayBuffer = false;
+	if (argc < 1 || napi_is_arraybuffer(env, args[0], &isArrayBuffer) != napi_ok || !isArrayBuffer) {
+		napi_throw_type_error(env, nullptr, "第一个参数必须是 ArrayBuffer");
+		return nullptr;
+	}
+	bool released = false;
+#ifdef FILE_DROP_EXTERNAL_BUFFERS
+	void* data = nullptr;
+	size_t size = 0;
+	if (napi_get_arraybuffer_info(env, args[0], &data, &size) == napi_ok && data != nullptr) {
+		std::shared_ptr<MappedFile> file;
+		{
+			std::lock_guard<std::mutex> lock(g_externalMutex);
+			auto it = g_externalBuffers.find(data);
+			if (it != g_externalBuffers.end()) {
+				file = *it->second;
 			}
 		}
+		// 先分离，确认 JS 再也无法访问这段内存之后才解除映射；分离时运行时可能直接调用 ReleaseMapping，不能持有锁
+		if (file && napi_detach_arraybuffer(env, args[0]) == napi_ok) {
+			std::lock_guard<std::mutex> lock(g_externalMutex);
+			auto it = g_externalBuffers.find(data);
+			if (it != g_externalBuffers.end() && *it->second == file) {
+				it->second->reset();
+				g_externalBuffers.erase(it);
+			}
+			released = true;
+		}
+		// file 是最后一份引用，离开作用域时解除映射
+	}
+#endif
+	napi_value result;
+	napi_get_boolean(env, released, &result);
+	return result;
+}
+
+// 释放所有尚未取走的预热映射，已取走的缓冲区不受影响
+static napi_value ClearPrewarmed(napi_env env, napi_callback_info info) {
+	FilePrewarmer::Clear();
+	return nullptr;
+}
+
+// 返回文件预热的统计 { files, bytes, taken, evicted, skipped }，bytes 为当前缓存的映射字节数
+static napi_value GetPrewarmStats(napi_env env, napi_callback_info info) {
+	PrewarmStats stats = FilePrewarmer::GetStats();
+	return NewNumberObject(env, {
+		{ "files", (double)stats.files },
+		{ "bytes", (double)stats.bytes },
+		{ "taken", (double)stats.taken },
+		{ "evicted", (double)stats.evicted },
+		{ "skipped", (double)stats.skipped },
+	});
+}
+
+// 返回鼠标钩子的健康计数 { calls, overruns, timeouts, reinstalls, degradations, degraded, maxMillis, droppedEvents }
+// droppedEvents 为当前环境因事件队列已满而丢弃的拖拽事件数
+static napi_value GetHookHealth(napi_env env, napi_callback_info info) {
+	HookHealth health = MouseHook::GetHookHealth();
+	AddonInstance* instance = AddonInstance::Get(env);
+	napi_value result = NewNumberObject(env, {
+		{ "calls", (double)health.calls },
+		{ "overruns", (double)health.overruns },
+		{ "timeouts", (double)health.timeouts },
+		{ "reinstalls", (double)health.reinstalls },
+		{ "degradations", (double)health.degradations },
+		{ "maxMillis", PipelineStats::TicksToMillis((int64_t)health.maxTicks) },
+		{ "droppedEvents", instance != nullptr ? (double)instance->DroppedEvents() : 0.0 },
+	});
+	SetBoolean(env, result, "degraded", health.degraded);
+	return result;
+}
+
+// StartRecording(path, maxBytes?)：开始录制钩子收到的原始鼠标事件，maxBytes 默认 64MB
+static napi_value StartRecording(napi_env env, napi_callback_info info) {
+	napi_value args[2];
+	size_t argc = GetArgs(env, info, args, 2);
+	std::string path;
+	AddonInstance* instance = AddonInstance::Get(env);
+	if (argc < 1 || !IsType(env, args[0], napi_string) || !GetUtf8String(env, args[0], path)) {
+		napi_throw_type_error(env, nullptr, "第一个参数必须是文件路径");
+		return nullptr;
+	}
+	double maxBytes = 64.0 * 1024 * 1024;
+	if (argc > 1 && IsType(env, args[1], napi_number)) {
+		napi_get_value_double(env, args[1], &maxBytes);
+	}
+	if (instance != nullptr) {
+		instance->RecordingPath() = Utf8ToWstring(path);
 	}
+	if (!MouseHook::StartRecording(maxBytes > 0 ? (size_t)maxBytes : 0)) {
+		napi_throw_error(env, nullptr, "鼠标钩子未运行，无法录制");
+	}
+	return nullptr;
+}
 
-	std::wstring setContents;
-	for (std::wstring wstr : targetExtensions) {
-		setContents += wstr + L" ";
+// StopRecording()：停止录制并写入文件，返回 { count, dropped, bytes }，未在录制时返回 null
+static napi_value StopRecording(napi_env env, napi_callback_info info) {
+	std::vector<uint8_t> stream;
+	uint64_t count = 0;
+	uint64_t dropped = 0;
+	AddonInstance* instance = AddonInstance::Get(env);
+	if (!MouseHook::StopRecording(stream, count, dropped)) {
+		napi_value result;
+		napi_get_null(env, &result);
+		return result;
 	}
-	std::wcout << L"Target extensions: " << setContents << std::endl;
-	MouseHook::InitMouseHook(targetExtensions);
+	if (instance == nullptr || !WriteBinaryFile(instance->RecordingPath(), stream.data(), stream.size())) {
+		napi_throw_error(env, nullptr, "录制文件写入失败");
+		return nullptr;
+	}
+
+	return NewNumberObject(env, {
+		{ "count", (double)count },
+		{ "dropped", (double)dropped },
+		{ "bytes", (double)stream.size() },
+	});
 }
 
-void Initialize(v8::Local<v8::Object> exports) {
-	NODE_SET_METHOD(exports, "AwareInitialize", AwareInitialize);
+// 导出枚举常量，例如 { Supported: 0, Released: 1, Inconclusive: 2 }
+static void ExportEnum(napi_env env, napi_value exports, const char* name,
+	const std::initializer_list<std::pair<const char*, int>>& values) {
+	napi_value object;
+	napi_create_object(env, &object);
+	for (const auto& value : values) {
+		napi_value number;
+		napi_create_int32(env, value.second, &number);
+		napi_set_named_property(env, object, value.first, number);
+	}
+	napi_set_named_property(env, exports, name, object);
+}
 
-	uv_signal_t* signalHandler = new uv_signal_t;
-	uv_signal_init(uv_default_loop(), signalHandler);
-	uv_signal_start(signalHandler, HandleExist, SIGTERM);
+// 返回各阶段的耗时统计 { stage: { count, p50, p90, p99, max } }，单位为毫秒
+// 默认在读取后开始新的统计窗口，传入 false 时只读取不清零
+static napi_value GetStats(napi_env env, napi_callback_info info) {
+	napi_value args[1];
+	size_t argc = GetArgs(env, info, args, 1);
+	bool reset = argc < 1 || ToBoolean(env, args[0]);
+
+	napi_value result;
+	napi_create_object(env, &result);
+	for (int i = 0; i < (int)PipelineStage::Count; i++) {
+		PipelineStage stage = (PipelineStage)i;
+		LatencySummary summary = PipelineStats::Summarize(stage, reset);
+		napi_value item = NewNumberObject(env, {
+			{ "count", (double)summary.count },
+			{ "p50", summary.p50 / 1000.0 },
+			{ "p90", summary.p90 / 1000.0 },
+			{ "p99", summary.p99 / 1000.0 },
+			{ "max", summary.max / 1000.0 },
+		});
+		napi_set_named_property(env, result, PipelineStats::StageName(stage), item);
+	}
+	return result;
 }
 
-NODE_MODULE(NODE_GYP_MODULE_NAME, Initialize)
+// 上下文感知的模块：主线程和每个 Worker 各自加载一次，各有独立的 AddonInstance
+NAPI_MODULE_INIT() {
+	if (AddonInstance::Create(env) == nullptr) {
+		napi_throw_error(env, nullptr, "模块初始化失败");
+		return nullptr;
+	}
+
+	const napi_property_descriptor methods[] = {
+		{ "AwareInitialize", nullptr, AwareInitialize, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "GetSpeculationStats", nullptr, GetSpeculationStats, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "GetSelectionCacheStats", nullptr, GetSelectionCacheStats, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "GetContentSniffStats", nullptr, GetContentSniffStats, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "CancelHashing", nullptr, CancelHashing, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "GetHashStats", nullptr, GetHashStats, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "TakePrewarmedBuffer", nullptr, TakePrewarmedBuffer, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "ReleasePrewarmedBuffer", nullptr, ReleasePrewarmedBuffer, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "ClearPrewarmed", nullptr, ClearPrewarmed, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "GetPrewarmStats", nullptr, GetPrewarmStats, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "GetStats", nullptr, GetStats, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "GetHookHealth", nullptr, GetHookHealth, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "StartRecording", nullptr, StartRecording, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "StopRecording", nullptr, StopRecording, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "UpdateRules", nullptr, UpdateRules, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "Start", nullptr, Start, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "Stop", nullptr, Stop, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "Pause", nullptr, Pause, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "Resume", nullptr, Resume, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+	};
+	napi_define_properties(env, exports, sizeof(methods) / sizeof(methods[0]), methods);
+	// 拖拽事件对象 { kind, timestamp, x, y, shell, matchCount, paths } 中 kind 和 shell 的取值
+	ExportEnum(env, exports, "DragEventKind", {
+		{ "Supported", (int)DragEventKind::Supported },
+		{ "Released", (int)DragEventKind::Released },
+		{ "Inconclusive", (int)DragEventKind::Inconclusive },
+		{ "Hashed", (int)DragEventKind::Hashed },
+	});
+	ExportEnum(env, exports, "ShellKind", {
+		{ "Unknown", (int)DragShellKind::Unknown },
+		{ "Desktop", (int)DragShellKind::Desktop },
+		{ "Explorer", (int)DragShellKind::Explorer },
+		{ "Xdnd", (int)DragShellKind::Xdnd },
+	});
+	return exports;
+}
 
 //int main()
 //{
@@ -0,0 +1,320 @@
+﻿#include "FileHasher.h"
+#include "MappedFile.h"
+#include "Xxh64.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+static std::mutex g_poolMutex;
+static std::condition_variable g_workAvailable;
+// 仍有文件未领取的任务
+static std::deque<std::shared_ptr<HashJob>> g_queue;
+// 尚未完成的任务，用于取消；已完成或已释放的条目在下次提交时清理
+static std::vector<std::weak_ptr<HashJob>> g_active;
+// 线程对象只在 join 之后释放：停止超时时线程可能仍卡在 IO 上，进程退出时不能析构可 join 的 std::thread
+static std::vector<std::thread*> g_threads;
+// RequestStop 置位，Stop join 所有线程后复位
+static bool g_stopping = false;
+
+static std::atomic<unsigned long long> g_files(0);
+static std::atomic<unsigned long long> g_bytes(0);
+static std::atomic<unsigned long long> g_failed(0);
+static std::atomic<unsigned long long> g_cancelled(0);
+
+// 哈希以计算和顺序读取为主，留出一半核心给拖拽本身和前台应用
+static unsigned PoolSize() {
+	unsigned count = std::thread::hardware_concurrency() / 2;
+	return count < 1 ? 1 : (count > 4 ? 4 : count);
+}
+
+HashJob::HashJob(std::shared_ptr<const MatchedPaths> paths, HashCompleteCallback callback, void* context)
+	: m_paths(std::move(paths)), m_entries(new Entry[m_paths->Count()]), m_callback(callback), m_context(context),
+	m_nextStat(0), m_nextHash(0), m_remaining(m_paths->Count()), m_state(0), m_cancelled(false) {
+	for (size_t i = 0; i < m_paths->Count(); i++) {
+		m_entries[i].status.store((uint8_t)HashStatus::Pending, std::memory_order_relaxed);
+		m_entries[i].size.store(0, std::memory_order_relaxed);
+		m_entries[i].mtime.store(0, std::memory_order_relaxed);
+		m_entries[i].digest.store(0, std::memory_order_relaxed);
+	}
+	if (m_paths->Count() == 0) {
+		m_state.store(kFinished, std::memory_order_relaxed);
+	}
+}
+
+FileHashResult HashJob::Get(size_t index) const {
+	const Entry& entry = m_entries[index];
+	FileHashResult result;
+	result.status = (HashStatus)entry.status.load(std::memory_order_acquire);
+	result.size = entry.size.load(std::memory_order_relaxed);
+	uint64_t mtime = entry.mtime.load(std::memory_order_relaxed);
+	result.mtime = mtime == 0 ? 0.0 : MappedFile::MtimeToUnixMillis(mtime);
+	result.digest = entry.digest.load(std::memory_order_relaxed);
+	return result;
+}
+
+bool HashJob::Seal() {
+	// 与 FinishEntry 中的 fetch_or 配对：两者中后到的一方看到对方的标记，回调恰好发生一次
+	unsigned previous = m_state.fetch_or(kSealed, std::memory_order_acq_rel);
+	return (previous & kFinished) != 0;
+}
+
+void HashJob::FinishEntry() {
+	if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+		return;
+	}
+	unsigned previous = m_state.fetch_or(kFinished, std::memory_order_acq_rel);
+	if ((previous & kSealed) != 0 && m_callback != nullptr) {
+		m_callback(m_context, shared_from_this());
+	}
+}
+
+void FileHasher::StampFile(HashJob& job, size_t index) {
+	if (job.Cancelled()) {
+		return;
+	}
+	HashJob::Entry& entry = job.m_entries[index];
+	FileStamp stamp;
+	bool offline = false;
+	if (!MappedFile::Stat(job.m_paths->PathAt(index), stamp, offline)) {
+		return;
+	}
+	entry.size.store(stamp.size, std::memory_order_relaxed);
+	entry.mtime.store(stamp.mtime, std::memory_order_relaxed);
+	// 哈希阶段可能已经先一步完成了这个文件，不能把状态改回去
+	uint8_t expected = (uint8_t)HashStatus::Pending;
+	entry.status.compare_exchange_strong(expected, (uint8_t)HashStatus::Stamped, std::memory_order_acq_rel);
+}
+
+#ifdef _WIN32
+// 映射期间文件被截断时，访问已不存在的页面产生 EXCEPTION_IN_PAGE_ERROR，这里按读取失败处理
+static bool UpdateHash(Xxh64& hash, const uint8_t* data, size_t length) {
+	__try {
+		hash.Update(data, length);
+	}
+	__except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH) {
+		return false;
+	}
+	return true;
+}
+
+// 按窗口依次映射，计算当前窗口的同时预读下一个窗口
+static HashStatus HashContent(HashJob& job, MappedFile& file, Xxh64& hash) {
+	uint64_t size = file.Stamp().size;
+	uint64_t offset = 0;
+	while (offset < size) {
+		if (!file.Map(offset, FileHasher::kWindowBytes) || file.Size() == 0) {
+			return HashStatus::Failed;
+		}
+		const uint8_t* data = file.Data();
+		size_t length = file.Size();
+		file.Prefetch(offset + length, FileHasher::kWindowBytes);
+		for (size_t done = 0; done < length; done += FileHasher::kChunkBytes) {
+			if (job.Cancelled()) {
+				return HashStatus::Cancelled;
+			}
+			size_t chunk = length - done < FileHasher::kChunkBytes ? length - done : FileHasher::kChunkBytes;
+			if (!UpdateHash(hash, data + done, chunk)) {
+				return HashStatus::Failed;
+			}
+		}
+		offset += length;
+		g_bytes += length;
+	}
+	return HashStatus::Done;
+}
+#else
+// 每个线程复用的读取缓冲区
+static thread_local std::vector<uint8_t> t_buffer;
+
+// 映射期间文件被截断产生的 SIGBUS 无法在不影响宿主进程的前提下捕获，这里用 pread 读入复用的缓冲区，
+// 截断只会读到较少的数据，按读取失败处理；每进入一个窗口时预读下一个窗口，保持与映射相同的预读距离
+static HashStatus HashContent(HashJob& job, MappedFile& file, Xxh64& hash) {
+	t_buffer.resize(FileHasher::kChunkBytes);
+	uint64_t size = file.Stamp().size;
+	uint64_t offset = 0;
+	while (offset < size) {
+		if (job.Cancelled()) {
+			return HashStatus::Cancelled;
+		}
+		if (offset % FileHasher::kWindowBytes == 0) {
+			file.Prefetch(offset + FileHasher::kWindowBytes, FileHasher::kWindowBytes);
+		}
+		size_t chunk = size - offset < FileHasher::kChunkBytes ? (size_t)(size - offset) : FileHasher::kChunkBytes;
+		size_t read = 0;
+		if (!file.Read(offset, t_buffer.data(), chunk, read) || read == 0) {
+			return HashStatus::Failed;
+		}
+		hash.Update(t_buffer.data(), read);
+		offset += read;
+		g_bytes += read;
+	}
+	return HashStatus::Done;
+}
+#endif
+
+void FileHasher::HashFile(HashJob& job, size_t index) {
+	HashJob::Entry& entry = job.m_entries[index];
+	HashStatus status = HashStatus::Failed;
+	if (job.Cancelled()) {
+		status = HashStatus::Cancelled;
+	}
+	else {
+		std::wstring path = job.m_paths->PathAt(index);
+		MappedFile file;
+		bool offline = false;
+		FileStamp stamp;
+		// 仅联机文件不计算哈希，读取会触发下载
+		if (MappedFile::Stat(path, stamp, offline) && !offline && file.Open(path, true)) {
+			// 以打开后的元数据为准
+			entry.size.store(file.Stamp().size, std::memory_order_relaxed);
+			entry.mtime.store(file.Stamp().mtime, std::memory_order_relaxed);
+			uint8_t expected = (uint8_t)HashStatus::Pending;
+			entry.status.compare_exchange_strong(expected, (uint8_t)HashStatus::Stamped, std::memory_order_acq_rel);
+
+			Xxh64 hash;
+			status = HashContent(job, file, hash);
+			file.Close();
+			if (status == HashStatus::Done) {
+				entry.digest.store(hash.Digest(), std::memory_order_relaxed);
+			}
+		}
+	}
+
+	switch (status)
+	{
+	case HashStatus::Done: g_files++; break;
+	case HashStatus::Cancelled: g_cancelled++; break;
+	default: g_failed++; break;
+	}
+	entry.status.store((uint8_t)status, std::memory_order_release);
+	job.FinishEntry();
+}
+
+void FileHasher::WorkerProc() {
+#ifdef _WIN32
+	// 哈希不能与前台抢占 CPU
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#endif
+	std::unique_lock<std::mutex> lock(g_poolMutex);
+	for (;;) {
+		g_workAvailable.wait(lock, []() { return g_stopping || !g_queue.empty(); });
+		if (g_stopping) {
+			break;
+		}
+		std::shared_ptr<HashJob> job = g_queue.front();
+		size_t count = job->Count();
+		// 先为所有文件取得元数据，释放时即使哈希还没完成也能给出大小和修改时间
+		size_t index = job->m_nextStat.fetch_add(1, std::memory_order_relaxed);
+		bool stamp = index < count;
+		if (!stamp) {
+			index = job->m_nextHash.fetch_add(1, std::memory_order_relaxed);
+			if (index >= count) {
+				if (!g_queue.empty() && g_queue.front() == job) {
+					g_queue.pop_front();
+				}
+				continue;
+			}
+		}
+
+		lock.unlock();
+		try {
+			if (stamp) {
+				StampFile(*job, index);
+			}
+			else {
+				HashFile(*job, index);
+			}
+		}
+		catch (...) {
+		}
+		job.reset();
+		lock.lock();
+	}
+}
+
+std::shared_ptr<HashJob> FileHasher::Begin(std::shared_ptr<const MatchedPaths> paths, HashCompleteCallback callback, void* context) {
+	std::shared_ptr<HashJob> job = std::make_shared<HashJob>(std::move(paths), callback, context);
+	if (job->Count() == 0) {
+		return job;
+	}
+	std::lock_guard<std::mutex> lock(g_poolMutex);
+	if (g_stopping) {
+		job->Cancel();
+		return job;
+	}
+	if (g_threads.empty()) {
+		unsigned threads = PoolSize();
+		for (unsigned i = 0; i < threads; i++) {
+			g_threads.push_back(new std::thread(WorkerProc));
+		}
+	}
+	for (size_t i = 0; i < g_active.size();) {
+		std::shared_ptr<HashJob> active = g_active[i].lock();
+		if (!active || active->m_remaining.load(std::memory_order_relaxed) == 0) {
+			g_active[i] = std::move(g_active.back());
+			g_active.pop_back();
+		}
+		else {
+			i++;
+		}
+	}
+	g_active.push_back(job);
+	g_queue.push_back(job);
+	g_workAvailable.notify_all();
+	return job;
+}
+
+void FileHasher::CancelAll() {
+	std::lock_guard<std::mutex> lock(g_poolMutex);
+	for (const std::weak_ptr<HashJob>& weak : g_active) {
+		std::shared_ptr<HashJob> job = weak.lock();
+		if (job) {
+			job->Cancel();
+		}
+	}
+}
+
+void FileHasher::RequestStop() {
+	{
+		std::lock_guard<std::mutex> lock(g_poolMutex);
+		for (const std::weak_ptr<HashJob>& weak : g_active) {
+			std::shared_ptr<HashJob> job = weak.lock();
+			if (job) {
+				job->Cancel();
+			}
+		}
+		g_active.clear();
+		g_queue.clear();
+		g_stopping = true;
+	}
+	g_workAvailable.notify_all();
+}
+
+void FileHasher::Stop() {
+	RequestStop();
+	std::vector<std::thread*> threads;
+	{
+		std::lock_guard<std::mutex> lock(g_poolMutex);
+		threads.swap(g_threads);
+	}
+	for (std::thread* thread : threads) {
+		thread->join();
+		delete thread;
+	}
+	std::lock_guard<std::mutex> lock(g_poolMutex);
+	g_stopping = false;
+}
+
+HashStats FileHasher::GetStats() {
+	HashStats stats;
+	stats.files = g_files.load();
+	stats.bytes = g_bytes.load();
+	stats.failed = g_failed.load();
+	stats.cancelled = g_cancelled.load();
+	return stats;
+}
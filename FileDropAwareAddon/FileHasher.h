@@ -0,0 +1,119 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "MatchedPaths.h"
+
+// 单个文件的哈希进度
+enum class HashStatus : uint8_t {
+	// 尚未开始
+	Pending,
+	// 已取得大小与修改时间，正在计算或等待计算哈希
+	Stamped,
+	Done,
+	// 无法打开或读取
+	Failed,
+	Cancelled,
+};
+
+// 某一时刻单个文件的结果，status 为 Pending 时其它字段无效，不是 Done 时 digest 无效
+struct FileHashResult {
+	HashStatus status;
+	uint64_t size;
+	// Unix 毫秒时间戳
+	double mtime;
+	// XXH64，种子为 0
+	uint64_t digest;
+};
+
+class HashJob;
+// 已释放的任务全部完成时在哈希线程上调用，不能阻塞
+typedef void (*HashCompleteCallback)(void* context, const std::shared_ptr<HashJob>& job);
+
+// 一次拖拽的哈希任务：先取得所有文件的大小与修改时间，再逐个计算内容哈希
+// 结果可在任意线程随时读取；钩子线程在释放拖拽时调用 Seal，之后任务完成时通过回调通知
+class HashJob : public std::enable_shared_from_this<HashJob>
+{
+public:
+	HashJob(std::shared_ptr<const MatchedPaths> paths, HashCompleteCallback callback, void* context);
+	HashJob(const HashJob&) = delete;
+	HashJob& operator=(const HashJob&) = delete;
+
+	size_t Count() const { return m_paths->Count(); }
+	const std::shared_ptr<const MatchedPaths>& Paths() const { return m_paths; }
+	FileHashResult Get(size_t index) const;
+
+	// 未开始的文件直接标记为 Cancelled，正在计算的文件在下一个读取块处停止
+	void Cancel() { m_cancelled.store(true, std::memory_order_release); }
+	bool Cancelled() const { return m_cancelled.load(std::memory_order_acquire); }
+	// 标记任务已随释放事件交给 JS：已全部完成返回 true；否则返回 false，完成时调用回调
+	bool Seal();
+
+private:
+	friend class FileHasher;
+
+	struct Entry {
+		std::atomic<uint8_t> status;
+		std::atomic<uint64_t> size;
+		std::atomic<uint64_t> mtime;
+		std::atomic<uint64_t> digest;
+	};
+
+	enum : unsigned {
+		kSealed = 1,
+		kFinished = 2,
+	};
+
+	// 由哈希线程调用：每个文件结束（包括失败与取消）时调用一次
+	void FinishEntry();
+
+	std::shared_ptr<const MatchedPaths> m_paths;
+	std::unique_ptr<Entry[]> m_entries;
+	HashCompleteCallback m_callback;
+	void* m_context;
+	// 两个阶段各自的下一个待领取下标
+	std::atomic<size_t> m_nextStat;
+	std::atomic<size_t> m_nextHash;
+	std::atomic<size_t> m_remaining;
+	std::atomic<unsigned> m_state;
+	std::atomic<bool> m_cancelled;
+};
+
+struct HashStats {
+	unsigned long long files;
+	unsigned long long bytes;
+	unsigned long long failed;
+	unsigned long long cancelled;
+};
+
+// 拖拽期间的后台哈希：检测到拖拽支持的文件后立即开始，利用拖拽本身的 0.5~2 秒空闲时间，
+// 释放时 JS 即可拿到大小、修改时间和已完成的哈希
+// Windows 上文件按固定大小的窗口依次映射，其它平台上用 pread 分块读取，以免文件被截断时产生 SIGBUS；
+// 不会一次映射或读入整个大文件；多个文件在线程池上并行计算，
+// 单个文件的哈希是顺序的，结果与标准 XXH64 一致
+// 因此单个文件的速度以一个核心的 XXH64 为上限（约 5 GB/s），4 GB 的文件在页缓存中也至少需要 0.8 秒，
+// 比很多拖拽都长；此时释放事件只带大小和修改时间，哈希完成后另行通知
+class FileHasher
+{
+public:
+	// 每次映射的窗口大小，其它平台上为预读的粒度
+	static const size_t kWindowBytes = 32 * 1024 * 1024;
+	// 每处理这么多字节检查一次是否已取消
+	static const size_t kChunkBytes = 1024 * 1024;
+
+	// 线程池在第一次调用时启动
+	static std::shared_ptr<HashJob> Begin(std::shared_ptr<const MatchedPaths> paths, HashCompleteCallback callback, void* context);
+	// 取消所有未完成的任务
+	static void CancelAll();
+	// 取消所有任务并请求线程池停止，不等待线程退出；正在读取的文件仍可能完成并调用回调
+	// 之后提交的任务直接取消，直到 Stop 完成
+	static void RequestStop();
+	// 取消所有任务并停止线程池，返回后不会再调用任何回调；可重复调用
+	static void Stop();
+	static HashStats GetStats();
+private:
+	static void WorkerProc();
+	static void StampFile(HashJob& job, size_t index);
+	static void HashFile(HashJob& job, size_t index);
+};
@@ -0,0 +1,249 @@
+﻿#include "FilePrewarmer.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+typedef std::chrono::steady_clock PrewarmClock;
+
+struct PrewarmEntry {
+	std::wstring path;
+	std::shared_ptr<MappedFile> file;
+	// 映射或最近一次被再次拖拽的时间
+	PrewarmClock::time_point touched;
+};
+
+static std::mutex g_mutex;
+static std::condition_variable g_wake;
+// 与 FileHasher 相同，join 后才释放：停止超时时线程可能仍卡在 IO 上
+static std::thread* g_thread = nullptr;
+// RequestStop 置位，Stop join 线程后复位
+static bool g_stopping = false;
+// 正在预热的一批路径，及其中下一个待处理的下标
+static std::shared_ptr<const MatchedPaths> g_pending;
+static size_t g_nextIndex = 0;
+
+// LRU 缓存：链表头部为最近使用的条目；所有条目的保留时间相同，尾部同时也是最早到期的条目
+static std::list<PrewarmEntry> g_cacheOrder;
+static std::unordered_map<std::wstring, std::list<PrewarmEntry>::iterator> g_cacheIndex;
+static uint64_t g_cachedBytes = 0;
+static PrewarmLimits g_limits = {
+	FilePrewarmer::kDefaultMaxBytes, FilePrewarmer::kDefaultMaxFileBytes, FilePrewarmer::kDefaultRetainMillis,
+};
+
+static std::atomic<unsigned long long> g_files(0);
+static std::atomic<unsigned long long> g_taken(0);
+static std::atomic<unsigned long long> g_evicted(0);
+static std::atomic<unsigned long long> g_skipped(0);
+
+// 移出缓存，映射交给 released，在释放锁之后才解除；调用方持有 g_mutex
+static void RemoveEntry(std::list<PrewarmEntry>::iterator it, std::vector<std::shared_ptr<MappedFile>>& released) {
+	g_cachedBytes -= it->file->Size();
+	released.push_back(std::move(it->file));
+	g_cacheIndex.erase(it->path);
+	g_cacheOrder.erase(it);
+}
+
+// 淘汰已到期的条目，以及为加入 files 个、共 bytes 字节的新映射需要腾出空间的最久未使用的条目；调用方持有 g_mutex
+static void Evict(PrewarmClock::time_point now, uint64_t bytes, size_t files, std::vector<std::shared_ptr<MappedFile>>& released) {
+	while (!g_cacheOrder.empty()) {
+		bool expired = g_limits.retainMillis != 0
+			&& now - g_cacheOrder.back().touched >= std::chrono::milliseconds(g_limits.retainMillis);
+		bool overCount = g_cacheOrder.size() + files > FilePrewarmer::kMaxFiles;
+		bool overBytes = g_limits.maxBytes != 0 && g_cachedBytes + bytes > g_limits.maxBytes;
+		if (!expired && !overCount && !overBytes) {
+			break;
+		}
+		RemoveEntry(std::prev(g_cacheOrder.end()), released);
+		g_evicted++;
+	}
+}
+
+void FilePrewarmer::PrewarmFile(const std::wstring& path) {
+	FileStamp stamp;
+	bool offline = false;
+	PrewarmLimits limits;
+	if (!MappedFile::Stat(path, stamp, offline)) {
+		g_skipped++;
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(g_mutex);
+		// 再次拖拽未变化的文件，只刷新淘汰顺序
+		auto it = g_cacheIndex.find(path);
+		if (it != g_cacheIndex.end() && it->second->file->Stamp() == stamp) {
+			it->second->touched = PrewarmClock::now();
+			g_cacheOrder.splice(g_cacheOrder.begin(), g_cacheOrder, it->second);
+			return;
+		}
+		limits = g_limits;
+	}
+
+	// 仅联机文件读取会触发下载；大小以打开后的元数据为准
+	std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+	if (offline || !file->Open(path, true)) {
+		g_skipped++;
+		return;
+	}
+	uint64_t size = file->Stamp().size;
+	if ((limits.maxFileBytes != 0 && size > limits.maxFileBytes) || (limits.maxBytes != 0 && size > limits.maxBytes)
+		|| size > (uint64_t)SIZE_MAX || !file->Map(0, (size_t)size, true)) {
+		g_skipped++;
+		return;
+	}
+	// Windows 上只提交预读，不等待完成，映射的页面属于系统文件缓存，在被访问前不计入进程的私有内存；
+	// 其它平台上 Map 已经读入了全部内容
+	file->Prefetch(0, file->Size());
+
+	std::vector<std::shared_ptr<MappedFile>> released;
+	std::lock_guard<std::mutex> lock(g_mutex);
+	auto it = g_cacheIndex.find(path);
+	if (it != g_cacheIndex.end()) {
+		RemoveEntry(it->second, released);
+	}
+	Evict(PrewarmClock::now(), file->Size(), 1, released);
+	g_cachedBytes += file->Size();
+	g_cacheOrder.push_front(PrewarmEntry{ path, std::move(file), PrewarmClock::now() });
+	g_cacheIndex.emplace(path, g_cacheOrder.begin());
+	g_files++;
+}
+
+void FilePrewarmer::WorkerProc() {
+	std::unique_lock<std::mutex> lock(g_mutex);
+	while (!g_stopping) {
+		if (g_pending && g_nextIndex < g_pending->Count()) {
+			std::wstring path = g_pending->PathAt(g_nextIndex++);
+			lock.unlock();
+			PrewarmFile(path);
+			lock.lock();
+			continue;
+		}
+		g_pending.reset();
+
+		std::vector<std::shared_ptr<MappedFile>> released;
+		Evict(PrewarmClock::now(), 0, 0, released);
+		if (!released.empty()) {
+			lock.unlock();
+			released.clear();
+			lock.lock();
+			continue;
+		}
+		// 没有待处理的文件时等到最早的条目到期
+		if (g_cacheOrder.empty() || g_limits.retainMillis == 0) {
+			g_wake.wait(lock);
+		}
+		else {
+			g_wake.wait_until(lock, g_cacheOrder.back().touched + std::chrono::milliseconds(g_limits.retainMillis));
+		}
+	}
+}
+
+void FilePrewarmer::SetLimits(const PrewarmLimits& limits) {
+	std::vector<std::shared_ptr<MappedFile>> released;
+	std::lock_guard<std::mutex> lock(g_mutex);
+	g_limits = limits;
+	Evict(PrewarmClock::now(), 0, 0, released);
+	g_wake.notify_all();
+}
+
+void FilePrewarmer::Prewarm(std::shared_ptr<const MatchedPaths> paths) {
+	std::lock_guard<std::mutex> lock(g_mutex);
+	if (g_stopping || !paths || paths->Count() == 0) {
+		return;
+	}
+	if (g_thread == nullptr) {
+		g_thread = new std::thread(WorkerProc);
+	}
+	g_pending = std::move(paths);
+	g_nextIndex = 0;
+	g_wake.notify_all();
+}
+
+std::shared_ptr<MappedFile> FilePrewarmer::Take(const std::wstring& path) {
+	std::shared_ptr<MappedFile> file;
+	{
+		std::lock_guard<std::mutex> lock(g_mutex);
+		auto it = g_cacheIndex.find(path);
+		if (it == g_cacheIndex.end()) {
+			return nullptr;
+		}
+		file = std::move(it->second->file);
+		g_cachedBytes -= file->Size();
+		g_cacheOrder.erase(it->second);
+		g_cacheIndex.erase(it);
+	}
+	// 映射之后文件被修改或替换，映射的内容已不可信
+	FileStamp stamp;
+	bool offline = false;
+	if (!MappedFile::Stat(path, stamp, offline) || stamp != file->Stamp()) {
+		g_evicted++;
+		return nullptr;
+	}
+	g_taken++;
+	return file;
+}
+
+void FilePrewarmer::Cancel() {
+	std::lock_guard<std::mutex> lock(g_mutex);
+	g_pending.reset();
+	g_nextIndex = 0;
+}
+
+void FilePrewarmer::Clear() {
+	std::vector<std::shared_ptr<MappedFile>> released;
+	std::lock_guard<std::mutex> lock(g_mutex);
+	g_pending.reset();
+	g_nextIndex = 0;
+	for (PrewarmEntry& entry : g_cacheOrder) {
+		released.push_back(std::move(entry.file));
+	}
+	g_evicted += g_cacheOrder.size();
+	g_cacheOrder.clear();
+	g_cacheIndex.clear();
+	g_cachedBytes = 0;
+}
+
+void FilePrewarmer::RequestStop() {
+	{
+		std::lock_guard<std::mutex> lock(g_mutex);
+		g_stopping = true;
+		g_pending.reset();
+	}
+	g_wake.notify_all();
+}
+
+void FilePrewarmer::Stop() {
+	RequestStop();
+	std::thread* thread;
+	{
+		std::lock_guard<std::mutex> lock(g_mutex);
+		thread = g_thread;
+		g_thread = nullptr;
+	}
+	if (thread != nullptr) {
+		thread->join();
+		delete thread;
+	}
+	Clear();
+	std::lock_guard<std::mutex> lock(g_mutex);
+	g_stopping = false;
+}
+
+PrewarmStats FilePrewarmer::GetStats() {
+	PrewarmStats stats;
+	{
+		std::lock_guard<std::mutex> lock(g_mutex);
+		stats.bytes = g_cachedBytes;
+	}
+	stats.files = g_files.load();
+	stats.taken = g_taken.load();
+	stats.evicted = g_evicted.load();
+	stats.skipped = g_skipped.load();
+	return stats;
+}
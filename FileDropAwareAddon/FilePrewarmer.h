@@ -0,0 +1,63 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "MappedFile.h"
+#include "MatchedPaths.h"
+
+// 预热的内存限制与淘汰策略，各项为 0 表示不限制
+struct PrewarmLimits {
+	// 缓存中尚未被取走的映射总字节数，超出时淘汰最久未使用的文件
+	uint64_t maxBytes;
+	// 超过该大小的文件不预热
+	uint64_t maxFileBytes;
+	// 映射后超过该时间仍未被取走就释放；映射期间 Windows 上的其他程序无法截断或替换该文件，不宜过长
+	uint32_t retainMillis;
+};
+
+struct PrewarmStats {
+	// 已映射的文件数
+	unsigned long long files;
+	// 当前缓存的字节数
+	unsigned long long bytes;
+	unsigned long long taken;
+	unsigned long long evicted;
+	// 仅联机、超过大小限制或无法打开而跳过的文件数
+	unsigned long long skipped;
+};
+
+// 拖拽期间把匹配的文件整个映射到内存并开始预读，投放时 JS 无需等待 IO，也无需复制到 V8 堆
+// 映射为写时复制：文件只读打开，JS 写入缓冲区只修改进程私有的副本
+// 每个文件只能取走一次，取走后映射由调用方持有（交给 JS 的 ArrayBuffer 被回收或显式释放时解除），不再计入 maxBytes
+// Windows 上视图存在期间其他程序无法截断或替换该文件；其它平台上在后台线程读入匿名内存（见 MappedFile::Map），
+// 文件之后被截断也不会产生 SIGBUS，代价是缓存的内容计入进程的私有内存
+class FilePrewarmer
+{
+public:
+	// 缓存的文件数上限，每个文件持有一个打开的句柄
+	static const size_t kMaxFiles = 256;
+	// PrewarmLimits 的默认值
+	static const uint64_t kDefaultMaxBytes = 2048ull * 1024 * 1024;
+	static const uint64_t kDefaultMaxFileBytes = 1024ull * 1024 * 1024;
+	static const uint32_t kDefaultRetainMillis = 10000;
+
+	// 新的限制立即生效，超出的缓存被淘汰
+	static void SetLimits(const PrewarmLimits& limits);
+	// 在后台映射并预读 paths 中的文件，上一批中尚未开始的文件被放弃；线程在第一次调用时启动
+	static void Prewarm(std::shared_ptr<const MatchedPaths> paths);
+	// 取走 path 的映射；未预热、已淘汰、仍在排队或文件已变化时返回空
+	static std::shared_ptr<MappedFile> Take(const std::wstring& path);
+	// 放弃尚未开始的文件，已映射的文件保留到被取走或淘汰
+	static void Cancel();
+	// 放弃尚未开始的文件并释放所有缓存的映射，已取走的不受影响
+	static void Clear();
+	// 请求线程停止并放弃尚未开始的文件，不等待线程退出；之后的 Prewarm 直接返回，直到 Stop 完成
+	static void RequestStop();
+	// 停止线程并释放缓存，可重复调用
+	static void Stop();
+	static PrewarmStats GetStats();
+private:
+	static void WorkerProc();
+	static void PrewarmFile(const std::wstring& path);
+};
@@ -0,0 +1,201 @@
+﻿#include "FileSignature.h"
+#include "ExtensionMatcher.h"
+#include <cstring>
+
+static const uint8_t kPdf[] = { '%', 'P', 'D', 'F', '-' };
+static const uint8_t kPng[] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+static const uint8_t kJpeg[] = { 0xFF, 0xD8, 0xFF };
+static const uint8_t kGif87[] = { 'G', 'I', 'F', '8', '7', 'a' };
+static const uint8_t kGif89[] = { 'G', 'I', 'F', '8', '9', 'a' };
+static const uint8_t kBmp[] = { 'B', 'M' };
+static const uint8_t kRiff[] = { 'R', 'I', 'F', 'F' };
+static const uint8_t kWebp[] = { 'W', 'E', 'B', 'P' };
+static const uint8_t kWave[] = { 'W', 'A', 'V', 'E' };
+static const uint8_t kZip[] = { 'P', 'K', 0x03, 0x04 };
+static const uint8_t kZipEmpty[] = { 'P', 'K', 0x05, 0x06 };
+static const uint8_t kOle[] = { 0xD0, 0xCF, 0x11, 0xE0, 0xA1, 0xB1, 0x1A, 0xE1 };
+static const uint8_t kGzip[] = { 0x1F, 0x8B };
+static const uint8_t kSevenZip[] = { '7', 'z', 0xBC, 0xAF, 0x27, 0x1C };
+static const uint8_t kRar[] = { 'R', 'a', 'r', '!', 0x1A, 0x07 };
+static const uint8_t kFtyp[] = { 'f', 't', 'y', 'p' };
+// 没有 ftyp 的旧 QuickTime 文件（.mov）以这些 atom 开头
+static const uint8_t kMoov[] = { 'm', 'o', 'o', 'v' };
+static const uint8_t kMdat[] = { 'm', 'd', 'a', 't' };
+static const uint8_t kWide[] = { 'w', 'i', 'd', 'e' };
+static const uint8_t kFree[] = { 'f', 'r', 'e', 'e' };
+static const uint8_t kSkip[] = { 's', 'k', 'i', 'p' };
+static const uint8_t kPnot[] = { 'p', 'n', 'o', 't' };
+static const uint8_t kMz[] = { 'M', 'Z' };
+static const uint8_t kElf[] = { 0x7F, 'E', 'L', 'F' };
+
+static const char kContentTypes[] = "[Content_Types].xml";
+
+#define PATTERN(offset, bytes) { offset, (uint8_t)sizeof(bytes), bytes }
+
+const char* FileKindName(FileKind kind) {
+	static const char* const kNames[] = {
+		"unknown", "pdf", "png", "jpeg", "gif", "bmp", "webp", "zip", "ooxml", "ole",
+		"gzip", "7z", "rar", "mp4", "wav", "exe", "elf",
+	};
+	static_assert(sizeof(kNames) / sizeof(kNames[0]) == (size_t)FileKind::Count, "FileKind names out of sync");
+	return (size_t)kind < (size_t)FileKind::Count ? kNames[(size_t)kind] : "unknown";
+}
+
+const SignatureTable& SignatureTable::Instance() {
+	static const SignatureTable table;
+	return table;
+}
+
+SignatureTable::SignatureTable() {
+	// 同一桶内按顺序比较，较长、较具体的特征放在前面
+	const Signature signatures[] = {
+		{ FileKind::Pdf, { PATTERN(0, kPdf) }, 1 },
+		{ FileKind::Png, { PATTERN(0, kPng) }, 1 },
+		{ FileKind::Jpeg, { PATTERN(0, kJpeg) }, 1 },
+		{ FileKind::Gif, { PATTERN(0, kGif89) }, 1 },
+		{ FileKind::Gif, { PATTERN(0, kGif87) }, 1 },
+		{ FileKind::Webp, { PATTERN(0, kRiff), PATTERN(8, kWebp) }, 2 },
+		{ FileKind::Wav, { PATTERN(0, kRiff), PATTERN(8, kWave) }, 2 },
+		{ FileKind::Zip, { PATTERN(0, kZip) }, 1 },
+		{ FileKind::Zip, { PATTERN(0, kZipEmpty) }, 1 },
+		{ FileKind::Ole, { PATTERN(0, kOle) }, 1 },
+		{ FileKind::SevenZip, { PATTERN(0, kSevenZip) }, 1 },
+		{ FileKind::Rar, { PATTERN(0, kRar) }, 1 },
+		{ FileKind::Elf, { PATTERN(0, kElf) }, 1 },
+		{ FileKind::Gzip, { PATTERN(0, kGzip) }, 1 },
+		{ FileKind::Executable, { PATTERN(0, kMz) }, 1 },
+		{ FileKind::Bmp, { PATTERN(0, kBmp) }, 1 },
+		{ FileKind::Mp4, { PATTERN(4, kFtyp) }, 1 },
+		{ FileKind::Mp4, { PATTERN(4, kMoov) }, 1 },
+		{ FileKind::Mp4, { PATTERN(4, kMdat) }, 1 },
+		{ FileKind::Mp4, { PATTERN(4, kWide) }, 1 },
+		{ FileKind::Mp4, { PATTERN(4, kFree) }, 1 },
+		{ FileKind::Mp4, { PATTERN(4, kSkip) }, 1 },
+		{ FileKind::Mp4, { PATTERN(4, kPnot) }, 1 },
+	};
+	for (const Signature& signature : signatures) {
+		const Pattern& first = signature.patterns[0];
+		if (first.offset == 0) {
+			m_buckets[first.bytes[0]].push_back(signature);
+		}
+		else {
+			m_others.push_back(signature);
+		}
+	}
+}
+
+bool SignatureTable::MatchPattern(const Pattern& pattern, const uint8_t* data, size_t length) {
+	return (size_t)pattern.offset + pattern.length <= length
+		&& memcmp(data + pattern.offset, pattern.bytes, pattern.length) == 0;
+}
+
+bool SignatureTable::MatchSignature(const Signature& signature, const uint8_t* data, size_t length) {
+	for (uint8_t i = 0; i < signature.patternCount; i++) {
+		if (!MatchPattern(signature.patterns[i], data, length)) return false;
+	}
+	return true;
+}
+
+bool SignatureTable::LooksLikeOoxml(const uint8_t* data, size_t length) {
+	// 本地文件头：偏移 26 为文件名长度，文件名从偏移 30 开始
+	if (length >= 30) {
+		size_t nameLength = (size_t)data[26] | ((size_t)data[27] << 8);
+		const char* name = (const char*)data + 30;
+		if (30 + nameLength <= length) {
+			static const char* const kPrefixes[] = { kContentTypes, "_rels/", "docProps/", "word/", "xl/", "ppt/" };
+			for (const char* prefix : kPrefixes) {
+				size_t prefixLength = strlen(prefix);
+				if (nameLength >= prefixLength && memcmp(name, prefix, prefixLength) == 0) return true;
+			}
+		}
+	}
+	// 第一个条目不是时，[Content_Types].xml 通常也在文件头的前几个条目中
+	const size_t markerLength = sizeof(kContentTypes) - 1;
+	for (size_t i = 30; i + markerLength <= length; i++) {
+		if (data[i] == '[' && memcmp(data + i, kContentTypes, markerLength) == 0) return true;
+	}
+	return false;
+}
+
+FileKind SignatureTable::Identify(const uint8_t* data, size_t length) const {
+	if (data == nullptr || length == 0) {
+		return FileKind::Unknown;
+	}
+	for (const Signature& signature : m_buckets[data[0]]) {
+		if (!MatchSignature(signature, data, length)) continue;
+		if (signature.kind == FileKind::Zip && LooksLikeOoxml(data, length)) {
+			return FileKind::Ooxml;
+		}
+		return signature.kind;
+	}
+	for (const Signature& signature : m_others) {
+		if (MatchSignature(signature, data, length)) return signature.kind;
+	}
+	return FileKind::Unknown;
+}
+
+struct ExtensionKinds {
+	const wchar_t* extension;
+	uint32_t kinds;
+};
+
+#define KIND(kind) (1u << (unsigned)FileKind::kind)
+static const ExtensionKinds kExtensionKinds[] = {
+	{ L"pdf", KIND(Pdf) },
+	{ L"png", KIND(Png) },
+	{ L"jpg", KIND(Jpeg) },
+	{ L"jpeg", KIND(Jpeg) },
+	{ L"jpe", KIND(Jpeg) },
+	{ L"jfif", KIND(Jpeg) },
+	{ L"gif", KIND(Gif) },
+	{ L"bmp", KIND(Bmp) },
+	{ L"webp", KIND(Webp) },
+	{ L"zip", KIND(Zip) | KIND(Ooxml) },
+	// 少数工具生成的 OOXML 没有把 [Content_Types].xml 放在前面，同样接受普通 zip
+	{ L"docx", KIND(Ooxml) | KIND(Zip) },
+	{ L"xlsx", KIND(Ooxml) | KIND(Zip) },
+	{ L"pptx", KIND(Ooxml) | KIND(Zip) },
+	{ L"docm", KIND(Ooxml) | KIND(Zip) },
+	{ L"xlsm", KIND(Ooxml) | KIND(Zip) },
+	{ L"pptm", KIND(Ooxml) | KIND(Zip) },
+	{ L"doc", KIND(Ole) },
+	{ L"xls", KIND(Ole) },
+	{ L"ppt", KIND(Ole) },
+	{ L"msg", KIND(Ole) },
+	{ L"gz", KIND(Gzip) },
+	{ L"tgz", KIND(Gzip) },
+	{ L"7z", KIND(SevenZip) },
+	{ L"rar", KIND(Rar) },
+	{ L"mp4", KIND(Mp4) },
+	{ L"m4a", KIND(Mp4) },
+	{ L"m4v", KIND(Mp4) },
+	{ L"mov", KIND(Mp4) },
+	{ L"wav", KIND(Wav) },
+	{ L"exe", KIND(Executable) },
+	{ L"dll", KIND(Executable) },
+};
+#undef KIND
+
+uint32_t SignatureTable::ExpectedKinds(const wchar_t* path, size_t length) {
+	// 只看文件名中最后一个 '.' 之后的部分
+	size_t dot = length;
+	for (size_t i = length; i > 0; i--) {
+		wchar_t c = path[i - 1];
+		if (c == L'\\' || c == L'/' || c == L':') return 0;
+		if (c == L'.') {
+			dot = i;
+			break;
+		}
+	}
+	if (dot == length) {
+		return 0;
+	}
+	const wchar_t* extension = path + dot;
+	size_t extensionLength = length - dot;
+	for (const ExtensionKinds& entry : kExtensionKinds) {
+		size_t i = 0;
+		while (i < extensionLength && entry.extension[i] != L'\0' && entry.extension[i] == ExtensionMatcher::FoldAscii(extension[i])) i++;
+		if (i == extensionLength && entry.extension[i] == L'\0') return entry.kinds;
+	}
+	return 0;
+}
@@ -0,0 +1,76 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 由文件头识别出的内容类型
+enum class FileKind : uint8_t {
+	Unknown = 0,
+	Pdf,
+	Png,
+	Jpeg,
+	Gif,
+	Bmp,
+	Webp,
+	Zip,
+	// Office Open XML（docx/xlsx/pptx），即带有 [Content_Types].xml 的 zip
+	Ooxml,
+	// OLE 复合文档（doc/xls/ppt/msg）
+	Ole,
+	Gzip,
+	SevenZip,
+	Rar,
+	// ISO 媒体文件（mp4/m4a/m4v）与 QuickTime（mov）
+	Mp4,
+	Wav,
+	Executable,
+	Elf,
+	Count,
+};
+
+const char* FileKindName(FileKind kind);
+
+// 编译后的文件头特征表：按偏移 0 处的首字节分桶，识别时只比较可能命中的特征
+// 特征表是静态的，进程内只构建一次，可在任意线程使用
+class SignatureTable
+{
+public:
+	// 识别需要的文件头长度，读取更多字节没有意义
+	static const size_t kHeaderBytes = 4096;
+
+	static const SignatureTable& Instance();
+
+	FileKind Identify(const uint8_t* data, size_t length) const;
+
+	// 文件名扩展名对应的内容类型，mask 的第 i 位表示接受 FileKind(i)
+	// 没有已知特征的扩展名（例如 .txt、.csv）返回 0，表示不做内容校验
+	static uint32_t ExpectedKinds(const wchar_t* path, size_t length);
+	static bool Accepts(uint32_t expected, FileKind kind) {
+		return expected == 0 || (expected & (1u << (unsigned)kind)) != 0;
+	}
+
+private:
+	struct Pattern {
+		uint16_t offset;
+		uint8_t length;
+		const uint8_t* bytes;
+	};
+	struct Signature {
+		FileKind kind;
+		// 最多两段，例如 RIFF....WEBP
+		Pattern patterns[2];
+		uint8_t patternCount;
+	};
+
+	SignatureTable();
+	static bool MatchPattern(const Pattern& pattern, const uint8_t* data, size_t length);
+	static bool MatchSignature(const Signature& signature, const uint8_t* data, size_t length);
+	// zip 的第一个条目是否为 [Content_Types].xml 或 OOXML 的目录
+	static bool LooksLikeOoxml(const uint8_t* data, size_t length);
+
+private:
+	// 第一段位于偏移 0 的特征，按首字节分桶
+	std::vector<Signature> m_buckets[256];
+	// 第一段不在偏移 0 的特征，逐个比较
+	std::vector<Signature> m_others;
+};
@@ -0,0 +1,149 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+
+// 钩子健康计数，可在任意线程读取
+struct HookHealth {
+	uint64_t calls;
+	// 耗时超过预算的调用
+	uint64_t overruns;
+	// 耗时超过系统超时 (LowLevelHooksTimeout) 的调用，系统可能已静默移除钩子
+	uint64_t timeouts;
+	uint64_t reinstalls;
+	// 进入降级模式的次数
+	uint64_t degradations;
+	bool degraded;
+	// 单次调用的最大耗时（时钟刻度）
+	uint64_t maxTicks;
+};
+
+// 钩子过程的耗时看门狗：统计每次调用的耗时，超出预算过于频繁时进入降级模式，
+// 超时或检测到钩子已失效时要求重新安装
+//
+// Clock 需要提供：
+//   uint64_t Now() const;                    单调时钟刻度
+//   uint64_t FromMillis(uint32_t ms) const;  毫秒转换为刻度
+// 除计数读取外，所有方法只能在钩子线程调用
+template <typename Clock>
+class HookWatchdog
+{
+public:
+	struct Config {
+		// 系统超时，超过即认为钩子可能已被移除
+		uint32_t timeoutMillis;
+		// 单次调用预算，通常为超时的一部分
+		uint32_t budgetMillis;
+		// 在 windowMillis 内超出预算 degradeOverruns 次即降级
+		uint32_t degradeOverruns;
+		uint32_t windowMillis;
+		// 连续 recoverMillis 没有超出预算后恢复正常模式
+		uint32_t recoverMillis;
+		// 光标移动但钩子超过该时间未被调用，认为钩子已失效
+		uint32_t silenceMillis;
+	};
+
+	explicit HookWatchdog(const Clock& clock = Clock()) : m_clock(clock) {
+		Configure({ 300, 100, 3, 10000, 30000, 1000 });
+	}
+
+	void Configure(const Config& config) {
+		m_timeout = m_clock.FromMillis(config.timeoutMillis);
+		m_budget = m_clock.FromMillis(config.budgetMillis);
+		m_window = m_clock.FromMillis(config.windowMillis);
+		m_recover = m_clock.FromMillis(config.recoverMillis);
+		m_silence = m_clock.FromMillis(config.silenceMillis);
+		m_degradeOverruns = config.degradeOverruns;
+		m_windowStart = 0;
+		m_windowOverruns = 0;
+		m_lastOverrun = 0;
+		m_lastCall = m_clock.Now();
+		m_suspectRemoved = false;
+	}
+
+	uint64_t Enter() const { return m_clock.Now(); }
+
+	// queuedMillis: 事件产生到钩子被调用之间的排队时间，同样计入系统超时
+	void Exit(uint64_t start, uint32_t queuedMillis) {
+		uint64_t now = m_clock.Now();
+		uint64_t elapsed = now - start + m_clock.FromMillis(queuedMillis);
+		m_lastCall = now;
+		// 只有钩子线程写入，不需要原子读改写
+		m_calls.store(m_calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		if (elapsed > m_maxTicks.load(std::memory_order_relaxed)) {
+			m_maxTicks.store(elapsed, std::memory_order_relaxed);
+		}
+		if (elapsed <= m_budget) {
+			return;
+		}
+
+		m_overruns.store(m_overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		m_lastOverrun = now;
+		if (elapsed > m_timeout) {
+			m_timeouts.store(m_timeouts.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			m_suspectRemoved = true;
+		}
+		if (m_windowOverruns == 0 || now - m_windowStart > m_window) {
+			m_windowStart = now;
+			m_windowOverruns = 0;
+		}
+		if (++m_windowOverruns >= m_degradeOverruns && !Degraded()) {
+			m_degraded.store(true, std::memory_order_relaxed);
+			m_degradations.store(m_degradations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+	}
+
+	// 定时检查，cursorMoved 表示光标位置与钩子最后一次看到的位置不同
+	// 返回 true 表示需要重新安装钩子
+	bool Check(bool cursorMoved) {
+		uint64_t now = m_clock.Now();
+		if (Degraded() && now - m_lastOverrun > m_recover) {
+			m_degraded.store(false, std::memory_order_relaxed);
+			m_windowOverruns = 0;
+		}
+		return m_suspectRemoved || (cursorMoved && now - m_lastCall > m_silence);
+	}
+
+	void OnReinstalled() {
+		m_reinstalls.store(m_reinstalls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		m_suspectRemoved = false;
+		m_lastCall = m_clock.Now();
+	}
+
+	bool Degraded() const { return m_degraded.load(std::memory_order_relaxed); }
+
+	HookHealth Health() const {
+		return {
+			m_calls.load(std::memory_order_relaxed),
+			m_overruns.load(std::memory_order_relaxed),
+			m_timeouts.load(std::memory_order_relaxed),
+			m_reinstalls.load(std::memory_order_relaxed),
+			m_degradations.load(std::memory_order_relaxed),
+			m_degraded.load(std::memory_order_relaxed),
+			m_maxTicks.load(std::memory_order_relaxed),
+		};
+	}
+
+	const Clock& GetClock() const { return m_clock; }
+
+private:
+	Clock m_clock;
+	uint64_t m_timeout;
+	uint64_t m_budget;
+	uint64_t m_window;
+	uint64_t m_recover;
+	uint64_t m_silence;
+	uint32_t m_degradeOverruns;
+	uint64_t m_windowStart;
+	uint32_t m_windowOverruns;
+	uint64_t m_lastOverrun;
+	uint64_t m_lastCall;
+	bool m_suspectRemoved;
+
+	std::atomic<uint64_t> m_calls{ 0 };
+	std::atomic<uint64_t> m_overruns{ 0 };
+	std::atomic<uint64_t> m_timeouts{ 0 };
+	std::atomic<uint64_t> m_reinstalls{ 0 };
+	std::atomic<uint64_t> m_degradations{ 0 };
+	std::atomic<bool> m_degraded{ false };
+	std::atomic<uint64_t> m_maxTicks{ 0 };
+};
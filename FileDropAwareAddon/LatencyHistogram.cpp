@@ -0,0 +1,84 @@
+﻿#include "LatencyHistogram.h"
+
+LatencyHistogram::LatencyHistogram() : m_max(0) {
+	for (size_t i = 0; i < kBucketCount; i++) {
+		m_buckets[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+static unsigned HighestBit(uint64_t value) {
+	unsigned bit = 0;
+	while (value >>= 1) {
+		bit++;
+	}
+	return bit;
+}
+
+size_t LatencyHistogram::BucketIndex(uint64_t value) {
+	const uint64_t maxValue = (1ull << (kMaxValueBits + 1)) - 1;
+	if (value > maxValue) {
+		value = maxValue;
+	}
+	// 小于 2 * kSubBucketCount 的值每个值一个桶
+	if (value < 2 * kSubBucketCount) {
+		return (size_t)value;
+	}
+	unsigned shift = HighestBit(value) - kSubBucketBits;
+	// 右移后落在 [kSubBucketCount, 2 * kSubBucketCount) 之间
+	uint64_t sub = value >> shift;
+	return (size_t)(shift * kSubBucketCount + sub);
+}
+
+uint64_t LatencyHistogram::BucketHighestValue(size_t index) {
+	if (index < 2 * kSubBucketCount) {
+		return index;
+	}
+	unsigned shift = (unsigned)(index / kSubBucketCount) - 1;
+	uint64_t sub = index - shift * kSubBucketCount;
+	return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t micros) {
+	m_buckets[BucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+	uint64_t current = m_max.load(std::memory_order_relaxed);
+	while (micros > current && !m_max.compare_exchange_weak(current, micros, std::memory_order_relaxed)) {
+	}
+}
+
+LatencySummary LatencyHistogram::Summarize(bool reset) {
+	// 先取出所有桶，再按累计计数查找分位数
+	uint32_t counts[kBucketCount];
+	uint64_t total = 0;
+	for (size_t i = 0; i < kBucketCount; i++) {
+		counts[i] = reset
+			? m_buckets[i].exchange(0, std::memory_order_relaxed)
+			: m_buckets[i].load(std::memory_order_relaxed);
+		total += counts[i];
+	}
+	uint64_t max = reset ? m_max.exchange(0, std::memory_order_relaxed) : m_max.load(std::memory_order_relaxed);
+
+	LatencySummary summary = { total, 0, 0, 0, max };
+	if (total == 0) {
+		return summary;
+	}
+
+	// 第 p 分位对应的排名（向上取整，至少为 1）
+	const uint64_t ranks[3] = {
+		(total * 50 + 99) / 100,
+		(total * 90 + 99) / 100,
+		(total * 99 + 99) / 100,
+	};
+	uint64_t* outputs[3] = { &summary.p50, &summary.p90, &summary.p99 };
+	uint64_t seen = 0;
+	size_t next = 0;
+	for (size_t i = 0; i < kBucketCount && next < 3; i++) {
+		seen += counts[i];
+		while (next < 3 && seen >= ranks[next]) {
+			uint64_t value = BucketHighestValue(i);
+			// 桶代表值不超过实际最大值
+			*outputs[next] = (max != 0 && value > max) ? max : value;
+			next++;
+		}
+	}
+	return summary;
+}
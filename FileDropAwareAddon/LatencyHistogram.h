@@ -0,0 +1,41 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// 一个统计窗口的汇总结果，单位为微秒
+struct LatencySummary {
+	uint64_t count;
+	uint64_t p50;
+	uint64_t p90;
+	uint64_t p99;
+	uint64_t max;
+};
+
+// 无锁的对数线性直方图 (HDR 风格)：每个 2 的幂区间再均分为 16 个子桶，相对误差不超过 1/16
+// Record 只做一次 relaxed 原子加法，可在钩子和检测线程上常开
+class LatencyHistogram
+{
+public:
+	static const unsigned kSubBucketBits = 4;
+	static const uint64_t kSubBucketCount = 1ull << kSubBucketBits;
+	// 超过该值（约 19 小时）的记录计入最后一个桶
+	static const unsigned kMaxValueBits = 36;
+	static const size_t kBucketCount = (kMaxValueBits - kSubBucketBits + 1) * kSubBucketCount + kSubBucketCount;
+
+	LatencyHistogram();
+	LatencyHistogram(const LatencyHistogram&) = delete;
+	LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+	void Record(uint64_t micros);
+	// 汇总当前窗口，reset 为 true 时同时开始新的窗口
+	LatencySummary Summarize(bool reset);
+
+	static size_t BucketIndex(uint64_t value);
+	// 桶内可能的最大值，作为该桶的代表值
+	static uint64_t BucketHighestValue(size_t index);
+
+private:
+	std::atomic<uint32_t> m_buckets[kBucketCount];
+	std::atomic<uint64_t> m_max;
+};
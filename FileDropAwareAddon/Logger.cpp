@@ -0,0 +1,57 @@
+﻿#include "Logger.h"
+#include "MpscRing.h"
+#include "Utf.h"
+#include <chrono>
+#include <cwchar>
+
+std::atomic<int> Logger::m_level((int)LogLevel::Info);
+
+static MpscRing<LogRecord, 1024> g_logRing;
+static std::atomic<unsigned long long> g_droppedCount(0);
+static std::atomic<void (*)()> g_notify(nullptr);
+
+void Logger::SetLevel(LogLevel level) {
+	m_level.store((int)level, std::memory_order_relaxed);
+}
+
+void Logger::SetNotify(void (*notify)()) {
+	g_notify.store(notify, std::memory_order_release);
+}
+
+void Logger::Write(LogLevel level, const wchar_t* text, size_t length) {
+	int64_t timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+
+	bool pushed = g_logRing.Push([&](LogRecord& record) {
+		record.level = level;
+		record.timestamp = timestamp;
+		// 超长时在完整字符处截断
+		record.length = (uint32_t)WideToUtf8Lossy(text, length, record.text, LogRecord::kMaxText);
+	});
+	if (!pushed) {
+		// 队列已满时不阻塞写入线程，只记录丢弃数量
+		g_droppedCount.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	void (*notify)() = g_notify.load(std::memory_order_acquire);
+	if (notify != nullptr) {
+		notify();
+	}
+}
+
+void Logger::Write(LogLevel level, const wchar_t* text) {
+	Write(level, text, text == nullptr ? 0 : wcslen(text));
+}
+
+size_t Logger::Drain(void (*consume)(void* context, const LogRecord& record), void* context, size_t maxRecords) {
+	size_t count = 0;
+	while (count < maxRecords && g_logRing.Pop([&](const LogRecord& record) { consume(context, record); })) {
+		count++;
+	}
+	return count;
+}
+
+unsigned long long Logger::TakeDroppedCount() {
+	return g_droppedCount.exchange(0, std::memory_order_relaxed);
+}
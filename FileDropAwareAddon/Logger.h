@@ -0,0 +1,53 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum class LogLevel : int {
+	Debug = 0,
+	Info = 1,
+	Error = 2,
+	// 关闭所有日志
+	Off = 3,
+};
+
+// 预先格式化的 UTF-8 日志记录，直接写入队列槽位，不额外分配内存
+struct LogRecord {
+	static const size_t kMaxText = 480;
+	LogLevel level;
+	// Unix 时间戳（毫秒）
+	int64_t timestamp;
+	uint32_t length;
+	char text[kMaxText];
+};
+
+// 多线程写入、主线程批量取出的日志管线
+class Logger
+{
+public:
+	static bool IsEnabled(LogLevel level) {
+		return (int)level >= m_level.load(std::memory_order_relaxed);
+	}
+	static void SetLevel(LogLevel level);
+	// 有新日志时调用（例如唤醒 JS 线程），可在任意线程执行
+	static void SetNotify(void (*notify)());
+
+	static void Write(LogLevel level, const wchar_t* text, size_t length);
+	static void Write(LogLevel level, const wchar_t* text);
+	static void Write(LogLevel level, const std::wstring& text) { Write(level, text.c_str(), text.size()); }
+
+	// 仅在消费线程调用，逐条取出日志，最多 maxRecords 条，返回取出的条数
+	static size_t Drain(void (*consume)(void* context, const LogRecord& record), void* context, size_t maxRecords);
+	// 返回并清零因队列已满被丢弃的日志数量
+	static unsigned long long TakeDroppedCount();
+private:
+	static std::atomic<int> m_level;
+};
+
+// 在调用处先判断级别，未启用的级别不会构造日志字符串
+#define LOG_AT(level, message) \
+	do { if (Logger::IsEnabled(level)) Logger::Write(level, message); } while (0)
+#define LOG_DEBUG(message) LOG_AT(LogLevel::Debug, message)
+#define LOG_INFO(message) LOG_AT(LogLevel::Info, message)
+#define LOG_ERROR(message) LOG_AT(LogLevel::Error, message)
@@ -0,0 +1,276 @@
+﻿#include "MappedFile.h"
+#ifndef _WIN32
+#include "Utf.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+#ifndef FILE_ATTRIBUTE_RECALL_ON_OPEN
+#define FILE_ATTRIBUTE_RECALL_ON_OPEN 0x00040000
+#endif
+#ifndef FILE_ATTRIBUTE_RECALL_ON_DATA_ACCESS
+#define FILE_ATTRIBUTE_RECALL_ON_DATA_ACCESS 0x00400000
+#endif
+
+static uint64_t FileTimeToUInt64(const FILETIME& time) {
+	return ((uint64_t)time.dwHighDateTime << 32) | time.dwLowDateTime;
+}
+
+MappedFile::MappedFile() : m_data(NULL), m_size(0), m_offset(0), m_stamp(), m_file(INVALID_HANDLE_VALUE), m_mapping(NULL) {
+}
+
+bool MappedFile::Open(const std::wstring& path, bool sequential) {
+	Close();
+	// 允许其他进程同时写入、删除，拖拽期间不影响资源管理器的操作
+	m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL, OPEN_EXISTING, sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, NULL);
+	if (m_file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	BY_HANDLE_FILE_INFORMATION info;
+	if (!GetFileInformationByHandle(m_file, &info) || (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+		Close();
+		return false;
+	}
+	m_stamp.size = ((uint64_t)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+	m_stamp.mtime = FileTimeToUInt64(info.ftLastWriteTime);
+	return true;
+}
+
+bool MappedFile::Map(uint64_t offset, size_t length, bool copyOnWrite) {
+	Unmap();
+	if (m_file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	if (offset >= m_stamp.size || length == 0) {
+		return true;
+	}
+	size_t size = m_stamp.size - offset < length ? (size_t)(m_stamp.size - offset) : length;
+	// 映射对象以整个文件为界，只创建一次，视图只映射需要的部分
+	if (m_mapping == NULL) {
+		m_mapping = CreateFileMappingW(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (m_mapping == NULL) {
+			return false;
+		}
+	}
+	// 以 PAGE_READONLY 创建的映射对象同样可以映射写时复制的视图
+	m_data = (const uint8_t*)MapViewOfFile(m_mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ,
+		(DWORD)(offset >> 32), (DWORD)offset, size);
+	if (m_data == NULL) {
+		return false;
+	}
+	m_size = size;
+	m_offset = offset;
+	return true;
+}
+
+// PrefetchVirtualMemory 从 Windows 8 起提供，运行时解析以兼容更早的系统
+struct PrefetchRange {
+	PVOID VirtualAddress;
+	SIZE_T NumberOfBytes;
+};
+typedef BOOL (WINAPI* PrefetchVirtualMemoryProc)(HANDLE, ULONG_PTR, PrefetchRange*, ULONG);
+
+void MappedFile::Prefetch(uint64_t offset, size_t length) {
+	// 当前窗口以外的部分（按窗口映射时的下一个窗口）依靠缺页聚簇与 FILE_FLAG_SEQUENTIAL_SCAN 预读
+	static const PrefetchVirtualMemoryProc prefetch = (PrefetchVirtualMemoryProc)GetProcAddress(
+		GetModuleHandleW(L"kernel32.dll"), "PrefetchVirtualMemory");
+	if (prefetch == NULL || m_data == NULL || offset < m_offset || offset >= m_offset + m_size) {
+		return;
+	}
+	size_t start = (size_t)(offset - m_offset);
+	PrefetchRange range = { (PVOID)(m_data + start), m_size - start < length ? m_size - start : length };
+	prefetch(GetCurrentProcess(), 1, &range, 0);
+}
+
+void MappedFile::Unmap() {
+	if (m_data != NULL) {
+		UnmapViewOfFile(m_data);
+		m_data = NULL;
+	}
+	m_size = 0;
+}
+
+void MappedFile::Close() {
+	Unmap();
+	if (m_mapping != NULL) {
+		CloseHandle(m_mapping);
+		m_mapping = NULL;
+	}
+	if (m_file != INVALID_HANDLE_VALUE) {
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+	m_stamp = FileStamp();
+}
+
+bool MappedFile::Stat(const std::wstring& path, FileStamp& stamp, bool& offline) {
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data) ||
+		(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+		return false;
+	}
+	stamp.size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+	stamp.mtime = FileTimeToUInt64(data.ftLastWriteTime);
+	offline = (data.dwFileAttributes & (FILE_ATTRIBUTE_OFFLINE | FILE_ATTRIBUTE_RECALL_ON_OPEN | FILE_ATTRIBUTE_RECALL_ON_DATA_ACCESS)) != 0;
+	return true;
+}
+
+double MappedFile::MtimeToUnixMillis(uint64_t mtime) {
+	// FILETIME 以 1601-01-01 为起点，单位 100 纳秒
+	const uint64_t kUnixEpoch = 116444736000000000ull;
+	return mtime < kUnixEpoch ? 0.0 : (double)((mtime - kUnixEpoch) / 10000);
+}
+
+#else
+
+// 宽字符路径转为 UTF-8，wchar_t 在这些平台上为 UTF-32
+static std::string PathToUtf8(const std::wstring& path) {
+	std::string result;
+	AppendUtf8(result, path.data(), path.size());
+	return result;
+}
+
+static FileStamp StampFromStat(const struct stat& st) {
+	FileStamp stamp;
+	stamp.size = (uint64_t)st.st_size;
+	stamp.mtime = (uint64_t)st.st_mtim.tv_sec * 1000000000ull + (uint64_t)st.st_mtim.tv_nsec;
+	return stamp;
+}
+
+MappedFile::MappedFile() : m_data(NULL), m_size(0), m_offset(0), m_stamp(), m_fd(-1), m_sequential(false) {
+}
+
+bool MappedFile::Open(const std::wstring& path, bool sequential) {
+	Close();
+	m_fd = open(PathToUtf8(path).c_str(), O_RDONLY | O_CLOEXEC);
+	if (m_fd < 0) {
+		return false;
+	}
+	struct stat st;
+	if (fstat(m_fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+		Close();
+		return false;
+	}
+	m_stamp = StampFromStat(st);
+	m_sequential = sequential;
+	if (sequential) {
+		posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	}
+	return true;
+}
+
+bool MappedFile::Map(uint64_t offset, size_t length, bool copyOnWrite) {
+	Unmap();
+	if (m_fd < 0) {
+		return false;
+	}
+	if (offset >= m_stamp.size || length == 0) {
+		return true;
+	}
+	size_t size = m_stamp.size - offset < length ? (size_t)(m_stamp.size - offset) : length;
+	if (copyOnWrite) {
+		return ReadCopy(offset, size);
+	}
+	void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, m_fd, (off_t)offset);
+	if (data == MAP_FAILED) {
+		return false;
+	}
+	if (m_sequential) {
+		madvise(data, size, MADV_SEQUENTIAL);
+	}
+	m_data = (const uint8_t*)data;
+	m_size = size;
+	m_offset = offset;
+	return true;
+}
+
+// 交给 JS 的视图可能在文件被截断之后才被访问，映射文件本身会在访问越界的页面时产生 SIGBUS，
+// 因此写时复制的视图改为匿名映射并立即读入，之后与文件无关；读取期间文件变短视为失败
+bool MappedFile::ReadCopy(uint64_t offset, size_t size) {
+	void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (data == MAP_FAILED) {
+		return false;
+	}
+	size_t read = 0;
+	if (!Read(offset, (uint8_t*)data, size, read) || read != size) {
+		munmap(data, size);
+		return false;
+	}
+	m_data = (const uint8_t*)data;
+	m_size = size;
+	m_offset = offset;
+	return true;
+}
+
+bool MappedFile::Read(uint64_t offset, uint8_t* buffer, size_t length, size_t& read) {
+	read = 0;
+	if (m_fd < 0) {
+		return false;
+	}
+	while (read < length) {
+		// 单次 read 在 Linux 上最多返回约 2GB
+		size_t chunk = length - read < (size_t)1 << 30 ? length - read : (size_t)1 << 30;
+		ssize_t count = pread(m_fd, buffer + read, chunk, (off_t)(offset + read));
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+		if (count < 0) {
+			return false;
+		}
+		if (count == 0) {
+			break;
+		}
+		read += (size_t)count;
+	}
+	return true;
+}
+
+void MappedFile::Prefetch(uint64_t offset, size_t length) {
+	// 缺页触发的预读窗口很小，冷缓存时只有顺序 read 的三分之一左右
+	if (m_fd >= 0 && offset < m_stamp.size) {
+		posix_fadvise(m_fd, (off_t)offset, (off_t)length, POSIX_FADV_WILLNEED);
+	}
+}
+
+void MappedFile::Unmap() {
+	if (m_data != NULL) {
+		munmap((void*)m_data, m_size);
+		m_data = NULL;
+	}
+	m_size = 0;
+}
+
+void MappedFile::Close() {
+	Unmap();
+	if (m_fd >= 0) {
+		close(m_fd);
+		m_fd = -1;
+	}
+	m_stamp = FileStamp();
+}
+
+bool MappedFile::Stat(const std::wstring& path, FileStamp& stamp, bool& offline) {
+	struct stat st;
+	if (stat(PathToUtf8(path).c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+		return false;
+	}
+	stamp = StampFromStat(st);
+	offline = false;
+	return true;
+}
+
+double MappedFile::MtimeToUnixMillis(uint64_t mtime) {
+	return (double)(mtime / 1000000);
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+	Close();
+}
@@ -0,0 +1,82 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// 文件大小与修改时间，缓存的内容校验结果以此判断文件是否变化
+struct FileStamp {
+	uint64_t size;
+	// Windows 上为 FILETIME，其它平台为纳秒
+	uint64_t mtime;
+
+	bool operator==(const FileStamp& other) const { return size == other.size && mtime == other.mtime; }
+	bool operator!=(const FileStamp& other) const { return !(*this == other); }
+};
+
+// 只读打开文件，并按需映射其中一段：识别文件头时只映射开头几 KB，Windows 上计算哈希时按窗口依次映射，
+// 不会一次映射整个大文件；析构时解除映射并关闭文件
+// Windows 上使用 CreateFileMapping/MapViewOfFile，其它平台使用 mmap
+// 映射期间文件被其他进程截断时，访问越界的页面会产生异常 (SIGBUS)，因此每次只映射需要的部分并尽快关闭；
+// 其它平台上需要读完整个文件时（哈希）改用 Read，生命周期不受控制的视图（交给 JS 的缓冲区）使用 copyOnWrite
+class MappedFile
+{
+public:
+	// 窗口的起始偏移必须是该值的整数倍（Windows 的分配粒度）
+	static const uint64_t kWindowAlignment = 64 * 1024;
+
+	MappedFile();
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// 打开 path 并读取元数据，目录或无法打开时返回 false；sequential 提示系统将按顺序读完整个文件
+	bool Open(const std::wstring& path, bool sequential = false);
+	// 映射 [offset, offset + length) 与文件的交集，替换之前的窗口；offset 超出文件末尾时映射为空
+	// copyOnWrite 时视图可写，写入只修改进程私有的副本，不会写回文件（交给 JS 的 ArrayBuffer 可能被写入）
+	// Windows 上为写时复制的视图；其它平台上立即读入匿名内存，之后截断文件不会影响视图
+	bool Map(uint64_t offset, size_t length, bool copyOnWrite = false);
+	void Unmap();
+	void Close();
+	// 提示系统在后台预读 [offset, offset + length)，不等待读取完成；顺序处理时在处理当前窗口前预读下一个窗口
+	// Windows 上只对当前窗口内的部分有效
+	void Prefetch(uint64_t offset, size_t length);
+#ifndef _WIN32
+	// 把 [offset, offset + length) 读入 buffer，read 为实际读到的字节数，到达文件末尾时少于 length；出错返回 false
+	// 读取期间文件被截断只会读到较少的数据，不会像访问映射那样产生 SIGBUS
+	bool Read(uint64_t offset, uint8_t* buffer, size_t length, size_t& read);
+#endif
+
+	// 当前窗口
+	const uint8_t* Data() const { return m_data; }
+	size_t Size() const { return m_size; }
+	const FileStamp& Stamp() const { return m_stamp; }
+
+	// 只读取元数据，不打开文件；目录或不存在的路径返回 false
+	// offline 表示文件内容不在本地（例如 OneDrive 仅联机文件），打开会触发下载
+	static bool Stat(const std::wstring& path, FileStamp& stamp, bool& offline);
+	// FileStamp::mtime 转换为 Unix 毫秒时间戳
+	static double MtimeToUnixMillis(uint64_t mtime);
+
+private:
+#ifndef _WIN32
+	// 读入 [offset, offset + size) 作为写时复制的视图
+	bool ReadCopy(uint64_t offset, size_t size);
+#endif
+
+private:
+	const uint8_t* m_data;
+	size_t m_size;
+	// 当前窗口在文件中的起始偏移
+	uint64_t m_offset;
+	FileStamp m_stamp;
+#ifdef _WIN32
+	HANDLE m_file;
+	HANDLE m_mapping;
+#else
+	int m_fd;
+	bool m_sequential;
+#endif
+};
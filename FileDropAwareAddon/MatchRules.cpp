@@ -0,0 +1,116 @@
+﻿#include "MatchRules.h"
+
+MatchRules::MatchRules(const MatchRuleSet& rules) : m_extensions(rules.extensions) {
+	for (const std::wstring& pattern : rules.globs) {
+		if (!pattern.empty()) m_globs.push_back(Compile(pattern));
+	}
+	for (const std::wstring& pattern : rules.exclusions) {
+		if (!pattern.empty()) m_exclusions.push_back(Compile(pattern));
+	}
+}
+
+MatchRules::Glob MatchRules::Compile(const std::wstring& pattern) {
+	Glob glob = { std::wstring(), 0, 0, 0, false };
+	glob.pattern.reserve(pattern.size());
+	for (wchar_t c : pattern) {
+		glob.pattern.push_back(ExtensionMatcher::FoldAscii(c));
+	}
+
+	size_t firstStar = glob.pattern.find(L'*');
+	glob.hasStar = firstStar != std::wstring::npos;
+	if (!glob.hasStar) {
+		glob.prefixLength = glob.pattern.size();
+		glob.minLength = glob.pattern.size();
+		return glob;
+	}
+	size_t lastStar = glob.pattern.rfind(L'*');
+	glob.prefixLength = firstStar;
+	glob.suffixLength = glob.pattern.size() - lastStar - 1;
+	for (wchar_t c : glob.pattern) {
+		if (c != L'*') glob.minLength++;
+	}
+	return glob;
+}
+
+// 定长比较，'?' 匹配任意一个字符
+static bool MatchFixed(const wchar_t* pattern, const wchar_t* name, size_t length) {
+	for (size_t i = 0; i < length; i++) {
+		if (pattern[i] != L'?' && pattern[i] != ExtensionMatcher::FoldAscii(name[i])) return false;
+	}
+	return true;
+}
+
+bool MatchRules::MatchGlob(const Glob& glob, const wchar_t* name, size_t length) {
+	if (length < glob.minLength) {
+		return false;
+	}
+	const wchar_t* pattern = glob.pattern.c_str();
+	size_t patternLength = glob.pattern.size();
+	if (!glob.hasStar) {
+		return length == patternLength && MatchFixed(pattern, name, length);
+	}
+	// 大多数不匹配的文件名在首尾定长部分就被排除（例如 "report_*.xlsx" 的 "report_" 与 ".xlsx"）
+	if (!MatchFixed(pattern, name, glob.prefixLength) ||
+		!MatchFixed(pattern + patternLength - glob.suffixLength, name + length - glob.suffixLength, glob.suffixLength)) {
+		return false;
+	}
+
+	// 中间部分以 '*' 开头并以 '*' 结尾，贪心匹配，失败时回退到上一个 '*'
+	size_t p = glob.prefixLength;
+	size_t pEnd = patternLength - glob.suffixLength;
+	size_t s = glob.prefixLength;
+	size_t sEnd = length - glob.suffixLength;
+	size_t star = std::wstring::npos;
+	size_t mark = 0;
+	while (s < sEnd) {
+		if (p < pEnd && pattern[p] == L'*') {
+			star = p++;
+			mark = s;
+		}
+		else if (p < pEnd && (pattern[p] == L'?' || pattern[p] == ExtensionMatcher::FoldAscii(name[s]))) {
+			p++;
+			s++;
+		}
+		else if (star != std::wstring::npos) {
+			p = star + 1;
+			s = ++mark;
+		}
+		else {
+			return false;
+		}
+	}
+	while (p < pEnd && pattern[p] == L'*') p++;
+	return p == pEnd;
+}
+
+bool MatchRules::MatchAny(const std::vector<Glob>& globs, const wchar_t* name, size_t length) {
+	for (const Glob& glob : globs) {
+		if (MatchGlob(glob, name, length)) return true;
+	}
+	return false;
+}
+
+bool MatchRules::Matches(const wchar_t* path, size_t length) const {
+	if (path == nullptr) {
+		return false;
+	}
+	// 只配置了扩展名时不需要定位文件名
+	bool included = m_extensions.Matches(path, length);
+	if (!included && m_globs.empty()) {
+		return false;
+	}
+	if (included && m_exclusions.empty()) {
+		return true;
+	}
+
+	size_t start = length;
+	while (start > 0 && path[start - 1] != L'\\' && path[start - 1] != L'/' && path[start - 1] != L':') {
+		start--;
+	}
+	const wchar_t* name = path + start;
+	size_t nameLength = length - start;
+	if (!included && !MatchAny(m_globs, name, nameLength)) {
+		return false;
+	}
+	return !MatchAny(m_exclusions, name, nameLength);
+}
@@ -0,0 +1,49 @@
+﻿#pragma once
+#include <cstddef>
+#include <set>
+#include <string>
+#include <vector>
+#include "ExtensionMatcher.h"
+
+// 匹配规则的原始描述，由 AwareInitialize / UpdateRules 传入
+struct MatchRuleSet {
+	// 扩展名，例如 ".txt"、"tar.gz"
+	std::set<std::wstring> extensions;
+	// 文件名通配符，例如 "report_*.xlsx"；'*' 匹配任意个字符，'?' 匹配一个字符
+	std::vector<std::wstring> globs;
+	// 排除规则，同样是文件名通配符，例如 "~$*"、"*.tmp"；命中时即使满足上面的规则也不匹配
+	std::vector<std::wstring> exclusions;
+};
+
+// 编译后的匹配规则，构建一次后只读，可以被多个线程同时使用
+// 通配符只作用于文件名（最后一个路径分隔符之后），不区分 ASCII 大小写；不含通配符的模式表示完整的文件名
+class MatchRules
+{
+public:
+	MatchRules() {}
+	explicit MatchRules(const MatchRuleSet& rules);
+
+	bool Empty() const { return m_extensions.Empty() && m_globs.empty(); }
+	bool Matches(const wchar_t* path, size_t length) const;
+	bool Matches(const std::wstring& path) const { return Matches(path.c_str(), path.size()); }
+
+private:
+	// 模式预先折叠为小写，并拆出首个 '*' 之前和最后一个 '*' 之后的定长部分，先比较这两段再回溯中间部分
+	struct Glob {
+		std::wstring pattern;
+		size_t prefixLength;
+		size_t suffixLength;
+		// 不含 '*' 的字符数，即可匹配文件名的最短长度
+		size_t minLength;
+		bool hasStar;
+	};
+
+	static Glob Compile(const std::wstring& pattern);
+	static bool MatchGlob(const Glob& glob, const wchar_t* name, size_t length);
+	static bool MatchAny(const std::vector<Glob>& globs, const wchar_t* name, size_t length);
+
+private:
+	ExtensionMatcher m_extensions;
+	std::vector<Glob> m_globs;
+	std::vector<Glob> m_exclusions;
+};
@@ -0,0 +1,69 @@
+﻿#include "MatchedPaths.h"
+
+MatchedPaths::MatchedPaths(size_t maxPaths) : m_maxPaths(maxPaths) {
+}
+
+bool MatchedPaths::Add(const wchar_t* path, size_t length) {
+	if (Full()) {
+		return false;
+	}
+
+	bool oneByte = true;
+	for (size_t i = 0; i < length; i++) {
+		if ((uint32_t)path[i] > 0xFF) {
+			oneByte = false;
+			break;
+		}
+	}
+
+	Span span = { oneByte, 0, length };
+	if (oneByte) {
+		span.offset = m_oneByte.size();
+		m_oneByte.reserve(m_oneByte.size() + length);
+		for (size_t i = 0; i < length; i++) {
+			m_oneByte.push_back((char)path[i]);
+		}
+	}
+	else {
+		span.offset = m_twoByte.size();
+		for (size_t i = 0; i < length; i++) {
+			uint32_t c = (uint32_t)path[i];
+			// wchar_t 为 32 位的平台上，BMP 以外的字符转换为代理对
+			if (c > 0xFFFF) {
+				c -= 0x10000;
+				m_twoByte.push_back((uint16_t)(0xD800 + (c >> 10)));
+				m_twoByte.push_back((uint16_t)(0xDC00 + (c & 0x3FF)));
+			}
+			else {
+				m_twoByte.push_back((uint16_t)c);
+			}
+		}
+		span.length = m_twoByte.size() - span.offset;
+	}
+	m_spans.push_back(span);
+	return true;
+}
+
+std::wstring MatchedPaths::PathAt(size_t index) const {
+	const Span& span = m_spans[index];
+	std::wstring path;
+	path.reserve(span.length);
+	if (span.oneByte) {
+		const char* data = OneByteData(span);
+		for (size_t i = 0; i < span.length; i++) {
+			path.push_back((wchar_t)(unsigned char)data[i]);
+		}
+		return path;
+	}
+	const uint16_t* data = TwoByteData(span);
+	for (size_t i = 0; i < span.length; i++) {
+		uint32_t c = data[i];
+		// wchar_t 为 32 位时把代理对合并回一个字符
+		if (sizeof(wchar_t) == 4 && c >= 0xD800 && c < 0xDC00 && i + 1 < span.length && data[i + 1] >= 0xDC00 && data[i + 1] < 0xE000) {
+			c = 0x10000 + ((c - 0xD800) << 10) + (data[i + 1] - 0xDC00);
+			i++;
+		}
+		path.push_back((wchar_t)c);
+	}
+	return path;
+}
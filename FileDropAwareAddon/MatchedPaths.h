@@ -0,0 +1,47 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 匹配到的文件路径，检测线程构建一次后只读
+// 路径只转换一次：全部字符不超过 0xFF 的路径存为单字节 (Latin-1)，其余存为 UTF-16，
+// 各自连续存放，主线程直接作为 V8 外部字符串的数据，不再复制
+class MatchedPaths
+{
+public:
+	struct Span {
+		bool oneByte;
+		size_t offset;
+		size_t length;
+	};
+
+	// maxPaths 为 0 表示不限制
+	explicit MatchedPaths(size_t maxPaths);
+	MatchedPaths(const MatchedPaths&) = delete;
+	MatchedPaths& operator=(const MatchedPaths&) = delete;
+
+	// 已满时返回 false
+	bool Add(const wchar_t* path, size_t length);
+	bool Full() const { return m_maxPaths != 0 && m_spans.size() >= m_maxPaths; }
+
+	size_t Count() const { return m_spans.size(); }
+	const Span& At(size_t index) const { return m_spans[index]; }
+	const char* OneByteData(const Span& span) const { return m_oneByte.data() + span.offset; }
+	const uint16_t* TwoByteData(const Span& span) const { return m_twoByte.data() + span.offset; }
+	// 还原为宽字符路径，供需要重新访问文件的场合（例如内容校验）使用
+	std::wstring PathAt(size_t index) const;
+
+private:
+	size_t m_maxPaths;
+	std::vector<Span> m_spans;
+	std::vector<char> m_oneByte;
+	std::vector<uint16_t> m_twoByte;
+};
+
+// 一次选中项检测的结果，可被选中项缓存和多个事件共享
+struct SelectionMatch {
+	long matchCount;
+	std::shared_ptr<const MatchedPaths> paths;
+};
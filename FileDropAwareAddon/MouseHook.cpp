@@ -1,282 +1,635 @@
-#include "MouseHook.h"
+﻿#include "MouseHook.h"
 #include "FileDetector.h"
+#include "DetectorWorker.h"
+#include "ContentSniffer.h"
+#include "FileHasher.h"
+#include "FilePrewarmer.h"
+#include "Logger.h"
+#include "PipelineStats.h"
+#include "MouseStream.h"
+#include "DragTracker.h"
+#include <windowsx.h>
 #include <iostream>
 #include <thread>
-
-// ȫھڷϢ
-DWORD			g_mainThreadId		= 0;
-static bool		g_isLButtonDown		= false;
-static bool		g_isDragging		= false;
-static bool		g_detectionCalled	= false;
-static bool		g_supportedFile		= false;
-static POINT	g_dragStartPos		= { 0, 0 };
-// ϵͳקֵ
+#include <future>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+// 钩子线程 ID（用于发送消息）
+static std::atomic<DWORD> g_hookThreadId(0);
+// 钩子线程对象在堆上分配，join 后才释放：停止超时时线程仍在运行，进程退出时不会析构一个
+// 可 join 的 std::thread（那会调用 std::terminate），线程随进程结束
+static std::thread* g_hookThread = NULL;
+// 触发检测时的光标位置，作为检测结果事件的坐标
+static POINT	g_dragCheckPos		= { 0, 0 };
+// 越过拖拽阈值的时间 (QueryPerformanceCounter)
+static LONGLONG	g_dragCheckTicks	= 0;
+// 系统拖拽阈值
 static int		g_minDragX			= 0;
 static int		g_minDragY			= 0;
-// Ӿ
+// 钩子句柄
 static HHOOK	g_mouseHook			= NULL;
 
-// ȫֱƲ
-std::atomic<bool> g_isChecking(false);
+// 预测模式开关，钩子线程读取
+static std::atomic<bool> g_speculativeMode(false);
+// 后台哈希开关，钩子线程读取
+static std::atomic<bool> g_contentHashing(false);
+// 文件预热开关，钩子线程读取
+static std::atomic<bool> g_prewarming(false);
+
+// 暂停开关，由其它线程写入，钩子线程通过 WM_HOOK_PAUSE 得知变化
+static std::atomic<bool> g_pauseRequested(false);
+// 钩子过程使用的暂停状态，仅在钩子线程访问
+static bool g_hookPaused = false;
+
+// 串行化钩子线程的启动与停止，Start/Stop 在线程池上执行，可能并发
+static std::mutex g_lifecycleMutex;
+// 已请求钩子线程退出但尚未 join，受 g_lifecycleMutex 保护
+static bool g_quitPosted = false;
+
+// 最近一次检测结果，释放事件沿用，仅在钩子线程访问
+static DragShellKind g_resultShell = DragShellKind::Unknown;
+static long g_resultMatchCount = 0;
+static std::shared_ptr<const MatchedPaths> g_resultPaths;
+// 当前拖拽的哈希任务，释放时随事件交出，仅在钩子线程访问
+static std::shared_ptr<HashJob> g_resultHashes;
+
+// 正在使用的录制器，仅在钩子线程访问
+static MouseStreamWriter* g_recorder = NULL;
+// 钩子线程是否还在接收录制消息：StartRecording/StopRecording 持锁检查后再投递，
+// 钩子线程退出消息循环时持锁清除并应答已投递的消息，之后不会再有录制消息进入队列
+static std::mutex g_recorderMutex;
+static bool g_recorderOpen = false;
+
+// 录制结果，由钩子线程交回给调用 StopRecording 的线程
+struct RecordingResult {
+	bool recording;
+	std::vector<uint8_t> stream;
+	uint64_t count;
+	uint64_t dropped;
+};
+
+// QueryPerformanceCounter 时钟，现代系统上由不变 TSC 实现，读取开销约数十纳秒
+struct QpcClock {
+	uint64_t Now() const { return (uint64_t)PipelineStats::Now(); }
+	uint64_t FromMillis(uint32_t ms) const { return (uint64_t)ms * (uint64_t)PipelineStats::TicksPerSecond() / 1000; }
+};
+
+// 钩子耗时看门狗，计数可在任意线程读取，其余状态仅在钩子线程访问
+static HookWatchdog<QpcClock> g_watchdog;
+// 钩子最后一次看到的光标位置，用于判断钩子是否已被系统移除
+static POINT g_lastHookPos = { 0, 0 };
+static UINT_PTR g_watchdogTimer = 0;
+// 看门狗检查间隔
+static const UINT kWatchdogIntervalMillis = 1000;
+
+// 拖拽事件的接收方，每个 JS 实例注册一个；锁只在注册/注销时才会有竞争，钩子线程不会等待 JS
+static std::mutex g_sinkMutex;
+static std::vector<std::pair<DragEventSink, void*>> g_sinks;
+
+// 仅在钩子线程调用
+static void DispatchDragEvent(const DragEvent& event) {
+	std::lock_guard<std::mutex> lock(g_sinkMutex);
+	for (const auto& sink : g_sinks) {
+		sink.first(sink.second, event);
+	}
+}
 
-v8::Persistent<v8::Function> MouseHook::m_fileDropCallback;
-v8::Isolate* MouseHook::m_Isolate = NULL;
+// 以最近一次检测结果构造事件，仅在钩子线程调用
+static void PushDragEvent(DragEventKind kind, const POINT& pt, LONGLONG originTicks, std::shared_ptr<const HashJob> hashes = nullptr) {
+	DragEvent event = { kind, PipelineStats::Now(), originTicks, (int32_t)pt.x, (int32_t)pt.y, g_resultShell, g_resultMatchCount, g_resultPaths, std::move(hashes) };
+	DispatchDragEvent(event);
+}
 
-extern void LogInfo(const std::wstring& info);
-extern void LogError(const std::wstring& error);
+// 已释放的哈希任务全部结束，在哈希线程上调用，交给钩子线程投递 Hashed 事件
+static void OnHashComplete(void* context, const std::shared_ptr<HashJob>& job) {
+	std::shared_ptr<HashJob>* message = new std::shared_ptr<HashJob>(job);
+	DWORD threadId = g_hookThreadId;
+	if (threadId == 0 || !PostThreadMessage(threadId, WM_HASH_COMPLETE, 0, (LPARAM)message))
+	{
+		delete message;
+	}
+}
 
-void MouseHook::InitMouseHook(std::set<std::wstring> supportedExtensions) {
-	LogInfo(L"Init mouse hook, monitoring mouse... Drag a file (e.g., .txt) to see detection.");
-	/*if (!FileDetector::ComInitialize())
+// 释放拖拽：哈希任务随释放事件交给 JS，未完成的部分在完成后通过 Hashed 事件补发
+static void ReleaseDrag(const POINT& pt) {
+	std::shared_ptr<HashJob> hashes = std::move(g_resultHashes);
+	if (hashes)
 	{
-		LogError(L"Failed to initialize COM! Error: " + std::to_wstring(GetLastError()));
-		return;
-	}*/
-	FileDetector::SetExtensions(supportedExtensions);
+		hashes->Seal();
+	}
+	PushDragEvent(DragEventKind::Released, pt, 0, std::move(hashes));
+}
 
-	g_mainThreadId = GetCurrentThreadId();
-	
-	g_minDragX = GetSystemMetrics(SM_CXDRAG);
-	g_minDragY = GetSystemMetrics(SM_CYDRAG);
-	
-	LogInfo(L"Mouse drag threshold: " + std::to_wstring(g_minDragX) + L"px");
+// 触控笔模拟的鼠标消息在 dwExtraInfo 中带有该签名
+#define MI_WP_SIGNATURE		0xFF515700
+#define SIGNATURE_MASK		0xFFFFFF00
+
+// 钩子线程上的拖拽动作：发起检测、预测和释放事件
+struct HookDragPolicy {
+	static const uint32_t kButtons = kDragButtonLeft | kDragButtonPen;
+
+	int ThresholdX() const { return g_minDragX; }
+	int ThresholdY() const { return g_minDragY; }
+
+	void OnPress(uint32_t sequence, int32_t x, int32_t y) {
+		g_resultShell = DragShellKind::Unknown;
+		g_resultMatchCount = 0;
+		g_resultPaths.reset();
+		// 上一次拖拽的哈希任务已随释放事件交出，继续在后台完成
+		g_resultHashes.reset();
+		// 降级模式下不做预测，减少钩子过程中的工作
+		if (g_speculativeMode && !g_watchdog.Degraded())
+		{
+			// 提前解析拖拽起点，如果没有拖拽就在松开时取消
+			PostThreadMessage(g_hookThreadId, WM_PERFORM_DRAG_PREFETCH, (WPARAM)sequence, MAKELPARAM(x, y));
+		}
+	}
 
-	g_mouseHook = SetWindowsHookEx(WH_MOUSE_LL, MouseHookProc, NULL, 0);
-	if (g_mouseHook == NULL)
+	void OnDragStart(uint32_t sequence, int32_t x, int32_t y) {
+		// 达到拖拽阈值，执行文件检测
+		g_dragCheckTicks = PipelineStats::Now();
+		g_dragCheckPos = { x, y };
+		PostThreadMessage(g_hookThreadId, WM_PERFORM_DRAG_CHECK, (WPARAM)sequence, MAKELPARAM(x, y));
+	}
+
+	void OnRelease(uint32_t sequence, int32_t x, int32_t y) {
+		// 钩子过程与消息循环在同一线程，直接写入事件队列
+		LOG_INFO(L"[Detected] Dragging released.");
+		ReleaseDrag({ x, y });
+	}
+
+	void OnCancel(uint32_t sequence) {
+		if (g_speculativeMode)
+		{
+			// 没有拖拽，预测结果作废
+			PostThreadMessage(g_hookThreadId, WM_PERFORM_DRAG_CANCEL, (WPARAM)sequence, 0);
+		}
+	}
+};
+
+// 拖拽状态，仅在钩子线程访问
+static DragTracker<HookDragPolicy> g_dragTracker;
+
+// 读取系统的低级钩子超时，未设置时使用默认值
+static DWORD GetLowLevelHooksTimeout() {
+	DWORD timeout = 0;
+	DWORD size = sizeof(timeout);
+	if (RegGetValueW(HKEY_CURRENT_USER, L"Control Panel\\Desktop", L"LowLevelHooksTimeout",
+		RRF_RT_REG_DWORD, NULL, &timeout, &size) != ERROR_SUCCESS || timeout == 0)
+	{
+		timeout = 300;
+	}
+	// Windows 10 1709 起超时上限为 1000 毫秒
+	return timeout > 1000 ? 1000 : timeout;
+}
+
+// 暂停或停止时结束进行中的手势：已通知 JS 的拖拽补发释放事件，尚未拖拽的预测作废，
+// 之后返回的检测结果会被丢弃
+static void AbandonGesture() {
+	// 放弃的拖拽不会被投放，哈希结果没有用处，尚未映射的文件也不再预热
+	if (g_resultHashes)
+	{
+		g_resultHashes->Cancel();
+		g_resultHashes.reset();
+	}
+	FilePrewarmer::Cancel();
+	if (g_dragTracker.IsDetected())
+	{
+		PushDragEvent(DragEventKind::Released, g_lastHookPos, 0);
+	}
+	else if (g_dragTracker.IsPressed() && !g_dragTracker.IsDragging())
+	{
+		g_dragTracker.GetPolicy().OnCancel(g_dragTracker.Sequence());
+	}
+	g_dragTracker.Reset();
+}
+
+// 在钩子线程上切换暂停状态
+static void ApplyPause(bool paused) {
+	if (paused == g_hookPaused)
 	{
-		LogError(L"Failed to install hook! Error: " + std::to_wstring(GetLastError()));
-		//FileDetector::ComUninitialize();
 		return;
 	}
+	g_hookPaused = paused;
+	if (paused)
+	{
+		AbandonGesture();
+	}
+	LOG_INFO(paused ? L"Monitoring paused." : L"Monitoring resumed.");
+}
 
-	MSG msg;
-	while (GetMessage(&msg, NULL, 0, 0))
+// 在钩子线程上重新安装钩子
+static void ReinstallHook() {
+	if (g_mouseHook != NULL)
 	{
-		// ǷԶϢ
-		if (msg.message == WM_PERFORM_DRAG_CHECK)
-		{
-			// ڼУ󣬷ֹѻ
-			if (g_isChecking) continue;
-			g_isChecking = true;
+		UnhookWindowsHookEx(g_mouseHook);
+	}
+	g_mouseHook = SetWindowsHookEx(WH_MOUSE_LL, MouseHook::MouseHookProc, NULL, 0);
+	if (g_mouseHook == NULL)
+	{
+		LOG_ERROR(L"Failed to reinstall hook! Error: " + std::to_wstring(GetLastError()));
+		return;
+	}
+	g_watchdog.OnReinstalled();
+	GetPhysicalCursorPos(&g_lastHookPos);
+	LOG_INFO(L"Mouse hook was removed by the system, reinstalled.");
+}
 
-			std::thread([]() {
-				// ߳ڲʼ COMΪ COM ߳ص (STA)
-				if (!FileDetector::ComInitialize())
-				{
-					LogError(L"Failed to initialize COM! Error: " + std::to_wstring(GetLastError()));
-					return;
-				}
+static void HookThreadProc(std::promise<bool>* ready) {
+	g_hookThreadId = GetCurrentThreadId();
 
-				bool result = FileDetector::IsDraggingSupportedFile();
+	MSG msg;
+	// 强制创建线程消息队列，保证其它线程的 PostThreadMessage 不会丢失
+	PeekMessage(&msg, NULL, WM_USER, WM_USER, PM_NOREMOVE);
+	// 在消息队列创建之后读取，之后的变化都会通过 WM_HOOK_PAUSE 送达
+	g_hookPaused = g_pauseRequested.load();
 
-				if (result) {
-					LogInfo(L"[Detected] Dragging supported file detected0000!");
-					// ɹ֪ͨ߳/UI߳ (Ҫһֻƻصֱ̣߳ﴦص)
-					//  V8/Node.js صͨҪִ߳УǷһɹϢ
-					// ע⣺Ҫõ߳ID g_mainThreadId ɷ
-					PostThreadMessage(g_mainThreadId, WM_DRAG_CHECK_SUCCESS, 0, 0);
-				}
+	g_mouseHook = SetWindowsHookEx(WH_MOUSE_LL, MouseHook::MouseHookProc, NULL, 0);
+	if (g_mouseHook == NULL)
+	{
+		LOG_ERROR(L"Failed to install hook! Error: " + std::to_wstring(GetLastError()));
+		g_hookThreadId = 0;
+		ready->set_value(false);
+		return;
+	}
+	if (!DetectorWorker::Start(g_hookThreadId))
+	{
+		UnhookWindowsHookEx(g_mouseHook);
+		g_mouseHook = NULL;
+		g_hookThreadId = 0;
+		ready->set_value(false);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(g_recorderMutex);
+		g_recorderOpen = true;
+	}
+	ready->set_value(true);
+
+	// 超时的三分之一作为单次调用预算
+	DWORD timeout = GetLowLevelHooksTimeout();
+	g_watchdog.Configure({ timeout, timeout / 3, 3, 10000, 30000, 1000 });
+	GetPhysicalCursorPos(&g_lastHookPos);
+	g_watchdogTimer = SetTimer(NULL, 0, kWatchdogIntervalMillis, NULL);
 
-				FileDetector::ComUninitialize();
-				g_isChecking = false;
-			}).detach();
-
-			// ȷ COM ̣߳STẠִ߳
-			// g_supportedFile = FileDetector::IsDraggingSupportedFile();
-			// if (g_supportedFile)
-			// {
-			// 	LogInfo(L"[Detected] Dragging supported file detected!");
-			// 	v8::Local<v8::Value> argv[1] = {
-			// 		v8::String::NewFromUtf8(m_Isolate, std::to_string(WM_PERFORM_DRAG_CHECK).c_str()).ToLocalChecked(),
-			// 	};
-
-			// 	// ûص
-			// 	m_fileDropCallback->Call(m_Isolate->GetCurrentContext(),
-			// 		Null(m_Isolate),
-			// 		1, argv).ToLocalChecked();
-			// }
+	while (GetMessage(&msg, NULL, 0, 0) > 0)
+	{
+		// 检查是否是我们自定义的消息
+		if (msg.message == WM_PERFORM_DRAG_CHECK)
+		{
+			// 钩子过程与消息循环在同一线程，可以直接读取阈值时间
+			LONGLONG originTicks = (g_dragTracker.Sequence() == (uint32_t)msg.wParam) ? g_dragCheckTicks : 0;
+			PipelineStats::Record(PipelineStage::HookPost, originTicks, PipelineStats::Now());
+			// 交给常驻检测线程，积压的请求由检测线程合并
+			DetectorWorker::Submit({ DetectRequestKind::Check, (unsigned long long)msg.wParam,
+				{ GET_X_LPARAM(msg.lParam), GET_Y_LPARAM(msg.lParam) }, originTicks });
+		}
+		else if (msg.message == WM_PERFORM_DRAG_PREFETCH)
+		{
+			DetectorWorker::Submit({ DetectRequestKind::Prefetch, (unsigned long long)msg.wParam,
+				{ GET_X_LPARAM(msg.lParam), GET_Y_LPARAM(msg.lParam) } });
+		}
+		else if (msg.message == WM_PERFORM_DRAG_CANCEL)
+		{
+			DetectorWorker::Submit({ DetectRequestKind::Cancel, (unsigned long long)msg.wParam, { 0, 0 } });
+		}
+		else if (msg.message == WM_HOOK_PAUSE)
+		{
+			ApplyPause(g_pauseRequested.load());
 		}
-		else if (msg.message == WM_DRAG_CHECK_SUCCESS)
+		else if (msg.message == WM_HASH_COMPLETE)
 		{
-            g_supportedFile = true;
-			LogInfo(L"[Detected] Dragging supported file detected!");
-			// ȷIsolate
-			if (m_Isolate == NULL) {
-				LogError(L"Isolate is null when trying to call callback.");
-				break;
+			// 释放时还未完成的哈希任务已结束，路径与计数取自任务本身，不受之后的拖拽影响
+			std::unique_ptr<std::shared_ptr<HashJob>> job((std::shared_ptr<HashJob>*)msg.lParam);
+			DragEvent event = { DragEventKind::Hashed, PipelineStats::Now(), 0, 0, 0, DragShellKind::Unknown,
+				(long)(*job)->Count(), (*job)->Paths(), *job };
+			DispatchDragEvent(event);
+		}
+		else if (msg.message == WM_TIMER && msg.hwnd == NULL && msg.wParam == g_watchdogTimer)
+		{
+			// 光标移动了但钩子没有被调用，或者出现过超时，说明钩子可能已被系统静默移除
+			POINT cursor;
+			bool moved = GetPhysicalCursorPos(&cursor) && (cursor.x != g_lastHookPos.x || cursor.y != g_lastHookPos.y);
+			if (g_watchdog.Check(moved))
+			{
+				ReinstallHook();
 			}
-			// Isolate
-    		v8::Isolate::Scope isolate_scope(m_Isolate);
-			//  HandleScope޷ v8::String
-			v8::HandleScope handle_scope(m_Isolate);
-
-			// صǷΪ
-			if (!m_fileDropCallback.IsEmpty()) {
-				// ȡǰ
-				v8::Local<v8::Context> context = m_Isolate->GetCurrentContext();
-
-				//  Persistent ȡ Local 
-				v8::Local<v8::Function> callback = v8::Local<v8::Function>::New(m_Isolate, m_fileDropCallback);
-
-				v8::Local<v8::Value> argv[1] = {
-					v8::String::NewFromUtf8(m_Isolate, std::to_string(WM_PERFORM_DRAG_CHECK).c_str()).ToLocalChecked(),
-				};
-
-				// ִлص
-				callback->Call(context, v8::Null(m_Isolate), 1, argv).ToLocalChecked();
+		}
+		else if (msg.message == WM_RECORDER_START)
+		{
+			// 录制器的所有权交给钩子线程；已在录制时保留原有录制
+			MouseStreamWriter* recorder = (MouseStreamWriter*)msg.lParam;
+			if (g_recorder == NULL) {
+				g_recorder = recorder;
 			}
-			else
-			{
-				LogError(L"m_fileDropCallback is empty.");
+			else {
+				delete recorder;
 			}
 		}
-		else if (msg.message == WM_PERFORM_DRAG_RELEASE)
+		else if (msg.message == WM_RECORDER_STOP)
 		{
-			if (g_supportedFile)
+			std::promise<RecordingResult>* stopped = (std::promise<RecordingResult>*)msg.lParam;
+			RecordingResult result = { g_recorder != NULL, {}, 0, 0 };
+			if (g_recorder != NULL) {
+				result.stream.swap(g_recorder->Bytes());
+				result.count = g_recorder->Count();
+				result.dropped = g_recorder->Dropped();
+				delete g_recorder;
+				g_recorder = NULL;
+			}
+			stopped->set_value(std::move(result));
+		}
+		else if (msg.message == WM_DRAG_CHECK_SUCCESS || msg.message == WM_DRAG_CHECK_INCONCLUSIVE)
+		{
+			// 检测结果由钩子线程接管并释放
+			std::unique_ptr<DetectResult> result((DetectResult*)msg.lParam);
+			// 忽略过期结果：已开始新的拖拽，或本次拖拽已经释放
+			// 无法确定时同样通知 JS，并在释放时发送释放事件
+			if (!result || !g_dragTracker.AcceptResult((uint32_t)msg.wParam)) continue;
+			g_resultShell = result->isDesktop ? DragShellKind::Desktop : DragShellKind::Explorer;
+			g_resultMatchCount = result->match.matchCount;
+			g_resultPaths = std::move(result->match.paths);
+			if (msg.message == WM_DRAG_CHECK_SUCCESS)
 			{
-				g_supportedFile = false;
-				LogInfo(L"[Detected] Dragging released.");
-				// ȷIsolate
-				if (m_Isolate == NULL) {
-					LogError(L"Isolate is null when trying to call callback.");
-					break;
-				}
-				// Isolate
-    			v8::Isolate::Scope isolate_scope(m_Isolate);
-				v8::HandleScope handle_scope(m_Isolate); //  Scope
-
-				if (!m_fileDropCallback.IsEmpty()) {
-					v8::Local<v8::Context> context = m_Isolate->GetCurrentContext();
-					v8::Local<v8::Function> callback = v8::Local<v8::Function>::New(m_Isolate, m_fileDropCallback);
-
-					v8::Local<v8::Value> argv[1] = {
-						v8::String::NewFromUtf8(m_Isolate, std::to_string(WM_PERFORM_DRAG_RELEASE).c_str()).ToLocalChecked(),
-					};
-
-					callback->Call(context, v8::Null(m_Isolate), 1, argv).ToLocalChecked();
+				LOG_INFO(L"[Detected] Dragging supported file detected!");
+				// 拖拽到投放通常还有 0.5~2 秒，在这段时间里提前计算哈希
+				if (g_contentHashing && g_resultPaths && g_resultPaths->Count() > 0)
+				{
+					g_resultHashes = FileHasher::Begin(g_resultPaths, OnHashComplete, NULL);
 				}
-				else
+				if (g_prewarming && g_resultPaths && g_resultPaths->Count() > 0)
 				{
-					LogError(L"m_fileDropCallback is empty.");
+					FilePrewarmer::Prewarm(g_resultPaths);
 				}
-				//v8::Local<v8::Value> argv[1] = {
-				//		v8::String::NewFromUtf8(m_Isolate, std::to_string(WM_PERFORM_DRAG_RELEASE).c_str()).ToLocalChecked(),
-				//};
-
-				//// ûص
-				//m_fileDropCallback->Call(m_Isolate->GetCurrentContext(),
-				//	Null(m_Isolate),
-				//	1, argv).ToLocalChecked();
+				PushDragEvent(DragEventKind::Supported, g_dragCheckPos, result->originTicks);
+			}
+			else
+			{
+				LOG_INFO(L"[Detected] Dragging selection is too large to verify.");
+				PushDragEvent(DragEventKind::Inconclusive, g_dragCheckPos, result->originTicks);
 			}
 		}
 		else
 		{
-			// ׼ϵͳϢ
+			// 处理其他标准系统消息
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
 		}
 	}
-	UninitMouseHook();
-}
 
-void MouseHook::UninitMouseHook() {
+	// 先关闭录制消息的入口，再应答已在队列中的录制消息，调用 StopRecording 的线程不会一直等待
+	{
+		std::lock_guard<std::mutex> lock(g_recorderMutex);
+		g_recorderOpen = false;
+		while (PeekMessage(&msg, NULL, WM_RECORDER_START, WM_RECORDER_STOP, PM_REMOVE))
+		{
+			if (msg.message == WM_RECORDER_START)
+			{
+				delete (MouseStreamWriter*)msg.lParam;
+			}
+			else
+			{
+				((std::promise<RecordingResult>*)msg.lParam)->set_value({ false, {}, 0, 0 });
+			}
+		}
+	}
+
+	KillTimer(NULL, g_watchdogTimer);
+	g_watchdogTimer = 0;
+	AbandonGesture();
 	UnhookWindowsHookEx(g_mouseHook);
-	/*FileDetector::ComUninitialize();*/
+	g_mouseHook = NULL;
+	DetectorWorker::Stop();
+	ContentSniffer::Stop();
+	// 返回后不会再有 WM_HASH_COMPLETE 投递进来
+	FileHasher::Stop();
+	// 已取走的映射由 JS 持有，不受影响
+	FilePrewarmer::Stop();
+
+	// 检测线程已停止，释放队列中尚未处理的消息所携带的对象
+	while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+	{
+		if (msg.message == WM_DRAG_CHECK_SUCCESS || msg.message == WM_DRAG_CHECK_INCONCLUSIVE)
+		{
+			delete (DetectResult*)msg.lParam;
+		}
+		else if (msg.message == WM_HASH_COMPLETE)
+		{
+			delete (std::shared_ptr<HashJob>*)msg.lParam;
+		}
+	}
+	g_resultPaths.reset();
+	g_resultHashes.reset();
+	delete g_recorder;
+	g_recorder = NULL;
+	g_hookThreadId = 0;
 }
 
-void MouseHook::SetFileDropCallback(v8::Local<v8::Function> callback) {
-	// ? ؼȷ Isolate  Context 
-    if (m_Isolate == NULL) {
-		LogError(L"m_Isolate is null");
-        // LogError ׳쳣
-        return;
-    }
-    
-    // 1. ȡǰ Context
-    v8::Local<v8::Context> context = m_Isolate->GetCurrentContext();
-
-    // 2. ?  Context ȷ V8 ЧĻн
-	// Isolate
-    // v8::Isolate::Scope isolate_scope(m_Isolate);
-    v8::Context::Scope context_scope(context);
-
-	// ֮ǰùãͷžɵã
-	if (!m_fileDropCallback.IsEmpty()) {
-		m_fileDropCallback.Reset();
-	}
-	// ʹ SetFileDropCallback ִϣصҲᱻ
-	m_fileDropCallback.Reset(m_Isolate, callback);
+// 等待已请求退出的钩子线程结束，调用方持有 g_lifecycleMutex
+static bool JoinHookThread(DWORD timeoutMillis) {
+	// 检测线程可能卡在无响应的 Explorer 的 COM 调用上，超时后保留线程，之后可以再次等待
+	if (WaitForSingleObject(g_hookThread->native_handle(), timeoutMillis) != WAIT_OBJECT_0)
+	{
+		LOG_ERROR(L"Mouse hook thread did not stop within " + std::to_wstring(timeoutMillis) + L"ms.");
+		return false;
+	}
+	g_hookThread->join();
+	delete g_hookThread;
+	g_hookThread = NULL;
+	g_quitPosted = false;
+	// 钩子线程退出前已 join 线程池；此前超时时只请求了停止，这里复位停止标记，线程池可以再次启动
+	// 此时线程池已没有线程，不会阻塞
+	ContentSniffer::Stop();
+	FileHasher::Stop();
+	FilePrewarmer::Stop();
+	return true;
 }
 
-void MouseHook::SetIsolate(v8::Isolate* isolate) {
-    m_Isolate = isolate;
+bool MouseHook::InitMouseHook(DWORD timeoutMillis) {
+	std::lock_guard<std::mutex> lock(g_lifecycleMutex);
+	if (g_hookThread != NULL)
+	{
+		if (!g_quitPosted)
+		{
+			LOG_INFO(L"Mouse hook is already running.");
+			return true;
+		}
+		// 上一次停止尚未完成
+		if (!JoinHookThread(timeoutMillis))
+		{
+			return false;
+		}
+	}
+
+	LOG_INFO(L"Init mouse hook, monitoring mouse... Drag a file (e.g., .txt) to see detection.");
+
+	g_minDragX = GetSystemMetrics(SM_CXDRAG);
+	g_minDragY = GetSystemMetrics(SM_CYDRAG);
+
+	LOG_INFO(L"Mouse drag threshold: " + std::to_wstring(g_minDragX) + L"px");
+
+	// 钩子和消息循环运行在独立线程上，这里只等待钩子安装完成
+	std::promise<bool> ready;
+	std::future<bool> installed = ready.get_future();
+	g_hookThread = new std::thread(HookThreadProc, &ready);
+	if (!installed.get())
+	{
+		g_hookThread->join();
+		delete g_hookThread;
+		g_hookThread = NULL;
+		return false;
+	}
+	return true;
 }
 
-LRESULT CALLBACK MouseHook::MouseHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
-	// ȷЧ (nCode >= 0)
-	if (nCode >= 0)
+bool MouseHook::UninitMouseHook(DWORD timeoutMillis) {
+	std::lock_guard<std::mutex> lock(g_lifecycleMutex);
+	if (g_hookThread == NULL)
 	{
-		MSLLHOOKSTRUCT* pMouseStruct = (MSLLHOOKSTRUCT*)lParam;
-		POINT currentPos = pMouseStruct->pt;
+		return true;
+	}
+	// 退出钩子线程的消息循环，钩子由钩子线程自己卸载，检测线程由钩子线程停止
+	if (!g_quitPosted)
+	{
+		PostThreadMessage(g_hookThreadId, WM_QUIT, 0, 0);
+		g_quitPosted = true;
+	}
+	if (!JoinHookThread(timeoutMillis))
+	{
+		// 钩子线程卡在等待检测线程上，还没有停止后台线程池；这里只请求停止，不在 g_lifecycleMutex 下等待：
+		// 线程池中的线程可能同样卡在 IO 上。join 留给钩子线程自己的退出过程，或下一次成功的 JoinHookThread
+		ContentSniffer::RequestStop();
+		FileHasher::RequestStop();
+		FilePrewarmer::RequestStop();
+		return false;
+	}
+	return true;
+}
 
-		switch (wParam)
-		{
-		case WM_LBUTTONDOWN:
-		{
-			// 
-			g_isLButtonDown = true;
-			g_isDragging = false;
-			g_detectionCalled = false;
-			g_dragStartPos = currentPos;
-			//std::cout << "\n[EVENT] LButton Down.\n";
+void MouseHook::SetPaused(bool paused) {
+	if (g_pauseRequested.exchange(paused) == paused)
+	{
+		return;
+	}
+	// 不等待 g_lifecycleMutex，停止过程中也能立即返回；未运行时投递失败，下次安装时读取状态
+	DWORD threadId = g_hookThreadId;
+	if (threadId != 0)
+	{
+		PostThreadMessage(threadId, WM_HOOK_PAUSE, 0, 0);
+	}
+}
+
+bool MouseHook::IsPaused() {
+	return g_pauseRequested.load();
+}
+
+void MouseHook::AddEventSink(DragEventSink sink, void* context) {
+	std::lock_guard<std::mutex> lock(g_sinkMutex);
+	g_sinks.emplace_back(sink, context);
+}
+
+void MouseHook::RemoveEventSink(DragEventSink sink, void* context) {
+	std::lock_guard<std::mutex> lock(g_sinkMutex);
+	for (auto it = g_sinks.begin(); it != g_sinks.end(); ++it) {
+		if (it->first == sink && it->second == context) {
+			g_sinks.erase(it);
 			break;
 		}
+	}
+}
+
+bool MouseHook::StartRecording(size_t maxBytes) {
+	std::lock_guard<std::mutex> lock(g_recorderMutex);
+	if (!g_recorderOpen)
+	{
+		return false;
+	}
+	MouseStreamWriter* recorder = new MouseStreamWriter(maxBytes);
+	if (!PostThreadMessage(g_hookThreadId, WM_RECORDER_START, 0, (LPARAM)recorder))
+	{
+		delete recorder;
+		return false;
+	}
+	return true;
+}
 
-		case WM_MOUSEMOVE:
+bool MouseHook::StopRecording(std::vector<uint8_t>& stream, uint64_t& count, uint64_t& dropped) {
+	std::promise<RecordingResult> stopped;
+	std::future<RecordingResult> result = stopped.get_future();
+	{
+		std::lock_guard<std::mutex> lock(g_recorderMutex);
+		if (!g_recorderOpen || !PostThreadMessage(g_hookThreadId, WM_RECORDER_STOP, 0, (LPARAM)&stopped))
 		{
-			if (g_isLButtonDown)
-			{
-				if (!g_isDragging)
-				{
-					// ڰ£Ƿ񳬹קֵ
-					long dx = std::abs(currentPos.x - g_dragStartPos.x);
-					long dy = std::abs(currentPos.y - g_dragStartPos.y);
-
-					if (dx >= g_minDragX || dy >= g_minDragY)
-					{
-						// ﵽקֵ
-						g_isDragging = true;
-						//std::cout << "[EVENT] Dragging Started.\n";
-					}
-				}
+			return false;
+		}
+	}
+	// 投递成功的消息一定会被应答：由消息循环处理，或在钩子线程退出消息循环时应答；钩子线程只交换缓冲区，等待时间很短
+	RecordingResult recording = result.get();
+	stream.swap(recording.stream);
+	count = recording.count;
+	dropped = recording.dropped;
+	return recording.recording;
+}
 
-				if (g_isDragging && !g_detectionCalled)
-				{
-					// קִļ
-					PostThreadMessage(g_mainThreadId, WM_PERFORM_DRAG_CHECK, 0, 0);
-					g_detectionCalled = true;
-				}
-			}
-			break;
+HookHealth MouseHook::GetHookHealth() {
+	return g_watchdog.Health();
+}
+
+void MouseHook::SetSpeculativeMode(bool enabled) {
+	g_speculativeMode = enabled;
+}
+
+void MouseHook::SetContentHashing(bool enabled) {
+	g_contentHashing = enabled;
+	if (!enabled)
+	{
+		FileHasher::CancelAll();
+	}
+}
+
+void MouseHook::SetPrewarming(bool enabled) {
+	g_prewarming = enabled;
+	if (!enabled)
+	{
+		FilePrewarmer::Clear();
+	}
+}
+
+LRESULT CALLBACK MouseHook::MouseHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
+	if (nCode >= 0 && g_hookPaused)
+	{
+		// 暂停时钩子保持安装但不做任何检测，只记录光标位置，供看门狗判断钩子是否仍然有效
+		g_lastHookPos = ((MSLLHOOKSTRUCT*)lParam)->pt;
+	}
+	// 确保处理是有效的 (nCode >= 0)
+	else if (nCode >= 0)
+	{
+		uint64_t start = g_watchdog.Enter();
+		MSLLHOOKSTRUCT* pMouseStruct = (MSLLHOOKSTRUCT*)lParam;
+		POINT currentPos = pMouseStruct->pt;
+		g_lastHookPos = currentPos;
+		// 降级模式下暂停录制
+		if (g_recorder != NULL && !g_watchdog.Degraded())
+		{
+			g_recorder->Append({ (uint32_t)wParam, currentPos.x, currentPos.y, pMouseStruct->time, pMouseStruct->flags });
 		}
 
-		case WM_LBUTTONUP:
+		PointerInput input;
+		if (DecodeMouseMessage((uint32_t)wParam, currentPos.x, currentPos.y, input))
 		{
-			// ͷ
-			if (g_isDragging && g_detectionCalled)
+			if (input.button == kDragButtonLeft && (pMouseStruct->dwExtraInfo & SIGNATURE_MASK) == MI_WP_SIGNATURE)
 			{
-				//std::cout << "[EVENT] Dragging Released.\n";
-				PostThreadMessage(g_mainThreadId, WM_PERFORM_DRAG_RELEASE, 0, 0);
+				input.button = kDragButtonPen;
 			}
-			// ״̬
-			g_isLButtonDown = false;
-			g_isDragging = false;
-			g_detectionCalled = false;
-			break;
-		}
+			g_dragTracker.Feed(input);
 		}
+		// 排队时间来自事件时间戳（GetTickCount 时钟），同样计入系统超时
+		DWORD queued = GetTickCount() - pMouseStruct->time;
+		g_watchdog.Exit(start, (LONG)queued < 0 ? 0 : queued);
 	}
 
-	// صһӣ¼ȥ
+	// 务必调用下一个钩子，将事件传递下去
 	return CallNextHookEx(g_mouseHook, nCode, wParam, lParam);
-}
\ No newline at end of file
+}
@@ -1,23 +1,53 @@
-#pragma once
+﻿#pragma once
 #include <windows.h>
 #include <string>
-#include <set>
-#include <node.h>
+#include <vector>
+#include <cstdint>
+#include "HookWatchdog.h"
+#include "DragEvents.h"
 
 #define WM_PERFORM_DRAG_CHECK	(WM_USER + 100)
 #define WM_PERFORM_DRAG_RELEASE (WM_USER + 101)
 #define WM_DRAG_CHECK_SUCCESS   (WM_USER + 102)
+#define WM_PERFORM_DRAG_PREFETCH (WM_USER + 103)
+#define WM_PERFORM_DRAG_CANCEL	(WM_USER + 104)
+#define WM_DRAG_CHECK_INCONCLUSIVE (WM_USER + 105)
+#define WM_RECORDER_START		(WM_USER + 106)
+#define WM_RECORDER_STOP		(WM_USER + 107)
+#define WM_HOOK_PAUSE			(WM_USER + 108)
+#define WM_HASH_COMPLETE		(WM_USER + 109)
+
+// WM_DRAG_CHECK_SUCCESS / WM_DRAG_CHECK_INCONCLUSIVE 的 lParam 为 DetectResult*，接收方负责释放
+// WM_HASH_COMPLETE 的 lParam 为 std::shared_ptr<HashJob>*，接收方负责释放
 
 class MouseHook
 {
 public:
-	static v8::Persistent<v8::Function> m_fileDropCallback;
-	static v8::Isolate* m_Isolate;
-public:
-	static void InitMouseHook(std::set<std::wstring> supportedExtensions);
-	static void UninitMouseHook();
-	static void SetFileDropCallback(v8::Local<v8::Function> callback);
-	static void SetIsolate(v8::Isolate* isolate);
+	// 在独立的钩子线程上安装钩子并运行消息循环，安装完成后立即返回；匹配规则由 FileDetector::SetRules 设置
+	// 已在运行时直接返回；上一次停止尚未完成时最多等待 timeoutMillis
+	static bool InitMouseHook(DWORD timeoutMillis = INFINITE);
+	// 卸载钩子并停止检测线程，timeoutMillis 内未完成时返回 false，线程继续退出，可以再次调用等待
+	// 进程退出前仍未结束的线程不会被等待，随进程一起结束
+	static bool UninitMouseHook(DWORD timeoutMillis = INFINITE);
+	// 暂停时钩子保持安装但跳过所有检测，恢复时无需重新安装；已通知 JS 的拖拽会补发释放事件
+	// 未运行时同样可以设置，下次安装后生效
+	static void SetPaused(bool paused);
+	static bool IsPaused();
+	// 注册拖拽事件的接收方，sink 在钩子线程上调用；注销返回后不会再被调用
+	static void AddEventSink(DragEventSink sink, void* context);
+	static void RemoveEventSink(DragEventSink sink, void* context);
+	// 预测模式：按下左键时就开始解析拖拽起点，拖拽开始时结果通常已经就绪
+	static void SetSpeculativeMode(bool enabled);
+	// 检测到拖拽支持的文件后在后台计算匹配文件的哈希，随释放事件交给 JS；暂停、停止时取消
+	static void SetContentHashing(bool enabled);
+	// 检测到拖拽支持的文件后在后台映射并预读匹配的文件，投放时通过 FilePrewarmer::Take 取走；关闭时释放缓存
+	static void SetPrewarming(bool enabled);
+	// 录制到达钩子过程的原始鼠标事件（增量编码，见 MouseStream.h），maxBytes 为 0 表示不限制
+	static bool StartRecording(size_t maxBytes);
+	// 停止录制并取出事件流，未在录制时返回 false
+	static bool StopRecording(std::vector<uint8_t>& stream, uint64_t& count, uint64_t& dropped);
+	// 钩子耗时看门狗的计数，maxTicks 为 QueryPerformanceCounter 刻度
+	static HookHealth GetHookHealth();
 	static LRESULT CALLBACK MouseHookProc(int nCode, WPARAM wParam, LPARAM lParam);
 protected:
 private:
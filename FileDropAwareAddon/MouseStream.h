@@ -0,0 +1,160 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 低级鼠标事件流的紧凑二进制格式，用于离线复现和基准测试，不依赖 Windows 头文件
+//
+// 文件头: "FDMS" + 版本号 (1 字节)
+// 每条记录:
+//   1 字节代码: 低 7 位为 message - 0x200 (0x7F 表示其后跟随 varint 原始 message)，
+//               最高位表示其后跟随 varint flags（为 0 时省略）
+//   zigzag varint: x、y 相对上一条记录的差值
+//   varint: time 相对上一条记录的差值（按 32 位回绕）
+struct MouseRecord {
+	uint32_t message;
+	int32_t x;
+	int32_t y;
+	// MSLLHOOKSTRUCT::time，毫秒
+	uint32_t time;
+	uint32_t flags;
+};
+
+// 编解码工具
+class MouseStream
+{
+public:
+	static const uint8_t kVersion = 1;
+	static const size_t kMagicSize = 4;
+	static const size_t kHeaderSize = kMagicSize + 1;
+	static const uint32_t kMessageBase = 0x200;
+	static const uint8_t kRawMessageCode = 0x7F;
+	static const uint8_t kFlagsBit = 0x80;
+	// 单条记录的最大长度：1 字节代码 + 5 个 varint
+	static const size_t kMaxRecordSize = 1 + 5 * 5;
+	static const uint8_t* Magic() {
+		static const uint8_t magic[kMagicSize] = { 'F', 'D', 'M', 'S' };
+		return magic;
+	}
+
+	static void PutVarint(std::vector<uint8_t>& out, uint32_t value) {
+		while (value >= 0x80) {
+			out.push_back((uint8_t)(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back((uint8_t)value);
+	}
+
+	static uint32_t ZigZag(int32_t value) {
+		return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+	}
+
+	static int32_t UnZigZag(uint32_t value) {
+		return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+	}
+
+	// 读取失败（数据截断或超过 5 字节）时返回 false
+	static bool GetVarint(const uint8_t*& cursor, const uint8_t* end, uint32_t& value) {
+		value = 0;
+		for (unsigned shift = 0; shift < 35 && cursor < end; shift += 7) {
+			uint8_t byte = *cursor++;
+			value |= (uint32_t)(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// 解码整个事件流并依次交给 sink(const MouseRecord&)
+	// 返回解码的记录数，文件头或数据损坏时返回 -1
+	template <typename Sink>
+	static int64_t Replay(const uint8_t* data, size_t size, Sink&& sink) {
+		if (size < kHeaderSize) {
+			return -1;
+		}
+		for (size_t i = 0; i < kMagicSize; i++) {
+			if (data[i] != Magic()[i]) {
+				return -1;
+			}
+		}
+		if (data[kMagicSize] != kVersion) {
+			return -1;
+		}
+
+		const uint8_t* cursor = data + kHeaderSize;
+		const uint8_t* end = data + size;
+		MouseRecord record = {};
+		int64_t count = 0;
+		while (cursor < end) {
+			uint8_t code = *cursor++;
+			uint32_t value = 0;
+			if ((code & ~kFlagsBit) == kRawMessageCode) {
+				if (!GetVarint(cursor, end, value)) return -1;
+				record.message = value;
+			}
+			else {
+				record.message = kMessageBase + (code & ~kFlagsBit);
+			}
+			record.flags = 0;
+			if (code & kFlagsBit) {
+				if (!GetVarint(cursor, end, record.flags)) return -1;
+			}
+			if (!GetVarint(cursor, end, value)) return -1;
+			record.x = (int32_t)((uint32_t)record.x + (uint32_t)UnZigZag(value));
+			if (!GetVarint(cursor, end, value)) return -1;
+			record.y = (int32_t)((uint32_t)record.y + (uint32_t)UnZigZag(value));
+			if (!GetVarint(cursor, end, value)) return -1;
+			record.time += value;
+			sink(static_cast<const MouseRecord&>(record));
+			count++;
+		}
+		return count;
+	}
+};
+
+// 增量编码写入器，只在单个线程上使用
+class MouseStreamWriter
+{
+public:
+	// maxBytes 为 0 表示不限制，超出后丢弃后续记录
+	explicit MouseStreamWriter(size_t maxBytes = 0) : m_maxBytes(maxBytes), m_count(0), m_dropped(0), m_last() {
+		m_bytes.reserve(64 * 1024);
+		m_bytes.insert(m_bytes.end(), MouseStream::Magic(), MouseStream::Magic() + MouseStream::kMagicSize);
+		// 按值传入，避免 ODR 使用类内静态常量（C++17 之前需要类外定义）
+		m_bytes.push_back((uint8_t)MouseStream::kVersion);
+	}
+
+	void Append(const MouseRecord& record) {
+		if (m_maxBytes != 0 && m_bytes.size() + MouseStream::kMaxRecordSize > m_maxBytes) {
+			m_dropped++;
+			return;
+		}
+		uint32_t code = record.message - MouseStream::kMessageBase;
+		bool raw = record.message < MouseStream::kMessageBase || code >= MouseStream::kRawMessageCode;
+		m_bytes.push_back((uint8_t)((raw ? MouseStream::kRawMessageCode : code) | (record.flags != 0 ? MouseStream::kFlagsBit : 0)));
+		if (raw) {
+			MouseStream::PutVarint(m_bytes, record.message);
+		}
+		if (record.flags != 0) {
+			MouseStream::PutVarint(m_bytes, record.flags);
+		}
+		MouseStream::PutVarint(m_bytes, MouseStream::ZigZag((int32_t)((uint32_t)record.x - (uint32_t)m_last.x)));
+		MouseStream::PutVarint(m_bytes, MouseStream::ZigZag((int32_t)((uint32_t)record.y - (uint32_t)m_last.y)));
+		MouseStream::PutVarint(m_bytes, record.time - m_last.time);
+		m_last = record;
+		m_count++;
+	}
+
+	const std::vector<uint8_t>& Bytes() const { return m_bytes; }
+	std::vector<uint8_t>& Bytes() { return m_bytes; }
+	uint64_t Count() const { return m_count; }
+	uint64_t Dropped() const { return m_dropped; }
+
+private:
+	size_t m_maxBytes;
+	uint64_t m_count;
+	uint64_t m_dropped;
+	std::vector<uint8_t> m_bytes;
+	MouseRecord m_last;
+};
@@ -0,0 +1,70 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// 多生产者/单消费者有界无锁队列 (Dmitry Vyukov 的有界队列算法)
+// 元素在槽位中原地写入和读取，避免拷贝较大的记录
+// Capacity 必须是 2 的幂
+template <typename T, size_t Capacity>
+class MpscRing
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+public:
+	MpscRing() : m_enqueuePos(0), m_dequeuePos(0) {
+		for (size_t i = 0; i < Capacity; i++) {
+			m_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+	MpscRing(const MpscRing&) = delete;
+	MpscRing& operator=(const MpscRing&) = delete;
+
+	// 任意线程调用，fill(T&) 负责填充槽位；队列满时返回 false
+	template <typename Fill>
+	bool Push(Fill&& fill) {
+		Cell* cell;
+		size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+		for (;;) {
+			cell = &m_cells[pos & (Capacity - 1)];
+			size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+			if (diff == 0) {
+				if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			}
+			else if (diff < 0) {
+				return false;
+			}
+			else {
+				pos = m_enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+		fill(cell->data);
+		cell->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	// 仅允许消费者线程调用，consume(const T&) 读取槽位；队列空时返回 false
+	template <typename Consume>
+	bool Pop(Consume&& consume) {
+		Cell& cell = m_cells[m_dequeuePos & (Capacity - 1)];
+		size_t sequence = cell.sequence.load(std::memory_order_acquire);
+		if ((intptr_t)sequence - (intptr_t)(m_dequeuePos + 1) < 0) {
+			return false;
+		}
+		consume(static_cast<const T&>(cell.data));
+		cell.sequence.store(m_dequeuePos + Capacity, std::memory_order_release);
+		m_dequeuePos++;
+		return true;
+	}
+
+private:
+	struct Cell {
+		std::atomic<size_t> sequence;
+		T data;
+	};
+	alignas(64) Cell m_cells[Capacity];
+	alignas(64) std::atomic<size_t> m_enqueuePos;
+	alignas(64) size_t m_dequeuePos;
+};
@@ -0,0 +1,51 @@
+﻿#include "PipelineStats.h"
+
+static LatencyHistogram g_histograms[(size_t)PipelineStage::Count];
+
+int64_t PipelineStats::TicksPerSecond() {
+#ifdef _WIN32
+	static const int64_t frequency = []() {
+		LARGE_INTEGER value;
+		QueryPerformanceFrequency(&value);
+		return (int64_t)value.QuadPart;
+	}();
+	return frequency;
+#else
+	return 1000000000;
+#endif
+}
+
+double PipelineStats::TicksToMillis(int64_t ticks) {
+	return (double)ticks * 1000.0 / (double)TicksPerSecond();
+}
+
+void PipelineStats::Record(PipelineStage stage, int64_t startTicks, int64_t endTicks) {
+	// 起点未记录或时钟回退时忽略
+	if (startTicks == 0 || endTicks < startTicks) {
+		return;
+	}
+	uint64_t micros = (uint64_t)(endTicks - startTicks) * 1000000ull / (uint64_t)TicksPerSecond();
+	g_histograms[(size_t)stage].Record(micros);
+}
+
+LatencySummary PipelineStats::Summarize(PipelineStage stage, bool reset) {
+	return g_histograms[(size_t)stage].Summarize(reset);
+}
+
+const char* PipelineStats::StageName(PipelineStage stage) {
+	switch (stage)
+	{
+	case PipelineStage::HookPost: return "hookPost";
+	case PipelineStage::DetectorQueue: return "detectorQueue";
+	case PipelineStage::Classify: return "classify";
+	case PipelineStage::UiaHitTest: return "uiaHitTest";
+	case PipelineStage::ShellLookup: return "shellLookup";
+	case PipelineStage::Selection: return "selection";
+	case PipelineStage::Sniff: return "sniff";
+	case PipelineStage::Detect: return "detect";
+	case PipelineStage::Delivery: return "delivery";
+	case PipelineStage::Callback: return "callback";
+	case PipelineStage::EndToEnd: return "endToEnd";
+	default: return "unknown";
+	}
+}
@@ -0,0 +1,70 @@
+﻿#pragma once
+#include <cstdint>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#include "LatencyHistogram.h"
+
+// 拖拽检测流水线的各个阶段
+enum class PipelineStage {
+	// 钩子过程越过拖拽阈值 -> 钩子线程取到 WM_PERFORM_DRAG_CHECK
+	HookPost,
+	// 提交给检测线程 -> 检测线程开始处理
+	DetectorQueue,
+	// 窗口祖先链分类（Shell 父窗口与内容区域判定）
+	Classify,
+	// UIA 命中测试
+	UiaHitTest,
+	// Shell 窗口索引查找
+	ShellLookup,
+	// 选中项扫描（缓存命中时不计入）
+	Selection,
+	// 匹配文件的内容校验（启用 verifyContent 时）
+	Sniff,
+	// 检测线程开始处理 -> 发出检测结果
+	Detect,
+	// 事件写入队列 -> JS 回调开始执行
+	Delivery,
+	// JS 回调本身的耗时
+	Callback,
+	// 越过拖拽阈值 -> JS 收到检测结果
+	EndToEnd,
+	Count,
+};
+
+// 各阶段的耗时直方图，时间戳在 Windows 上使用 QueryPerformanceCounter，其它平台使用 CLOCK_MONOTONIC 纳秒
+class PipelineStats
+{
+public:
+	static int64_t Now() {
+#ifdef _WIN32
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+		return now.QuadPart;
+#else
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+#endif
+	}
+	static int64_t TicksPerSecond();
+	static double TicksToMillis(int64_t ticks);
+	static void Record(PipelineStage stage, int64_t startTicks, int64_t endTicks);
+	static LatencySummary Summarize(PipelineStage stage, bool reset);
+	static const char* StageName(PipelineStage stage);
+};
+
+// 作用域计时：析构时记录从构造到析构的耗时
+class StageTimer
+{
+public:
+	explicit StageTimer(PipelineStage stage) : m_stage(stage), m_start(PipelineStats::Now()) {}
+	~StageTimer() { PipelineStats::Record(m_stage, m_start, PipelineStats::Now()); }
+	StageTimer(const StageTimer&) = delete;
+	StageTimer& operator=(const StageTimer&) = delete;
+private:
+	PipelineStage m_stage;
+	int64_t m_start;
+};
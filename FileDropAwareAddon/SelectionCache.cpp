@@ -0,0 +1,118 @@
+﻿#include "SelectionCache.h"
+#include <shdispid.h>
+#include <atomic>
+#include <string>
+
+#include "ComEventSink.h"
+
+// 缓存的窗口数上限，超过后整体清空
+static const size_t kMaxCachedViews = 32;
+
+static std::atomic<unsigned long long> g_cacheHits(0);
+static std::atomic<unsigned long long> g_cacheMisses(0);
+
+SelectionCache::~SelectionCache() {
+	Clear();
+}
+
+SelectionCacheStats SelectionCache::GetStats() {
+	return {
+		g_cacheHits.load(std::memory_order_relaxed),
+		g_cacheMisses.load(std::memory_order_relaxed)
+	};
+}
+
+void SelectionCache::OnFolderViewEvent(void* context, DISPID dispId) {
+	switch (dispId)
+	{
+	// 选中项变化、文件夹内容变化（重命名、删除）或重新枚举完成都会影响结果
+	case DISPID_SELECTIONCHANGED:
+	case DISPID_CONTENTSCHANGED:
+	case DISPID_FILELISTENUMDONE:
+		static_cast<Entry*>(context)->valid = false;
+		break;
+	default:
+		break;
+	}
+}
+
+void SelectionCache::Disconnect(Entry& entry) {
+	if (entry.pFolderView != NULL && entry.adviseCookie != 0) {
+		AtlUnadvise(entry.pFolderView, DIID_DShellFolderViewEvents, entry.adviseCookie);
+	}
+	entry.adviseCookie = 0;
+	if (entry.pSink != NULL) {
+		entry.pSink->Detach();
+		entry.pSink->Release();
+		entry.pSink = NULL;
+	}
+	entry.pFolderView.Release();
+	entry.pViewIdentity.Release();
+	entry.valid = false;
+}
+
+void SelectionCache::Clear() {
+	for (auto& item : m_entries) {
+		Disconnect(*item.second);
+		delete item.second;
+	}
+	m_entries.clear();
+}
+
+bool SelectionCache::Lookup(HWND shellHwnd, IShellFolderViewDual* pFolderView, unsigned int rulesVersion, SelectionMatch& match) {
+	auto it = m_entries.find(shellHwnd);
+	if (it != m_entries.end() && it->second->valid && it->second->rulesVersion == rulesVersion) {
+		CComPtr<IUnknown> pIdentity;
+		pFolderView->QueryInterface(IID_IUnknown, (void**)&pIdentity);
+		if (pIdentity == it->second->pViewIdentity) {
+			match = it->second->match;
+			g_cacheHits++;
+			return true;
+		}
+	}
+	g_cacheMisses++;
+	return false;
+}
+
+void SelectionCache::Store(HWND shellHwnd, IShellFolderViewDual* pFolderView, unsigned int rulesVersion, const SelectionMatch& match) {
+	CComPtr<IUnknown> pIdentity;
+	if (FAILED(pFolderView->QueryInterface(IID_IUnknown, (void**)&pIdentity))) {
+		return;
+	}
+
+	Entry* pEntry = NULL;
+	auto it = m_entries.find(shellHwnd);
+	if (it != m_entries.end()) {
+		pEntry = it->second;
+	}
+	else {
+		if (m_entries.size() >= kMaxCachedViews) {
+			Clear();
+		}
+		pEntry = new Entry();
+		pEntry->shellHwnd = shellHwnd;
+		pEntry->pSink = NULL;
+		pEntry->adviseCookie = 0;
+		pEntry->valid = false;
+		m_entries[shellHwnd] = pEntry;
+	}
+
+	// 导航到其它文件夹后视图对象会变化，需要重新订阅事件
+	if (pEntry->pViewIdentity != pIdentity) {
+		Disconnect(*pEntry);
+		pEntry->pSink = new ComEventSink(DIID_DShellFolderViewEvents, OnFolderViewEvent, pEntry);
+		HRESULT hr = AtlAdvise(pFolderView, pEntry->pSink, DIID_DShellFolderViewEvents, &pEntry->adviseCookie);
+		if (FAILED(hr)) {
+			// 收不到失效通知就不能缓存
+			pEntry->adviseCookie = 0;
+			Disconnect(*pEntry);
+			return;
+		}
+		pEntry->pFolderView = pFolderView;
+		pEntry->pViewIdentity = pIdentity;
+	}
+
+	pEntry->match = match;
+	pEntry->rulesVersion = rulesVersion;
+	pEntry->valid = true;
+}
@@ -0,0 +1,46 @@
+﻿#pragma once
+#include <windows.h>
+#include <shldisp.h>
+#include <atlbase.h>
+#include <unordered_map>
+#include "MatchedPaths.h"
+
+class ComEventSink;
+
+// 选中项缓存命中统计
+struct SelectionCacheStats {
+	unsigned long long hits;
+	unsigned long long misses;
+};
+
+// 按 Shell 窗口缓存选中项的检测结果
+// 通过 DShellFolderViewEvents 的 SelectionChanged / ContentsChanged 失效；
+// 导航后文件夹视图对象会变化，视图不一致时同样视为未命中
+// 事件通过 COM 消息投递，所属 STA 线程必须持续分发消息
+class SelectionCache
+{
+public:
+	~SelectionCache();
+	// match.matchCount 为 0 表示没有匹配；路径缓冲区只读，命中时直接共享
+	bool Lookup(HWND shellHwnd, IShellFolderViewDual* pFolderView, unsigned int rulesVersion, SelectionMatch& match);
+	void Store(HWND shellHwnd, IShellFolderViewDual* pFolderView, unsigned int rulesVersion, const SelectionMatch& match);
+	void Clear();
+	static SelectionCacheStats GetStats();
+private:
+	struct Entry {
+		HWND shellHwnd;
+		// 用 IUnknown 判断是否为同一个视图对象
+		CComPtr<IUnknown> pViewIdentity;
+		CComPtr<IShellFolderViewDual> pFolderView;
+		ComEventSink* pSink;
+		DWORD adviseCookie;
+		bool valid;
+		SelectionMatch match;
+		unsigned int rulesVersion;
+	};
+	static void OnFolderViewEvent(void* context, DISPID dispId);
+	static void Disconnect(Entry& entry);
+private:
+	// Entry 地址被事件接收器引用，必须保持稳定，因此存放指针
+	std::unordered_map<HWND, Entry*> m_entries;
+};
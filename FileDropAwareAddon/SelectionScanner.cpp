@@ -0,0 +1,89 @@
+﻿#include "SelectionScanner.h"
+#include "MatchRules.h"
+#include "MatchedPaths.h"
+
+// 每扫描这么多项检查一次耗时，避免频繁读取计时器
+static const long kTimeCheckInterval = 16;
+
+SelectionScanner::SelectionScanner(const MatchRules& matcher, const ScanBudget& budget)
+	: m_matcher(matcher), m_budget(budget), m_maxTicks(0), m_scanned(0), m_matched(0), m_truncated(false) {
+	if (m_budget.maxMillis > 0) {
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		m_maxTicks = frequency.QuadPart * (LONGLONG)m_budget.maxMillis / 1000;
+	}
+}
+
+bool SelectionScanner::IsOverTime(LONGLONG startTicks) const {
+	if (m_maxTicks == 0) {
+		return false;
+	}
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return now.QuadPart - startTicks > m_maxTicks;
+}
+
+ScanVerdict SelectionScanner::Scan(FolderItems* pItems, MatchedPaths* paths) {
+	m_scanned = 0;
+	m_matched = 0;
+	m_truncated = false;
+	if (pItems == NULL) {
+		return ScanVerdict::NoMatch;
+	}
+
+	long count = 0;
+	if (FAILED(pItems->get_Count(&count)) || count <= 0) {
+		return ScanVerdict::NoMatch;
+	}
+
+	LARGE_INTEGER start;
+	QueryPerformanceCounter(&start);
+
+	// 索引和路径在整个循环中复用，不为每一项分配临时字符串
+	VARIANT varIndex;
+	varIndex.vt = VT_I4;
+	BSTR bstrPath = NULL;
+
+	for (long i = 0; i < count; i++)
+	{
+		if ((m_budget.maxItems > 0 && m_scanned >= m_budget.maxItems) ||
+			(m_scanned > 0 && m_scanned % kTimeCheckInterval == 0 && IsOverTime(start.QuadPart))) {
+			// 预算耗尽：已找到匹配项时仍然给出结论，只是计数不完整
+			m_truncated = true;
+			return m_matched > 0 ? ScanVerdict::Match : ScanVerdict::Inconclusive;
+		}
+		m_scanned++;
+
+		varIndex.lVal = i;
+		FolderItem* pItem = NULL;
+		if (FAILED(pItems->Item(varIndex, &pItem)) || pItem == NULL) continue;
+
+		bool matched = false;
+		if (SUCCEEDED(pItem->get_Path(&bstrPath)) && bstrPath != NULL)
+		{
+			matched = m_matcher.Matches(bstrPath, SysStringLen(bstrPath));
+		}
+
+		// 扩展名匹配后才确认是否为文件夹（例如名为 "a.txt" 的文件夹）
+		if (matched)
+		{
+			VARIANT_BOOL isFolder = VARIANT_FALSE;
+			pItem->get_IsFolder(&isFolder);
+			matched = (isFolder != VARIANT_TRUE);
+		}
+		pItem->Release();
+
+		if (matched) {
+			m_matched++;
+			// 路径直接从 BSTR 转入结果缓冲区
+			if (paths != NULL) {
+				paths->Add(bstrPath, SysStringLen(bstrPath));
+			}
+		}
+		if (bstrPath != NULL) {
+			SysFreeString(bstrPath);
+			bstrPath = NULL;
+		}
+	}
+	return m_matched > 0 ? ScanVerdict::Match : ScanVerdict::NoMatch;
+}
@@ -0,0 +1,29 @@
+﻿#pragma once
+#include <windows.h>
+#include <shldisp.h>
+#include "DesktopBackend.h"
+
+// 统计选中项中匹配的文件数
+// 每项只读取一次 Path 并直接在 BSTR 上匹配规则，只有匹配时才确认是否为文件夹
+class SelectionScanner
+{
+public:
+	SelectionScanner(const MatchRules& matcher, const ScanBudget& budget);
+	// paths 不为空时收集匹配文件的路径，直到达到其上限
+	ScanVerdict Scan(FolderItems* pItems, MatchedPaths* paths = NULL);
+	// 本次实际检查的项数
+	long ScannedCount() const { return m_scanned; }
+	// 已检查的项中匹配的文件数
+	long MatchCount() const { return m_matched; }
+	// 是否因预算耗尽而提前结束，此时 MatchCount 只是下限
+	bool Truncated() const { return m_truncated; }
+private:
+	bool IsOverTime(LONGLONG startTicks) const;
+private:
+	const MatchRules& m_matcher;
+	ScanBudget m_budget;
+	LONGLONG m_maxTicks;
+	long m_scanned;
+	long m_matched;
+	bool m_truncated;
+};
@@ -0,0 +1,29 @@
+﻿#include "ShellAncestry.h"
+#include <cwchar>
+
+struct ShellClassName {
+	const wchar_t* name;
+	size_t length;
+	ShellClass shellClass;
+};
+
+#define SHELL_CLASS_NAME(name, cls) { name, sizeof(name) / sizeof(wchar_t) - 1, cls }
+static const ShellClassName kShellClassNames[] = {
+	SHELL_CLASS_NAME(L"CabinetWClass", ShellClass::Cabinet),
+	SHELL_CLASS_NAME(L"SHELLDLL_DefView", ShellClass::DefView),
+	SHELL_CLASS_NAME(L"Progman", ShellClass::Progman),
+	SHELL_CLASS_NAME(L"WorkerW", ShellClass::WorkerW),
+	SHELL_CLASS_NAME(L"SearchEditBoxWrapperClass", ShellClass::SearchBox),
+	SHELL_CLASS_NAME(L"Address Band Root", ShellClass::AddressBand),
+	SHELL_CLASS_NAME(L"TravelBand", ShellClass::TravelBand),
+};
+#undef SHELL_CLASS_NAME
+
+ShellClass ClassifyShellClassName(const wchar_t* className, size_t length) {
+	for (const ShellClassName& entry : kShellClassNames) {
+		if (entry.length == length && wmemcmp(entry.name, className, length) == 0) {
+			return entry.shellClass;
+		}
+	}
+	return ShellClass::Other;
+}
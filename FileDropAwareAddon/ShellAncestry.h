@@ -0,0 +1,103 @@
+﻿#pragma once
+#include <cstddef>
+#include "DesktopBackend.h"
+
+// 祖先链上关心的窗口类，类名只比较一次，之后按枚举处理
+enum class ShellClass : unsigned char {
+	Other = 0,
+	Cabinet,		// CabinetWClass
+	DefView,		// SHELLDLL_DefView
+	Progman,		// Progman
+	WorkerW,		// WorkerW
+	SearchBox,		// SearchEditBoxWrapperClass
+	AddressBand,	// Address Band Root
+	TravelBand,		// TravelBand
+};
+
+ShellClass ClassifyShellClassName(const wchar_t* className, size_t length);
+
+/**===============================================================================================================================================================
+Windows 资源管理器（Explorer）的窗口层级结构通常如下：
+
+|CabinetWClass(主窗口 / 标题栏)
+|
+|---WorkerW / ReBarWindow32(包含地址栏、工具栏)
+|
+|---ShellTabWindowClass
+|	|
+|	|---SHELLDLL_DefView < --我们的目标区域
+|		|
+|	    |---DirectUIHWND(实际显示文件的控件)
+|
+|---SysTreeView32(左侧导航栏，通常不包含在 DefView 中)
+
+	逻辑流程对比：
+	1. 拖动文件时：鼠标点在 DirectUIHWND 上 -> 向上找父级 -> 遇到 SHELLDLL_DefView -> isContentArea 为 true -> 继续检测选中项 -> 通过。
+
+	2. 拖动窗口时：鼠标点在 CabinetWClass 的标题栏区域 -> 向上找父级 -> 立即遇到 CabinetWClass (没遇到 SHELLDLL_DefView) -> isContentArea 为 false -> 拦截。
+
+	3. 点击左侧导航栏时：鼠标点在 SysTreeView32 -> 向上找父级 -> 遇到 CabinetWClass -> isContentArea 为 false -> 拦截（这也是合理的，因为通常左侧树的选中状态和右侧视图的选中状态是分离的）。
+======================================================================================================================================================================*/
+// 单次遍历父窗口链，同时得出 Shell 父窗口与内容区域判定
+// Windows 需要提供：
+//   ShellClass ClassOf(DesktopWindow window);       窗口类
+//   DesktopWindow ParentOf(DesktopWindow window);   父窗口，顶层窗口返回 0
+template <typename Windows>
+void WalkShellAncestry(Windows& windows, DesktopWindow window, WindowAncestry& ancestry) {
+	ancestry = { 0, false, false };
+	// 内容区域判定以遇到的第一个关键窗口类为准
+	bool contentDecided = false;
+	DesktopWindow current = window;
+
+	while (current != 0)
+	{
+		ShellClass shellClass = windows.ClassOf(current);
+
+		if (!contentDecided)
+		{
+			switch (shellClass)
+			{
+			// 搜索框、地址栏、TravelBand 不是文件显示区域
+			case ShellClass::SearchBox:
+			case ShellClass::AddressBand:
+			case ShellClass::TravelBand:
+				contentDecided = true;
+				break;
+			// 遇到文件视图的窗口类，说明在文件区域内
+			case ShellClass::DefView:
+				ancestry.isContentArea = true;
+				contentDecided = true;
+				break;
+			// 如果还没遇到 DefView 就已经到了顶层资源管理器窗口，说明点击的是标题栏、菜单栏或左侧导航栏
+			case ShellClass::Cabinet:
+				contentDecided = true;
+				break;
+			// 桌面：部分版本桌面不一定有 DefView，或者 DefView 在 Progman/WorkerW 下面
+			case ShellClass::Progman:
+			case ShellClass::WorkerW:
+				ancestry.isContentArea = true;
+				contentDecided = true;
+				break;
+			default:
+				break;
+			}
+		}
+
+		// 检查是否是普通资源管理器
+		if (shellClass == ShellClass::Cabinet)
+		{
+			ancestry.shellWindow = current;
+			return;
+		}
+
+		// 检查是否是桌面
+		if (shellClass == ShellClass::Progman || shellClass == ShellClass::WorkerW)
+		{
+			ancestry.shellWindow = current;
+			ancestry.isDesktop = true;
+			return;
+		}
+
+		current = windows.ParentOf(current);
+	}
+}
@@ -0,0 +1,156 @@
+﻿#include "ShellWindowIndex.h"
+#include <shlobj.h>
+#include <exdispid.h>
+#include <string>
+
+#include "Utils.h"
+#include "Logger.h"
+#include "ComEventSink.h"
+
+
+// 窗口注册或注销时只把索引标记为过期
+static void OnShellWindowsEvent(void* context, DISPID dispId) {
+	if (dispId == DISPID_WINDOWREGISTERED || dispId == DISPID_WINDOWREVOKED) {
+		static_cast<ShellWindowIndex*>(context)->Invalidate();
+	}
+}
+
+ShellWindowIndex::ShellWindowIndex() : m_pSink(NULL), m_adviseCookie(0), m_dirty(true) {}
+
+ShellWindowIndex::~ShellWindowIndex() {
+	Disconnect();
+}
+
+HRESULT ShellWindowIndex::Initialize() {
+	HRESULT hr = Connect();
+	if (FAILED(hr)) {
+		return hr;
+	}
+	return Rebuild();
+}
+
+HRESULT ShellWindowIndex::Connect() {
+	Disconnect();
+	HRESULT hr = m_pShellWindows.CoCreateInstance(CLSID_ShellWindows);
+	if (FAILED(hr)) {
+		LOG_ERROR(L"Failed to create IShellWindows instance: " + HResultToHexString(hr));
+		return hr;
+	}
+
+	m_pSink = new ComEventSink(DIID_DShellWindowsEvents, OnShellWindowsEvent, this);
+	hr = AtlAdvise(m_pShellWindows, m_pSink, DIID_DShellWindowsEvents, &m_adviseCookie);
+	if (FAILED(hr)) {
+		// 没有事件时退化为每次查找都重建索引
+		LOG_ERROR(L"Failed to advise DShellWindowsEvents: " + HResultToHexString(hr));
+		m_adviseCookie = 0;
+	}
+	m_dirty = true;
+	return S_OK;
+}
+
+void ShellWindowIndex::Disconnect() {
+	if (m_pShellWindows != NULL && m_adviseCookie != 0) {
+		AtlUnadvise(m_pShellWindows, DIID_DShellWindowsEvents, m_adviseCookie);
+	}
+	m_adviseCookie = 0;
+	if (m_pSink != NULL) {
+		m_pSink->Detach();
+		m_pSink->Release();
+		m_pSink = NULL;
+	}
+	m_windows.clear();
+	m_pDesktop.Release();
+	m_pShellWindows.Release();
+}
+
+void ShellWindowIndex::Invalidate() {
+	m_dirty = true;
+}
+
+HRESULT ShellWindowIndex::Rebuild() {
+	m_windows.clear();
+	m_pDesktop.Release();
+
+	long winCount = 0;
+	HRESULT hr = m_pShellWindows->get_Count(&winCount);
+	if (FAILED(hr)) {
+		// explorer.exe 重启后旧的 ShellWindows 代理失效，重新连接
+		LOG_INFO(L"ShellWindows is disconnected, reconnecting: " + HResultToHexString(hr));
+		hr = Connect();
+		if (FAILED(hr)) {
+			return hr;
+		}
+		hr = m_pShellWindows->get_Count(&winCount);
+		if (FAILED(hr)) {
+			return hr;
+		}
+	}
+
+	for (long i = 0; i < winCount; i++)
+	{
+		CComVariant index(i);
+		CComPtr<IDispatch> pDisp;
+		hr = m_pShellWindows->Item(index, &pDisp);
+		if (FAILED(hr) || !pDisp) continue;
+
+		CComPtr<IWebBrowser2> pBrowser;
+		hr = pDisp->QueryInterface(IID_IWebBrowser2, (void**)&pBrowser);
+		if (FAILED(hr)) continue;
+
+		SHANDLE_PTR hWindow = 0;
+		if (SUCCEEDED(pBrowser->get_HWND(&hWindow)) && hWindow != 0)
+		{
+			m_windows[(HWND)hWindow] = pDisp;
+		}
+	}
+
+	// 对应 C#: shellWindows.FindWindowSW(..., SWC_DESKTOP, ..., SWFO_NEEDDISPATCH)
+	CComVariant vMissing;
+	vMissing.vt = VT_ERROR;
+	vMissing.scode = DISP_E_PARAMNOTFOUND;
+	long hwndVal = 0;
+	hr = m_pShellWindows->FindWindowSW(&vMissing, &vMissing, SWC_DESKTOP, &hwndVal, SWFO_NEEDDISPATCH, &m_pDesktop);
+	if (FAILED(hr)) {
+		m_pDesktop.Release();
+	}
+
+	// 只有接收到事件时才能信任索引，否则保持过期状态
+	m_dirty = (m_adviseCookie == 0);
+	return S_OK;
+}
+
+bool ShellWindowIndex::Lookup(HWND shellHwnd, CComPtr<IDispatch>& pDisp) {
+	// 初始化失败时在下一次查找时重试
+	if (m_pShellWindows == NULL && FAILED(Connect())) {
+		return false;
+	}
+	bool rebuilt = false;
+	if (m_dirty) {
+		if (FAILED(Rebuild())) return false;
+		rebuilt = true;
+	}
+
+	auto it = m_windows.find(shellHwnd);
+	if (it == m_windows.end() && !rebuilt) {
+		// 事件可能尚未送达（窗口刚打开），重建一次后再查找
+		if (FAILED(Rebuild())) return false;
+		it = m_windows.find(shellHwnd);
+	}
+	if (it == m_windows.end()) {
+		return false;
+	}
+	pDisp = it->second;
+	return true;
+}
+
+bool ShellWindowIndex::LookupDesktop(CComPtr<IDispatch>& pDisp) {
+	// 初始化失败时在下一次查找时重试
+	if (m_pShellWindows == NULL && FAILED(Connect())) {
+		return false;
+	}
+	if (m_dirty || m_pDesktop == NULL) {
+		if (FAILED(Rebuild())) return false;
+	}
+	pDisp = m_pDesktop;
+	return pDisp != NULL;
+}
@@ -0,0 +1,36 @@
+﻿#pragma once
+#include <windows.h>
+#include <exdisp.h>
+#include <atlbase.h>
+#include <unordered_map>
+
+class ComEventSink;
+
+// HWND -> Explorer 窗口 IDispatch 的持久索引
+// 由 DShellWindowsEvents 的 WindowRegistered/WindowRevoked 事件维护，查找为 O(1)
+// 事件通过 COM 消息投递，所属 STA 线程必须持续分发消息
+class ShellWindowIndex
+{
+public:
+	ShellWindowIndex();
+	~ShellWindowIndex();
+	HRESULT Initialize();
+	// 查找 Explorer 窗口对应的 IDispatch，未找到返回 false
+	bool Lookup(HWND shellHwnd, CComPtr<IDispatch>& pDisp);
+	// 获取缓存的桌面 IDispatch
+	// explorer.exe 重启后缓存的代理失效且没有事件通知，调用方遇到断开错误时应 Invalidate 后重新查找
+	bool LookupDesktop(CComPtr<IDispatch>& pDisp);
+	// 窗口注册或注销、或缓存的代理已断开时调用，下一次查找时重建索引
+	void Invalidate();
+private:
+	HRESULT Connect();
+	void Disconnect();
+	HRESULT Rebuild();
+private:
+	CComPtr<IShellWindows> m_pShellWindows;
+	ComEventSink* m_pSink;
+	DWORD m_adviseCookie;
+	bool m_dirty;
+	std::unordered_map<HWND, CComPtr<IDispatch>> m_windows;
+	CComPtr<IDispatch> m_pDesktop;
+};
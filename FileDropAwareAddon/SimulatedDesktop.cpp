@@ -0,0 +1,256 @@
+﻿#include "SimulatedDesktop.h"
+#include "MatchRules.h"
+#include <chrono>
+
+// 与 SelectionScanner 一致：每扫描这么多项检查一次耗时
+static const long kTimeCheckInterval = 16;
+
+typedef std::chrono::steady_clock SimulatedClock;
+
+// 模拟桌面的文件视图，只记录所属的 Shell 窗口
+class SimulatedView : public DesktopView
+{
+public:
+	explicit SimulatedView(DesktopWindow window) : shellWindow(window) {}
+	DesktopWindow shellWindow;
+};
+
+SimulatedDesktop::SimulatedDesktop() : m_desktop(0) {
+	for (size_t i = 0; i < (size_t)SimulatedCall::Count; i++) {
+		m_latencies[i] = 0;
+		m_callCounts[i] = 0;
+	}
+}
+
+DesktopWindow SimulatedDesktop::AddWindow(DesktopWindow parent, const std::wstring& className, const SimulatedRect& rect) {
+	m_windows.push_back({ parent, className, rect, {}, {} });
+	DesktopWindow window = (DesktopWindow)m_windows.size();
+	Window* pParent = LookupWindow(parent);
+	if (pParent != nullptr) {
+		pParent->children.push_back(window);
+	}
+	else {
+		m_topLevel.push_back(window);
+	}
+	return window;
+}
+
+void SimulatedDesktop::AddFileItem(DesktopWindow window, const SimulatedRect& rect) {
+	Window* pWindow = LookupWindow(window);
+	if (pWindow != nullptr) {
+		pWindow->fileItems.push_back(rect);
+	}
+}
+
+void SimulatedDesktop::RegisterShellWindow(DesktopWindow shellWindow, bool isDesktop) {
+	Shell& shell = m_shells[shellWindow];
+	shell.isDesktop = isDesktop;
+	shell.generation = 0;
+	shell.cached = false;
+	if (isDesktop) {
+		m_desktop = shellWindow;
+	}
+}
+
+void SimulatedDesktop::SetSelection(DesktopWindow shellWindow, const std::vector<SimulatedItem>& items) {
+	Shell* shell = LookupShell(shellWindow);
+	if (shell == nullptr) {
+		return;
+	}
+	shell->selection = items;
+	shell->generation++;
+}
+
+DesktopWindow SimulatedDesktop::AddExplorerWindow(const SimulatedRect& rect, DesktopWindow* contentWindow) {
+	DesktopWindow cabinet = AddWindow(0, L"CabinetWClass", rect);
+	// 工具栏与地址栏占据顶部 48 像素，左侧 200 像素为导航栏
+	int32_t toolbarBottom = rect.top + 48;
+	int32_t navigationRight = rect.left + 200;
+	DesktopWindow rebar = AddWindow(cabinet, L"ReBarWindow32", { rect.left, rect.top, rect.right, toolbarBottom });
+	AddWindow(rebar, L"Address Band Root", { rect.left + 100, rect.top + 8, rect.right - 200, toolbarBottom - 8 });
+	AddWindow(cabinet, L"SysTreeView32", { rect.left, toolbarBottom, navigationRight, rect.bottom });
+	SimulatedRect viewRect = { navigationRight, toolbarBottom, rect.right, rect.bottom };
+	DesktopWindow tab = AddWindow(cabinet, L"ShellTabWindowClass", viewRect);
+	DesktopWindow defView = AddWindow(tab, L"SHELLDLL_DefView", viewRect);
+	DesktopWindow content = AddWindow(defView, L"DirectUIHWND", viewRect);
+	RegisterShellWindow(cabinet, false);
+	if (contentWindow != nullptr) {
+		*contentWindow = content;
+	}
+	return cabinet;
+}
+
+DesktopWindow SimulatedDesktop::AddDesktop(const SimulatedRect& rect, DesktopWindow* contentWindow) {
+	DesktopWindow progman = AddWindow(0, L"Progman", rect);
+	DesktopWindow defView = AddWindow(progman, L"SHELLDLL_DefView", rect);
+	DesktopWindow content = AddWindow(defView, L"SysListView32", rect);
+	RegisterShellWindow(progman, true);
+	// 桌面位于所有窗口之下
+	m_topLevel.pop_back();
+	m_topLevel.insert(m_topLevel.begin(), progman);
+	if (contentWindow != nullptr) {
+		*contentWindow = content;
+	}
+	return progman;
+}
+
+void SimulatedDesktop::SetLatency(SimulatedCall call, uint32_t micros) {
+	m_latencies[(size_t)call] = micros;
+}
+
+uint64_t SimulatedDesktop::CallCount(SimulatedCall call) const {
+	return m_callCounts[(size_t)call];
+}
+
+void SimulatedDesktop::ResetCallCounts() {
+	for (size_t i = 0; i < (size_t)SimulatedCall::Count; i++) {
+		m_callCounts[i] = 0;
+	}
+}
+
+bool SimulatedDesktop::Contains(const SimulatedRect& rect, const DesktopPoint& pt) {
+	return pt.x >= rect.left && pt.x < rect.right && pt.y >= rect.top && pt.y < rect.bottom;
+}
+
+void SimulatedDesktop::Call(SimulatedCall call) {
+	m_callCounts[(size_t)call]++;
+	uint32_t micros = m_latencies[(size_t)call];
+	if (micros == 0) {
+		return;
+	}
+	SimulatedClock::time_point deadline = SimulatedClock::now() + std::chrono::microseconds(micros);
+	while (SimulatedClock::now() < deadline) {
+	}
+}
+
+SimulatedDesktop::Window* SimulatedDesktop::LookupWindow(DesktopWindow window) {
+	if (window == 0 || window > m_windows.size()) {
+		return nullptr;
+	}
+	return &m_windows[window - 1];
+}
+
+SimulatedDesktop::Shell* SimulatedDesktop::LookupShell(DesktopWindow shellWindow) {
+	auto it = m_shells.find(shellWindow);
+	return it != m_shells.end() ? &it->second : nullptr;
+}
+
+DesktopWindow SimulatedDesktop::HitTestChildren(const std::vector<DesktopWindow>& windows, const DesktopPoint& pt) {
+	// 从最上层的窗口开始，返回包含该点的最深层子窗口
+	for (auto it = windows.rbegin(); it != windows.rend(); ++it) {
+		Window* pWindow = LookupWindow(*it);
+		if (pWindow == nullptr || !Contains(pWindow->rect, pt)) {
+			continue;
+		}
+		DesktopWindow child = HitTestChildren(pWindow->children, pt);
+		return child != 0 ? child : *it;
+	}
+	return 0;
+}
+
+ShellClass SimulatedDesktop::ClassOf(DesktopWindow window) {
+	Call(SimulatedCall::ClassName);
+	Window* pWindow = LookupWindow(window);
+	if (pWindow == nullptr) {
+		return ShellClass::Other;
+	}
+	return ClassifyShellClassName(pWindow->className.c_str(), pWindow->className.size());
+}
+
+DesktopWindow SimulatedDesktop::ParentOf(DesktopWindow window) {
+	Call(SimulatedCall::Parent);
+	Window* pWindow = LookupWindow(window);
+	return pWindow != nullptr ? pWindow->parent : 0;
+}
+
+DesktopWindow SimulatedDesktop::WindowFromPoint(const DesktopPoint& pt) {
+	Call(SimulatedCall::WindowFromPoint);
+	return HitTestChildren(m_topLevel, pt);
+}
+
+void SimulatedDesktop::Classify(DesktopWindow window, WindowAncestry& ancestry) {
+	WalkShellAncestry(*this, window, ancestry);
+}
+
+bool SimulatedDesktop::IsOverFileItem(const DesktopPoint& pt) {
+	Call(SimulatedCall::HitTest);
+	Window* pWindow = LookupWindow(HitTestChildren(m_topLevel, pt));
+	if (pWindow == nullptr) {
+		return false;
+	}
+	for (const SimulatedRect& item : pWindow->fileItems) {
+		if (Contains(item, pt)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+std::shared_ptr<DesktopView> SimulatedDesktop::FindView(DesktopWindow shellWindow, bool isDesktop) {
+	Call(SimulatedCall::FindView);
+	// 与真实后端一致，桌面不按窗口查找，直接使用注册的桌面
+	DesktopWindow window = isDesktop ? m_desktop : shellWindow;
+	Shell* shell = LookupShell(window);
+	if (shell == nullptr || shell->isDesktop != isDesktop) {
+		return nullptr;
+	}
+	return std::make_shared<SimulatedView>(window);
+}
+
+bool SimulatedDesktop::LookupSelection(DesktopView& view, unsigned int rulesVersion, SelectionMatch& match) {
+	Shell* shell = LookupShell(static_cast<SimulatedView&>(view).shellWindow);
+	if (shell == nullptr || !shell->cached || shell->cachedGeneration != shell->generation
+		|| shell->cachedRulesVersion != rulesVersion) {
+		return false;
+	}
+	match = shell->cachedMatch;
+	return true;
+}
+
+void SimulatedDesktop::StoreSelection(DesktopView& view, unsigned int rulesVersion, const SelectionMatch& match) {
+	Shell* shell = LookupShell(static_cast<SimulatedView&>(view).shellWindow);
+	if (shell == nullptr) {
+		return;
+	}
+	shell->cached = true;
+	shell->cachedGeneration = shell->generation;
+	shell->cachedRulesVersion = rulesVersion;
+	shell->cachedMatch = match;
+}
+
+ScanVerdict SimulatedDesktop::ScanSelection(DesktopView& view, const MatchRules& matcher, const ScanBudget& budget,
+	MatchedPaths* paths, SelectionScanSummary& summary) {
+	summary = { 0, 0, false };
+	Shell* shell = LookupShell(static_cast<SimulatedView&>(view).shellWindow);
+	if (shell == nullptr) {
+		return ScanVerdict::NoMatch;
+	}
+
+	// 预算规则与 SelectionScanner 相同
+	SimulatedClock::time_point start = SimulatedClock::now();
+	for (const SimulatedItem& item : shell->selection)
+	{
+		if ((budget.maxItems > 0 && summary.scanned >= budget.maxItems) ||
+			(budget.maxMillis > 0 && summary.scanned > 0 && summary.scanned % kTimeCheckInterval == 0 &&
+				SimulatedClock::now() - start > std::chrono::milliseconds(budget.maxMillis))) {
+			summary.truncated = true;
+			return summary.matched > 0 ? ScanVerdict::Match : ScanVerdict::Inconclusive;
+		}
+		summary.scanned++;
+
+		Call(SimulatedCall::ItemPath);
+		bool matched = matcher.Matches(item.path);
+		if (matched)
+		{
+			Call(SimulatedCall::ItemIsFolder);
+			matched = !item.isFolder;
+		}
+		if (matched) {
+			summary.matched++;
+			if (paths != nullptr) {
+				paths->Add(item.path.c_str(), item.path.size());
+			}
+		}
+	}
+	return summary.matched > 0 ? ScanVerdict::Match : ScanVerdict::NoMatch;
+}
@@ -0,0 +1,117 @@
+﻿#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "DesktopBackend.h"
+#include "ShellAncestry.h"
+#include "MatchedPaths.h"
+
+// 模拟的桌面调用，用于注入延迟和统计调用次数；与真实后端中的跨进程调用一一对应
+enum class SimulatedCall {
+	// WindowFromPoint
+	WindowFromPoint,
+	// 祖先链上每个窗口的 GetClassNameW
+	ClassName,
+	// 祖先链上每次 GetParent
+	Parent,
+	// UIA 命中测试
+	HitTest,
+	// Shell 窗口索引查找
+	FindView,
+	// 选中项扫描中每一项的 get_Path
+	ItemPath,
+	// 扩展名匹配后的 get_IsFolder
+	ItemIsFolder,
+	Count,
+};
+
+struct SimulatedRect {
+	int32_t left;
+	int32_t top;
+	int32_t right;
+	int32_t bottom;
+};
+
+struct SimulatedItem {
+	std::wstring path;
+	bool isFolder;
+};
+
+// 可配置的模拟桌面：窗口树、Explorer 窗口与桌面、选中项和每类调用的延迟
+// 检测流程（FileDetector）与真实桌面走同一套逻辑，窗口分类同样使用 WalkShellAncestry，
+// 可以在任何平台上端到端地运行并测量检测延迟
+// 延迟通过忙等注入，结果不受调度器睡眠精度影响；配置与检测必须在同一线程，或由调用方同步
+class SimulatedDesktop : public IDesktopBackend
+{
+public:
+	SimulatedDesktop();
+
+	// 添加窗口，parent 为 0 表示顶层窗口；后添加的窗口位于同级窗口之上，子窗口总在父窗口之上
+	DesktopWindow AddWindow(DesktopWindow parent, const std::wstring& className, const SimulatedRect& rect);
+	// 在窗口中放置一个文件项，UIA 命中测试落在其中时视为位于文件项上
+	void AddFileItem(DesktopWindow window, const SimulatedRect& rect);
+	// 注册 Explorer 窗口 (CabinetWClass) 或桌面 (Progman / WorkerW)，之后才能找到其文件视图
+	void RegisterShellWindow(DesktopWindow shellWindow, bool isDesktop);
+	// 替换选中项，同时使该窗口缓存的选中项结果失效（相当于 SelectionChanged 事件）
+	void SetSelection(DesktopWindow shellWindow, const std::vector<SimulatedItem>& items);
+
+	// 构建典型的 Explorer 窗口：CabinetWClass > ShellTabWindowClass > SHELLDLL_DefView > DirectUIHWND，
+	// 并在标题栏下方放置地址栏；返回 CabinetWClass，contentWindow 返回 DirectUIHWND
+	DesktopWindow AddExplorerWindow(const SimulatedRect& rect, DesktopWindow* contentWindow = nullptr);
+	// 构建桌面：Progman > SHELLDLL_DefView > SysListView32，返回 Progman
+	DesktopWindow AddDesktop(const SimulatedRect& rect, DesktopWindow* contentWindow = nullptr);
+
+	void SetLatency(SimulatedCall call, uint32_t micros);
+	uint64_t CallCount(SimulatedCall call) const;
+	void ResetCallCounts();
+
+	DesktopWindow WindowFromPoint(const DesktopPoint& pt) override;
+	void Classify(DesktopWindow window, WindowAncestry& ancestry) override;
+	bool IsOverFileItem(const DesktopPoint& pt) override;
+	std::shared_ptr<DesktopView> FindView(DesktopWindow shellWindow, bool isDesktop) override;
+	bool LookupSelection(DesktopView& view, unsigned int rulesVersion, SelectionMatch& match) override;
+	void StoreSelection(DesktopView& view, unsigned int rulesVersion, const SelectionMatch& match) override;
+	ScanVerdict ScanSelection(DesktopView& view, const MatchRules& matcher, const ScanBudget& budget,
+		MatchedPaths* paths, SelectionScanSummary& summary) override;
+
+	// WalkShellAncestry 的窗口访问接口
+	ShellClass ClassOf(DesktopWindow window);
+	DesktopWindow ParentOf(DesktopWindow window);
+
+private:
+	struct Window {
+		DesktopWindow parent;
+		std::wstring className;
+		SimulatedRect rect;
+		std::vector<DesktopWindow> children;
+		std::vector<SimulatedRect> fileItems;
+	};
+	struct Shell {
+		bool isDesktop;
+		std::vector<SimulatedItem> selection;
+		// 每次替换选中项递增
+		uint64_t generation;
+		// 选中项缓存
+		bool cached;
+		uint64_t cachedGeneration;
+		unsigned int cachedRulesVersion;
+		SelectionMatch cachedMatch;
+	};
+
+	static bool Contains(const SimulatedRect& rect, const DesktopPoint& pt);
+	// 记录一次调用并忙等注入的延迟
+	void Call(SimulatedCall call);
+	Window* LookupWindow(DesktopWindow window);
+	Shell* LookupShell(DesktopWindow shellWindow);
+	DesktopWindow HitTestChildren(const std::vector<DesktopWindow>& windows, const DesktopPoint& pt);
+
+private:
+	// 句柄即下标加一
+	std::vector<Window> m_windows;
+	std::vector<DesktopWindow> m_topLevel;
+	std::unordered_map<DesktopWindow, Shell> m_shells;
+	DesktopWindow m_desktop;
+	uint32_t m_latencies[(size_t)SimulatedCall::Count];
+	uint64_t m_callCounts[(size_t)SimulatedCall::Count];
+};
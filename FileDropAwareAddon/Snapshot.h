@@ -0,0 +1,61 @@
+﻿#pragma once
+#include <atomic>
+#include <memory>
+
+// 不可变快照的发布点（RCU 风格）：写入方构建好新快照后整体替换，已取得旧快照的读取方继续使用旧快照，
+// 旧快照在最后一个持有者放手时释放
+// 读取方通过 SnapshotReader 访问：版本未变化时只读一个原子计数，不加锁、不修改引用计数
+template <typename T>
+class SnapshotCell
+{
+public:
+	SnapshotCell() : m_value(std::make_shared<const T>()), m_version(0) {}
+	SnapshotCell(const SnapshotCell&) = delete;
+	SnapshotCell& operator=(const SnapshotCell&) = delete;
+
+	// 可在任意线程调用，多个写入方之间以最后一次为准
+	void Publish(std::shared_ptr<const T> value) {
+		std::atomic_store_explicit(&m_value, std::move(value), std::memory_order_release);
+		// 先替换快照再递增版本，读取方看到新版本时一定能取到新快照
+		m_version.fetch_add(1, std::memory_order_acq_rel);
+	}
+
+	std::shared_ptr<const T> Load() const {
+		return std::atomic_load_explicit(&m_value, std::memory_order_acquire);
+	}
+
+	unsigned int Version() const {
+		return m_version.load(std::memory_order_acquire);
+	}
+
+private:
+	std::shared_ptr<const T> m_value;
+	std::atomic<unsigned int> m_version;
+};
+
+// 每个读取线程一个，缓存当前快照，只在版本变化后才重新加载
+// Get 返回的引用在同一线程下一次调用 Get 之前有效
+template <typename T>
+class SnapshotReader
+{
+public:
+	SnapshotReader() : m_version(0) {}
+
+	const T& Get(const SnapshotCell<T>& cell) {
+		unsigned int version = cell.Version();
+		if (!m_snapshot || version != m_version) {
+			m_snapshot = cell.Load();
+			m_version = version;
+		}
+		return *m_snapshot;
+	}
+
+	// 放开持有的快照，例如线程空闲时让旧快照尽早释放
+	void Reset() {
+		m_snapshot.reset();
+	}
+
+private:
+	std::shared_ptr<const T> m_snapshot;
+	unsigned int m_version;
+};
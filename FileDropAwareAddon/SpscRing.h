@@ -0,0 +1,51 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// 单生产者/单消费者无锁环形队列
+// 生产者：钩子线程；消费者：JS 线程 (线程安全函数的回调)
+// Capacity 必须是 2 的幂，实际可用容量为 Capacity - 1
+template <typename T, size_t Capacity>
+class SpscRing
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+public:
+	SpscRing() : m_head(0), m_tail(0) {}
+	SpscRing(const SpscRing&) = delete;
+	SpscRing& operator=(const SpscRing&) = delete;
+
+	// 仅允许生产者线程调用，队列满时返回 false
+	bool Push(const T& item) {
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		const size_t next = (tail + 1) & (Capacity - 1);
+		if (next == m_head.load(std::memory_order_acquire)) {
+			return false;
+		}
+		m_items[tail] = item;
+		m_tail.store(next, std::memory_order_release);
+		return true;
+	}
+
+	// 仅允许消费者线程调用，队列空时返回 false
+	bool Pop(T& item) {
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+		// 移出元素，不在槽位中保留对资源的引用
+		item = std::move(m_items[head]);
+		m_head.store((head + 1) & (Capacity - 1), std::memory_order_release);
+		return true;
+	}
+
+	bool Empty() const {
+		return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+	}
+
+private:
+	// head/tail 分别位于不同缓存行，避免生产者与消费者之间的伪共享
+	alignas(64) std::atomic<size_t> m_head;
+	alignas(64) std::atomic<size_t> m_tail;
+	alignas(64) T m_items[Capacity];
+};
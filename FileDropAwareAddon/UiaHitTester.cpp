@@ -0,0 +1,59 @@
+﻿#include "UiaHitTester.h"
+
+HRESULT UiaHitTester::Initialize() {
+	// CLSID_CUIAutomation 对应 IUIAutomation 接口的自动化对象
+	HRESULT hr = m_pAutomation.CoCreateInstance(CLSID_CUIAutomation, NULL, CLSCTX_INPROC_SERVER);
+	if (FAILED(hr)) {
+		return hr;
+	}
+
+	// RawViewWalker 包含所有元素，包括容器
+	hr = m_pAutomation->get_RawViewWalker(&m_pWalker);
+	if (FAILED(hr)) {
+		return hr;
+	}
+
+	// 只缓存 ControlType，命中元素时一并取回，避免额外的跨进程读取
+	hr = m_pAutomation->CreateCacheRequest(&m_pCacheRequest);
+	if (FAILED(hr)) {
+		return hr;
+	}
+	return m_pCacheRequest->AddProperty(UIA_ControlTypePropertyId);
+}
+
+HRESULT UiaHitTester::HitTest(const POINT& mousePos, UiaHitResult& result) {
+	result = { 0, false, 0 };
+	if (m_pAutomation == NULL) {
+		return E_POINTER;
+	}
+
+	// 1. 获取鼠标坐标下的 UIA 元素，ControlType 随同一次调用返回
+	CComPtr<IUIAutomationElement> pElement;
+	HRESULT hr = m_pAutomation->ElementFromPointBuildCache(mousePos, m_pCacheRequest, &pElement);
+	if (FAILED(hr)) {
+		return hr;
+	}
+	if (pElement == NULL) {
+		return E_FAIL;
+	}
+	hr = pElement->get_CachedControlType(&result.controlType);
+	if (FAILED(hr) || result.controlType == UIA_ListItemControlTypeId) {
+		return hr;
+	}
+
+	// 2. 缓存请求不支持 TreeScope_Parent，父元素通过 TreeWalker 获取，同样带回缓存的 ControlType
+	CComPtr<IUIAutomationElement> pParentElement;
+	hr = m_pWalker->GetParentElementBuildCache(pElement, m_pCacheRequest, &pParentElement);
+	if (FAILED(hr)) {
+		return hr;
+	}
+	if (hr == S_FALSE || pParentElement == NULL) {
+		// 已经到达树的根部 (通常是桌面)，没有父元素
+		return E_FAIL;
+	}
+	hr = pParentElement->get_CachedControlType(&result.parentControlType);
+	if (SUCCEEDED(hr)) {
+		result.hasParent = true;
+	}
+	return hr;
+}
@@ -0,0 +1,33 @@
+﻿#pragma once
+#include <windows.h>
+#include <UIAutomation.h>
+#include <atlbase.h>
+
+// 鼠标位置命中的 UIA 元素信息
+struct UiaHitResult {
+	CONTROLTYPEID controlType;
+	// 元素本身已是 ListItem 时不再获取父元素，此时 hasParent 为 false
+	bool hasParent;
+	CONTROLTYPEID parentControlType;
+};
+
+// UIA 命中测试接口，便于替换实现（例如统计调用次数的模拟实现）
+class IUiaHitTester
+{
+public:
+	virtual ~IUiaHitTester() {}
+	virtual HRESULT HitTest(const POINT& mousePos, UiaHitResult& result) = 0;
+};
+
+// 缓存 IUIAutomation / TreeWalker / CacheRequest 的实现，每个检测线程创建一次
+// 必须在创建它的 COM 线程上使用
+class UiaHitTester : public IUiaHitTester
+{
+public:
+	HRESULT Initialize();
+	HRESULT HitTest(const POINT& mousePos, UiaHitResult& result) override;
+private:
+	CComPtr<IUIAutomation> m_pAutomation;
+	CComPtr<IUIAutomationTreeWalker> m_pWalker;
+	CComPtr<IUIAutomationCacheRequest> m_pCacheRequest;
+};
@@ -0,0 +1,331 @@
+﻿#include "Utf.h"
+#include <cstring>
+
+// x64 与启用 /arch:SSE2（MSVC 的默认值）的 x86 都可以直接使用 SSE2，无需运行时检测
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define UTF_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// 每次整块检查的单元数
+static const size_t kBlockUnits = 16;
+
+// 从输入开头连续转换整块的 ASCII 字符，遇到含非 ASCII 字符的块或剩余不足一块时停止，返回转换的单元数
+// UTF-16/UTF-32 → UTF-8
+template <typename Unit>
+static inline size_t NarrowAscii(const Unit* input, size_t length, char* output, size_t capacity) {
+	size_t limit = length < capacity ? length : capacity;
+	size_t i = 0;
+#ifdef UTF_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	if (sizeof(Unit) == 2) {
+		const __m128i high = _mm_set1_epi16((short)0xFF80);
+		for (; i + kBlockUnits <= limit; i += kBlockUnits) {
+			__m128i a = _mm_loadu_si128((const __m128i*)(input + i));
+			__m128i b = _mm_loadu_si128((const __m128i*)(input + i + 8));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(_mm_or_si128(a, b), high), zero)) != 0xFFFF) {
+				break;
+			}
+			_mm_storeu_si128((__m128i*)(output + i), _mm_packus_epi16(a, b));
+		}
+	}
+	else {
+		const __m128i high = _mm_set1_epi32((int)0xFFFFFF80);
+		for (; i + kBlockUnits <= limit; i += kBlockUnits) {
+			__m128i a = _mm_loadu_si128((const __m128i*)(input + i));
+			__m128i b = _mm_loadu_si128((const __m128i*)(input + i + 4));
+			__m128i c = _mm_loadu_si128((const __m128i*)(input + i + 8));
+			__m128i d = _mm_loadu_si128((const __m128i*)(input + i + 12));
+			__m128i any = _mm_and_si128(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)), high);
+			if (_mm_movemask_epi8(_mm_cmpeq_epi32(any, zero)) != 0xFFFF) {
+				break;
+			}
+			// 所有值都小于 0x80，有符号饱和不会改变结果
+			_mm_storeu_si128((__m128i*)(output + i), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+		}
+	}
+#else
+	while (i < limit && (uint32_t)input[i] < 0x80) {
+		output[i] = (char)input[i];
+		i++;
+	}
+#endif
+	return i;
+}
+
+// UTF-8 → UTF-16/UTF-32
+template <typename Unit>
+static inline size_t WidenAscii(const uint8_t* input, size_t length, Unit* output, size_t capacity) {
+	size_t limit = length < capacity ? length : capacity;
+	size_t i = 0;
+#ifdef UTF_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + kBlockUnits <= limit; i += kBlockUnits) {
+		__m128i bytes = _mm_loadu_si128((const __m128i*)(input + i));
+		if (_mm_movemask_epi8(bytes) != 0) {
+			break;
+		}
+		__m128i low = _mm_unpacklo_epi8(bytes, zero);
+		__m128i high = _mm_unpackhi_epi8(bytes, zero);
+		if (sizeof(Unit) == 2) {
+			_mm_storeu_si128((__m128i*)(output + i), low);
+			_mm_storeu_si128((__m128i*)(output + i + 8), high);
+		}
+		else {
+			_mm_storeu_si128((__m128i*)(output + i), _mm_unpacklo_epi16(low, zero));
+			_mm_storeu_si128((__m128i*)(output + i + 4), _mm_unpackhi_epi16(low, zero));
+			_mm_storeu_si128((__m128i*)(output + i + 8), _mm_unpacklo_epi16(high, zero));
+			_mm_storeu_si128((__m128i*)(output + i + 12), _mm_unpackhi_epi16(high, zero));
+		}
+	}
+#else
+	while (i < limit && input[i] < 0x80) {
+		output[i] = (Unit)input[i];
+		i++;
+	}
+#endif
+	return i;
+}
+
+// 解码一个 UTF-8 序列（按 Unicode 表 3-7 校验），返回其长度
+// 非法时返回 0，invalid 为应整体替换为一个 U+FFFD 的最长非法前缀的长度
+static inline size_t DecodeSequence(const uint8_t* input, size_t length, uint32_t& code, size_t& invalid) {
+	uint8_t lead = input[0];
+	if (lead < 0x80) {
+		code = lead;
+		return 1;
+	}
+	size_t trailing;
+	uint8_t low = 0x80;
+	uint8_t high = 0xBF;
+	if (lead >= 0xC2 && lead <= 0xDF) {
+		trailing = 1;
+		code = lead & 0x1F;
+	}
+	else if (lead >= 0xE0 && lead <= 0xEF) {
+		trailing = 2;
+		code = lead & 0x0F;
+		// 排除过长编码与代理区
+		if (lead == 0xE0) low = 0xA0;
+		if (lead == 0xED) high = 0x9F;
+	}
+	else if (lead >= 0xF0 && lead <= 0xF4) {
+		trailing = 3;
+		code = lead & 0x07;
+		// 排除过长编码与超出 U+10FFFF 的码点
+		if (lead == 0xF0) low = 0x90;
+		if (lead == 0xF4) high = 0x8F;
+	}
+	else {
+		invalid = 1;
+		return 0;
+	}
+	for (size_t k = 1; k <= trailing; k++) {
+		if (k >= length || input[k] < low || input[k] > high) {
+			invalid = k;
+			return 0;
+		}
+		code = (code << 6) | (input[k] & 0x3F);
+		low = 0x80;
+		high = 0xBF;
+	}
+	return trailing + 1;
+}
+
+// Unit 为 2 字节时按 UTF-16 处理，为 4 字节时按 UTF-32 处理
+template <typename Unit>
+static TranscodeResult EncodeUtf8(const Unit* input, size_t length, char* output, size_t capacity) {
+	size_t i = 0;
+	size_t o = 0;
+	while (i < length) {
+		size_t ascii = NarrowAscii(input + i, length - i, output + o, capacity - o);
+		i += ascii;
+		o += ascii;
+		// 逐个转换含非 ASCII 字符的这一块（代理对可能跨过块的末尾），之后回到整块处理
+		size_t end = length - i < kBlockUnits ? length : i + kBlockUnits;
+		while (i < end) {
+			uint32_t code = (uint32_t)input[i];
+			size_t units = 1;
+			if (code < 0x80) {
+				if (o == capacity) {
+					return { i, o, false };
+				}
+				output[o++] = (char)code;
+				i++;
+				continue;
+			}
+			if (code >= 0xD800 && code <= 0xDFFF) {
+				if (sizeof(Unit) != 2 || code > 0xDBFF || i + 1 >= length
+					|| (uint32_t)input[i + 1] < 0xDC00 || (uint32_t)input[i + 1] > 0xDFFF) {
+					return { i, o, true };
+				}
+				code = 0x10000 + ((code - 0xD800) << 10) + ((uint32_t)input[i + 1] - 0xDC00);
+				units = 2;
+			}
+			else if (code > 0x10FFFF) {
+				return { i, o, true };
+			}
+
+			if (code < 0x800) {
+				if (capacity - o < 2) {
+					return { i, o, false };
+				}
+				output[o] = (char)(0xC0 | (code >> 6));
+				output[o + 1] = (char)(0x80 | (code & 0x3F));
+				o += 2;
+			}
+			else if (code < 0x10000) {
+				if (capacity - o < 3) {
+					return { i, o, false };
+				}
+				output[o] = (char)(0xE0 | (code >> 12));
+				output[o + 1] = (char)(0x80 | ((code >> 6) & 0x3F));
+				output[o + 2] = (char)(0x80 | (code & 0x3F));
+				o += 3;
+			}
+			else {
+				if (capacity - o < 4) {
+					return { i, o, false };
+				}
+				output[o] = (char)(0xF0 | (code >> 18));
+				output[o + 1] = (char)(0x80 | ((code >> 12) & 0x3F));
+				output[o + 2] = (char)(0x80 | ((code >> 6) & 0x3F));
+				output[o + 3] = (char)(0x80 | (code & 0x3F));
+				o += 4;
+			}
+			i += units;
+		}
+	}
+	return { i, o, false };
+}
+
+template <typename Unit>
+static TranscodeResult DecodeUtf8(const char* text, size_t length, Unit* output, size_t capacity) {
+	const uint8_t* input = (const uint8_t*)text;
+	size_t i = 0;
+	size_t o = 0;
+	while (i < length) {
+		size_t ascii = WidenAscii(input + i, length - i, output + o, capacity - o);
+		i += ascii;
+		o += ascii;
+		size_t end = length - i < kBlockUnits ? length : i + kBlockUnits;
+		while (i < end) {
+			// 两字节与常见的三字节字符（汉字等）直接解码，E0/ED 开头及四字节的序列交给 DecodeSequence 校验
+			uint8_t lead = input[i];
+			if (lead >= 0xE1 && lead <= 0xEF && lead != 0xED && length - i >= 3
+				&& (input[i + 1] & 0xC0) == 0x80 && (input[i + 2] & 0xC0) == 0x80) {
+				if (o == capacity) {
+					return { i, o, false };
+				}
+				output[o++] = (Unit)(((lead & 0x0F) << 12) | ((input[i + 1] & 0x3F) << 6) | (input[i + 2] & 0x3F));
+				i += 3;
+				continue;
+			}
+			if (lead >= 0xC2 && lead <= 0xDF && length - i >= 2 && (input[i + 1] & 0xC0) == 0x80) {
+				if (o == capacity) {
+					return { i, o, false };
+				}
+				output[o++] = (Unit)(((lead & 0x1F) << 6) | (input[i + 1] & 0x3F));
+				i += 2;
+				continue;
+			}
+			uint32_t code;
+			size_t invalid;
+			size_t read = DecodeSequence(input + i, length - i, code, invalid);
+			if (read == 0) {
+				return { i, o, true };
+			}
+			if (sizeof(Unit) == 2 && code >= 0x10000) {
+				if (capacity - o < 2) {
+					return { i, o, false };
+				}
+				output[o] = (Unit)(0xD800 + ((code - 0x10000) >> 10));
+				output[o + 1] = (Unit)(0xDC00 + ((code - 0x10000) & 0x3FF));
+				o += 2;
+			}
+			else {
+				if (o == capacity) {
+					return { i, o, false };
+				}
+				output[o++] = (Unit)code;
+			}
+			i += read;
+		}
+	}
+	return { i, o, false };
+}
+
+TranscodeResult Utf16ToUtf8(const char16_t* input, size_t length, char* output, size_t capacity) {
+	return EncodeUtf8(input, length, output, capacity);
+}
+
+TranscodeResult Utf8ToUtf16(const char* input, size_t length, char16_t* output, size_t capacity) {
+	return DecodeUtf8(input, length, output, capacity);
+}
+
+TranscodeResult Utf32ToUtf8(const char32_t* input, size_t length, char* output, size_t capacity) {
+	return EncodeUtf8(input, length, output, capacity);
+}
+
+TranscodeResult Utf8ToUtf32(const char* input, size_t length, char32_t* output, size_t capacity) {
+	return DecodeUtf8(input, length, output, capacity);
+}
+
+// 直接以 wchar_t 实例化，不把 wchar_t 指针转换为 char16_t/char32_t 指针
+TranscodeResult WideToUtf8(const wchar_t* input, size_t length, char* output, size_t capacity) {
+	return EncodeUtf8(input, length, output, capacity);
+}
+
+TranscodeResult Utf8ToWide(const char* input, size_t length, wchar_t* output, size_t capacity) {
+	return DecodeUtf8(input, length, output, capacity);
+}
+
+size_t WideToUtf8Lossy(const wchar_t* input, size_t length, char* output, size_t capacity) {
+	size_t written = 0;
+	for (;;) {
+		TranscodeResult result = WideToUtf8(input, length, output + written, capacity - written);
+		written += result.written;
+		input += result.read;
+		length -= result.read;
+		if (!result.invalid || capacity - written < 3) {
+			return written;
+		}
+		// 孤立代理或超出范围的码点，每个单元替换为一个 U+FFFD
+		memcpy(output + written, "\xEF\xBF\xBD", 3);
+		written += 3;
+		input++;
+		length--;
+	}
+}
+
+size_t Utf8ToWideLossy(const char* input, size_t length, wchar_t* output, size_t capacity) {
+	size_t written = 0;
+	for (;;) {
+		TranscodeResult result = Utf8ToWide(input, length, output + written, capacity - written);
+		written += result.written;
+		input += result.read;
+		length -= result.read;
+		if (!result.invalid || written == capacity) {
+			return written;
+		}
+		uint32_t code;
+		size_t invalid = 1;
+		DecodeSequence((const uint8_t*)input, length, code, invalid);
+		output[written++] = (wchar_t)0xFFFD;
+		input += invalid;
+		length -= invalid;
+	}
+}
+
+void AppendUtf8(std::string& output, const wchar_t* input, size_t length) {
+	size_t base = output.size();
+	size_t capacity = length * kMaxUtf8PerWide;
+	output.resize(base + capacity);
+	output.resize(base + WideToUtf8Lossy(input, length, &output[base], capacity));
+}
+
+void AppendWide(std::wstring& output, const char* input, size_t length) {
+	size_t base = output.size();
+	output.resize(base + length);
+	output.resize(base + Utf8ToWideLossy(input, length, &output[base], length));
+}
@@ -0,0 +1,43 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// UTF-8 与 UTF-16/UTF-32 之间的转换，一次遍历直接写入调用方提供的缓冲区，不调用系统 API，各平台结果一致
+// 主循环每次检查 16 个单元，全部为 ASCII（路径和日志中最常见的情况）时用 SSE2 整块转换，其余逐个字符转换
+// UTF-8 一侧使用 char：工程按 C++17 编译，没有 char8_t
+
+// 严格转换的结果：遇到非法输入或输出空间不足时停在该字符之前
+struct TranscodeResult {
+	// 已读取的输入单元数
+	size_t read;
+	// 已写入的输出单元数
+	size_t written;
+	// read 处是非法序列（孤立代理、截断、过长编码、超出 U+10FFFF 等）；
+	// 为 false 且 read 小于输入长度时表示输出空间不足
+	bool invalid;
+};
+
+// 每个输入单元最多产生的 UTF-8 字节数，按此分配的缓冲区一定能容纳完整结果
+static const size_t kMaxUtf8PerUtf16 = 3;
+static const size_t kMaxUtf8PerUtf32 = 4;
+static const size_t kMaxUtf8PerWide = sizeof(wchar_t) == 2 ? kMaxUtf8PerUtf16 : kMaxUtf8PerUtf32;
+// UTF-8 转为 UTF-16 或 UTF-32 时，每个字节最多产生一个单元
+
+TranscodeResult Utf16ToUtf8(const char16_t* input, size_t length, char* output, size_t capacity);
+TranscodeResult Utf8ToUtf16(const char* input, size_t length, char16_t* output, size_t capacity);
+TranscodeResult Utf32ToUtf8(const char32_t* input, size_t length, char* output, size_t capacity);
+TranscodeResult Utf8ToUtf32(const char* input, size_t length, char32_t* output, size_t capacity);
+
+// wchar_t 在 Windows 上为 UTF-16，其它平台为 UTF-32
+TranscodeResult WideToUtf8(const wchar_t* input, size_t length, char* output, size_t capacity);
+TranscodeResult Utf8ToWide(const char* input, size_t length, wchar_t* output, size_t capacity);
+
+// 宽松转换：非法序列替换为 U+FFFD（与 WideCharToMultiByte/MultiByteToWideChar 一致），
+// 空间不足时在完整字符处截断，返回写入的单元数
+size_t WideToUtf8Lossy(const wchar_t* input, size_t length, char* output, size_t capacity);
+size_t Utf8ToWideLossy(const char* input, size_t length, wchar_t* output, size_t capacity);
+
+// 按上限扩展一次后原地转换，再截去多余部分
+void AppendUtf8(std::string& output, const wchar_t* input, size_t length);
+void AppendWide(std::wstring& output, const char* input, size_t length);
@@ -1,38 +1,22 @@
 #include "Utils.h"
+#include "Logger.h"
+#include "Utf.h"
 #include <iostream>
-#include <vector>
 #include <sstream>
 #include <iomanip>
 
 std::string WcharToUtf8(const wchar_t* wstr) {
-	if (wstr == nullptr) return "";
-	int size_needed = WideCharToMultiByte(CP_UTF8, 0, wstr, -1, nullptr, 0, nullptr, nullptr);
-	if (size_needed == 0) return "";
-
-	std::string result(size_needed, 0);
-	WideCharToMultiByte(CP_UTF8, 0, wstr, -1, &result[0], size_needed, nullptr, nullptr);
-	// Ƴĩβ null ֹ
-	if (!result.empty() && result[result.size() - 1] == '\0') {
-		result.pop_back();
+	std::string result;
+	if (wstr != nullptr) {
+		AppendUtf8(result, wstr, wcslen(wstr));
 	}
 	return result;
 }
 
 std::wstring Utf8ToWstring(const std::string& utf8Str) {
-	if (utf8Str.empty()) return L"";
-
-	int wchars_count = MultiByteToWideChar(CP_UTF8, 0, utf8Str.c_str(), -1, nullptr, 0);
-	if (wchars_count == 0) return L"";
-
-	std::vector<wchar_t> wchars(wchars_count);
-	MultiByteToWideChar(CP_UTF8, 0, utf8Str.c_str(), -1, wchars.data(), wchars_count);
-
-	// Ƴĩβ null ֹ
-	if (!wchars.empty() && wchars[wchars.size() - 1] == L'\0') {
-		wchars.pop_back();
-	}
-
-	return std::wstring(wchars.begin(), wchars.end());
+	std::wstring result;
+	AppendWide(result, utf8Str.data(), utf8Str.size());
+	return result;
 }
 
 std::wstring HResultToHexString(HRESULT hr)
@@ -58,7 +42,7 @@ BOOL GetModuleDirectory(std::wstring& path) {
 			const std::wstring prefix = L"\\\\?\\";
 			if (path.compare(0, prefix.length(), prefix) == 0) {
 				path = path.substr(prefix.length());
-				std::wcout << L"short path: " << path << std::endl;
+				LOG_DEBUG(L"short path: " + path);
 			}
 
 			size_t pos = path.find_last_of(L"\\");
@@ -77,4 +61,28 @@ BOOL GetModuleDirectory(std::wstring& path) {
 	{
 		return FALSE;
 	}
-}
\ No newline at end of file
+}
+BOOL WriteBinaryFile(const std::wstring& path, const void* data, size_t size) {
+	HANDLE hFile = CreateFileW(path.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		LOG_ERROR(L"Failed to create file " + path + L"! Error: " + std::to_wstring(GetLastError()));
+		return FALSE;
+	}
+	const BYTE* cursor = (const BYTE*)data;
+	while (size > 0)
+	{
+		DWORD chunk = size > 0x40000000 ? 0x40000000 : (DWORD)size;
+		DWORD written = 0;
+		if (!WriteFile(hFile, cursor, chunk, &written, NULL) || written == 0)
+		{
+			LOG_ERROR(L"Failed to write file " + path + L"! Error: " + std::to_wstring(GetLastError()));
+			CloseHandle(hFile);
+			return FALSE;
+		}
+		cursor += written;
+		size -= written;
+	}
+	CloseHandle(hFile);
+	return TRUE;
+}
@@ -9,3 +9,5 @@ std::wstring Utf8ToWstring(const std::string& utf8Str);
 std::wstring HResultToHexString(HRESULT hr);
 
 BOOL GetModuleDirectory(std::wstring& path);
+
+BOOL WriteBinaryFile(const std::wstring& path, const void* data, size_t size);
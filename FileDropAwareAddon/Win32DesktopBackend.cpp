@@ -0,0 +1,280 @@
+﻿#include "Win32DesktopBackend.h"
+#include <shlobj.h>
+#include <UIAutomation.h>
+
+#include "Utils.h"
+#include "Logger.h"
+#include "UiaHitTester.h"
+#include "ShellWindowIndex.h"
+#include "WindowClassifier.h"
+#include "SelectionCache.h"
+#include "SelectionScanner.h"
+
+// Explorer 窗口或桌面的文件视图
+// 文件夹视图在第一次查询选中项时才获取：预测解析之后、拖拽开始之前窗口可能已经导航
+class Win32ShellView : public DesktopView
+{
+public:
+	HWND shellHwnd;
+	bool isDesktop;
+	CComPtr<IDispatch> pDispWindow;
+	bool folderViewResolved;
+	CComPtr<IShellFolderViewDual> pFolderView;
+};
+
+static HRESULT GetFolderView(IDispatch* pDispWindow, CComPtr<IShellFolderViewDual>& pFolderView) {
+	if (!pDispWindow) {
+		LOG_ERROR(L"pDispWindow is null");
+		return E_POINTER;
+	}
+
+	CComPtr<IWebBrowser2> pBrowser;
+	HRESULT hr = pDispWindow->QueryInterface(IID_IWebBrowser2, (void**)&pBrowser);
+	if (FAILED(hr)) {
+		LOG_ERROR(L"Get IWebBrowser2 failed: " + HResultToHexString(hr));
+		return hr;
+	}
+
+	// 获取 Document
+	CComPtr<IDispatch> pDispDoc;
+	hr = pBrowser->get_Document(&pDispDoc);
+	if (FAILED(hr) || !pDispDoc) {
+		LOG_ERROR(L"Get Document failed: " + HResultToHexString(hr));
+		return FAILED(hr) ? hr : E_FAIL;
+	}
+
+	// 获取 Folder View
+	hr = pDispDoc->QueryInterface(IID_IShellFolderViewDual, (void**)&pFolderView);
+	if (FAILED(hr)) {
+		LOG_ERROR(L"Get Folder View failed: " + HResultToHexString(hr));
+		return hr;
+	}
+	return S_OK;
+}
+
+// 代理所在的进程已退出，例如 explorer.exe 重启
+static bool IsDisconnected(HRESULT hr) {
+	return hr == RPC_E_DISCONNECTED || hr == RPC_E_SERVER_DIED || hr == RPC_E_SERVER_DIED_DNE
+		|| hr == CO_E_OBJNOTCONNECTED || hr == HRESULT_FROM_WIN32(RPC_S_SERVER_UNAVAILABLE);
+}
+
+// 获取视图的文件夹视图，失败只尝试一次
+// explorer.exe 重启后索引中缓存的 IDispatch（尤其是桌面）是失效的代理，也不会再有事件把索引标记为过期：
+// 遇到断开错误时让索引过期，重新查找一次
+static IShellFolderViewDual* ResolveFolderView(Win32ShellView& view, ShellWindowIndex* pShellWindowIndex) {
+	if (!view.folderViewResolved) {
+		view.folderViewResolved = true;
+		HRESULT hr = GetFolderView(view.pDispWindow, view.pFolderView);
+		if (IsDisconnected(hr) && pShellWindowIndex != NULL) {
+			LOG_INFO(L"Shell window is disconnected, rebuilding index: " + HResultToHexString(hr));
+			pShellWindowIndex->Invalidate();
+			CComPtr<IDispatch> pDispWindow;
+			bool found = view.isDesktop
+				? pShellWindowIndex->LookupDesktop(pDispWindow)
+				: pShellWindowIndex->Lookup(view.shellHwnd, pDispWindow);
+			if (found) {
+				view.pDispWindow = pDispWindow;
+				hr = GetFolderView(view.pDispWindow, view.pFolderView);
+			}
+		}
+		if (FAILED(hr)) {
+			view.pFolderView.Release();
+		}
+	}
+	return view.pFolderView;
+}
+
+Win32DesktopBackend::Win32DesktopBackend()
+	: m_comInitialized(false), m_pUiaHitTester(NULL), m_pShellWindowIndex(NULL), m_pWindowClassifier(NULL), m_pSelectionCache(NULL) {
+}
+
+Win32DesktopBackend::~Win32DesktopBackend() {
+	Uninitialize();
+}
+
+bool Win32DesktopBackend::Initialize() {
+	HRESULT hr = CoInitialize(NULL);
+	if (hr != S_OK && hr != S_FALSE)
+	{
+		LOG_ERROR(L"COM Initialization failed (HRESULT: " + HResultToHexString(hr) + L"). Shell operations require STA.");
+		return false;
+	}
+	m_comInitialized = true;
+
+	// UIA 对象与当前 COM 线程绑定，创建一次后在本线程的每次检测中复用
+	UiaHitTester* pHitTester = new UiaHitTester();
+	hr = pHitTester->Initialize();
+	if (FAILED(hr))
+	{
+		LOG_ERROR(L"Failed to CoCreate IUIAutomation: " + HResultToHexString(hr));
+		delete pHitTester;
+		pHitTester = NULL;
+	}
+	m_pUiaHitTester = pHitTester;
+
+	// 初始化失败时索引会在首次查找时重试连接
+	m_pShellWindowIndex = new ShellWindowIndex();
+	m_pShellWindowIndex->Initialize();
+
+	m_pWindowClassifier = new WindowClassifier();
+	m_pSelectionCache = new SelectionCache();
+	return true;
+}
+
+void Win32DesktopBackend::Uninitialize() {
+	if (!m_comInitialized) {
+		return;
+	}
+	// 必须在 CoUninitialize 之前释放 COM 对象
+	delete m_pUiaHitTester;
+	m_pUiaHitTester = NULL;
+	delete m_pShellWindowIndex;
+	m_pShellWindowIndex = NULL;
+	delete m_pWindowClassifier;
+	m_pWindowClassifier = NULL;
+	delete m_pSelectionCache;
+	m_pSelectionCache = NULL;
+	CoUninitialize();
+	m_comInitialized = false;
+}
+
+DesktopWindow Win32DesktopBackend::WindowFromPoint(const DesktopPoint& pt) {
+	POINT point = { pt.x, pt.y };
+	return (DesktopWindow)::WindowFromPoint(point);
+}
+
+void Win32DesktopBackend::Classify(DesktopWindow window, WindowAncestry& ancestry) {
+	if (m_pWindowClassifier == NULL)
+	{
+		LOG_ERROR(L"Window classifier is not initialized on this thread.");
+		ancestry = { 0, false, false };
+		return;
+	}
+	m_pWindowClassifier->Classify((HWND)window, ancestry);
+}
+
+bool Win32DesktopBackend::IsOverFileItem(const DesktopPoint& pt) {
+	if (m_pUiaHitTester == NULL) {
+		LOG_ERROR(L"UIA hit tester is not initialized on this thread.");
+		return false;
+	}
+
+	// 元素与父元素的 ControlType 均通过缓存请求取回
+	POINT mousePos = { pt.x, pt.y };
+	UiaHitResult hit;
+	HRESULT hr = m_pUiaHitTester->HitTest(mousePos, hit);
+	if (FAILED(hr)) {
+		// 如果失败，通常是鼠标在屏幕外或不可访问区域
+		LOG_ERROR(L"Failed to hit test UIA element: " + HResultToHexString(hr));
+		return false;
+	}
+	LOG_DEBUG(L"ControlType ID: " + std::to_wstring(hit.controlType));
+	if (hit.controlType == UIA_ListItemControlTypeId) {
+		return true;
+	}
+
+	LOG_DEBUG(L"parent element type id: " + std::to_wstring(hit.parentControlType));
+	// 例如：检查父元素是否是列表项容器
+	if (hit.hasParent && hit.parentControlType == UIA_ListItemControlTypeId) {
+		return true;
+	}
+
+	/*
+	空白
+	UIA_ListControlTypeId 50008
+	UIA_PaneControlTypeId 50033
+
+	文件
+	UIA_EditControlTypeId 50004
+	UIA_ListItemControlTypeId 50007
+
+	时间标签
+	UIA_CustomControlTypeId 50025
+	UIA_GroupControlTypeId 50026
+
+	表头
+	UIA_SplitButtonControlTypeId 50031
+	UIA_HeaderControlTypeId 50034
+	*/
+
+	// 4. 过滤和分类
+	//if (controlTypeId == UIA_ListItemControlTypeId) {
+	//	// 命中了文件或文件夹项
+	//	*pResult = HitType_FileItem;
+	//}
+	//else if (controlTypeId == UIA_GroupControlTypeId || controlTypeId == UIA_HeaderControlTypeId) {
+	//	// 命中了分组标题 (如 "今天")
+	//	*pResult = HitType_GroupHeader;
+	//}
+	//else {
+	//	// 命中了滚动条、容器或其他元素
+	//	*pResult = HitType_Other;
+	//}
+
+	return false;
+}
+
+std::shared_ptr<DesktopView> Win32DesktopBackend::FindView(DesktopWindow shellWindow, bool isDesktop) {
+	// 从常驻索引中查找 Shell 窗口，不再每次创建 ShellWindows 并遍历所有窗口
+	if (m_pShellWindowIndex == NULL)
+	{
+		LOG_ERROR(L"Shell window index is not initialized on this thread.");
+		return nullptr;
+	}
+
+	CComPtr<IDispatch> pDispWindow;
+	bool found = isDesktop
+		? m_pShellWindowIndex->LookupDesktop(pDispWindow)
+		: m_pShellWindowIndex->Lookup((HWND)shellWindow, pDispWindow);
+	if (!found)
+	{
+		return nullptr;
+	}
+	std::shared_ptr<Win32ShellView> view = std::make_shared<Win32ShellView>();
+	view->shellHwnd = (HWND)shellWindow;
+	view->isDesktop = isDesktop;
+	view->pDispWindow = pDispWindow;
+	view->folderViewResolved = false;
+	return view;
+}
+
+bool Win32DesktopBackend::LookupSelection(DesktopView& view, unsigned int rulesVersion, SelectionMatch& match) {
+	Win32ShellView& shellView = static_cast<Win32ShellView&>(view);
+	IShellFolderViewDual* pFolderView = ResolveFolderView(shellView, m_pShellWindowIndex);
+	if (m_pSelectionCache == NULL || pFolderView == NULL) {
+		return false;
+	}
+	return m_pSelectionCache->Lookup(shellView.shellHwnd, pFolderView, rulesVersion, match);
+}
+
+void Win32DesktopBackend::StoreSelection(DesktopView& view, unsigned int rulesVersion, const SelectionMatch& match) {
+	Win32ShellView& shellView = static_cast<Win32ShellView&>(view);
+	IShellFolderViewDual* pFolderView = ResolveFolderView(shellView, m_pShellWindowIndex);
+	if (m_pSelectionCache == NULL || pFolderView == NULL) {
+		return;
+	}
+	m_pSelectionCache->Store(shellView.shellHwnd, pFolderView, rulesVersion, match);
+}
+
+ScanVerdict Win32DesktopBackend::ScanSelection(DesktopView& view, const MatchRules& matcher, const ScanBudget& budget,
+	MatchedPaths* paths, SelectionScanSummary& summary) {
+	summary = { 0, 0, false };
+	Win32ShellView& shellView = static_cast<Win32ShellView&>(view);
+	IShellFolderViewDual* pFolderView = ResolveFolderView(shellView, m_pShellWindowIndex);
+	if (pFolderView == NULL) {
+		return ScanVerdict::NoMatch;
+	}
+
+	// 获取 SelectedItems
+	CComPtr<FolderItems> pSelectedItems;
+	HRESULT hr = pFolderView->SelectedItems(&pSelectedItems);
+	if (FAILED(hr) || !pSelectedItems) {
+		LOG_ERROR(L"Get Selected Items failed");
+		return ScanVerdict::NoMatch;
+	}
+
+	SelectionScanner scanner(matcher, budget);
+	ScanVerdict verdict = scanner.Scan(pSelectedItems, paths);
+	summary = { scanner.ScannedCount(), scanner.MatchCount(), scanner.Truncated() };
+	return verdict;
+}
@@ -0,0 +1,41 @@
+﻿#pragma once
+#include <windows.h>
+#include <shldisp.h>
+#include <atlbase.h> // 使用 CComPtr 简化 COM 内存管理
+#include "DesktopBackend.h"
+
+class IUiaHitTester;
+class ShellWindowIndex;
+class WindowClassifier;
+class SelectionCache;
+
+// 真实桌面的后端：WindowFromPoint + 窗口类分类、UIA 命中测试、IShellWindows 索引和 IShellFolderViewDual 选中项
+// 所有对象都与创建它的 STA 线程绑定，该线程必须持续分发消息（事件回调依赖消息投递）
+class Win32DesktopBackend : public IDesktopBackend
+{
+public:
+	Win32DesktopBackend();
+	~Win32DesktopBackend();
+	// 在检测线程上初始化 COM (STA) 并创建各个组件
+	bool Initialize();
+	// 释放所有 COM 对象后 CoUninitialize，调用前必须先释放持有的 DesktopView
+	void Uninitialize();
+
+	DesktopWindow WindowFromPoint(const DesktopPoint& pt) override;
+	void Classify(DesktopWindow window, WindowAncestry& ancestry) override;
+	bool IsOverFileItem(const DesktopPoint& pt) override;
+	std::shared_ptr<DesktopView> FindView(DesktopWindow shellWindow, bool isDesktop) override;
+	bool LookupSelection(DesktopView& view, unsigned int rulesVersion, SelectionMatch& match) override;
+	void StoreSelection(DesktopView& view, unsigned int rulesVersion, const SelectionMatch& match) override;
+	ScanVerdict ScanSelection(DesktopView& view, const MatchRules& matcher, const ScanBudget& budget,
+		MatchedPaths* paths, SelectionScanSummary& summary) override;
+private:
+	bool m_comInitialized;
+	IUiaHitTester* m_pUiaHitTester;
+	// HWND -> Shell 窗口索引
+	ShellWindowIndex* m_pShellWindowIndex;
+	// 窗口祖先链分类器
+	WindowClassifier* m_pWindowClassifier;
+	// 选中项结果缓存
+	SelectionCache* m_pSelectionCache;
+};
@@ -0,0 +1,92 @@
+﻿#include "WindowClassifier.h"
+
+// 缓存上限，超过后整体清空，避免无限增长
+static const size_t kMaxCachedWindows = 256;
+
+// WinEvent 回调在安装钩子的线程上执行，通过它找到本线程的分类器
+static thread_local WindowClassifier* t_pClassifier = NULL;
+
+WindowClassifier::WindowClassifier() : m_destroyHook(NULL), m_parentChangeHook(NULL) {
+	t_pClassifier = this;
+	m_destroyHook = SetWinEventHook(EVENT_OBJECT_DESTROY, EVENT_OBJECT_DESTROY, NULL,
+		WinEventProc, 0, 0, WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS);
+	m_parentChangeHook = SetWinEventHook(EVENT_OBJECT_PARENTCHANGE, EVENT_OBJECT_PARENTCHANGE, NULL,
+		WinEventProc, 0, 0, WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS);
+}
+
+WindowClassifier::~WindowClassifier() {
+	if (m_destroyHook != NULL) UnhookWinEvent(m_destroyHook);
+	if (m_parentChangeHook != NULL) UnhookWinEvent(m_parentChangeHook);
+	if (t_pClassifier == this) t_pClassifier = NULL;
+}
+
+// 通过 Win32 API 读取窗口类和父窗口
+struct Win32Windows {
+	ShellClass ClassOf(DesktopWindow window) const {
+		wchar_t className[256];
+		int length = GetClassNameW((HWND)window, className, 256);
+		return length > 0 ? ClassifyShellClassName(className, (size_t)length) : ShellClass::Other;
+	}
+	DesktopWindow ParentOf(DesktopWindow window) const {
+		return (DesktopWindow)GetParent((HWND)window);
+	}
+};
+
+void WindowClassifier::Classify(HWND hWnd, WindowAncestry& ancestry) {
+	auto it = m_cache.find(hWnd);
+	if (it != m_cache.end()) {
+		ancestry = it->second;
+		return;
+	}
+
+	Win32Windows windows;
+	WalkShellAncestry(windows, (DesktopWindow)hWnd, ancestry);
+
+	// 没有可靠的失效通知时不缓存
+	if (m_destroyHook == NULL || m_parentChangeHook == NULL) {
+		return;
+	}
+	if (m_cache.size() >= kMaxCachedWindows) {
+		m_cache.clear();
+		m_shellWindows.clear();
+	}
+	m_cache.emplace(hWnd, ancestry);
+	if (ancestry.shellWindow != 0) {
+		m_shellWindows.insert((HWND)ancestry.shellWindow);
+	}
+}
+
+void WindowClassifier::OnWindowDestroyed(HWND hWnd) {
+	m_cache.erase(hWnd);
+	if (m_shellWindows.erase(hWnd) == 0) {
+		return;
+	}
+	// 销毁的是某个缓存项的 Shell 父窗口
+	for (auto it = m_cache.begin(); it != m_cache.end();) {
+		if (it->second.shellWindow == (DesktopWindow)hWnd) {
+			it = m_cache.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+void CALLBACK WindowClassifier::WinEventProc(HWINEVENTHOOK hWinEventHook, DWORD event, HWND hWnd,
+	LONG idObject, LONG idChild, DWORD idEventThread, DWORD dwmsEventTime) {
+	// 只关心窗口本身，忽略窗口内部的可访问对象
+	if (idObject != OBJID_WINDOW || idChild != CHILDID_SELF || hWnd == NULL) {
+		return;
+	}
+	WindowClassifier* pClassifier = t_pClassifier;
+	if (pClassifier == NULL || pClassifier->m_cache.empty()) {
+		return;
+	}
+	if (event == EVENT_OBJECT_PARENTCHANGE) {
+		// 父窗口变化会影响其所有后代的祖先链，直接清空
+		pClassifier->m_cache.clear();
+		pClassifier->m_shellWindows.clear();
+		return;
+	}
+	pClassifier->OnWindowDestroyed(hWnd);
+}
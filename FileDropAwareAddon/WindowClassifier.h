@@ -0,0 +1,26 @@
+﻿#pragma once
+#include <windows.h>
+#include <cstddef>
+#include <unordered_map>
+#include <unordered_set>
+#include "ShellAncestry.h"
+
+// 用 GetClassNameW / GetParent 遍历祖先链（见 WalkShellAncestry），结果按 HWND 缓存
+// 窗口销毁或重新挂接父窗口时通过 WinEvent 失效，必须在持续分发消息的线程上使用
+class WindowClassifier
+{
+public:
+	WindowClassifier();
+	~WindowClassifier();
+	void Classify(HWND hWnd, WindowAncestry& ancestry);
+private:
+	static void CALLBACK WinEventProc(HWINEVENTHOOK hWinEventHook, DWORD event, HWND hWnd,
+		LONG idObject, LONG idChild, DWORD idEventThread, DWORD dwmsEventTime);
+	void OnWindowDestroyed(HWND hWnd);
+private:
+	HWINEVENTHOOK m_destroyHook;
+	HWINEVENTHOOK m_parentChangeHook;
+	std::unordered_map<HWND, WindowAncestry> m_cache;
+	// 缓存项引用到的 Shell 父窗口，销毁事件先查这里，避免遍历缓存
+	std::unordered_set<HWND> m_shellWindows;
+};
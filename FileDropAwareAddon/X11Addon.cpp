@@ -0,0 +1,282 @@
+﻿// Linux (X11) 上的模块入口：与 Windows 版导出相同的回调约定，拖拽事件由 X11DragMonitor 产生，
+// 经 AddonInstance 投递给 JS；Windows 版的预测、内容校验、哈希和预热在这里不可用
+#ifdef __linux__
+#include <node_api.h>
+#include <initializer_list>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "AddonInstance.h"
+#include "X11DragMonitor.h"
+#include "Logger.h"
+#include "PipelineStats.h"
+#include "Utf.h"
+
+// 已调用 AwareInitialize 的实例数，监视线程是进程级的，最后一个实例退出时才停止
+static std::mutex g_instanceMutex;
+static int g_activeInstances = 0;
+
+static size_t GetArgs(napi_env env, napi_callback_info info, napi_value* args, size_t count) {
+	size_t argc = count;
+	if (napi_get_cb_info(env, info, &argc, args, nullptr, nullptr) != napi_ok) {
+		return 0;
+	}
+	return argc;
+}
+
+static bool IsType(napi_env env, napi_value value, napi_valuetype type) {
+	napi_valuetype actual;
+	return napi_typeof(env, value, &actual) == napi_ok && actual == type;
+}
+
+static bool IsArray(napi_env env, napi_value value) {
+	bool result = false;
+	return napi_is_array(env, value, &result) == napi_ok && result;
+}
+
+static bool GetUtf8String(napi_env env, napi_value value, std::string& result) {
+	size_t length = 0;
+	if (napi_get_value_string_utf8(env, value, nullptr, 0, &length) != napi_ok) {
+		return false;
+	}
+	std::vector<char> buffer(length + 1);
+	if (napi_get_value_string_utf8(env, value, buffer.data(), buffer.size(), &length) != napi_ok) {
+		return false;
+	}
+	result.assign(buffer.data(), length);
+	return true;
+}
+
+// 读取字符串数组，忽略非字符串元素
+template <typename Container>
+static void GetStringArray(napi_env env, napi_value array, Container& result) {
+	uint32_t length = 0;
+	napi_get_array_length(env, array, &length);
+	for (uint32_t i = 0; i < length; i++) {
+		napi_value element;
+		std::string utf8Str;
+		if (napi_get_element(env, array, i, &element) == napi_ok && IsType(env, element, napi_string)
+			&& GetUtf8String(env, element, utf8Str)) {
+			std::wstring wide;
+			AppendWide(wide, utf8Str.data(), utf8Str.size());
+			result.insert(result.end(), wide);
+		}
+	}
+}
+
+static bool GetOption(napi_env env, napi_value options, const char* name, napi_valuetype type, napi_value* value) {
+	return napi_get_named_property(env, options, name, value) == napi_ok && IsType(env, *value, type);
+}
+
+static LogLevel ParseLogLevel(const std::string& name, LogLevel fallback) {
+	if (name == "debug") return LogLevel::Debug;
+	if (name == "info") return LogLevel::Info;
+	if (name == "error") return LogLevel::Error;
+	if (name == "off") return LogLevel::Off;
+	return fallback;
+}
+
+static napi_value ResolvedPromise(napi_env env) {
+	napi_deferred deferred;
+	napi_value promise;
+	napi_value undefined;
+	if (napi_create_promise(env, &deferred, &promise) != napi_ok) {
+		return nullptr;
+	}
+	napi_get_undefined(env, &undefined);
+	napi_resolve_deferred(env, deferred, undefined);
+	return promise;
+}
+
+// 环境销毁时执行（进程退出、Worker 结束），注销事件接收并释放线程安全函数
+static void OnEnvCleanup(void* arg) {
+	AddonInstance* instance = static_cast<AddonInstance*>(arg);
+	LOG_INFO(L"Monitoring stopped by process exit");
+	X11DragMonitor::RemoveEventSink(AddonInstance::OnDragEvent, instance);
+	instance->Close();
+
+	bool last = false;
+	{
+		std::lock_guard<std::mutex> lock(g_instanceMutex);
+		last = --g_activeInstances == 0;
+	}
+	if (last) {
+		X11DragMonitor::Stop();
+	}
+}
+
+// AwareInitialize(extensions, fileDropCallback, logCallback, options?)
+// options 只支持 maxPaths 与 logLevel，含义与 Windows 版相同
+static napi_value AwareInitialize(napi_env env, napi_callback_info info) {
+	napi_value args[4];
+	size_t argc = GetArgs(env, info, args, 4);
+	if (argc < 3 || !IsArray(env, args[0]) || !IsType(env, args[1], napi_function) || !IsType(env, args[2], napi_function)) {
+		napi_throw_type_error(env, nullptr, "必须传入一个字符串数组和两个回调函数");
+		return nullptr;
+	}
+	AddonInstance* instance = AddonInstance::Get(env);
+	if (instance == nullptr) {
+		napi_throw_error(env, nullptr, "模块未正确加载");
+		return nullptr;
+	}
+
+	long maxPaths = 1000;
+	LogLevel logLevel = LogLevel::Info;
+	if (argc > 3 && IsType(env, args[3], napi_object)) {
+		napi_value value;
+		int64_t integer;
+		if (GetOption(env, args[3], "maxPaths", napi_number, &value) && napi_get_value_int64(env, value, &integer) == napi_ok) {
+			maxPaths = (long)integer;
+		}
+		std::string levelName;
+		if (GetOption(env, args[3], "logLevel", napi_string, &value) && GetUtf8String(env, value, levelName)) {
+			logLevel = ParseLogLevel(levelName, logLevel);
+		}
+	}
+	Logger::SetLevel(logLevel);
+
+	// 同一环境重复调用时只替换回调
+	bool firstBind = !instance->IsBound();
+	if (!instance->Bind(env, args[1], args[2])) {
+		return nullptr;
+	}
+	if (firstBind) {
+		X11DragMonitor::AddEventSink(AddonInstance::OnDragEvent, instance);
+		napi_add_env_cleanup_hook(env, OnEnvCleanup, instance);
+		std::lock_guard<std::mutex> lock(g_instanceMutex);
+		g_activeInstances++;
+	}
+
+	std::set<std::wstring> targetExtensions;
+	GetStringArray(env, args[0], targetExtensions);
+	X11DragMonitor::SetExtensions(targetExtensions);
+	X11DragMonitor::SetMaxPaths(maxPaths);
+	if (!X11DragMonitor::Start()) {
+		napi_throw_error(env, nullptr, "无法连接 X11 显示或缺少 XInput2/XFixes 扩展");
+	}
+	return nullptr;
+}
+
+// UpdateRules(rules)：与 Windows 版相同，rules 为扩展名数组或 { extensions?, globs?, exclude? }
+static napi_value UpdateRules(napi_env env, napi_callback_info info) {
+	napi_value args[1];
+	size_t argc = GetArgs(env, info, args, 1);
+	MatchRuleSet rules;
+	if (argc >= 1 && IsArray(env, args[0])) {
+		GetStringArray(env, args[0], rules.extensions);
+	}
+	else if (argc >= 1 && IsType(env, args[0], napi_object)) {
+		napi_value value;
+		if (napi_get_named_property(env, args[0], "extensions", &value) == napi_ok && IsArray(env, value)) {
+			GetStringArray(env, value, rules.extensions);
+		}
+		if (napi_get_named_property(env, args[0], "globs", &value) == napi_ok && IsArray(env, value)) {
+			GetStringArray(env, value, rules.globs);
+		}
+		if (napi_get_named_property(env, args[0], "exclude", &value) == napi_ok && IsArray(env, value)) {
+			GetStringArray(env, value, rules.exclusions);
+		}
+	}
+	else {
+		napi_throw_type_error(env, nullptr, "参数必须是扩展名数组或规则对象");
+		return nullptr;
+	}
+	X11DragMonitor::SetRules(rules);
+	return nullptr;
+}
+
+// Start()/Stop()：打开显示很快，直接在 JS 线程上完成，返回已完成的 Promise 以保持与 Windows 版一致
+static napi_value Start(napi_env env, napi_callback_info info) {
+	if (!X11DragMonitor::Start()) {
+		napi_throw_error(env, nullptr, "无法连接 X11 显示或缺少 XInput2/XFixes 扩展");
+		return nullptr;
+	}
+	return ResolvedPromise(env);
+}
+
+static napi_value Stop(napi_env env, napi_callback_info info) {
+	X11DragMonitor::Stop();
+	return ResolvedPromise(env);
+}
+
+// 返回各阶段的耗时统计 { stage: { count, p50, p90, p99, max } }，单位为毫秒；X11 下只有 detect、delivery、
+// callback 和 endToEnd 有数据
+static napi_value GetStats(napi_env env, napi_callback_info info) {
+	napi_value args[1];
+	size_t argc = GetArgs(env, info, args, 1);
+	bool reset = true;
+	if (argc >= 1) {
+		napi_value coerced;
+		if (napi_coerce_to_bool(env, args[0], &coerced) == napi_ok) {
+			napi_get_value_bool(env, coerced, &reset);
+		}
+	}
+
+	napi_value result;
+	napi_create_object(env, &result);
+	for (int i = 0; i < (int)PipelineStage::Count; i++) {
+		PipelineStage stage = (PipelineStage)i;
+		LatencySummary summary = PipelineStats::Summarize(stage, reset);
+		napi_value item;
+		napi_create_object(env, &item);
+		const std::pair<const char*, double> fields[] = {
+			{ "count", (double)summary.count },
+			{ "p50", summary.p50 / 1000.0 },
+			{ "p90", summary.p90 / 1000.0 },
+			{ "p99", summary.p99 / 1000.0 },
+			{ "max", summary.max / 1000.0 },
+		};
+		for (const auto& field : fields) {
+			napi_value number;
+			napi_create_double(env, field.second, &number);
+			napi_set_named_property(env, item, field.first, number);
+		}
+		napi_set_named_property(env, result, PipelineStats::StageName(stage), item);
+	}
+	return result;
+}
+
+// 导出枚举常量，例如 { Supported: 0, Released: 1, Inconclusive: 2 }
+static void ExportEnum(napi_env env, napi_value exports, const char* name,
+	const std::initializer_list<std::pair<const char*, int>>& values) {
+	napi_value object;
+	napi_create_object(env, &object);
+	for (const auto& value : values) {
+		napi_value number;
+		napi_create_int32(env, value.second, &number);
+		napi_set_named_property(env, object, value.first, number);
+	}
+	napi_set_named_property(env, exports, name, object);
+}
+
+NAPI_MODULE_INIT() {
+	if (AddonInstance::Create(env) == nullptr) {
+		napi_throw_error(env, nullptr, "模块初始化失败");
+		return nullptr;
+	}
+
+	const napi_property_descriptor methods[] = {
+		{ "AwareInitialize", nullptr, AwareInitialize, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "UpdateRules", nullptr, UpdateRules, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "GetStats", nullptr, GetStats, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "Start", nullptr, Start, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "Stop", nullptr, Stop, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+	};
+	napi_define_properties(env, exports, sizeof(methods) / sizeof(methods[0]), methods);
+	ExportEnum(env, exports, "DragEventKind", {
+		{ "Supported", (int)DragEventKind::Supported },
+		{ "Released", (int)DragEventKind::Released },
+		{ "Inconclusive", (int)DragEventKind::Inconclusive },
+		{ "Hashed", (int)DragEventKind::Hashed },
+	});
+	ExportEnum(env, exports, "ShellKind", {
+		{ "Unknown", (int)DragShellKind::Unknown },
+		{ "Desktop", (int)DragShellKind::Desktop },
+		{ "Explorer", (int)DragShellKind::Explorer },
+		{ "Xdnd", (int)DragShellKind::Xdnd },
+	});
+	return exports;
+}
+#endif
@@ -0,0 +1,454 @@
+﻿#ifdef __linux__
+#include "X11DragMonitor.h"
+#include "MatchRules.h"
+#include "MatchedPaths.h"
+#include "Snapshot.h"
+#include "DragTracker.h"
+#include "Logger.h"
+#include "PipelineStats.h"
+#include "Utf.h"
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include <X11/extensions/XInput2.h>
+#include <X11/extensions/Xfixes.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// 与 GTK 默认的 dnd-drag-threshold 一致
+static const int kDragThreshold = 8;
+
+// 串行化监视线程的启动与停止
+static std::mutex g_lifecycleMutex;
+static std::thread g_monitorThread;
+// 通知监视线程退出
+static int g_stopPipe[2] = { -1, -1 };
+
+// 拖拽事件的接收方，与 MouseHook 相同：锁只在注册/注销时才会有竞争
+static std::mutex g_sinkMutex;
+static std::vector<std::pair<DragEventSink, void*>> g_sinks;
+
+// 匹配规则快照，只在监视线程上读取
+static SnapshotCell<MatchRules> g_rules;
+static SnapshotReader<MatchRules> g_rulesReader;
+static std::atomic<long> g_maxPaths(1000);
+
+// 监视线程上的 X11 状态
+struct X11State {
+	Display* display;
+	Window root;
+	// 作为选择转换目标的隐藏窗口
+	Window window;
+	int xiOpcode;
+	int fixesEventBase;
+	Atom xdndSelection;
+	Atom uriList;
+	Atom property;
+	Atom incr;
+	unsigned char buttonMap[256];
+	// 本次按下后 XdndSelection 的所有者发生过变化
+	bool ownerChanged;
+	// 本次拖拽已请求过转换
+	bool convertRequested;
+	// 有一个转换尚未收到 SelectionNotify；同一时间只发出一个，应答按请求顺序到达
+	bool convertPending;
+	// 发出转换请求时的拖拽序号，应答到达时已开始新的拖拽则丢弃
+	uint32_t convertSequence;
+	int32_t dragX;
+	int32_t dragY;
+	// 越过拖拽阈值的时间 (PipelineStats::Now)
+	int64_t dragStartTicks;
+};
+static X11State g_x11;
+
+// 最近一次检测结果，释放事件沿用
+static long g_resultMatchCount = 0;
+static std::shared_ptr<const MatchedPaths> g_resultPaths;
+
+// 仅在监视线程调用
+static void DispatchDragEvent(DragEventKind kind, int32_t x, int32_t y, int64_t originTicks) {
+	DragEvent event = { kind, PipelineStats::Now(), originTicks, x, y, DragShellKind::Xdnd,
+		g_resultMatchCount, g_resultPaths, nullptr };
+	std::lock_guard<std::mutex> lock(g_sinkMutex);
+	for (const auto& sink : g_sinks) {
+		sink.first(sink.second, event);
+	}
+}
+
+static void RequestUriList();
+
+struct X11DragPolicy {
+	static const uint32_t kButtons = kDragButtonLeft;
+
+	int ThresholdX() const { return kDragThreshold; }
+	int ThresholdY() const { return kDragThreshold; }
+
+	void OnPress(uint32_t sequence, int32_t x, int32_t y) {
+		// 上一次拖拽未应答的转换保持 convertPending，应答到达时按序号丢弃
+		g_x11.ownerChanged = false;
+		g_x11.convertRequested = false;
+		g_resultMatchCount = 0;
+		g_resultPaths.reset();
+	}
+
+	void OnDragStart(uint32_t sequence, int32_t x, int32_t y) {
+		g_x11.dragX = x;
+		g_x11.dragY = y;
+		g_x11.dragStartTicks = PipelineStats::Now();
+		// 拖拽源可能先于我们越过阈值并已取得 XdndSelection
+		RequestUriList();
+	}
+
+	void OnRelease(uint32_t sequence, int32_t x, int32_t y) {
+		LOG_INFO(L"[Detected] Dragging released.");
+		DispatchDragEvent(DragEventKind::Released, x, y, 0);
+	}
+
+	void OnCancel(uint32_t sequence) {
+	}
+};
+
+static DragTracker<X11DragPolicy> g_dragTracker;
+
+// 本次拖拽已开始、XdndSelection 的所有者已变化时请求 text/uri-list；上一个转换尚未应答时推迟到应答之后
+static void RequestUriList() {
+	if (g_x11.convertRequested || g_x11.convertPending || !g_x11.ownerChanged || !g_dragTracker.IsDragging()) {
+		return;
+	}
+	if (XGetSelectionOwner(g_x11.display, g_x11.xdndSelection) == None) {
+		return;
+	}
+	g_x11.convertRequested = true;
+	g_x11.convertPending = true;
+	g_x11.convertSequence = g_dragTracker.Sequence();
+	XConvertSelection(g_x11.display, g_x11.xdndSelection, g_x11.uriList, g_x11.property, g_x11.window, CurrentTime);
+	XFlush(g_x11.display);
+}
+
+static int HexValue(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+// file:// URI 转换为本地路径，其它协议返回 false
+static bool UriToPath(const char* begin, const char* end, std::string& path) {
+	static const char kScheme[] = "file://";
+	const size_t schemeLength = sizeof(kScheme) - 1;
+	if ((size_t)(end - begin) <= schemeLength || std::string(begin, schemeLength) != kScheme) {
+		return false;
+	}
+	// 跳过主机名，例如 file://hostname/path
+	const char* cursor = begin + schemeLength;
+	while (cursor < end && *cursor != '/') {
+		cursor++;
+	}
+	path.clear();
+	while (cursor < end) {
+		if (*cursor == '%' && end - cursor >= 3 && HexValue(cursor[1]) >= 0 && HexValue(cursor[2]) >= 0) {
+			path.push_back((char)(HexValue(cursor[1]) * 16 + HexValue(cursor[2])));
+			cursor += 3;
+		}
+		else {
+			path.push_back(*cursor++);
+		}
+	}
+	return !path.empty();
+}
+
+// 解析 text/uri-list (RFC 2483)，统计匹配的文件
+static long MatchUriList(const char* data, size_t size, MatchedPaths& paths) {
+	const MatchRules& rules = g_rulesReader.Get(g_rules);
+	long matched = 0;
+	std::string path;
+	std::wstring widePath;
+	const char* end = data + size;
+	const char* line = data;
+	while (line < end) {
+		const char* lineEnd = line;
+		while (lineEnd < end && *lineEnd != '\r' && *lineEnd != '\n') {
+			lineEnd++;
+		}
+		if (lineEnd > line && *line != '#' && UriToPath(line, lineEnd, path)) {
+			// 非法序列替换为 U+FFFD
+			widePath.clear();
+			AppendWide(widePath, path.data(), path.size());
+			struct stat info;
+			// 规则匹配后才确认不是目录
+			if (rules.Matches(widePath) && stat(path.c_str(), &info) == 0 && !S_ISDIR(info.st_mode)) {
+				matched++;
+				paths.Add(widePath.c_str(), widePath.size());
+			}
+		}
+		line = lineEnd;
+		while (line < end && (*line == '\r' || *line == '\n')) {
+			line++;
+		}
+	}
+	return matched;
+}
+
+static void OnSelectionNotify(const XSelectionEvent& event) {
+	if (event.requestor != g_x11.window || event.selection != g_x11.xdndSelection || !g_x11.convertPending) {
+		return;
+	}
+	g_x11.convertPending = false;
+	// 应答属于发出请求时的拖拽；之后已开始新的拖拽时丢弃，并为新的拖拽补发被推迟的请求
+	uint32_t sequence = g_x11.convertSequence;
+	if (sequence != g_dragTracker.Sequence()) {
+		if (event.property != None) {
+			XDeleteProperty(g_x11.display, g_x11.window, event.property);
+		}
+		RequestUriList();
+		return;
+	}
+	if (event.property == None) {
+		return;
+	}
+
+	Atom type = None;
+	int format = 0;
+	unsigned long count = 0;
+	unsigned long remaining = 0;
+	unsigned char* data = nullptr;
+	// 一次读取整个属性；INCR 分段传输的超大列表不处理
+	if (XGetWindowProperty(g_x11.display, g_x11.window, g_x11.property, 0, 0x1000000, True, AnyPropertyType,
+		&type, &format, &count, &remaining, &data) != Success) {
+		return;
+	}
+	if (data == nullptr || type == g_x11.incr || format != 8) {
+		if (data != nullptr) XFree(data);
+		return;
+	}
+
+	std::shared_ptr<MatchedPaths> paths = std::make_shared<MatchedPaths>((size_t)g_maxPaths.load(std::memory_order_relaxed));
+	long matched = MatchUriList((const char*)data, count, *paths);
+	XFree(data);
+
+	if (matched > 0 && g_dragTracker.AcceptResult(sequence)) {
+		g_resultMatchCount = matched;
+		if (paths->Count() > 0) {
+			g_resultPaths = std::move(paths);
+		}
+		PipelineStats::Record(PipelineStage::Detect, g_x11.dragStartTicks, PipelineStats::Now());
+		LOG_INFO(L"[Detected] Dragging supported file detected!");
+		DispatchDragEvent(DragEventKind::Supported, g_x11.dragX, g_x11.dragY, g_x11.dragStartTicks);
+	}
+}
+
+static bool QueryPointer(int32_t& x, int32_t& y) {
+	Window rootReturn, childReturn;
+	int rootX, rootY, winX, winY;
+	unsigned int mask;
+	if (!XQueryPointer(g_x11.display, g_x11.root, &rootReturn, &childReturn, &rootX, &rootY, &winX, &winY, &mask)) {
+		return false;
+	}
+	x = rootX;
+	y = rootY;
+	return true;
+}
+
+static void OnRawEvent(XIRawEvent* raw) {
+	PointerInput input;
+	input.button = kDragButtonLeft;
+	switch (raw->evtype)
+	{
+	case XI_RawButtonPress:
+	case XI_RawButtonRelease:
+	{
+		// 原始事件中是物理按键，按核心指针的映射转换（例如左手模式）
+		unsigned int button = raw->detail < 256 ? g_x11.buttonMap[raw->detail] : 0;
+		if (button == 1) input.button = kDragButtonLeft;
+		else if (button == 2) input.button = kDragButtonMiddle;
+		else if (button == 3) input.button = kDragButtonRight;
+		else return;
+		input.action = raw->evtype == XI_RawButtonPress ? PointerAction::Down : PointerAction::Up;
+		break;
+	}
+	case XI_RawMotion:
+		// 原始移动只有相对量；只有按下且尚未开始拖拽时才需要查询光标位置
+		if (!g_dragTracker.IsPressed() || g_dragTracker.IsDragging()) {
+			return;
+		}
+		input.action = PointerAction::Move;
+		break;
+	default:
+		return;
+	}
+	if (!QueryPointer(input.x, input.y)) {
+		return;
+	}
+	g_dragTracker.Feed(input);
+}
+
+static void HandleEvent(XEvent& event) {
+	if (event.type == GenericEvent && event.xcookie.extension == g_x11.xiOpcode) {
+		if (XGetEventData(g_x11.display, &event.xcookie)) {
+			OnRawEvent((XIRawEvent*)event.xcookie.data);
+			XFreeEventData(g_x11.display, &event.xcookie);
+		}
+	}
+	else if (event.type == g_x11.fixesEventBase + XFixesSelectionNotify) {
+		XFixesSelectionNotifyEvent* notify = (XFixesSelectionNotifyEvent*)&event;
+		if (notify->owner != None && g_dragTracker.IsPressed()) {
+			g_x11.ownerChanged = true;
+			if (g_dragTracker.IsDragging()) {
+				RequestUriList();
+			}
+		}
+	}
+	else if (event.type == SelectionNotify) {
+		OnSelectionNotify(event.xselection);
+	}
+}
+
+static bool OpenDisplay() {
+	g_x11.display = XOpenDisplay(nullptr);
+	if (g_x11.display == nullptr) {
+		return false;
+	}
+	int event, error;
+	int major = 2, minor = 2;
+	if (!XQueryExtension(g_x11.display, "XInputExtension", &g_x11.xiOpcode, &event, &error)
+		|| XIQueryVersion(g_x11.display, &major, &minor) != Success
+		|| !XFixesQueryExtension(g_x11.display, &g_x11.fixesEventBase, &error)) {
+		XCloseDisplay(g_x11.display);
+		g_x11.display = nullptr;
+		return false;
+	}
+
+	g_x11.root = DefaultRootWindow(g_x11.display);
+	g_x11.window = XCreateWindow(g_x11.display, g_x11.root, -1, -1, 1, 1, 0, CopyFromParent, InputOnly,
+		CopyFromParent, 0, nullptr);
+	g_x11.xdndSelection = XInternAtom(g_x11.display, "XdndSelection", False);
+	g_x11.uriList = XInternAtom(g_x11.display, "text/uri-list", False);
+	g_x11.property = XInternAtom(g_x11.display, "FILE_DROP_AWARE_URI_LIST", False);
+	g_x11.incr = XInternAtom(g_x11.display, "INCR", False);
+	g_x11.ownerChanged = false;
+	g_x11.convertRequested = false;
+	g_x11.convertPending = false;
+
+	for (int i = 0; i < 256; i++) {
+		g_x11.buttonMap[i] = (unsigned char)i;
+	}
+	unsigned char map[256];
+	int mapped = XGetPointerMapping(g_x11.display, map, 255);
+	for (int i = 0; i < mapped; i++) {
+		g_x11.buttonMap[i + 1] = map[i];
+	}
+
+	// XI 2.1 起可以直接在主设备上接收原始事件，且不受其它客户端抓取的影响
+	unsigned char bits[XIMaskLen(XI_LASTEVENT)] = { 0 };
+	XISetMask(bits, XI_RawButtonPress);
+	XISetMask(bits, XI_RawButtonRelease);
+	XISetMask(bits, XI_RawMotion);
+	XIEventMask mask = { XIAllMasterDevices, (int)sizeof(bits), bits };
+	XISelectEvents(g_x11.display, g_x11.root, &mask, 1);
+	XFixesSelectSelectionInput(g_x11.display, g_x11.window, g_x11.xdndSelection, XFixesSetSelectionOwnerNotifyMask);
+	XFlush(g_x11.display);
+	return true;
+}
+
+static void MonitorThreadProc() {
+	pollfd fds[2] = {
+		{ ConnectionNumber(g_x11.display), POLLIN, 0 },
+		{ g_stopPipe[0], POLLIN, 0 },
+	};
+	for (;;) {
+		// 先处理 Xlib 已缓冲的事件，再阻塞等待
+		while (XPending(g_x11.display) > 0) {
+			XEvent event;
+			XNextEvent(g_x11.display, &event);
+			HandleEvent(event);
+		}
+		if (poll(fds, 2, -1) < 0) {
+			continue;
+		}
+		if (fds[1].revents != 0) {
+			break;
+		}
+	}
+
+	// 未释放的拖拽随监视线程结束，重新启动后的应答按序号丢弃
+	g_dragTracker.Reset();
+	g_resultPaths.reset();
+	XDestroyWindow(g_x11.display, g_x11.window);
+	XCloseDisplay(g_x11.display);
+	g_x11.display = nullptr;
+}
+
+bool X11DragMonitor::Start() {
+	std::lock_guard<std::mutex> lock(g_lifecycleMutex);
+	if (g_monitorThread.joinable()) {
+		return true;
+	}
+	if (!OpenDisplay()) {
+		LOG_ERROR(L"Failed to open X display with XInput2 and XFixes.");
+		return false;
+	}
+	if (pipe(g_stopPipe) != 0) {
+		XDestroyWindow(g_x11.display, g_x11.window);
+		XCloseDisplay(g_x11.display);
+		g_x11.display = nullptr;
+		return false;
+	}
+	g_monitorThread = std::thread(MonitorThreadProc);
+	LOG_INFO(L"X11 drag monitor started.");
+	return true;
+}
+
+void X11DragMonitor::Stop() {
+	std::lock_guard<std::mutex> lock(g_lifecycleMutex);
+	if (!g_monitorThread.joinable()) {
+		return;
+	}
+	char stop = 1;
+	ssize_t written = write(g_stopPipe[1], &stop, 1);
+	(void)written;
+	g_monitorThread.join();
+	close(g_stopPipe[0]);
+	close(g_stopPipe[1]);
+	g_stopPipe[0] = g_stopPipe[1] = -1;
+}
+
+bool X11DragMonitor::IsRunning() {
+	std::lock_guard<std::mutex> lock(g_lifecycleMutex);
+	return g_monitorThread.joinable();
+}
+
+void X11DragMonitor::AddEventSink(DragEventSink sink, void* context) {
+	std::lock_guard<std::mutex> lock(g_sinkMutex);
+	g_sinks.emplace_back(sink, context);
+}
+
+void X11DragMonitor::RemoveEventSink(DragEventSink sink, void* context) {
+	std::lock_guard<std::mutex> lock(g_sinkMutex);
+	for (auto it = g_sinks.begin(); it != g_sinks.end(); ++it) {
+		if (it->first == sink && it->second == context) {
+			g_sinks.erase(it);
+			break;
+		}
+	}
+}
+
+void X11DragMonitor::SetExtensions(const std::set<std::wstring>& extensions) {
+	MatchRuleSet rules;
+	rules.extensions = extensions;
+	SetRules(rules);
+}
+
+void X11DragMonitor::SetRules(const MatchRuleSet& rules) {
+	g_rules.Publish(std::make_shared<const MatchRules>(rules));
+}
+
+void X11DragMonitor::SetMaxPaths(long maxPaths) {
+	g_maxPaths = maxPaths < 0 ? 0 : maxPaths;
+}
+#endif
@@ -0,0 +1,28 @@
+﻿#pragma once
+#ifdef __linux__
+#include <set>
+#include <string>
+#include "DragEvents.h"
+#include "MatchRules.h"
+
+// X11 拖拽监视器：在独立线程上通过 XInput2 原始事件 (XI_RawButtonPress / XI_RawMotion) 跟踪拖拽，
+// 通过 XFixes 监听 XdndSelection 所有者变化，再以 text/uri-list 取得被拖拽的文件并匹配扩展名
+// 线程阻塞在 poll 上，不轮询；事件与 Windows 钩子相同 (DragEvent)，shell 为 DragShellKind::Xdnd，
+// originTicks 为越过拖拽阈值的时间
+class X11DragMonitor
+{
+public:
+	// 打开显示并启动监视线程，已在运行时直接返回 true；DISPLAY 不可用或缺少 XInput2/XFixes 时返回 false
+	static bool Start();
+	static void Stop();
+	static bool IsRunning();
+	// 注册拖拽事件的接收方，sink 在监视线程上调用；注销返回后不会再被调用
+	static void AddEventSink(DragEventSink sink, void* context);
+	static void RemoveEventSink(DragEventSink sink, void* context);
+	static void SetExtensions(const std::set<std::wstring>& extensions);
+	// 替换匹配规则，监视线程不加锁读取
+	static void SetRules(const MatchRuleSet& rules);
+	// 最多返回的匹配路径数，0 表示不限制
+	static void SetMaxPaths(long maxPaths);
+};
+#endif
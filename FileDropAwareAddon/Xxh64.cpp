@@ -0,0 +1,145 @@
+﻿#include "Xxh64.h"
+#include <cstring>
+
+static const uint64_t kPrime1 = 0x9E3779B185EBCA87ull;
+static const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4Full;
+static const uint64_t kPrime3 = 0x165667B19E3779F9ull;
+static const uint64_t kPrime4 = 0x85EBCA77C2B2AE63ull;
+static const uint64_t kPrime5 = 0x27D4EB2F165667C5ull;
+
+static inline uint64_t RotateLeft(uint64_t value, int bits) {
+	return (value << bits) | (value >> (64 - bits));
+}
+
+// 按小端读取，memcpy 会被编译为一次非对齐加载（只支持小端平台：x86、x64 与 ARM64）
+static inline uint64_t Read64(const uint8_t* p) {
+	uint64_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static inline uint32_t Read32(const uint8_t* p) {
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static inline uint64_t Round(uint64_t acc, uint64_t input) {
+	acc += input * kPrime2;
+	acc = RotateLeft(acc, 31);
+	return acc * kPrime1;
+}
+
+static inline uint64_t MergeRound(uint64_t acc, uint64_t value) {
+	acc ^= Round(0, value);
+	return acc * kPrime1 + kPrime4;
+}
+
+// 处理尽可能多的完整 32 字节块，返回处理的字节数
+static size_t ConsumeStripes(uint64_t lanes[4], const uint8_t* p, size_t length) {
+	const uint8_t* const start = p;
+	const uint8_t* const limit = p + (length & ~(size_t)31);
+	uint64_t v1 = lanes[0];
+	uint64_t v2 = lanes[1];
+	uint64_t v3 = lanes[2];
+	uint64_t v4 = lanes[3];
+	while (p < limit) {
+		v1 = Round(v1, Read64(p));
+		v2 = Round(v2, Read64(p + 8));
+		v3 = Round(v3, Read64(p + 16));
+		v4 = Round(v4, Read64(p + 24));
+		p += 32;
+	}
+	lanes[0] = v1;
+	lanes[1] = v2;
+	lanes[2] = v3;
+	lanes[3] = v4;
+	return (size_t)(p - start);
+}
+
+Xxh64::Xxh64(uint64_t seed) {
+	Reset(seed);
+}
+
+void Xxh64::Reset(uint64_t seed) {
+	m_seed = seed;
+	m_lanes[0] = seed + kPrime1 + kPrime2;
+	m_lanes[1] = seed + kPrime2;
+	m_lanes[2] = seed;
+	m_lanes[3] = seed - kPrime1;
+	m_totalLength = 0;
+	m_buffered = 0;
+}
+
+void Xxh64::Update(const void* data, size_t length) {
+	const uint8_t* p = (const uint8_t*)data;
+	m_totalLength += length;
+
+	// 先补满上次剩下的块
+	if (m_buffered > 0) {
+		size_t fill = sizeof(m_buffer) - m_buffered;
+		if (length < fill) {
+			memcpy(m_buffer + m_buffered, p, length);
+			m_buffered += length;
+			return;
+		}
+		memcpy(m_buffer + m_buffered, p, fill);
+		ConsumeStripes(m_lanes, m_buffer, sizeof(m_buffer));
+		p += fill;
+		length -= fill;
+		m_buffered = 0;
+	}
+
+	size_t consumed = ConsumeStripes(m_lanes, p, length);
+	m_buffered = length - consumed;
+	memcpy(m_buffer, p + consumed, m_buffered);
+}
+
+uint64_t Xxh64::Digest() const {
+	uint64_t hash;
+	if (m_totalLength >= 32) {
+		hash = RotateLeft(m_lanes[0], 1) + RotateLeft(m_lanes[1], 7) + RotateLeft(m_lanes[2], 12) + RotateLeft(m_lanes[3], 18);
+		hash = MergeRound(hash, m_lanes[0]);
+		hash = MergeRound(hash, m_lanes[1]);
+		hash = MergeRound(hash, m_lanes[2]);
+		hash = MergeRound(hash, m_lanes[3]);
+	}
+	else {
+		hash = m_seed + kPrime5;
+	}
+	hash += m_totalLength;
+
+	const uint8_t* p = m_buffer;
+	size_t remaining = m_buffered;
+	while (remaining >= 8) {
+		hash ^= Round(0, Read64(p));
+		hash = RotateLeft(hash, 27) * kPrime1 + kPrime4;
+		p += 8;
+		remaining -= 8;
+	}
+	if (remaining >= 4) {
+		hash ^= (uint64_t)Read32(p) * kPrime1;
+		hash = RotateLeft(hash, 23) * kPrime2 + kPrime3;
+		p += 4;
+		remaining -= 4;
+	}
+	while (remaining > 0) {
+		hash ^= (uint64_t)*p * kPrime5;
+		hash = RotateLeft(hash, 11) * kPrime1;
+		p++;
+		remaining--;
+	}
+
+	hash ^= hash >> 33;
+	hash *= kPrime2;
+	hash ^= hash >> 29;
+	hash *= kPrime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+uint64_t Xxh64::Hash(const void* data, size_t length, uint64_t seed) {
+	Xxh64 state(seed);
+	state.Update(data, length);
+	return state.Digest();
+}
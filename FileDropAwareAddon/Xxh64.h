@@ -0,0 +1,26 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// XXH64 的流式实现，结果与参考实现 (xxhash.h 的 XXH64) 一致，可与服务端的 xxhsum -H1 对照
+// 主循环每次处理 32 字节，四条互不依赖的累加链交给 CPU 并行执行；单核约 5 GB/s（2.1GHz Xeon，见 bench/FileHashBench）
+class Xxh64
+{
+public:
+	explicit Xxh64(uint64_t seed = 0);
+
+	void Reset(uint64_t seed = 0);
+	void Update(const void* data, size_t length);
+	// 不改变状态，可以在继续 Update 前多次调用
+	uint64_t Digest() const;
+
+	static uint64_t Hash(const void* data, size_t length, uint64_t seed = 0);
+
+private:
+	uint64_t m_lanes[4];
+	uint64_t m_seed;
+	uint64_t m_totalLength;
+	// 不足 32 字节的尾部
+	uint8_t m_buffer[32];
+	size_t m_buffered;
+};
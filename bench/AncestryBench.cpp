@@ -0,0 +1,168 @@
+﻿#include "Bench.h"
+#include "ShellAncestry.h"
+#include <cwchar>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 窗口祖先链分类：单次遍历 + 类名枚举（WalkShellAncestry），以及按窗口缓存结果（WindowClassifier），
+// 对比旧实现 FindShellParent 与 IsContentArea 各自遍历一次、每层用 wcscmp 逐个比较类名
+// 窗口树是合成的：每层的 GetClassNameW 以复制到 256 宽的缓冲区表示，不含跨进程开销
+
+class SyntheticWindows
+{
+public:
+	DesktopWindow Add(DesktopWindow parent, const wchar_t* className) {
+		m_windows.push_back({ parent, className });
+		return (DesktopWindow)m_windows.size();
+	}
+
+	// 与 GetClassNameW 相同，复制到调用方的缓冲区
+	size_t ClassName(DesktopWindow window, wchar_t* buffer, size_t capacity) const {
+		const std::wstring& name = m_windows[window - 1].className;
+		size_t length = name.size() < capacity - 1 ? name.size() : capacity - 1;
+		wmemcpy(buffer, name.c_str(), length);
+		buffer[length] = L'\0';
+		return length;
+	}
+
+	// WalkShellAncestry 的窗口访问接口
+	ShellClass ClassOf(DesktopWindow window) {
+		wchar_t className[256];
+		size_t length = ClassName(window, className, 256);
+		return ClassifyShellClassName(className, length);
+	}
+	DesktopWindow ParentOf(DesktopWindow window) { return m_windows[window - 1].parent; }
+
+private:
+	struct Window {
+		DesktopWindow parent;
+		std::wstring className;
+	};
+	std::vector<Window> m_windows;
+};
+
+// 旧实现的 IsContentArea
+static bool LegacyIsContentArea(SyntheticWindows& windows, DesktopWindow window) {
+	for (DesktopWindow current = window; current != 0; current = windows.ParentOf(current)) {
+		wchar_t className[256];
+		windows.ClassName(current, className, 256);
+		if (wcscmp(className, L"SearchEditBoxWrapperClass") == 0) return false;
+		if (wcscmp(className, L"Address Band Root") == 0) return false;
+		if (wcscmp(className, L"TravelBand") == 0) return false;
+		if (wcscmp(className, L"SHELLDLL_DefView") == 0) return true;
+		if (wcscmp(className, L"CabinetWClass") == 0) return false;
+		if (wcscmp(className, L"Progman") == 0 || wcscmp(className, L"WorkerW") == 0) return true;
+	}
+	return false;
+}
+
+// 旧实现的 FindShellParent
+static DesktopWindow LegacyFindShellParent(SyntheticWindows& windows, DesktopWindow window, bool& isDesktop) {
+	isDesktop = false;
+	for (DesktopWindow current = window; current != 0; current = windows.ParentOf(current)) {
+		wchar_t className[256];
+		windows.ClassName(current, className, 256);
+		if (wcscmp(className, L"CabinetWClass") == 0) return current;
+		if (wcscmp(className, L"Progman") == 0 || wcscmp(className, L"WorkerW") == 0) {
+			isDesktop = true;
+			return current;
+		}
+	}
+	return 0;
+}
+
+static WindowAncestry LegacyClassify(SyntheticWindows& windows, DesktopWindow window) {
+	WindowAncestry ancestry = { 0, false, false };
+	ancestry.shellWindow = LegacyFindShellParent(windows, window, ancestry.isDesktop);
+	if (ancestry.shellWindow != 0) {
+		ancestry.isContentArea = LegacyIsContentArea(windows, window);
+	}
+	return ancestry;
+}
+
+// 按 Windows 10 Explorer 的实际层级构建，返回拖拽可能落在的叶子窗口
+static void AddExplorer(SyntheticWindows& windows, std::vector<DesktopWindow>& leaves) {
+	DesktopWindow cabinet = windows.Add(0, L"CabinetWClass");
+	DesktopWindow workerW = windows.Add(cabinet, L"WorkerW");
+	DesktopWindow rebar = windows.Add(workerW, L"ReBarWindow32");
+	DesktopWindow address = windows.Add(rebar, L"Address Band Root");
+	DesktopWindow progress = windows.Add(address, L"msctls_progress32");
+	leaves.push_back(windows.Add(progress, L"Breadcrumb Parent"));
+	DesktopWindow tab = windows.Add(cabinet, L"ShellTabWindowClass");
+	DesktopWindow dui = windows.Add(tab, L"DUIViewWndClassName");
+	DesktopWindow outer = windows.Add(dui, L"DirectUIHWND");
+	DesktopWindow sink = windows.Add(outer, L"CtrlNotifySink");
+	DesktopWindow defView = windows.Add(sink, L"SHELLDLL_DefView");
+	leaves.push_back(windows.Add(defView, L"DirectUIHWND"));
+	DesktopWindow navSink = windows.Add(outer, L"CtrlNotifySink");
+	DesktopWindow pane = windows.Add(navSink, L"NamespaceTreeControl");
+	leaves.push_back(windows.Add(pane, L"SysTreeView32"));
+	leaves.push_back(cabinet);
+}
+
+int main(int argc, char** argv) {
+	bool quick = BenchQuick(argc, argv);
+	uint64_t iterations = BenchArg(argc, argv, "iterations", quick ? 20000 : 2000000);
+
+	SyntheticWindows windows;
+	std::vector<DesktopWindow> leaves;
+	for (int i = 0; i < 16; i++) {
+		AddExplorer(windows, leaves);
+	}
+	DesktopWindow progman = windows.Add(0, L"Progman");
+	DesktopWindow defView = windows.Add(progman, L"SHELLDLL_DefView");
+	leaves.push_back(windows.Add(defView, L"SysListView32"));
+	DesktopWindow other = windows.Add(0, L"Chrome_WidgetWin_1");
+	leaves.push_back(windows.Add(other, L"Chrome_RenderWidgetHostHWND"));
+
+	// 两种实现的结果必须一致
+	for (DesktopWindow leaf : leaves) {
+		WindowAncestry expected = LegacyClassify(windows, leaf);
+		WindowAncestry actual;
+		WalkShellAncestry(windows, leaf, actual);
+		if (expected.shellWindow != actual.shellWindow || expected.isDesktop != actual.isDesktop ||
+			expected.isContentArea != actual.isContentArea) {
+			std::fprintf(stderr, "classification mismatch for window %zu\n", (size_t)leaf);
+			return 1;
+		}
+	}
+
+	uint64_t checksum = 0;
+	uint64_t start = BenchNowNanos();
+	for (uint64_t i = 0; i < iterations; i++) {
+		WindowAncestry ancestry = LegacyClassify(windows, leaves[i % leaves.size()]);
+		checksum += ancestry.shellWindow + ancestry.isContentArea;
+	}
+	double legacyNanos = (double)(BenchNowNanos() - start) / iterations;
+
+	start = BenchNowNanos();
+	for (uint64_t i = 0; i < iterations; i++) {
+		WindowAncestry ancestry;
+		WalkShellAncestry(windows, leaves[i % leaves.size()], ancestry);
+		checksum += ancestry.shellWindow + ancestry.isContentArea;
+	}
+	double walkNanos = (double)(BenchNowNanos() - start) / iterations;
+
+	// WindowClassifier：命中缓存时不遍历
+	std::unordered_map<DesktopWindow, WindowAncestry> cache;
+	start = BenchNowNanos();
+	for (uint64_t i = 0; i < iterations; i++) {
+		DesktopWindow leaf = leaves[i % leaves.size()];
+		auto it = cache.find(leaf);
+		if (it == cache.end()) {
+			WindowAncestry ancestry;
+			WalkShellAncestry(windows, leaf, ancestry);
+			it = cache.emplace(leaf, ancestry).first;
+		}
+		checksum += it->second.shellWindow + it->second.isContentArea;
+	}
+	double cachedNanos = (double)(BenchNowNanos() - start) / iterations;
+
+	BenchKeep(checksum);
+	std::printf("%zu leaf windows, %llu classifications\n", leaves.size(), (unsigned long long)iterations);
+	std::printf("%-32s %8.1f ns/classification\n", "two walks + wcscmp", legacyNanos);
+	std::printf("%-32s %8.1f ns/classification\n", "single walk + enum", walkNanos);
+	std::printf("%-32s %8.1f ns/classification\n", "single walk + per-window cache", cachedNanos);
+	return 0;
+}
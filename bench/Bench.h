@@ -0,0 +1,86 @@
+﻿#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// 基准公用的计时与统计工具
+
+static inline uint64_t BenchNowNanos() {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 忙等指定的纳秒数，用于注入固定开销，不受调度器睡眠精度影响
+static inline void BenchSpinNanos(uint64_t nanos) {
+	uint64_t deadline = BenchNowNanos() + nanos;
+	while (BenchNowNanos() < deadline) {
+	}
+}
+
+// 命令行带 --quick 时缩短运行时间，ctest 以此验证基准可以跑通
+static inline bool BenchQuick(int argc, char** argv) {
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--quick") == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// 读取 --name=value 形式的数值参数，不存在时返回 fallback
+static inline uint64_t BenchArg(int argc, char** argv, const char* name, uint64_t fallback) {
+	size_t length = std::strlen(name);
+	for (int i = 1; i < argc; i++) {
+		if (std::strncmp(argv[i], "--", 2) == 0 && std::strncmp(argv[i] + 2, name, length) == 0 && argv[i][2 + length] == '=') {
+			return std::strtoull(argv[i] + 3 + length, nullptr, 10);
+		}
+	}
+	return fallback;
+}
+
+// 阻止编译器优化掉基准中的计算结果
+template <typename T>
+static inline void BenchKeep(const T& value) {
+	static volatile T sink;
+	sink = value;
+	(void)sink;
+}
+
+// 一组延迟样本（纳秒）
+class BenchSamples
+{
+public:
+	void Add(uint64_t nanos) { m_values.push_back(nanos); m_sorted = false; }
+	size_t Count() const { return m_values.size(); }
+	void Merge(const BenchSamples& other) {
+		m_values.insert(m_values.end(), other.m_values.begin(), other.m_values.end());
+		m_sorted = false;
+	}
+
+	// 最近秩法百分位，p 取 0-100
+	uint64_t Percentile(double p) {
+		if (m_values.empty()) {
+			return 0;
+		}
+		if (!m_sorted) {
+			std::sort(m_values.begin(), m_values.end());
+			m_sorted = true;
+		}
+		size_t rank = (size_t)(p / 100.0 * (double)m_values.size() + 0.999999);
+		rank = std::min(std::max(rank, (size_t)1), m_values.size());
+		return m_values[rank - 1];
+	}
+
+	void Print(const char* name) {
+		std::printf("%-32s n=%-7zu p50=%9.1fus p99=%9.1fus max=%9.1fus\n", name, Count(),
+			Percentile(50) / 1000.0, Percentile(99) / 1000.0, Percentile(100) / 1000.0);
+	}
+
+private:
+	std::vector<uint64_t> m_values;
+	bool m_sorted = false;
+};
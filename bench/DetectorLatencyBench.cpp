@@ -0,0 +1,224 @@
+﻿#include "Bench.h"
+#include "CoalescingQueue.h"
+#include "FileDetector.h"
+#include "Logger.h"
+#include "SimulatedDesktop.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// 拖拽到检测结果的延迟：每次拖拽新建线程并初始化后端（旧实现），对比常驻检测线程加合并队列
+// 后端为模拟桌面，COM 初始化和创建 UIA / ShellWindows 对象的开销以 --setup-us 注入（默认 2000us）
+
+static const DesktopPoint kItemPoint = { 310, 150 };
+
+struct DetectRequest {
+	uint64_t sequence;
+	uint64_t submitNanos;
+};
+
+// 每个后端实例构建同样的桌面：一个 Explorer 窗口，选中 20 项，其中一项匹配
+static DesktopWindow BuildDesktop(SimulatedDesktop& desktop) {
+	DesktopWindow content = 0;
+	desktop.AddDesktop({ 0, 0, 1920, 1080 });
+	DesktopWindow explorer = desktop.AddExplorerWindow({ 100, 100, 1100, 800 }, &content);
+	desktop.AddFileItem(content, { 300, 148, 1100, 170 });
+	desktop.SetLatency(SimulatedCall::HitTest, 200);
+	desktop.SetLatency(SimulatedCall::FindView, 50);
+	desktop.SetLatency(SimulatedCall::ItemPath, 2);
+	return explorer;
+}
+
+// 每次检测前替换选中项，使两种方式都走完整的扫描而不是命中选中项缓存
+static ScanVerdict Detect(SimulatedDesktop& desktop, DesktopWindow explorer) {
+	std::vector<SimulatedItem> selection;
+	for (int i = 0; i < 20; i++) {
+		selection.push_back({ L"C:\\Work\\drawing" + std::to_wstring(i) + (i == 19 ? L".pdf" : L".dwg"), false });
+	}
+	desktop.SetSelection(explorer, selection);
+	DragTarget target;
+	SelectionMatch match = {};
+	return FileDetector::IsDraggingSupportedFile(kItemPoint, target, match);
+}
+
+// 旧实现：每次拖拽一个线程，线程内初始化后端，检测期间到达的请求被丢弃
+class ThreadPerDrag
+{
+public:
+	explicit ThreadPerDrag(uint64_t setupNanos) : m_setupNanos(setupNanos), m_checking(false) {}
+
+	// 返回 false 表示请求因正在检测而被丢弃
+	bool Submit(const DetectRequest& request, std::atomic<uint64_t>& verdictSequence, BenchSamples& samples) {
+		if (m_checking.exchange(true)) {
+			return false;
+		}
+		if (m_thread.joinable()) {
+			m_thread.join();
+		}
+		m_thread = std::thread([this, request, &verdictSequence, &samples]() {
+			BenchSpinNanos(m_setupNanos);
+			SimulatedDesktop desktop;
+			DesktopWindow explorer = BuildDesktop(desktop);
+			FileDetector::SetThreadBackend(&desktop);
+			if (Detect(desktop, explorer) == ScanVerdict::Match) {
+				samples.Add(BenchNowNanos() - request.submitNanos);
+			}
+			FileDetector::SetThreadBackend(NULL);
+			m_checking = false;
+			verdictSequence = request.sequence;
+		});
+		return true;
+	}
+
+	void Join() {
+		if (m_thread.joinable()) {
+			m_thread.join();
+		}
+	}
+
+private:
+	uint64_t m_setupNanos;
+	std::atomic<bool> m_checking;
+	std::thread m_thread;
+};
+
+// 新实现：常驻线程只初始化一次后端，请求进入合并队列
+class PersistentWorker
+{
+public:
+	PersistentWorker(uint64_t setupNanos, std::atomic<uint64_t>& verdictSequence, BenchSamples& samples)
+		: m_stop(false), m_signaled(false), m_verdictSequence(verdictSequence), m_samples(samples) {
+		m_thread = std::thread([this, setupNanos]() { Run(setupNanos); });
+	}
+
+	~PersistentWorker() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_wake.notify_one();
+		m_thread.join();
+	}
+
+	void Submit(const DetectRequest& request) {
+		m_queue.Push(request);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_signaled = true;
+		}
+		m_wake.notify_one();
+	}
+
+	unsigned long long CoalescedCount() const { return m_queue.CoalescedCount(); }
+
+private:
+	void Run(uint64_t setupNanos) {
+		BenchSpinNanos(setupNanos);
+		SimulatedDesktop desktop;
+		DesktopWindow explorer = BuildDesktop(desktop);
+		FileDetector::SetThreadBackend(&desktop);
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_wake.wait(lock, [this]() { return m_stop || m_signaled; });
+				if (m_stop) {
+					break;
+				}
+				m_signaled = false;
+			}
+			DetectRequest request;
+			while (m_queue.TakeLatest(request)) {
+				if (Detect(desktop, explorer) == ScanVerdict::Match) {
+					m_samples.Add(BenchNowNanos() - request.submitNanos);
+				}
+				m_verdictSequence = request.sequence;
+			}
+		}
+		FileDetector::SetThreadBackend(NULL);
+	}
+
+	CoalescingQueue<DetectRequest, 8> m_queue;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	bool m_stop;
+	bool m_signaled;
+	std::atomic<uint64_t>& m_verdictSequence;
+	BenchSamples& m_samples;
+	std::thread m_thread;
+};
+
+static void WaitForVerdict(std::atomic<uint64_t>& verdictSequence, uint64_t sequence) {
+	while (verdictSequence.load() < sequence) {
+		std::this_thread::yield();
+	}
+}
+
+int main(int argc, char** argv) {
+	bool quick = BenchQuick(argc, argv);
+	uint64_t drags = BenchArg(argc, argv, "drags", quick ? 50 : 1000);
+	uint64_t setupNanos = BenchArg(argc, argv, "setup-us", 2000) * 1000;
+	// 连续拖拽：每组内相邻请求间隔 100us，间隔短于一次检测
+	const int kBurst = 4;
+	const uint64_t kBurstGapNanos = 100 * 1000;
+
+	Logger::SetLevel(LogLevel::Off);
+	FileDetector::SetExtensions({ L".pdf" });
+	std::printf("drags=%llu setup=%lluus\n", (unsigned long long)drags, (unsigned long long)(setupNanos / 1000));
+
+	uint64_t sequence = 0;
+	{
+		BenchSamples samples;
+		std::atomic<uint64_t> verdictSequence(0);
+		ThreadPerDrag detector(setupNanos);
+		for (uint64_t i = 0; i < drags; i++) {
+			sequence++;
+			detector.Submit({ sequence, BenchNowNanos() }, verdictSequence, samples);
+			WaitForVerdict(verdictSequence, sequence);
+		}
+		detector.Join();
+		samples.Print("thread per drag");
+
+		// 连续拖拽：统计最新请求没有得到结果的组数
+		unsigned long long lost = 0;
+		for (uint64_t i = 0; i < drags / kBurst; i++) {
+			bool newestAccepted = false;
+			for (int j = 0; j < kBurst; j++) {
+				sequence++;
+				newestAccepted = detector.Submit({ sequence, BenchNowNanos() }, verdictSequence, samples);
+				BenchSpinNanos(kBurstGapNanos);
+			}
+			detector.Join();
+			if (!newestAccepted) {
+				lost++;
+			}
+		}
+		std::printf("%-32s %llu of %llu bursts lost the newest request\n", "thread per drag", lost,
+			(unsigned long long)(drags / kBurst));
+	}
+
+	{
+		BenchSamples samples;
+		std::atomic<uint64_t> verdictSequence(0);
+		PersistentWorker worker(setupNanos, verdictSequence, samples);
+		for (uint64_t i = 0; i < drags; i++) {
+			sequence++;
+			worker.Submit({ sequence, BenchNowNanos() });
+			WaitForVerdict(verdictSequence, sequence);
+		}
+		samples.Print("persistent worker");
+
+		// 合并队列保证每组最新的请求一定得到结果
+		for (uint64_t i = 0; i < drags / kBurst; i++) {
+			for (int j = 0; j < kBurst; j++) {
+				sequence++;
+				worker.Submit({ sequence, BenchNowNanos() });
+				BenchSpinNanos(kBurstGapNanos);
+			}
+			WaitForVerdict(verdictSequence, sequence);
+		}
+		std::printf("%-32s 0 of %llu bursts lost the newest request, %llu requests coalesced\n", "persistent worker",
+			(unsigned long long)(drags / kBurst), worker.CoalescedCount());
+	}
+	return 0;
+}
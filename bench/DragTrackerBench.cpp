@@ -0,0 +1,119 @@
+﻿#include "Bench.h"
+#include "DragTracker.h"
+#include <cstdlib>
+#include <random>
+
+// DragTracker 每秒可处理的指针输入数；对照为原 MouseHookProc 基于全局变量的判断
+
+template <uint32_t Buttons>
+struct CountingPolicy {
+	static const uint32_t kButtons = Buttons;
+	uint64_t actions = 0;
+	int ThresholdX() const { return 4; }
+	int ThresholdY() const { return 4; }
+	void OnPress(uint32_t, int32_t, int32_t) { actions++; }
+	void OnDragStart(uint32_t, int32_t, int32_t) { actions++; }
+	void OnRelease(uint32_t, int32_t, int32_t) { actions++; }
+	void OnCancel(uint32_t) { actions++; }
+};
+
+// 原实现：只处理左键，状态分散在四个变量中
+struct LegacyState {
+	bool down = false;
+	bool dragging = false;
+	bool detectionCalled = false;
+	int32_t startX = 0;
+	int32_t startY = 0;
+	uint64_t actions = 0;
+
+	void Feed(const PointerInput& input) {
+		if (input.action == PointerAction::Down && input.button == kDragButtonLeft) {
+			down = true;
+			dragging = false;
+			detectionCalled = false;
+			startX = input.x;
+			startY = input.y;
+		}
+		else if (input.action == PointerAction::Move && down) {
+			if (!dragging && (std::abs(input.x - startX) >= 4 || std::abs(input.y - startY) >= 4)) {
+				dragging = true;
+			}
+			if (dragging && !detectionCalled) {
+				detectionCalled = true;
+				actions++;
+			}
+		}
+		else if (input.action == PointerAction::Up && input.button == kDragButtonLeft) {
+			if (dragging && detectionCalled) {
+				actions++;
+			}
+			down = false;
+			dragging = false;
+			detectionCalled = false;
+		}
+	}
+};
+
+static std::vector<PointerInput> GenerateInputs(size_t count) {
+	std::mt19937 random(15);
+	std::vector<PointerInput> inputs;
+	inputs.reserve(count);
+	int32_t x = 800;
+	int32_t y = 600;
+	bool down = false;
+	DragButton button = kDragButtonLeft;
+	for (size_t i = 0; i < count; i++) {
+		uint32_t roll = random() % 100;
+		if (!down && roll < 2) {
+			button = roll == 0 ? kDragButtonRight : (random() % 8 == 0 ? kDragButtonPen : kDragButtonLeft);
+			inputs.push_back({ PointerAction::Down, button, x, y });
+			down = true;
+		}
+		else if (down && roll < 10) {
+			inputs.push_back({ PointerAction::Up, button, x, y });
+			down = false;
+		}
+		else {
+			x += (int32_t)(random() % 9) - 4;
+			y += (int32_t)(random() % 9) - 4;
+			inputs.push_back({ PointerAction::Move, kDragButtonLeft, x, y });
+		}
+	}
+	return inputs;
+}
+
+template <typename Feeder>
+static double EventsPerSecond(const std::vector<PointerInput>& inputs, uint64_t events, Feeder&& feed) {
+	uint64_t start = BenchNowNanos();
+	size_t index = 0;
+	for (uint64_t i = 0; i < events; i++) {
+		feed(inputs[index]);
+		index = index + 1 == inputs.size() ? 0 : index + 1;
+	}
+	return (double)events * 1e9 / (double)(BenchNowNanos() - start);
+}
+
+int main(int argc, char** argv) {
+	bool quick = BenchQuick(argc, argv);
+	uint64_t events = BenchArg(argc, argv, "events", quick ? 1000000 : 500000000);
+	// 输入放在 L2 内，测量的是状态机本身
+	std::vector<PointerInput> inputs = GenerateInputs(16384);
+
+	DragTracker<CountingPolicy<kDragButtonLeft>> left;
+	double leftRate = EventsPerSecond(inputs, events, [&](const PointerInput& input) { left.Feed(input); });
+	BenchKeep(left.GetPolicy().actions);
+
+	DragTracker<CountingPolicy<kDragButtonLeft | kDragButtonRight | kDragButtonPen>> multi;
+	double multiRate = EventsPerSecond(inputs, events, [&](const PointerInput& input) { multi.Feed(input); });
+	BenchKeep(multi.GetPolicy().actions);
+
+	LegacyState legacy;
+	double legacyRate = EventsPerSecond(inputs, events, [&](const PointerInput& input) { legacy.Feed(input); });
+	BenchKeep(legacy.actions);
+
+	std::printf("events=%llu\n", (unsigned long long)events);
+	std::printf("DragTracker, left:             %.0f M events/s\n", leftRate / 1e6);
+	std::printf("DragTracker, left+right+pen:   %.0f M events/s\n", multiRate / 1e6);
+	std::printf("legacy globals, left:          %.0f M events/s\n", legacyRate / 1e6);
+	return 0;
+}
@@ -0,0 +1,66 @@
+'use strict';
+// 拖拽事件风暴：后台线程连续投递事件，统计 JS 每秒收到的事件数、丢弃数和 GC 次数
+// 用法：node EventStormBench.js <EventStormModule.node> [--quick] [--events=N]
+const { PerformanceObserver } = require('perf_hooks');
+
+const args = process.argv.slice(2);
+const addon = require(require('path').resolve(args[0]));
+const quick = args.includes('--quick');
+const eventsArg = args.find((arg) => arg.startsWith('--events='));
+const total = eventsArg ? Number(eventsArg.slice(9)) : (quick ? 20000 : 1000000);
+
+let gcCount = 0;
+let gcMillis = 0;
+const observer = new PerformanceObserver((list) => {
+	for (const entry of list.getEntries()) {
+		gcCount++;
+		gcMillis += entry.duration;
+	}
+});
+observer.observe({ entryTypes: ['gc'] });
+
+let received = 0;
+let checksum = 0;
+function onEvent(event) {
+	received++;
+	checksum += typeof event === 'string' ? event.length : event.x + event.paths.length;
+}
+
+function waitFor(condition) {
+	return new Promise((resolve) => {
+		const poll = () => (condition() ? resolve() : setImmediate(poll));
+		poll();
+	});
+}
+
+async function run(name, start, dropped) {
+	received = 0;
+	gcCount = 0;
+	gcMillis = 0;
+	const droppedBefore = dropped();
+	const heapBefore = process.memoryUsage().heapUsed;
+	const begin = process.hrtime.bigint();
+	start();
+	await waitFor(() => addon.Finished() && received + dropped() - droppedBefore >= total);
+	const seconds = Number(process.hrtime.bigint() - begin) / 1e9;
+	// 等待挂起的 GC 条目送达
+	await new Promise((resolve) => setTimeout(resolve, 50));
+	const heapAfter = process.memoryUsage().heapUsed;
+	console.log(`${name.padEnd(36)} ${(received / seconds / 1e6).toFixed(2)} M events/s delivered, ` +
+		`dropped ${dropped() - droppedBefore}, gc ${gcCount} (${gcMillis.toFixed(1)} ms), ` +
+		`heap ${((heapAfter - heapBefore) / 1048576).toFixed(1)} MB`);
+}
+
+(async () => {
+	addon.Bind(onEvent, () => {});
+	console.log(`events=${total}`);
+	await run('event objects, no paths', () => addon.Storm(total, 0), addon.Dropped);
+	await run('event objects, 3 paths', () => addon.Storm(total, 3), addon.Dropped);
+	await run('message id strings (old)', () => addon.StormMessages(onEvent, total), () => 0);
+	observer.disconnect();
+	if (checksum === 0) {
+		process.exitCode = 1;
+	}
+	// 线程安全函数在绑定后保持事件循环存活，测量结束后直接退出
+	process.exit();
+})();
@@ -0,0 +1,159 @@
+﻿#include <node_api.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include "AddonInstance.h"
+#include "PipelineStats.h"
+
+// EventStormBench.js 使用的测试模块：用 AddonInstance 的真实投递路径（有界队列 + 线程安全函数 + 事件对象）
+// 从后台线程向 JS 连续投递拖拽事件；另提供旧实现的对照：每个事件一次线程安全函数调用，参数为新建的消息号字符串
+
+static std::thread g_producer;
+static std::atomic<bool> g_finished(true);
+
+static size_t GetArgs(napi_env env, napi_callback_info info, napi_value* args, size_t count) {
+	size_t argc = count;
+	napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+	return argc;
+}
+
+static uint32_t GetUint32(napi_env env, napi_value value) {
+	uint32_t result = 0;
+	napi_get_value_uint32(env, value, &result);
+	return result;
+}
+
+static void JoinProducer() {
+	if (g_producer.joinable()) {
+		g_producer.join();
+	}
+}
+
+// Bind(onEvent, onLog)
+static napi_value Bind(napi_env env, napi_callback_info info) {
+	napi_value args[2];
+	GetArgs(env, info, args, 2);
+	AddonInstance::Get(env)->Bind(env, args[0], args[1]);
+	return nullptr;
+}
+
+// Storm(count, pathCount)：队列满时生产方稍作等待，投递速度由 JS 线程的处理能力决定
+static napi_value Storm(napi_env env, napi_callback_info info) {
+	napi_value args[2];
+	GetArgs(env, info, args, 2);
+	uint32_t count = GetUint32(env, args[0]);
+	uint32_t pathCount = GetUint32(env, args[1]);
+	AddonInstance* instance = AddonInstance::Get(env);
+
+	std::shared_ptr<MatchedPaths> paths = std::make_shared<MatchedPaths>(0);
+	for (uint32_t i = 0; i < pathCount; i++) {
+		std::wstring path = L"C:\\Users\\me\\Documents\\Drawings\\plan-" + std::to_wstring(i) + L".dwg";
+		paths->Add(path.c_str(), path.size());
+	}
+
+	JoinProducer();
+	g_finished = false;
+	g_producer = std::thread([instance, count, paths]() {
+		unsigned long long dropped = instance->DroppedEvents();
+		for (uint32_t i = 0; i < count; i++) {
+			DragEvent event;
+			event.kind = (i & 1) == 0 ? DragEventKind::Supported : DragEventKind::Released;
+			event.ticks = PipelineStats::Now();
+			event.originTicks = event.ticks;
+			event.x = (int32_t)(i % 1920);
+			event.y = (int32_t)(i % 1080);
+			event.shell = DragShellKind::Explorer;
+			event.matchCount = (long)paths->Count();
+			event.paths = paths;
+			AddonInstance::OnDragEvent(instance, event);
+			unsigned long long now = instance->DroppedEvents();
+			if (now != dropped) {
+				dropped = now;
+				std::this_thread::sleep_for(std::chrono::microseconds(50));
+			}
+		}
+		g_finished = true;
+	});
+	return nullptr;
+}
+
+static void CallMessageJs(napi_env env, napi_value callback, void* context, void* data) {
+	if (env == nullptr) {
+		return;
+	}
+	// 旧实现：std::to_string(WM_PERFORM_DRAG_CHECK) 作为参数
+	std::string message = std::to_string((unsigned)(uintptr_t)data);
+	napi_value argument;
+	napi_value global;
+	napi_create_string_utf8(env, message.c_str(), message.size(), &argument);
+	napi_get_global(env, &global);
+	napi_call_function(env, global, callback, 1, &argument, nullptr);
+}
+
+// StormMessages(callback, count)
+static napi_value StormMessages(napi_env env, napi_callback_info info) {
+	napi_value args[2];
+	GetArgs(env, info, args, 2);
+	uint32_t count = GetUint32(env, args[1]);
+	napi_value name;
+	napi_create_string_utf8(env, "EventStorm.messages", NAPI_AUTO_LENGTH, &name);
+	napi_threadsafe_function function;
+	if (napi_create_threadsafe_function(env, args[0], nullptr, name, 0, 1, nullptr, nullptr, nullptr,
+		CallMessageJs, &function) != napi_ok) {
+		napi_throw_error(env, nullptr, "napi_create_threadsafe_function failed");
+		return nullptr;
+	}
+
+	JoinProducer();
+	g_finished = false;
+	g_producer = std::thread([function, count]() {
+		for (uint32_t i = 0; i < count; i++) {
+			// WM_USER + 1 / WM_USER + 2
+			uintptr_t message = 0x0400 + 1 + (i & 1);
+			napi_call_threadsafe_function(function, (void*)message, napi_tsfn_blocking);
+		}
+		napi_release_threadsafe_function(function, napi_tsfn_release);
+		g_finished = true;
+	});
+	return nullptr;
+}
+
+// Finished() -> boolean，生产方结束后回收线程
+static napi_value Finished(napi_env env, napi_callback_info info) {
+	bool finished = g_finished.load();
+	if (finished) {
+		JoinProducer();
+	}
+	napi_value result;
+	napi_get_boolean(env, finished, &result);
+	return result;
+}
+
+static napi_value Dropped(napi_env env, napi_callback_info info) {
+	napi_value result;
+	napi_create_double(env, (double)AddonInstance::Get(env)->DroppedEvents(), &result);
+	return result;
+}
+
+static void OnEnvCleanup(void* arg) {
+	JoinProducer();
+	static_cast<AddonInstance*>(arg)->Close();
+}
+
+NAPI_MODULE_INIT() {
+	AddonInstance* instance = AddonInstance::Create(env);
+	if (instance == nullptr) {
+		napi_throw_error(env, nullptr, "AddonInstance::Create failed");
+		return nullptr;
+	}
+	napi_add_env_cleanup_hook(env, OnEnvCleanup, instance);
+	const napi_property_descriptor methods[] = {
+		{ "Bind", nullptr, Bind, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "Storm", nullptr, Storm, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "StormMessages", nullptr, StormMessages, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "Finished", nullptr, Finished, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+		{ "Dropped", nullptr, Dropped, nullptr, nullptr, nullptr, napi_enumerable, nullptr },
+	};
+	napi_define_properties(env, exports, sizeof(methods) / sizeof(methods[0]), methods);
+	return exports;
+}
@@ -0,0 +1,96 @@
+﻿#include "Bench.h"
+#include "ExtensionMatcher.h"
+#include <algorithm>
+#include <cwchar>
+#include <cwctype>
+#include <set>
+#include <string>
+#include <vector>
+
+// 扩展名匹配：ExtensionMatcher 对比旧实现（PathFindExtensionW 取最后一段扩展名、复制为 std::wstring、
+// towlower 后在 std::set 中查找）；路径为随机生成的典型文件名，约 1/4 匹配
+
+// 与 PathFindExtensionW 相同：文件名中最后一个 '.' 开始的部分，没有时返回末尾
+static const wchar_t* FindExtension(const wchar_t* path) {
+	const wchar_t* extension = nullptr;
+	for (const wchar_t* p = path; *p != L'\0'; p++) {
+		if (*p == L'\\' || *p == L'/' || *p == L':') {
+			extension = nullptr;
+		}
+		else if (*p == L'.') {
+			extension = p;
+		}
+		else if (*p == L' ') {
+			extension = nullptr;
+		}
+	}
+	return extension != nullptr ? extension : path + wcslen(path);
+}
+
+static bool LegacyMatches(const std::set<std::wstring>& extensions, const std::wstring& path) {
+	std::wstring extension(FindExtension(path.c_str()));
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::towlower);
+	return extensions.count(extension) > 0;
+}
+
+static std::vector<std::wstring> MakePaths(size_t count) {
+	static const wchar_t* kDirectories[] = {
+		L"C:\\Users\\zhang\\Documents\\项目资料\\2024\\",
+		L"C:\\Users\\zhang\\Desktop\\",
+		L"D:\\CAD\\Drawings\\Building-A\\Floor 3\\",
+		L"\\\\fileserver\\share\\Engineering\\Releases\\v2.1\\",
+	};
+	static const wchar_t* kExtensions[] = {
+		L".dwg", L".PDF", L".docx", L".xlsx", L".png", L".JPG", L".tmp", L".tar.gz", L".d.ts", L".bak", L"", L".7z",
+	};
+	uint64_t state = 0x9e3779b97f4a7c15ull;
+	std::vector<std::wstring> paths;
+	paths.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		state = state * 6364136223846793005ull + 1442695040888963407ull;
+		const wchar_t* directory = kDirectories[(state >> 33) % 4];
+		const wchar_t* extension = kExtensions[(state >> 40) % 12];
+		paths.push_back(std::wstring(directory) + L"Drawing_" + std::to_wstring((state >> 20) % 100000) + extension);
+	}
+	return paths;
+}
+
+int main(int argc, char** argv) {
+	bool quick = BenchQuick(argc, argv);
+	size_t count = (size_t)BenchArg(argc, argv, "paths", quick ? 100000 : 4000000);
+
+	std::set<std::wstring> configured = { L".dwg", L".dxf", L".pdf", L".step", L".stp", L".iges", L".tar.gz" };
+	ExtensionMatcher matcher(configured);
+	std::vector<std::wstring> paths = MakePaths(count);
+
+	// 单段扩展名时两者的结果必须一致（旧实现不支持 .tar.gz，单独统计）
+	size_t legacyMatches = 0;
+	size_t matcherMatches = 0;
+	uint64_t start = BenchNowNanos();
+	for (const std::wstring& path : paths) {
+		legacyMatches += LegacyMatches(configured, path);
+	}
+	double legacyNanos = (double)(BenchNowNanos() - start) / count;
+
+	start = BenchNowNanos();
+	for (const std::wstring& path : paths) {
+		matcherMatches += matcher.Matches(path);
+	}
+	double matcherNanos = (double)(BenchNowNanos() - start) / count;
+
+	size_t compound = 0;
+	for (const std::wstring& path : paths) {
+		if (path.size() >= 7 && path.compare(path.size() - 7, 7, L".tar.gz") == 0) {
+			compound++;
+		}
+	}
+	if (matcherMatches != legacyMatches + compound) {
+		std::fprintf(stderr, "match count mismatch: %zu vs %zu + %zu\n", matcherMatches, legacyMatches, compound);
+		return 1;
+	}
+
+	std::printf("%zu paths, %zu matches (%zu .tar.gz only found by the matcher)\n", count, matcherMatches, compound);
+	std::printf("%-32s %8.1f ns/path\n", "std::set + towlower", legacyNanos);
+	std::printf("%-32s %8.1f ns/path\n", "ExtensionMatcher", matcherNanos);
+	return 0;
+}
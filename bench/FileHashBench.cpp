@@ -0,0 +1,128 @@
+﻿#include "Bench.h"
+#include "FileHasher.h"
+#include "Xxh64.h"
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+// 拖拽期间后台哈希的吞吐：先测单核 XXH64 在内存中的上限，再用 FileHasher 哈希 --files 个共 --size MB 的
+// 临时文件（默认 4 个共 4096MB，--quick 时 64MB），文件刚写入，通常在页缓存中，测的是映射与计算而不是磁盘
+// --dir 指定临时文件所在的目录（默认系统临时目录），--keep 时保留文件供下次运行
+
+struct Completion {
+	std::mutex mutex;
+	std::condition_variable done;
+	bool finished = false;
+
+	static void Callback(void* context, const std::shared_ptr<HashJob>&) {
+		Completion* completion = static_cast<Completion*>(context);
+		std::lock_guard<std::mutex> lock(completion->mutex);
+		completion->finished = true;
+		completion->done.notify_all();
+	}
+};
+
+static bool HasFlag(int argc, char** argv, const char* flag) {
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], flag) == 0) return true;
+	}
+	return false;
+}
+
+static const char* StringArg(int argc, char** argv, const char* prefix) {
+	size_t length = std::strlen(prefix);
+	for (int i = 1; i < argc; i++) {
+		if (std::strncmp(argv[i], prefix, length) == 0) return argv[i] + length;
+	}
+	return nullptr;
+}
+
+// 写入伪随机内容，已存在且大小相同的文件直接复用
+static void PrepareFile(const std::filesystem::path& path, uint64_t size, uint32_t seed) {
+	std::error_code error;
+	if (std::filesystem::file_size(path, error) == size && !error) {
+		return;
+	}
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	std::vector<uint32_t> block(1024 * 1024);
+	std::mt19937 random(seed);
+	for (uint32_t& value : block) value = random();
+	for (uint64_t written = 0; written < size;) {
+		// 每个块的第一个字写入块序号，避免各块内容相同
+		block[0] = (uint32_t)(written >> 22);
+		uint64_t chunk = std::min<uint64_t>(block.size() * sizeof(uint32_t), size - written);
+		out.write((const char*)block.data(), (std::streamsize)chunk);
+		written += chunk;
+	}
+}
+
+static void MeasureMemory(uint64_t bytes) {
+	std::vector<uint8_t> buffer((size_t)std::min<uint64_t>(bytes, 256ull * 1024 * 1024));
+	for (size_t i = 0; i < buffer.size(); i++) buffer[i] = (uint8_t)(i * 131);
+	uint64_t total = 0;
+	uint64_t start = BenchNowNanos();
+	while (total < bytes) {
+		BenchKeep(Xxh64::Hash(buffer.data(), buffer.size()));
+		total += buffer.size();
+	}
+	double seconds = (BenchNowNanos() - start) / 1e9;
+	std::printf("%-32s %8.2f GB/s\n", "XXH64, one core, in memory", total / seconds / 1e9);
+}
+
+int main(int argc, char** argv) {
+	bool quick = BenchQuick(argc, argv);
+	uint64_t files = BenchArg(argc, argv, "files", 4);
+	uint64_t totalBytes = BenchArg(argc, argv, "size", quick ? 64 : 4096) * 1024 * 1024;
+	uint64_t fileBytes = files == 0 ? 0 : totalBytes / files;
+	const char* dir = StringArg(argc, argv, "--dir=");
+	bool keep = HasFlag(argc, argv, "--keep");
+	std::printf("files=%llu size=%lluMB\n", (unsigned long long)files, (unsigned long long)(totalBytes >> 20));
+
+	MeasureMemory(quick ? 64ull << 20 : 4ull << 30);
+
+	std::filesystem::path directory = dir != nullptr ? std::filesystem::path(dir) : std::filesystem::temp_directory_path() / "filedrop-hash-bench";
+	std::filesystem::create_directories(directory);
+	std::shared_ptr<MatchedPaths> paths = std::make_shared<MatchedPaths>(0);
+	std::vector<std::filesystem::path> created;
+	for (uint64_t i = 0; i < files; i++) {
+		std::filesystem::path path = directory / ("file" + std::to_string(i) + ".bin");
+		PrepareFile(path, fileBytes, (uint32_t)i);
+		created.push_back(path);
+		std::wstring wide = path.wstring();
+		paths->Add(wide.c_str(), wide.size());
+	}
+
+	// 第一轮预热页缓存，第二轮计时
+	double seconds = 0;
+	for (int round = 0; round < 2; round++) {
+		Completion completion;
+		uint64_t start = BenchNowNanos();
+		std::shared_ptr<HashJob> job = FileHasher::Begin(paths, Completion::Callback, &completion);
+		if (!job->Seal()) {
+			std::unique_lock<std::mutex> lock(completion.mutex);
+			completion.done.wait(lock, [&completion]() { return completion.finished; });
+		}
+		seconds = (BenchNowNanos() - start) / 1e9;
+		for (size_t i = 0; i < job->Count(); i++) {
+			if (job->Get(i).status != HashStatus::Done) {
+				std::printf("file %zu was not hashed\n", i);
+				return 1;
+			}
+		}
+	}
+	std::string name = "FileHasher, " + std::to_string(files) + " files, page cache";
+	std::printf("%-32s %8.2f GB/s  (%.2fs for %lluMB)\n", name.c_str(), totalBytes / seconds / 1e9, seconds,
+		(unsigned long long)(totalBytes >> 20));
+
+	FileHasher::Stop();
+	if (!keep) {
+		for (const std::filesystem::path& path : created) std::filesystem::remove(path);
+		if (dir == nullptr) std::filesystem::remove(directory);
+	}
+	return 0;
+}
@@ -0,0 +1,37 @@
+﻿#include "Bench.h"
+#include "HookWatchdog.h"
+#include "PipelineStats.h"
+
+// 钩子过程每次调用的计时开销：Enter + Exit，时钟与 MouseHook 相同（Windows 上为 QueryPerformanceCounter，
+// 这里为 CLOCK_MONOTONIC）
+
+struct MonotonicClock {
+	uint64_t Now() const { return (uint64_t)PipelineStats::Now(); }
+	uint64_t FromMillis(uint32_t ms) const { return (uint64_t)ms * (uint64_t)PipelineStats::TicksPerSecond() / 1000; }
+};
+
+int main(int argc, char** argv) {
+	bool quick = BenchQuick(argc, argv);
+	uint64_t calls = BenchArg(argc, argv, "calls", quick ? 200000 : 50000000);
+
+	HookWatchdog<MonotonicClock> watchdog;
+	uint64_t start = BenchNowNanos();
+	for (uint64_t i = 0; i < calls; i++) {
+		uint64_t enter = watchdog.Enter();
+		watchdog.Exit(enter, 0);
+	}
+	double perCall = (double)(BenchNowNanos() - start) / (double)calls;
+	HookHealth health = watchdog.Health();
+	BenchKeep(health.calls);
+
+	start = BenchNowNanos();
+	for (uint64_t i = 0; i < calls; i++) {
+		BenchKeep(watchdog.Check(false));
+	}
+	double perCheck = (double)(BenchNowNanos() - start) / (double)calls;
+
+	std::printf("calls=%llu, overruns=%llu\n", (unsigned long long)health.calls, (unsigned long long)health.overruns);
+	std::printf("Enter + Exit: %.1f ns per hook call\n", perCall);
+	std::printf("Check:        %.1f ns\n", perCheck);
+	return 0;
+}
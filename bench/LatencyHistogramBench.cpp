@@ -0,0 +1,78 @@
+﻿#include "Bench.h"
+#include "LatencyHistogram.h"
+#include "PipelineStats.h"
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 各阶段常开计时的开销：每次 Record、每个 StageTimer（两次取时间戳 + Record），
+// 以及多个线程同时记录同一阶段时的开销；对照为加锁追加样本的做法
+
+class LockedSamples
+{
+public:
+	void Record(uint64_t micros) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_values.push_back(micros);
+	}
+	size_t Count() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_values.size();
+	}
+private:
+	std::mutex m_mutex;
+	std::vector<uint64_t> m_values;
+};
+
+template <typename Recorder>
+static double NanosPerRecord(Recorder& recorder, unsigned threads, uint64_t perThread) {
+	std::vector<std::thread> workers;
+	uint64_t start = BenchNowNanos();
+	for (unsigned t = 0; t < threads; t++) {
+		workers.emplace_back([&recorder, perThread, t]() {
+			uint64_t value = 17 + t;
+			for (uint64_t i = 0; i < perThread; i++) {
+				// 模拟 1 微秒到约 1 秒的分布
+				value = value * 6364136223846793005ull + 1442695040888963407ull;
+				recorder.Record((value >> 44) + 1);
+			}
+		});
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	return (double)(BenchNowNanos() - start) / (double)(threads * perThread);
+}
+
+int main(int argc, char** argv) {
+	bool quick = BenchQuick(argc, argv);
+	uint64_t iterations = BenchArg(argc, argv, "iterations", quick ? 200000 : 20000000);
+	unsigned threads = (unsigned)BenchArg(argc, argv, "threads", 4);
+
+	for (unsigned count : { 1u, threads }) {
+		LatencyHistogram histogram;
+		double histogramNanos = NanosPerRecord(histogram, count, iterations / count);
+		BenchKeep(histogram.Summarize(true).count);
+		LockedSamples locked;
+		double lockedNanos = NanosPerRecord(locked, count, iterations / count);
+		BenchKeep(locked.Count());
+		std::printf("Record, %u thread(s): histogram %.1f ns, mutex + vector %.1f ns\n",
+			count, histogramNanos, lockedNanos);
+	}
+
+	uint64_t start = BenchNowNanos();
+	for (uint64_t i = 0; i < iterations; i++) {
+		StageTimer timer(PipelineStage::Classify);
+	}
+	std::printf("StageTimer: %.1f ns\n", (double)(BenchNowNanos() - start) / (double)iterations);
+	BenchKeep(PipelineStats::Summarize(PipelineStage::Classify, true).count);
+
+	// GetStats 每个阶段汇总一次
+	const uint64_t summaries = quick ? 100 : 10000;
+	start = BenchNowNanos();
+	for (uint64_t i = 0; i < summaries; i++) {
+		BenchKeep(PipelineStats::Summarize(PipelineStage::Classify, false).p99);
+	}
+	std::printf("Summarize: %.2f us per stage\n", (double)(BenchNowNanos() - start) / 1000.0 / (double)summaries);
+	return 0;
+}
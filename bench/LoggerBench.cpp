@@ -0,0 +1,186 @@
+﻿#include "Bench.h"
+#include "Logger.h"
+#include "Utf.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 多线程写日志的吞吐与单次写入延迟：Logger（无锁 MPSC 环形队列，按批取出，调用 JS 时不持锁）
+// 对比旧实现（拼接前缀的 std::wstring、log_mutex 保护的 std::queue，消费方持锁逐条转换并调用 JS）
+// JS 回调的耗时以 --call-us 注入（默认 5us）；旧实现每条一次调用，新实现每批一次
+// 两种负载：满速写入（生产方远快于消费方，Logger 丢弃并计数，旧实现无界堆积），
+// 以及按节奏写入（每个线程每 100us 写一批 16 条，接近检测线程和钩子线程的日志突发）
+
+static const wchar_t kMessage[] = L"Drag check finished: verdict=1 matches=3 elapsed=0.412ms";
+// 每隔这么多次写入记录一次单次写入的耗时
+static const int kLatencySampleInterval = 16;
+// 按节奏写入时每批的条数和间隔
+static const uint64_t kPacedBurst = 16;
+static const auto kPacedInterval = std::chrono::microseconds(100);
+
+struct RunResult {
+	double recordsPerSecond;
+	unsigned long long delivered;
+	unsigned long long dropped;
+};
+
+// 旧实现的移植
+class LegacyLog
+{
+public:
+	void Write(const std::wstring& message) {
+		std::wstring text = L"[drop file info] " + message;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_queue.push(std::move(text));
+		}
+		// uv_async_send
+		m_wake.notify_one();
+	}
+
+	// 持锁取出全部消息，每条转换为 UTF-8 后调用一次 JS
+	unsigned long long Consume(uint64_t callNanos, std::atomic<bool>& stop) {
+		unsigned long long delivered = 0;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (!stop.load() || !m_queue.empty()) {
+			m_wake.wait_for(lock, std::chrono::milliseconds(1), [this]() { return !m_queue.empty(); });
+			while (!m_queue.empty()) {
+				std::string utf8;
+				AppendUtf8(utf8, m_queue.front().data(), m_queue.front().size());
+				m_queue.pop();
+				BenchSpinNanos(callNanos);
+				delivered++;
+			}
+		}
+		return delivered;
+	}
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::queue<std::wstring> m_queue;
+};
+
+static void CountRecord(void* context, const LogRecord& record) {
+	(*static_cast<unsigned long long*>(context))++;
+	BenchKeep(record.length);
+}
+
+// 与 AddonInstance::Wake 相同：已有未处理的唤醒时不再通知
+static std::atomic<bool> g_wakePending(false);
+static std::mutex g_wakeMutex;
+static std::condition_variable g_wake;
+
+static void NotifyLogAvailable() {
+	if (!g_wakePending.exchange(true, std::memory_order_acq_rel)) {
+		g_wake.notify_one();
+	}
+}
+
+template <typename Write, typename Consume>
+static RunResult Run(int producers, uint64_t perProducer, bool paced, BenchSamples& latencies, Write write, Consume consume) {
+	std::atomic<bool> stop(false);
+	unsigned long long delivered = 0;
+	std::thread consumer([&]() { delivered = consume(stop); });
+
+	uint64_t start = BenchNowNanos();
+	std::vector<std::thread> threads;
+	std::vector<BenchSamples> samples(producers);
+	for (int p = 0; p < producers; p++) {
+		threads.emplace_back([&, p]() {
+			std::wstring message = kMessage;
+			for (uint64_t i = 0; i < perProducer; i++) {
+				if (paced && i % kPacedBurst == 0) {
+					std::this_thread::sleep_for(kPacedInterval);
+				}
+				if (i % kLatencySampleInterval == 0) {
+					uint64_t writeStart = BenchNowNanos();
+					write(message);
+					samples[p].Add(BenchNowNanos() - writeStart);
+				}
+				else {
+					write(message);
+				}
+			}
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	double seconds = (double)(BenchNowNanos() - start) / 1e9;
+	stop = true;
+	g_wake.notify_one();
+	consumer.join();
+
+	for (const BenchSamples& producerSamples : samples) {
+		latencies.Merge(producerSamples);
+	}
+	return { (double)producers * perProducer / seconds, delivered, Logger::TakeDroppedCount() };
+}
+
+int main(int argc, char** argv) {
+	bool quick = BenchQuick(argc, argv);
+	uint64_t perProducer = BenchArg(argc, argv, "records", quick ? 2000 : 200000);
+	uint64_t callNanos = BenchArg(argc, argv, "call-us", 5) * 1000;
+	size_t length = sizeof(kMessage) / sizeof(wchar_t) - 1;
+
+	// 调用处过滤：未启用的级别只读一个原子变量
+	Logger::SetLevel(LogLevel::Info);
+	uint64_t filtered = quick ? 1000000 : 100000000;
+	uint64_t start = BenchNowNanos();
+	for (uint64_t i = 0; i < filtered; i++) {
+		LOG_DEBUG(L"Drag check finished: " + std::to_wstring(i));
+	}
+	std::printf("disabled LOG_DEBUG: %.2f ns/call\n", (double)(BenchNowNanos() - start) / filtered);
+	std::printf("records per producer=%llu js call=%lluus\n", (unsigned long long)perProducer, (unsigned long long)(callNanos / 1000));
+
+	Logger::SetNotify(NotifyLogAvailable);
+	for (int mode = 0; mode < 2; mode++) {
+		bool paced = mode == 1;
+		std::printf("%s\n", paced ? "paced: 16 records per 100us per producer" : "flood: producers write as fast as they can");
+		for (int producers = 1; producers <= 8; producers *= 2) {
+			BenchSamples ringLatencies;
+			RunResult ring = Run(producers, paced ? perProducer / 10 : perProducer, paced, ringLatencies,
+				[length](const std::wstring& message) { Logger::Write(LogLevel::Info, message.c_str(), length); },
+				[callNanos](std::atomic<bool>& stop) {
+					unsigned long long delivered = 0;
+					for (;;) {
+						bool stopping = stop.load();
+						{
+							std::unique_lock<std::mutex> lock(g_wakeMutex);
+							g_wake.wait_for(lock, std::chrono::milliseconds(1), []() { return g_wakePending.load(); });
+						}
+						g_wakePending.store(false, std::memory_order_release);
+						// 一次唤醒取出一批，调用一次 JS，期间不持有任何锁
+						while (Logger::Drain(CountRecord, &delivered, 1024) > 0) {
+							BenchSpinNanos(callNanos);
+						}
+						if (stopping) {
+							return delivered;
+						}
+					}
+				});
+
+			LegacyLog legacy;
+			BenchSamples legacyLatencies;
+			RunResult old = Run(producers, paced ? perProducer / 10 : perProducer, paced, legacyLatencies,
+				[&legacy](const std::wstring& message) { legacy.Write(message); },
+				[&legacy, callNanos](std::atomic<bool>& stop) { return legacy.Consume(callNanos, stop); });
+
+			std::printf("%d producer(s):\n", producers);
+			std::printf("  %-30s %6.2f M records/s, delivered %llu, dropped %llu\n", "Logger (MPSC ring)",
+				ring.recordsPerSecond / 1e6, ring.delivered, ring.dropped);
+			std::printf("  %-30s %6.2f M records/s, delivered %llu\n", "mutex + std::queue",
+				old.recordsPerSecond / 1e6, old.delivered);
+			std::printf("  ");
+			ringLatencies.Print("Logger write latency");
+			std::printf("  ");
+			legacyLatencies.Print("mutex + queue write latency");
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,96 @@
+﻿#include "Bench.h"
+#include "DragTracker.h"
+#include "MouseStream.h"
+#include <random>
+
+// 录制的鼠标事件流回放速度：只解码，以及解码后交给 DragTracker（检测结果立即返回）
+
+struct CountingPolicy {
+	static const uint32_t kButtons = kDragButtonLeft;
+	uint64_t drags = 0;
+	uint64_t releases = 0;
+	uint32_t started = 0;
+	bool pending = false;
+
+	int ThresholdX() const { return 4; }
+	int ThresholdY() const { return 4; }
+	void OnPress(uint32_t, int32_t, int32_t) {}
+	void OnDragStart(uint32_t sequence, int32_t, int32_t) { drags++; started = sequence; pending = true; }
+	void OnRelease(uint32_t, int32_t, int32_t) { releases++; }
+	void OnCancel(uint32_t) {}
+};
+
+// 约 1/5 的时间按住左键移动，其余为普通移动与点击
+static std::vector<uint8_t> GenerateStream(uint64_t events) {
+	std::mt19937 random(14);
+	MouseStreamWriter writer;
+	int32_t x = 800;
+	int32_t y = 600;
+	uint32_t time = 0;
+	bool down = false;
+	for (uint64_t i = 0; i < events; i++) {
+		uint32_t message = 0x0200;
+		uint32_t roll = random() % 100;
+		if (!down && roll < 2) {
+			message = 0x0201;
+			down = true;
+		}
+		else if (down && roll < 10) {
+			message = 0x0202;
+			down = false;
+		}
+		else {
+			x += (int32_t)(random() % 9) - 4;
+			y += (int32_t)(random() % 9) - 4;
+		}
+		time += 1 + random() % 8;
+		writer.Append({ message, x, y, time, 0 });
+	}
+	return writer.Bytes();
+}
+
+int main(int argc, char** argv) {
+	bool quick = BenchQuick(argc, argv);
+	uint64_t events = BenchArg(argc, argv, "events", quick ? 200000 : 20000000);
+	std::vector<uint8_t> stream = GenerateStream(events);
+	std::printf("events=%llu, %.2f bytes/event\n", (unsigned long long)events, (double)stream.size() / (double)events);
+
+	int rounds = quick ? 1 : 5;
+	uint64_t best = ~0ull;
+	for (int round = 0; round < rounds; round++) {
+		uint64_t checksum = 0;
+		uint64_t start = BenchNowNanos();
+		MouseStream::Replay(stream.data(), stream.size(), [&](const MouseRecord& record) {
+			checksum += (uint32_t)record.x ^ record.message;
+		});
+		uint64_t elapsed = BenchNowNanos() - start;
+		best = elapsed < best ? elapsed : best;
+		BenchKeep(checksum);
+	}
+	std::printf("decode only:          %.1f M events/s\n", (double)events * 1000.0 / (double)best);
+
+	best = ~0ull;
+	for (int round = 0; round < rounds; round++) {
+		DragTracker<CountingPolicy> tracker;
+		uint64_t start = BenchNowNanos();
+		MouseStream::Replay(stream.data(), stream.size(), [&](const MouseRecord& record) {
+			PointerInput input;
+			if (DecodeMouseMessage(record.message, record.x, record.y, input)) {
+				tracker.Feed(input);
+			}
+			if (tracker.GetPolicy().pending) {
+				tracker.GetPolicy().pending = false;
+				tracker.AcceptResult(tracker.GetPolicy().started);
+			}
+		});
+		uint64_t elapsed = BenchNowNanos() - start;
+		best = elapsed < best ? elapsed : best;
+		BenchKeep(tracker.GetPolicy().drags + tracker.GetPolicy().releases);
+		if (round == 0) {
+			std::printf("drags=%llu, releases=%llu\n",
+				(unsigned long long)tracker.GetPolicy().drags, (unsigned long long)tracker.GetPolicy().releases);
+		}
+	}
+	std::printf("decode + DragTracker: %.1f M events/s\n", (double)events * 1000.0 / (double)best);
+	return 0;
+}
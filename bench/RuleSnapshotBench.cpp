@@ -0,0 +1,112 @@
+﻿#include "Bench.h"
+#include "MatchRules.h"
+#include "Snapshot.h"
+#include <atomic>
+#include <cwchar>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// 写入方不停地替换匹配规则时读取方的吞吐：SnapshotCell + 线程内 SnapshotReader（版本未变时只读一个原子计数），
+// 对比每次读取都加锁复制 shared_ptr 的实现；--readers 读取线程数（默认 4），--swap-us 两次发布的间隔（默认 0，即连续发布）
+
+static const wchar_t* const kPaths[] = {
+	L"C:\\Users\\me\\Documents\\report_2024.xlsx",
+	L"C:\\Users\\me\\Documents\\~$report_2024.xlsx",
+	L"D:\\Photos\\IMG_0042.jpg",
+	L"C:\\Work\\plan.pdf",
+};
+static const size_t kPathCount = sizeof(kPaths) / sizeof(kPaths[0]);
+
+static MatchRuleSet RuleSet(unsigned round) {
+	MatchRuleSet set;
+	set.extensions = { L".pdf", L".docx", round % 2 == 0 ? L".jpg" : L".png" };
+	set.globs = { L"report_*.xlsx" };
+	set.exclusions = { L"~$*" };
+	return set;
+}
+
+// 加锁读取：每次匹配前在互斥锁下复制 shared_ptr
+class LockedRules
+{
+public:
+	void Publish(std::shared_ptr<const MatchRules> rules) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_rules = std::move(rules);
+	}
+	std::shared_ptr<const MatchRules> Load() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_rules;
+	}
+
+private:
+	std::mutex m_mutex;
+	std::shared_ptr<const MatchRules> m_rules;
+};
+
+struct Result {
+	double readsPerSecond;
+	unsigned long long publishes;
+};
+
+template <typename Store, typename Read>
+static Result Run(Store& store, Read read, unsigned readers, uint64_t durationNanos, uint64_t swapNanos) {
+	std::atomic<bool> stop(false);
+	std::atomic<unsigned long long> reads(0);
+	std::vector<std::thread> threads;
+	for (unsigned t = 0; t < readers; t++) {
+		threads.emplace_back([&, t]() {
+			unsigned long long count = 0;
+			unsigned long long matched = 0;
+			auto reader = read();
+			while (!stop.load(std::memory_order_relaxed)) {
+				const wchar_t* path = kPaths[(count + t) % kPathCount];
+				matched += reader(path) ? 1 : 0;
+				count++;
+			}
+			BenchKeep(matched);
+			reads.fetch_add(count);
+		});
+	}
+
+	unsigned long long publishes = 0;
+	uint64_t start = BenchNowNanos();
+	while (BenchNowNanos() - start < durationNanos) {
+		store.Publish(std::make_shared<const MatchRules>(RuleSet((unsigned)publishes)));
+		publishes++;
+		if (swapNanos > 0) {
+			BenchSpinNanos(swapNanos);
+		}
+	}
+	stop = true;
+	uint64_t elapsed = BenchNowNanos() - start;
+	for (std::thread& thread : threads) thread.join();
+	return { reads.load() * 1e9 / (double)elapsed, publishes };
+}
+
+static void Print(const char* name, const Result& result) {
+	std::printf("%-24s %8.2f M reads/s  %10llu publishes\n", name, result.readsPerSecond / 1e6, result.publishes);
+}
+
+int main(int argc, char** argv) {
+	bool quick = BenchQuick(argc, argv);
+	unsigned readers = (unsigned)BenchArg(argc, argv, "readers", 4);
+	uint64_t durationNanos = BenchArg(argc, argv, "ms", quick ? 50 : 1000) * 1000000;
+	uint64_t swapNanos = BenchArg(argc, argv, "swap-us", 0) * 1000;
+	std::printf("readers=%u swap=%lluus\n", readers, (unsigned long long)(swapNanos / 1000));
+
+	SnapshotCell<MatchRules> cell;
+	Result snapshot = Run(cell, [&cell]() {
+		auto reader = std::make_shared<SnapshotReader<MatchRules>>();
+		return [&cell, reader](const wchar_t* path) { return reader->Get(cell).Matches(path, std::wcslen(path)); };
+	}, readers, durationNanos, swapNanos);
+	Print("snapshot reader", snapshot);
+
+	LockedRules locked;
+	locked.Publish(std::make_shared<const MatchRules>(RuleSet(0)));
+	Result mutex = Run(locked, [&locked]() {
+		return [&locked](const wchar_t* path) { return locked.Load()->Matches(path, std::wcslen(path)); };
+	}, readers, durationNanos, swapNanos);
+	Print("mutex + shared_ptr copy", mutex);
+	return 0;
+}
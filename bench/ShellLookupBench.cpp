@@ -0,0 +1,80 @@
+﻿#include "Bench.h"
+#include "SimulatedDesktop.h"
+#include <string>
+
+// Shell 窗口查找随窗口数的变化：事件维护的索引（SimulatedDesktop::FindView，O(1)）
+// 对比旧实现逐个枚举 IShellWindows 的线性查找；旧实现每个窗口的 Item + QueryInterface + get_HWND
+// 以 --call-us 注入的跨进程调用开销表示（默认 20us）
+
+// 按注册顺序逐个比较窗口句柄，找到后再取视图
+class LinearScanDesktop : public SimulatedDesktop
+{
+public:
+	explicit LinearScanDesktop(uint64_t callNanos) : m_callNanos(callNanos) {}
+
+	void AddShell(DesktopWindow window) { m_registered.push_back(window); }
+
+	std::shared_ptr<DesktopView> FindView(DesktopWindow shellWindow, bool isDesktop) override {
+		for (DesktopWindow window : m_registered) {
+			BenchSpinNanos(m_callNanos);
+			if (window == shellWindow) {
+				return SimulatedDesktop::FindView(shellWindow, isDesktop);
+			}
+		}
+		return nullptr;
+	}
+
+private:
+	uint64_t m_callNanos;
+	std::vector<DesktopWindow> m_registered;
+};
+
+static std::vector<DesktopWindow> AddWindows(SimulatedDesktop& desktop, LinearScanDesktop* linear, size_t count) {
+	std::vector<DesktopWindow> windows;
+	for (size_t i = 0; i < count; i++) {
+		int32_t offset = (int32_t)(i % 64) * 10;
+		DesktopWindow window = desktop.AddExplorerWindow({ 100 + offset, 100 + offset, 1100 + offset, 800 + offset });
+		if (linear != nullptr) {
+			linear->AddShell(window);
+		}
+		windows.push_back(window);
+	}
+	return windows;
+}
+
+// 依次查找每个窗口，拖拽起点在各窗口间均匀分布
+static void Measure(IDesktopBackend& backend, const std::vector<DesktopWindow>& windows, uint64_t lookups, BenchSamples& samples) {
+	for (uint64_t i = 0; i < lookups; i++) {
+		DesktopWindow window = windows[(i * 7919) % windows.size()];
+		uint64_t start = BenchNowNanos();
+		std::shared_ptr<DesktopView> view = backend.FindView(window, false);
+		samples.Add(BenchNowNanos() - start);
+		BenchKeep(view != nullptr);
+	}
+}
+
+int main(int argc, char** argv) {
+	bool quick = BenchQuick(argc, argv);
+	uint64_t lookups = BenchArg(argc, argv, "lookups", quick ? 50 : 2000);
+	uint64_t callNanos = BenchArg(argc, argv, "call-us", 20) * 1000;
+	uint64_t maxWindows = BenchArg(argc, argv, "windows", quick ? 8 : 128);
+	std::printf("lookups=%llu call=%lluus\n", (unsigned long long)lookups, (unsigned long long)(callNanos / 1000));
+
+	for (uint64_t count = 1; count <= maxWindows; count *= 2) {
+		SimulatedDesktop indexed;
+		std::vector<DesktopWindow> windows = AddWindows(indexed, nullptr, (size_t)count);
+		BenchSamples indexedSamples;
+		Measure(indexed, windows, lookups, indexedSamples);
+
+		LinearScanDesktop linear(callNanos);
+		windows = AddWindows(linear, &linear, (size_t)count);
+		BenchSamples linearSamples;
+		Measure(linear, windows, lookups, linearSamples);
+
+		std::string name = std::to_string(count) + " windows, index";
+		indexedSamples.Print(name.c_str());
+		name = std::to_string(count) + " windows, linear scan";
+		linearSamples.Print(name.c_str());
+	}
+	return 0;
+}
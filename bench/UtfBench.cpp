@@ -0,0 +1,159 @@
+﻿#include "Bench.h"
+#include "Utf.h"
+#include <string>
+#include <vector>
+
+// 路径与日志形状的输入上，一次遍历的 AppendUtf8 / AppendWide（SSE2 ASCII 快速路径）对比原来的两遍转换：
+// 旧实现先调用一次 WideCharToMultiByte / MultiByteToWideChar 计算长度，再调用一次转换，
+// UTF-8 转宽字符时还经过 std::vector<wchar_t> 再复制到 std::wstring；这里用逐字符的标量编解码按同样的结构移植
+// --iterations 每种输入的转换次数（默认 200 万）
+
+// 逐字符编码，output 为空时只计算长度；非法单元替换为 U+FFFD
+static size_t LegacyEncode(const wchar_t* input, size_t length, char* output) {
+	size_t written = 0;
+	for (size_t i = 0; i < length; i++) {
+		uint32_t code = (uint32_t)input[i];
+		if (sizeof(wchar_t) == 2 && code >= 0xD800 && code <= 0xDBFF && i + 1 < length
+			&& (uint32_t)input[i + 1] >= 0xDC00 && (uint32_t)input[i + 1] <= 0xDFFF) {
+			code = 0x10000 + ((code - 0xD800) << 10) + ((uint32_t)input[++i] - 0xDC00);
+		}
+		else if ((code >= 0xD800 && code <= 0xDFFF) || code > 0x10FFFF) {
+			code = 0xFFFD;
+		}
+		char bytes[4];
+		size_t count;
+		if (code < 0x80) {
+			bytes[0] = (char)code;
+			count = 1;
+		}
+		else if (code < 0x800) {
+			bytes[0] = (char)(0xC0 | (code >> 6));
+			bytes[1] = (char)(0x80 | (code & 0x3F));
+			count = 2;
+		}
+		else if (code < 0x10000) {
+			bytes[0] = (char)(0xE0 | (code >> 12));
+			bytes[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+			bytes[2] = (char)(0x80 | (code & 0x3F));
+			count = 3;
+		}
+		else {
+			bytes[0] = (char)(0xF0 | (code >> 18));
+			bytes[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+			bytes[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+			bytes[3] = (char)(0x80 | (code & 0x3F));
+			count = 4;
+		}
+		if (output != nullptr) {
+			for (size_t j = 0; j < count; j++) output[written + j] = bytes[j];
+		}
+		written += count;
+	}
+	return written;
+}
+
+// 逐字符解码，output 为空时只计算长度；输入均为合法的 UTF-8，只处理合法序列
+static size_t LegacyDecode(const char* input, size_t length, wchar_t* output) {
+	size_t written = 0;
+	for (size_t i = 0; i < length;) {
+		uint8_t lead = (uint8_t)input[i];
+		uint32_t code;
+		size_t count = lead < 0x80 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+		if (i + count > length) {
+			code = 0xFFFD;
+			count = length - i;
+		}
+		else if (count == 1) {
+			code = lead;
+		}
+		else {
+			code = lead & (0x7F >> count);
+			for (size_t j = 1; j < count; j++) code = (code << 6) | ((uint8_t)input[i + j] & 0x3F);
+		}
+		i += count;
+		if (sizeof(wchar_t) == 2 && code >= 0x10000) {
+			if (output != nullptr) {
+				output[written] = (wchar_t)(0xD800 + ((code - 0x10000) >> 10));
+				output[written + 1] = (wchar_t)(0xDC00 + ((code - 0x10000) & 0x3FF));
+			}
+			written += 2;
+		}
+		else {
+			if (output != nullptr) output[written] = (wchar_t)code;
+			written++;
+		}
+	}
+	return written;
+}
+
+// 旧的 WcharToUtf8：计算长度、分配、转换
+static std::string LegacyToUtf8(const std::wstring& input) {
+	size_t size = LegacyEncode(input.c_str(), input.size(), nullptr);
+	std::string result(size, '\0');
+	LegacyEncode(input.c_str(), input.size(), &result[0]);
+	return result;
+}
+
+// 旧的 Utf8ToWstring：计算长度、转换到 vector、再复制到 wstring
+static std::wstring LegacyToWide(const std::string& input) {
+	size_t size = LegacyDecode(input.c_str(), input.size(), nullptr);
+	std::vector<wchar_t> chars(size);
+	LegacyDecode(input.c_str(), input.size(), chars.data());
+	return std::wstring(chars.begin(), chars.end());
+}
+
+static std::wstring ToWide(const std::string& input) {
+	std::wstring result;
+	AppendWide(result, input.data(), input.size());
+	return result;
+}
+
+static std::string ToUtf8(const std::wstring& input) {
+	std::string result;
+	AppendUtf8(result, input.data(), input.size());
+	return result;
+}
+
+template <typename Convert, typename Input>
+static double NanosPerCall(Convert convert, const Input& input, uint64_t iterations) {
+	size_t total = 0;
+	uint64_t start = BenchNowNanos();
+	for (uint64_t i = 0; i < iterations; i++) {
+		total += convert(input).size();
+	}
+	BenchKeep(total);
+	return (double)(BenchNowNanos() - start) / (double)iterations;
+}
+
+int main(int argc, char** argv) {
+	bool quick = BenchQuick(argc, argv);
+	uint64_t iterations = BenchArg(argc, argv, "iterations", quick ? 20000 : 2000000);
+	std::printf("iterations=%llu\n", (unsigned long long)iterations);
+
+	struct Input {
+		const char* name;
+		std::string utf8;
+	};
+	const Input inputs[] = {
+		{ "ascii path", "C:\\Users\\me\\Documents\\Projects\\2024\\Quarterly\\report_q3_final.xlsx" },
+		{ "cjk path", "D:\\\xE9\xA1\xB9\xE7\x9B\xAE\\\xE8\xAE\xBE\xE8\xAE\xA1\xE5\x9B\xBE\xE7\xBA\xB8\\\xE5\x8A\x9E\xE5\x85\xAC\xE6\xA5\xBC_\xE4\xB8\x89\xE5\xB1\x82.dwg" },
+		{ "log line", "[2024-06-11 10:42:17.318] [info] Drag check succeeded: 3 matching files, first C:\\Work\\Drawings\\plan_v2.pdf (12.4ms)" },
+		{ "log line, mixed", "[2024-06-11 10:42:17.318] [info] \xE6\x8B\x96\xE6\x8B\xBD\xE6\xA3\x80\xE6\xB5\x8B\xE6\x88\x90\xE5\x8A\x9F: C:\\\xE5\xB7\xA5\xE4\xBD\x9C\\\xE5\x9B\xBE\xE7\xBA\xB8\\plan_v2.pdf (12.4ms)" },
+	};
+
+	std::printf("%-18s %7s %14s %14s %14s %14s\n", "input", "bytes", "to wide", "legacy", "to utf-8", "legacy");
+	for (const Input& input : inputs) {
+		std::wstring wide = ToWide(input.utf8);
+		if (wide != LegacyToWide(input.utf8) || ToUtf8(wide) != input.utf8 || LegacyToUtf8(wide) != input.utf8) {
+			std::printf("%s: conversions disagree\n", input.name);
+			return 1;
+		}
+		double toWide = NanosPerCall(ToWide, input.utf8, iterations);
+		double legacyWide = NanosPerCall(LegacyToWide, input.utf8, iterations);
+		double toUtf8 = NanosPerCall(ToUtf8, wide, iterations);
+		double legacyUtf8 = NanosPerCall(LegacyToUtf8, wide, iterations);
+		std::printf("%-18s %7zu %11.1f ns %11.1f ns %11.1f ns %11.1f ns\n", input.name, input.utf8.size(),
+			toWide, legacyWide, toUtf8, legacyUtf8);
+	}
+	return 0;
+}
@@ -0,0 +1,31 @@
+﻿#pragma once
+#include <cstdio>
+
+// 最小的测试断言：失败时打印位置并计数，main 返回失败次数
+static int g_checkFailures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+			g_checkFailures++; \
+		} \
+	} while (0)
+
+#define CHECK_EQ(actual, expected) \
+	do { \
+		if (!((actual) == (expected))) { \
+			std::fprintf(stderr, "%s:%d: CHECK_EQ failed: %s == %s\n", __FILE__, __LINE__, #actual, #expected); \
+			g_checkFailures++; \
+		} \
+	} while (0)
+
+// 在 main 末尾返回，同时打印汇总
+static inline int CheckResult(const char* name) {
+	if (g_checkFailures == 0) {
+		std::printf("%s: all checks passed\n", name);
+		return 0;
+	}
+	std::fprintf(stderr, "%s: %d check(s) failed\n", name, g_checkFailures);
+	return 1;
+}
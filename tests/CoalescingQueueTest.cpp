@@ -0,0 +1,80 @@
+﻿#include "CoalescingQueue.h"
+#include "Check.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static void TestTakeLatest() {
+	CoalescingQueue<int, 8> queue;
+	int value = -1;
+	CHECK(!queue.TakeLatest(value));
+
+	queue.Push(1);
+	CHECK(queue.TakeLatest(value));
+	CHECK_EQ(value, 1);
+	CHECK_EQ(queue.CoalescedCount(), 0ull);
+
+	// 积压的请求合并为最新的一条
+	queue.Push(2);
+	queue.Push(3);
+	queue.Push(4);
+	CHECK(queue.TakeLatest(value));
+	CHECK_EQ(value, 4);
+	CHECK_EQ(queue.CoalescedCount(), 2ull);
+	CHECK(!queue.TakeLatest(value));
+}
+
+static void TestCapacity() {
+	CoalescingQueue<int, 4> queue;
+	for (int i = 0; i < 10; i++) {
+		queue.Push(i);
+	}
+	// 超出容量淘汰 6 条，取出时再合并 3 条
+	int value = -1;
+	CHECK(queue.TakeLatest(value));
+	CHECK_EQ(value, 9);
+	CHECK_EQ(queue.CoalescedCount(), 9ull);
+
+	queue.Push(10);
+	queue.Clear();
+	CHECK(!queue.TakeLatest(value));
+}
+
+// 多个生产者并发提交，每条请求要么被取出，要么计入合并数量，且最后一条一定能取到
+static void TestConcurrentProducers() {
+	const int kProducers = 4;
+	const int kPerProducer = 20000;
+	CoalescingQueue<long, 8> queue;
+	std::atomic<int> running(kProducers);
+	std::vector<std::thread> producers;
+	for (int p = 0; p < kProducers; p++) {
+		producers.emplace_back([&, p]() {
+			for (int i = 0; i < kPerProducer; i++) {
+				queue.Push((long)p * kPerProducer + i);
+			}
+			running--;
+		});
+	}
+
+	unsigned long long taken = 0;
+	long value;
+	while (running.load() > 0) {
+		if (queue.TakeLatest(value)) {
+			taken++;
+		}
+	}
+	for (std::thread& producer : producers) {
+		producer.join();
+	}
+	while (queue.TakeLatest(value)) {
+		taken++;
+	}
+	CHECK_EQ(taken + queue.CoalescedCount(), (unsigned long long)kProducers * kPerProducer);
+}
+
+int main() {
+	TestTakeLatest();
+	TestCapacity();
+	TestConcurrentProducers();
+	return CheckResult("CoalescingQueueTest");
+}
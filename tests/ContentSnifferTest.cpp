@@ -0,0 +1,304 @@
+﻿#include "Check.h"
+#include "ContentSniffer.h"
+#include "FileDetector.h"
+#include "SimulatedDesktop.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 按文件头校验内容：特征表的识别（含两段特征、OOXML 与普通 zip、过短的文件头）、扩展名到类型的映射、
+// 按 (大小, 修改时间) 失效的缓存、截止时间与停止线程池，以及检测流程中校验结果对结论和匹配数的影响
+
+static const DesktopPoint kExplorerItem = { 310, 150 };
+
+static FileKind Identify(const std::string& bytes) {
+	return SignatureTable::Instance().Identify((const uint8_t*)bytes.data(), bytes.size());
+}
+
+// 偏移 26 为文件名长度的 zip 本地文件头
+static std::string ZipHeader(const std::string& name) {
+	std::string bytes("PK\x03\x04", 4);
+	bytes.append(22, '\0');
+	bytes += (char)name.size();
+	bytes += '\0';
+	bytes.append(2, '\0');
+	return bytes + name;
+}
+
+static void TestIdentify() {
+	CHECK(Identify("%PDF-1.7\n") == FileKind::Pdf);
+	CHECK(Identify(std::string("\x89PNG\r\n\x1A\n\0\0\0\x0DIHDR", 16)) == FileKind::Png);
+	CHECK(Identify("\xFF\xD8\xFF\xE0") == FileKind::Jpeg);
+	CHECK(Identify("GIF87a") == FileKind::Gif);
+	CHECK(Identify("GIF89a\x01") == FileKind::Gif);
+	CHECK(Identify("BM6\x0C") == FileKind::Bmp);
+	CHECK(Identify(std::string("\xD0\xCF\x11\xE0\xA1\xB1\x1A\xE1", 8)) == FileKind::Ole);
+	CHECK(Identify("\x1F\x8B\x08") == FileKind::Gzip);
+	CHECK(Identify("7z\xBC\xAF\x27\x1C") == FileKind::SevenZip);
+	CHECK(Identify("Rar!\x1A\x07\x01") == FileKind::Rar);
+	CHECK(Identify(std::string("MZ\x90\0", 4)) == FileKind::Executable);
+	CHECK(Identify("\x7F" "ELF\x02") == FileKind::Elf);
+
+	// RIFF 需要两段都匹配
+	CHECK(Identify(std::string("RIFF\x24\0\0\0WEBPVP8 ", 16)) == FileKind::Webp);
+	CHECK(Identify(std::string("RIFF\x24\0\0\0WAVEfmt ", 16)) == FileKind::Wav);
+	CHECK(Identify(std::string("RIFF\x24\0\0\0" "AVI LIST", 16)) == FileKind::Unknown);
+	CHECK(Identify("RIFF\x24") == FileKind::Unknown);
+
+	// ISO 媒体文件与没有 ftyp 的旧 QuickTime 文件
+	CHECK(Identify(std::string("\0\0\0\x20" "ftypisom", 12)) == FileKind::Mp4);
+	CHECK(Identify(std::string("\0\0\0\x08" "wide\0\0\0\0mdat", 16)) == FileKind::Mp4);
+	CHECK(Identify(std::string("\0\0\x01\0" "moov", 8)) == FileKind::Mp4);
+	CHECK(Identify(std::string("\0\0\0\x10" "free", 8)) == FileKind::Mp4);
+	CHECK(Identify(std::string("\0\0\0\x14" "pnot", 8)) == FileKind::Mp4);
+
+	// zip 的第一个条目决定是否为 OOXML；第一个条目不是时在文件头中查找 [Content_Types].xml
+	CHECK(Identify(ZipHeader("[Content_Types].xml")) == FileKind::Ooxml);
+	CHECK(Identify(ZipHeader("word/document.xml")) == FileKind::Ooxml);
+	CHECK(Identify(ZipHeader("_rels/.rels")) == FileKind::Ooxml);
+	CHECK(Identify(ZipHeader("mimetype") + std::string(40, 'x') + ZipHeader("[Content_Types].xml")) == FileKind::Ooxml);
+	CHECK(Identify(ZipHeader("photos/cat.jpg")) == FileKind::Zip);
+	CHECK(Identify(std::string("PK\x05\x06", 4) + std::string(18, '\0')) == FileKind::Zip);
+	// 文件名长度超出已读取的部分
+	CHECK(Identify(ZipHeader("word/document.xml").substr(0, 35)) == FileKind::Zip);
+
+	// 过短的文件头
+	CHECK(Identify("") == FileKind::Unknown);
+	CHECK(SignatureTable::Instance().Identify(nullptr, 0) == FileKind::Unknown);
+	CHECK(Identify("%PD") == FileKind::Unknown);
+	CHECK(Identify("\x89PNG") == FileKind::Unknown);
+	CHECK(Identify("B") == FileKind::Unknown);
+	CHECK(Identify("BM") == FileKind::Bmp);
+	CHECK(Identify(std::string("\0\0\0\x20" "fty", 7)) == FileKind::Unknown);
+	CHECK(Identify("plain text") == FileKind::Unknown);
+}
+
+static uint32_t Expected(const std::wstring& path) {
+	return SignatureTable::ExpectedKinds(path.c_str(), path.size());
+}
+
+static bool Accepts(const std::wstring& path, FileKind kind) {
+	return SignatureTable::Accepts(Expected(path), kind);
+}
+
+static void TestExpectedKinds() {
+	CHECK(Accepts(L"C:\\Work\\plan.pdf", FileKind::Pdf));
+	CHECK(!Accepts(L"C:\\Work\\plan.pdf", FileKind::Executable));
+	// 大小写不敏感
+	CHECK_EQ(Expected(L"C:\\Work\\SCAN.PDF"), Expected(L"C:\\Work\\plan.pdf"));
+	CHECK(Accepts(L"C:\\Work\\Photo.JpEg", FileKind::Jpeg));
+	CHECK(Accepts(L"/home/me/clip.MOV", FileKind::Mp4));
+	// OOXML 同样接受普通 zip
+	CHECK(Accepts(L"C:\\Work\\report.docx", FileKind::Ooxml));
+	CHECK(Accepts(L"C:\\Work\\report.docx", FileKind::Zip));
+	CHECK(!Accepts(L"C:\\Work\\report.docx", FileKind::Ole));
+	// 只看最后一个扩展名
+	CHECK(Accepts(L"C:\\Work\\backup.tar.gz", FileKind::Gzip));
+	CHECK(Accepts(L"C:\\Work\\plan.pdf.exe", FileKind::Executable));
+
+	// 没有已知特征的扩展名或没有扩展名时不校验
+	CHECK_EQ(Expected(L"C:\\Work\\notes.txt"), 0u);
+	CHECK_EQ(Expected(L"C:\\Work\\README"), 0u);
+	CHECK_EQ(Expected(L"C:\\Work\\trailing."), 0u);
+	CHECK_EQ(Expected(L"C:\\Work\\plan.pdfx"), 0u);
+	CHECK_EQ(Expected(L"C:\\Work\\plan.pd"), 0u);
+	CHECK_EQ(Expected(L""), 0u);
+	// 目录名中的 '.' 不是扩展名
+	CHECK_EQ(Expected(L"C:\\Release.pdf\\README"), 0u);
+	CHECK_EQ(Expected(L"/srv/v1.2.zip/notes"), 0u);
+	CHECK_EQ(Expected(L"C:file"), 0u);
+	CHECK(Accepts(L"C:\\v1.2\\plan.pdf", FileKind::Pdf));
+	CHECK(Accepts(L"C:\\v1.2\\plan.pdf", FileKind::Pdf) && !Accepts(L"C:\\v1.2\\plan.pdf", FileKind::Zip));
+}
+
+static void WriteFile(const std::filesystem::path& path, const std::string& bytes) {
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out.write(bytes.data(), (std::streamsize)bytes.size());
+}
+
+static const std::string kPdfBytes = "%PDF-1.7\n%\xE2\xE3\xCF\xD3\n1 0 obj\n<<>>\nendobj\n";
+// 与 kPdfBytes 等长的可执行文件头
+static const std::string kExeBytes = std::string("MZ\x90\0", 4) + std::string(kPdfBytes.size() - 4, '\0');
+
+static void TestCache(const std::filesystem::path& directory) {
+	ContentSniffer::ClearCache();
+	std::filesystem::path path = directory / "cached.pdf";
+	std::wstring wide = path.wstring();
+	WriteFile(path, kPdfBytes);
+
+	SniffStats before = ContentSniffer::GetStats();
+	CHECK(ContentSniffer::Verify(wide) == SniffResult::Accepted);
+	CHECK(ContentSniffer::Verify(wide) == SniffResult::Accepted);
+	SniffStats after = ContentSniffer::GetStats();
+	CHECK_EQ(after.cacheMisses, before.cacheMisses + 1);
+	CHECK_EQ(after.cacheHits, before.cacheHits + 1);
+
+	// 大小不变、修改时间变化：旧结果作废
+	WriteFile(path, kExeBytes);
+	std::filesystem::last_write_time(path, std::filesystem::last_write_time(path) + std::chrono::seconds(10));
+	CHECK(ContentSniffer::Verify(wide) == SniffResult::Rejected);
+	SniffStats changed = ContentSniffer::GetStats();
+	CHECK_EQ(changed.cacheMisses, after.cacheMisses + 1);
+	CHECK_EQ(changed.rejected, after.rejected + 1);
+	CHECK(ContentSniffer::Verify(wide) == SniffResult::Rejected);
+	CHECK_EQ(ContentSniffer::GetStats().cacheHits, changed.cacheHits + 1);
+
+	// 大小变化
+	WriteFile(path, kPdfBytes + "trailer\n");
+	CHECK(ContentSniffer::Verify(wide) == SniffResult::Accepted);
+	CHECK_EQ(ContentSniffer::GetStats().cacheMisses, changed.cacheMisses + 1);
+
+	// 无需读取的文件：没有已知特征的扩展名、缺失的文件、空文件
+	SniffStats untouched = ContentSniffer::GetStats();
+	WriteFile(directory / "empty.pdf", "");
+	CHECK(ContentSniffer::Verify((directory / "notes.txt").wstring()) == SniffResult::Accepted);
+	CHECK(ContentSniffer::Verify((directory / "missing.pdf").wstring()) == SniffResult::Accepted);
+	CHECK(ContentSniffer::Verify((directory / "empty.pdf").wstring()) == SniffResult::Accepted);
+	CHECK_EQ(ContentSniffer::GetStats().cacheMisses, untouched.cacheMisses);
+}
+
+// 在 directory 下写入 count 个内容为 bytes 的文件，返回路径
+static std::vector<std::wstring> WriteFiles(const std::filesystem::path& directory, const std::string& prefix, size_t count,
+	const std::string& bytes) {
+	std::vector<std::wstring> paths;
+	for (size_t i = 0; i < count; i++) {
+		std::filesystem::path path = directory / (prefix + std::to_string(i) + ".pdf");
+		WriteFile(path, bytes);
+		paths.push_back(path.wstring());
+	}
+	return paths;
+}
+
+static void TestVerifyAll(const std::filesystem::path& directory) {
+	ContentSniffer::ClearCache();
+	std::vector<std::wstring> paths = WriteFiles(directory, "batch", 3, kPdfBytes);
+	paths.push_back((directory / "fake.pdf").wstring());
+	WriteFile(directory / "fake.pdf", kExeBytes);
+	std::vector<SniffResult> results;
+	CHECK(ContentSniffer::VerifyAll(paths, 0, results));
+	CHECK_EQ(results.size(), (size_t)4);
+	CHECK(results[0] == SniffResult::Accepted && results[2] == SniffResult::Accepted);
+	CHECK(results[3] == SniffResult::Rejected);
+	CHECK(ContentSniffer::VerifyAll({}, 1, results));
+	CHECK(results.empty());
+
+	// 截止时间远小于读取所有文件所需的时间：尚未完成的项为 Pending 并计入 timedOut
+	ContentSniffer::ClearCache();
+	std::vector<std::wstring> many = WriteFiles(directory, "deadline", 3000, kPdfBytes);
+	SniffStats before = ContentSniffer::GetStats();
+	CHECK(!ContentSniffer::VerifyAll(many, 1, results));
+	size_t pending = 0;
+	for (SniffResult result : results) {
+		CHECK(result != SniffResult::Rejected);
+		if (result == SniffResult::Pending) pending++;
+	}
+	CHECK(pending > 0);
+	CHECK_EQ(ContentSniffer::GetStats().timedOut, before.timedOut + pending);
+
+	// 不限时的等待在线程池停止时返回，未开始的项为 Pending
+	ContentSniffer::ClearCache();
+	std::promise<bool> returned;
+	std::future<bool> future = returned.get_future();
+	std::thread waiter([&many, &returned]() {
+		std::vector<SniffResult> waited;
+		returned.set_value(ContentSniffer::VerifyAll(many, 0, waited));
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	ContentSniffer::Stop();
+	CHECK(future.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+	waiter.join();
+	// 停止之后线程池可以再次启动
+	CHECK(ContentSniffer::VerifyAll({ paths[0] }, 0, results));
+	CHECK(results[0] == SniffResult::Accepted);
+}
+
+struct Fixture {
+	SimulatedDesktop desktop;
+	DesktopWindow explorer;
+
+	Fixture() {
+		DesktopWindow content = 0;
+		desktop.AddDesktop({ 0, 0, 1920, 1080 });
+		explorer = desktop.AddExplorerWindow({ 100, 100, 1100, 800 }, &content);
+		desktop.AddFileItem(content, { 300, 148, 1100, 170 });
+		FileDetector::SetThreadBackend(&desktop);
+		FileDetector::SetExtensions({ L".pdf" });
+		FileDetector::SetScanBudget(0, 0);
+	}
+	~Fixture() {
+		FileDetector::SetContentVerification(false, 50);
+		FileDetector::SetMaxPaths(1000);
+		FileDetector::SetScanBudget(2000, 200);
+		FileDetector::SetThreadBackend(NULL);
+	}
+
+	ScanVerdict Detect(const std::vector<std::wstring>& paths, SelectionMatch& match) {
+		std::vector<SimulatedItem> items;
+		for (const std::wstring& path : paths) items.push_back({ path, false });
+		desktop.SetSelection(explorer, items);
+		DragTarget target;
+		return FileDetector::IsDraggingSupportedFile(kExplorerItem, target, match);
+	}
+};
+
+static void TestDetection(const std::filesystem::path& directory) {
+	Fixture fixture;
+	std::wstring real = (directory / "real.pdf").wstring();
+	std::wstring fake = (directory / "renamed.pdf").wstring();
+	std::wstring fake2 = (directory / "renamed2.pdf").wstring();
+	WriteFile(real, kPdfBytes);
+	WriteFile(fake, kExeBytes);
+	WriteFile(fake2, kExeBytes);
+	SelectionMatch match = {};
+
+	// 未开启校验时只看扩展名
+	CHECK(fixture.Detect({ real, fake }, match) == ScanVerdict::Match);
+	CHECK_EQ(match.matchCount, 2L);
+
+	FileDetector::SetContentVerification(true, 0);
+	CHECK(fixture.Detect({ real, fake }, match) == ScanVerdict::Match);
+	CHECK_EQ(match.matchCount, 1L);
+	CHECK_EQ(match.paths->Count(), (size_t)1);
+	CHECK(match.paths->PathAt(0) == real);
+
+	// 全部被拒绝且扫描完整：否定结论
+	CHECK(fixture.Detect({ fake, fake2 }, match) == ScanVerdict::NoMatch);
+	CHECK_EQ(match.matchCount, 0L);
+	CHECK(match.paths == nullptr);
+
+	// 匹配数超过路径上限：只校验有路径的项，其余按扩展名结果计数
+	FileDetector::SetMaxPaths(2);
+	CHECK(fixture.Detect({ fake, real, fake2, real }, match) == ScanVerdict::Match);
+	CHECK_EQ(match.matchCount, 1L + 2L);
+	CHECK_EQ(match.paths->Count(), (size_t)1);
+	CHECK(fixture.Detect({ fake, fake2, real }, match) == ScanVerdict::Match);
+	CHECK_EQ(match.matchCount, 0L + 1L);
+	CHECK(match.paths == nullptr);
+
+	// 超时且没有已接受的项：结论不确定
+	FileDetector::SetMaxPaths(5000);
+	ContentSniffer::ClearCache();
+	std::vector<std::wstring> many = WriteFiles(directory, "timeout", 3000, kExeBytes);
+	FileDetector::SetContentVerification(true, 1);
+	CHECK(fixture.Detect(many, match) == ScanVerdict::Inconclusive);
+	CHECK_EQ(match.matchCount, 0L);
+}
+
+int main() {
+	TestIdentify();
+	TestExpectedKinds();
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / ("filedrop-sniff-" + std::to_string(std::random_device()()));
+	std::filesystem::create_directories(directory);
+	TestCache(directory);
+	TestVerifyAll(directory);
+	TestDetection(directory);
+	ContentSniffer::Stop();
+	std::filesystem::remove_all(directory);
+	return CheckResult("ContentSnifferTest");
+}
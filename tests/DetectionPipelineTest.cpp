@@ -0,0 +1,157 @@
+﻿#include "Check.h"
+#include "FileDetector.h"
+#include "Logger.h"
+#include "PipelineStats.h"
+#include "SimulatedDesktop.h"
+
+// 端到端的检测流程：鼠标位置 -> 窗口分类 -> 命中测试 -> Shell 窗口查找 -> 选中项扫描 -> 缓存
+// 模拟桌面上有一个 Explorer 窗口和桌面，检查各种选中项的结论以及每一步的调用次数
+
+static const DesktopPoint kExplorerItem = { 310, 150 };
+static const DesktopPoint kDesktopPoint = { 1500, 500 };
+static const uint32_t kItemPathMicros = 20;
+
+struct Fixture {
+	SimulatedDesktop desktop;
+	DesktopWindow explorer;
+	DesktopWindow progman;
+
+	Fixture() {
+		DesktopWindow content = 0;
+		progman = desktop.AddDesktop({ 0, 0, 1920, 1080 });
+		explorer = desktop.AddExplorerWindow({ 100, 100, 1100, 800 }, &content);
+		desktop.AddFileItem(content, { 300, 148, 1100, 170 });
+		desktop.SetLatency(SimulatedCall::ItemPath, kItemPathMicros);
+		FileDetector::SetThreadBackend(&desktop);
+	}
+	~Fixture() {
+		FileDetector::SetThreadBackend(NULL);
+	}
+
+	ScanVerdict Detect(const DesktopPoint& pt, SelectionMatch& match) {
+		desktop.ResetCallCounts();
+		DragTarget target;
+		return FileDetector::IsDraggingSupportedFile(pt, target, match);
+	}
+};
+
+static void TestVerdicts() {
+	Fixture fixture;
+	SelectionMatch match = {};
+
+	fixture.desktop.SetSelection(fixture.explorer, { { L"C:\\Work\\plan.pdf", false }, { L"C:\\Work\\notes.txt", false },
+		{ L"C:\\Work\\scan.PDF", false } });
+	CHECK(fixture.Detect(kExplorerItem, match) == ScanVerdict::Match);
+	CHECK_EQ(match.matchCount, 2L);
+	CHECK(match.paths != nullptr);
+	CHECK_EQ(match.paths->Count(), (size_t)2);
+	CHECK(match.paths->PathAt(0) == L"C:\\Work\\plan.pdf");
+	CHECK(match.paths->PathAt(1) == L"C:\\Work\\scan.PDF");
+	CHECK_EQ(fixture.desktop.CallCount(SimulatedCall::ItemPath), 3u);
+
+	// 没有匹配项
+	fixture.desktop.SetSelection(fixture.explorer, { { L"C:\\Work\\notes.txt", false } });
+	CHECK(fixture.Detect(kExplorerItem, match) == ScanVerdict::NoMatch);
+	CHECK_EQ(match.matchCount, 0L);
+	CHECK(match.paths == nullptr);
+
+	// 扩展名相符的文件夹不算匹配
+	fixture.desktop.SetSelection(fixture.explorer, { { L"C:\\Work\\archive.pdf", true } });
+	CHECK(fixture.Detect(kExplorerItem, match) == ScanVerdict::NoMatch);
+	CHECK_EQ(fixture.desktop.CallCount(SimulatedCall::ItemIsFolder), 1u);
+
+	// 空白处不解析选中项
+	fixture.desktop.SetSelection(fixture.explorer, { { L"C:\\Work\\plan.pdf", false } });
+	CHECK(fixture.Detect({ 310, 300 }, match) == ScanVerdict::NoMatch);
+	CHECK_EQ(fixture.desktop.CallCount(SimulatedCall::FindView), 0u);
+	CHECK_EQ(fixture.desktop.CallCount(SimulatedCall::ItemPath), 0u);
+
+	// 桌面使用自己的选中项
+	fixture.desktop.SetSelection(fixture.progman, { { L"C:\\Users\\me\\Desktop\\report.pdf", false } });
+	CHECK(fixture.Detect(kDesktopPoint, match) == ScanVerdict::Match);
+	CHECK_EQ(match.matchCount, 1L);
+	CHECK(match.paths->PathAt(0) == L"C:\\Users\\me\\Desktop\\report.pdf");
+	CHECK_EQ(fixture.desktop.CallCount(SimulatedCall::HitTest), 0u);
+}
+
+static void TestSelectionCache() {
+	Fixture fixture;
+	SelectionMatch match = {};
+	fixture.desktop.SetSelection(fixture.explorer, { { L"C:\\Work\\a.txt", false }, { L"C:\\Work\\b.pdf", false } });
+
+	CHECK(fixture.Detect(kExplorerItem, match) == ScanVerdict::Match);
+	CHECK_EQ(fixture.desktop.CallCount(SimulatedCall::ItemPath), 2u);
+
+	// 选中项未变化：命中缓存，不再逐项读取路径，结果与路径相同
+	std::shared_ptr<const MatchedPaths> first = match.paths;
+	CHECK(fixture.Detect(kExplorerItem, match) == ScanVerdict::Match);
+	CHECK_EQ(fixture.desktop.CallCount(SimulatedCall::ItemPath), 0u);
+	CHECK_EQ(match.matchCount, 1L);
+	CHECK(match.paths == first);
+
+	// 更新规则使缓存失效
+	FileDetector::SetExtensions({ L".txt" });
+	CHECK(fixture.Detect(kExplorerItem, match) == ScanVerdict::Match);
+	CHECK_EQ(fixture.desktop.CallCount(SimulatedCall::ItemPath), 2u);
+	CHECK(match.paths->PathAt(0) == L"C:\\Work\\a.txt");
+	FileDetector::SetExtensions({ L".pdf" });
+
+	// 替换选中项使该窗口的缓存失效
+	fixture.desktop.SetSelection(fixture.explorer, { { L"C:\\Work\\c.docx", false } });
+	CHECK(fixture.Detect(kExplorerItem, match) == ScanVerdict::NoMatch);
+	CHECK_EQ(fixture.desktop.CallCount(SimulatedCall::ItemPath), 1u);
+}
+
+static void TestBudget() {
+	Fixture fixture;
+	SelectionMatch match = {};
+	std::vector<SimulatedItem> items;
+	for (int i = 0; i < 50; i++) {
+		items.push_back({ L"D:\\Photos\\IMG_" + std::to_wstring(i) + (i == 49 ? L".pdf" : L".jpg"), false });
+	}
+	fixture.desktop.SetSelection(fixture.explorer, items);
+
+	// 匹配项在预算之外：无法给出结论，且不缓存
+	FileDetector::SetScanBudget(10, 0);
+	CHECK(fixture.Detect(kExplorerItem, match) == ScanVerdict::Inconclusive);
+	CHECK_EQ(fixture.desktop.CallCount(SimulatedCall::ItemPath), 10u);
+	CHECK(fixture.Detect(kExplorerItem, match) == ScanVerdict::Inconclusive);
+	CHECK_EQ(fixture.desktop.CallCount(SimulatedCall::ItemPath), 10u);
+
+	FileDetector::SetScanBudget(0, 0);
+	CHECK(fixture.Detect(kExplorerItem, match) == ScanVerdict::Match);
+	CHECK_EQ(fixture.desktop.CallCount(SimulatedCall::ItemPath), 50u);
+	FileDetector::SetScanBudget(2000, 200);
+}
+
+static void TestStageLatency() {
+	Fixture fixture;
+	std::vector<SimulatedItem> items;
+	for (int i = 0; i < 10; i++) {
+		items.push_back({ L"C:\\Work\\sheet" + std::to_wstring(i) + L".pdf", false });
+	}
+	PipelineStats::Summarize(PipelineStage::Selection, true);
+	for (int i = 0; i < 5; i++) {
+		// 每次替换选中项，避免命中缓存
+		fixture.desktop.SetSelection(fixture.explorer, items);
+		SelectionMatch match = {};
+		CHECK(fixture.Detect(kExplorerItem, match) == ScanVerdict::Match);
+	}
+	// 缓存命中不计入扫描阶段
+	SelectionMatch match = {};
+	CHECK(fixture.Detect(kExplorerItem, match) == ScanVerdict::Match);
+
+	LatencySummary summary = PipelineStats::Summarize(PipelineStage::Selection, true);
+	CHECK_EQ(summary.count, 5u);
+	CHECK(summary.p50 >= 10 * kItemPathMicros);
+}
+
+int main() {
+	Logger::SetLevel(LogLevel::Off);
+	FileDetector::SetExtensions({ L".pdf" });
+	TestVerdicts();
+	TestSelectionCache();
+	TestBudget();
+	TestStageLatency();
+	return CheckResult("DetectionPipelineTest");
+}
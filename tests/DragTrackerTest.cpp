@@ -0,0 +1,184 @@
+﻿#include "Check.h"
+#include "DragTracker.h"
+#include <string>
+#include <vector>
+
+// DragTracker 的状态转换：阈值、按键集合、序号与过期结果、放弃手势
+
+template <uint32_t Buttons>
+struct TracePolicy {
+	static const uint32_t kButtons = Buttons;
+	int thresholdX = 4;
+	int thresholdY = 4;
+	std::string trace;
+
+	int ThresholdX() const { return thresholdX; }
+	int ThresholdY() const { return thresholdY; }
+	void OnPress(uint32_t sequence, int32_t x, int32_t y) { Append("press", sequence, x, y); }
+	void OnDragStart(uint32_t sequence, int32_t x, int32_t y) { Append("drag", sequence, x, y); }
+	void OnRelease(uint32_t sequence, int32_t x, int32_t y) { Append("release", sequence, x, y); }
+	void OnCancel(uint32_t sequence) { Append("cancel", sequence, 0, 0); }
+
+	void Append(const char* action, uint32_t sequence, int32_t x, int32_t y) {
+		trace += std::string(action) + " " + std::to_string(sequence) + " " + std::to_string(x) + "," + std::to_string(y) + ";";
+	}
+	std::string Take() {
+		std::string result;
+		result.swap(trace);
+		return result;
+	}
+};
+
+typedef TracePolicy<kDragButtonLeft> LeftPolicy;
+typedef TracePolicy<kDragButtonLeft | kDragButtonRight | kDragButtonPen> MultiPolicy;
+
+static PointerInput Down(int32_t x, int32_t y, DragButton button = kDragButtonLeft) {
+	return { PointerAction::Down, button, x, y };
+}
+static PointerInput Up(int32_t x, int32_t y, DragButton button = kDragButtonLeft) {
+	return { PointerAction::Up, button, x, y };
+}
+static PointerInput Move(int32_t x, int32_t y) {
+	return { PointerAction::Move, kDragButtonLeft, x, y };
+}
+
+static void TestClickAndDrag() {
+	DragTracker<LeftPolicy> tracker;
+	// 状态只占一个 64 位字
+	CHECK_EQ(sizeof(tracker), sizeof(LeftPolicy) + sizeof(uint64_t));
+
+	tracker.Feed(Down(100, 200));
+	tracker.Feed(Move(103, 203));
+	tracker.Feed(Up(103, 203));
+	CHECK_EQ(tracker.GetPolicy().Take(), "press 1 100,200;cancel 1 0,0;");
+
+	// 越过阈值只通知一次；未确认的拖拽释放时不通知
+	tracker.Feed(Down(100, 200));
+	tracker.Feed(Move(104, 200));
+	tracker.Feed(Move(140, 200));
+	CHECK(tracker.IsDragging());
+	tracker.Feed(Up(140, 200));
+	CHECK_EQ(tracker.GetPolicy().Take(), "press 2 100,200;drag 2 104,200;");
+	CHECK(!tracker.IsPressed());
+
+	// 确认后释放
+	tracker.Feed(Down(-1920, -50));
+	tracker.Feed(Move(-1920, -54));
+	CHECK(tracker.AcceptResult(3));
+	CHECK(tracker.IsDetected());
+	tracker.Feed(Up(-1900, -60));
+	CHECK_EQ(tracker.GetPolicy().Take(), "press 3 -1920,-50;drag 3 -1920,-54;release 3 -1900,-60;");
+	CHECK_EQ(tracker.StartX(), -1920);
+	CHECK_EQ(tracker.StartY(), -50);
+}
+
+static void TestThresholdPerAxis() {
+	LeftPolicy policy;
+	policy.thresholdX = 10;
+	policy.thresholdY = 2;
+	DragTracker<LeftPolicy> tracker(policy);
+	tracker.Feed(Down(0, 0));
+	tracker.Feed(Move(9, 1));
+	CHECK(!tracker.IsDragging());
+	tracker.Feed(Move(9, -2));
+	CHECK(tracker.IsDragging());
+	tracker.Feed(Up(0, 0));
+	tracker.GetPolicy().Take();
+
+	tracker.Feed(Down(0, 0));
+	tracker.Feed(Move(-10, 0));
+	CHECK(tracker.IsDragging());
+}
+
+static void TestButtons() {
+	// 不在按键集合中的按键被忽略
+	DragTracker<LeftPolicy> left;
+	left.Feed(Down(0, 0, kDragButtonRight));
+	left.Feed(Move(50, 50));
+	left.Feed(Up(50, 50, kDragButtonRight));
+	CHECK_EQ(left.GetPolicy().Take(), "");
+	CHECK_EQ(left.Sequence(), 0u);
+
+	DragTracker<MultiPolicy> multi;
+	multi.Feed(Down(0, 0, kDragButtonPen));
+	CHECK(multi.Button() == kDragButtonPen);
+	multi.Feed(Move(0, 10));
+	// 拖拽中按下其它按键不打断当前拖拽，其它按键的松开也不结束拖拽
+	multi.Feed(Down(0, 10, kDragButtonRight));
+	multi.Feed(Up(0, 10, kDragButtonRight));
+	CHECK(multi.IsDragging());
+	CHECK(multi.AcceptResult(1));
+	multi.Feed(Up(0, 12, kDragButtonPen));
+	CHECK_EQ(multi.GetPolicy().Take(), "press 1 0,0;drag 1 0,10;release 1 0,12;");
+
+	multi.Feed(Down(5, 5, kDragButtonRight));
+	CHECK(multi.Button() == kDragButtonRight);
+	multi.Feed(Move(5, 0));
+	multi.Feed(Up(5, 0, kDragButtonRight));
+	CHECK_EQ(multi.GetPolicy().Take(), "press 2 5,5;drag 2 5,0;");
+}
+
+static void TestStaleResults() {
+	DragTracker<LeftPolicy> tracker;
+	tracker.Feed(Down(0, 0));
+	// 尚未开始拖拽
+	CHECK(!tracker.AcceptResult(1));
+	tracker.Feed(Move(10, 0));
+	// 序号不一致
+	CHECK(!tracker.AcceptResult(2));
+	tracker.Feed(Up(10, 0));
+	// 已经释放
+	CHECK(!tracker.AcceptResult(1));
+
+	// 丢失松开消息时同一按键再次按下，开始新的手势，旧结果作废
+	tracker.Feed(Down(0, 0));
+	tracker.Feed(Move(10, 0));
+	tracker.Feed(Down(20, 0));
+	CHECK_EQ(tracker.Sequence(), 3u);
+	CHECK(!tracker.AcceptResult(2));
+	tracker.Feed(Move(30, 0));
+	CHECK(tracker.AcceptResult(3));
+
+	// 放弃手势保留序号，不通知 Policy
+	tracker.GetPolicy().Take();
+	tracker.Reset();
+	CHECK(!tracker.IsPressed());
+	CHECK(!tracker.AcceptResult(3));
+	tracker.Feed(Up(30, 0));
+	CHECK_EQ(tracker.GetPolicy().Take(), "");
+	CHECK_EQ(tracker.Sequence(), 3u);
+}
+
+struct SilentPolicy {
+	static const uint32_t kButtons = kDragButtonLeft;
+	int ThresholdX() const { return 4; }
+	int ThresholdY() const { return 4; }
+	void OnPress(uint32_t, int32_t, int32_t) {}
+	void OnDragStart(uint32_t, int32_t, int32_t) {}
+	void OnRelease(uint32_t, int32_t, int32_t) {}
+	void OnCancel(uint32_t) {}
+};
+
+static void TestSequenceWrap() {
+	DragTracker<SilentPolicy> tracker;
+	const uint32_t mask = DragTracker<SilentPolicy>::kSequenceMask;
+	for (uint32_t i = 0; i < mask; i++) {
+		tracker.Feed(Down(0, 0));
+		tracker.Feed(Up(0, 0));
+	}
+	CHECK_EQ(tracker.Sequence(), mask);
+	tracker.Feed(Down(0, 0));
+	CHECK_EQ(tracker.Sequence(), 0u);
+	tracker.Feed(Move(10, 0));
+	// 结果携带的序号只比较低位
+	CHECK(tracker.AcceptResult(mask + 1));
+}
+
+int main() {
+	TestClickAndDrag();
+	TestThresholdPerAxis();
+	TestButtons();
+	TestStaleResults();
+	TestSequenceWrap();
+	return CheckResult("DragTrackerTest");
+}
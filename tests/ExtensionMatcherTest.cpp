@@ -0,0 +1,81 @@
+﻿#include "Check.h"
+#include "ExtensionMatcher.h"
+
+static void TestSingleExtensions() {
+	ExtensionMatcher matcher({ L".pdf", L"dwg", L".TXT" });
+	CHECK(!matcher.Empty());
+	CHECK(matcher.Matches(L"C:\\Work\\plan.pdf"));
+	// 配置和路径都不区分 ASCII 大小写，配置中的前导 '.' 可省略
+	CHECK(matcher.Matches(L"C:\\Work\\PLAN.Pdf"));
+	CHECK(matcher.Matches(L"C:\\Work\\floor.dwg"));
+	CHECK(matcher.Matches(L"/home/me/readme.txt"));
+	CHECK(!matcher.Matches(L"C:\\Work\\plan.pdfx"));
+	CHECK(!matcher.Matches(L"C:\\Work\\plan"));
+	CHECK(!matcher.Matches(L"C:\\Work\\pdf"));
+	CHECK(!matcher.Matches(L""));
+	CHECK(!matcher.Matches(nullptr, 0));
+	// 扩展名只在文件名内查找
+	CHECK(!matcher.Matches(L"C:\\Work.pdf\\plan"));
+	CHECK(!matcher.Matches(L"C:\\Work.pdf\\"));
+	CHECK(!matcher.Matches(L"C:.pdf\\x"));
+	// 非 ASCII 字符不做折叠
+	CHECK(matcher.Matches(L"C:\\文档\\计划.pdf"));
+	CHECK(!matcher.Matches(L"C:\\Work\\plan.ｐｄｆ"));
+}
+
+static void TestCompoundExtensions() {
+	ExtensionMatcher matcher({ L".tar.gz", L".d.ts", L".gz" });
+	CHECK(matcher.Matches(L"/src/backup.tar.gz"));
+	CHECK(matcher.Matches(L"/src/backup.TAR.GZ"));
+	CHECK(matcher.Matches(L"/src/types/index.d.ts"));
+	CHECK(matcher.Matches(L"/src/log.gz"));
+	CHECK(!matcher.Matches(L"/src/index.ts"));
+	CHECK(!matcher.Matches(L"/src/archive.tar"));
+	// 多段扩展名只匹配完整的后缀
+	CHECK(!matcher.Matches(L"/src/a.d.tsx"));
+
+	ExtensionMatcher single({ L".ts" });
+	CHECK(single.Matches(L"/src/index.d.ts"));
+	CHECK(!single.Matches(L"/src/index.d.tsx"));
+}
+
+static void TestLimits() {
+	ExtensionMatcher empty;
+	CHECK(empty.Empty());
+	CHECK(!empty.Matches(L"a.txt"));
+
+	// 超长的扩展名被忽略
+	std::wstring longExtension = L"." + std::wstring(ExtensionMatcher::kMaxExtensionLength, L'x');
+	ExtensionMatcher matcher({ longExtension, L"", L".txt" });
+	CHECK(!matcher.Matches(L"a" + longExtension));
+	CHECK(matcher.Matches(L"a.txt"));
+
+	// 大量扩展名时探测链仍然正确
+	std::set<std::wstring> many;
+	for (int i = 0; i < 500; i++) {
+		many.insert(L".e" + std::to_wstring(i));
+	}
+	ExtensionMatcher large(many);
+	for (int i = 0; i < 500; i++) {
+		CHECK(large.Matches(L"C:\\f.E" + std::to_wstring(i)));
+	}
+	CHECK(!large.Matches(L"C:\\f.e500"));
+}
+
+static void TestFoldAscii() {
+	for (wchar_t c = 0; c < 0x3000; c++) {
+		wchar_t expected = (c >= L'A' && c <= L'Z') ? (wchar_t)(c - L'A' + L'a') : c;
+		if (ExtensionMatcher::FoldAscii(c) != expected) {
+			CHECK(ExtensionMatcher::FoldAscii(c) == expected);
+			break;
+		}
+	}
+}
+
+int main() {
+	TestSingleExtensions();
+	TestCompoundExtensions();
+	TestLimits();
+	TestFoldAscii();
+	return CheckResult("ExtensionMatcherTest");
+}
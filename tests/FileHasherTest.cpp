@@ -0,0 +1,191 @@
+﻿#include "Check.h"
+#include "FileHasher.h"
+#include "Xxh64.h"
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+// XXH64 与参考实现 (xxhash 0.8) 的结果对照，流式分块与一次计算一致；
+// 后台哈希跨越映射窗口的大文件、缺失的文件、取消、哈希期间被截断的文件，以及只请求停止后重新启动
+
+static void TestVectors() {
+	CHECK_EQ(Xxh64::Hash("", 0), 0xEF46DB3751D8E999ull);
+	CHECK_EQ(Xxh64::Hash("a", 1), 0xD24EC4F1A98C6E5Bull);
+	CHECK_EQ(Xxh64::Hash("abc", 3), 0x44BC2CF5AD770999ull);
+	const char* sentence = "Nobody inspects the spammish repetition";
+	CHECK_EQ(Xxh64::Hash(sentence, 39), 0xFBCEA83C8A378BF1ull);
+
+	std::vector<uint8_t> bytes(1024);
+	for (size_t i = 0; i < bytes.size(); i++) bytes[i] = (uint8_t)i;
+	CHECK_EQ(Xxh64::Hash(bytes.data(), bytes.size()), 0x6F3914F18FE4DF57ull);
+
+	const uint64_t seed = 0x9E3779B185EBCA87ull;
+	CHECK_EQ(Xxh64::Hash("", 0, seed), 0x6EC6D05F61C7E7A7ull);
+	CHECK_EQ(Xxh64::Hash("abc", 3, seed), 0xA7CB2AAC405E36C7ull);
+	CHECK_EQ(Xxh64::Hash(bytes.data(), bytes.size(), seed), 0xDAC5100D94914D1Dull);
+}
+
+static void TestStreaming() {
+	std::mt19937 random(7);
+	std::vector<uint8_t> bytes(4099);
+	for (uint8_t& byte : bytes) byte = (uint8_t)random();
+	uint64_t expected = Xxh64::Hash(bytes.data(), bytes.size());
+
+	// 各种分块方式，包括跨越 32 字节条带和 1 字节的块
+	const size_t steps[] = { 1, 3, 31, 32, 33, 64, 1000, 4099 };
+	for (size_t step : steps) {
+		Xxh64 hash;
+		for (size_t offset = 0; offset < bytes.size(); offset += step) {
+			hash.Update(bytes.data() + offset, std::min(step, bytes.size() - offset));
+			// Digest 不改变状态
+			hash.Digest();
+		}
+		CHECK_EQ(hash.Digest(), expected);
+	}
+
+	Xxh64 hash;
+	hash.Update(bytes.data(), 100);
+	hash.Reset();
+	hash.Update(bytes.data(), bytes.size());
+	CHECK_EQ(hash.Digest(), expected);
+}
+
+struct Completion {
+	std::mutex mutex;
+	std::condition_variable done;
+	int calls = 0;
+
+	static void Callback(void* context, const std::shared_ptr<HashJob>&) {
+		Completion* completion = static_cast<Completion*>(context);
+		std::lock_guard<std::mutex> lock(completion->mutex);
+		completion->calls++;
+		completion->done.notify_all();
+	}
+
+	// Seal 返回 false 时等待完成回调
+	bool Wait(HashJob& job) {
+		if (job.Seal()) {
+			return true;
+		}
+		std::unique_lock<std::mutex> lock(mutex);
+		return done.wait_for(lock, std::chrono::seconds(30), [this]() { return calls > 0; });
+	}
+};
+
+static std::shared_ptr<MatchedPaths> Paths(const std::vector<std::wstring>& paths) {
+	std::shared_ptr<MatchedPaths> result = std::make_shared<MatchedPaths>(0);
+	for (const std::wstring& path : paths) result->Add(path.c_str(), path.size());
+	return result;
+}
+
+static std::vector<uint8_t> WriteFile(const std::filesystem::path& path, size_t size, uint32_t seed) {
+	std::vector<uint8_t> bytes(size);
+	std::mt19937 random(seed);
+	for (size_t i = 0; i < size; i += 4) {
+		uint32_t value = random();
+		for (size_t j = 0; j < 4 && i + j < size; j++) bytes[i + j] = (uint8_t)(value >> (8 * j));
+	}
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out.write((const char*)bytes.data(), (std::streamsize)bytes.size());
+	return bytes;
+}
+
+static void TestBackgroundHash(const std::filesystem::path& directory) {
+	// 大文件跨越映射窗口边界且末尾不足一个条带
+	std::filesystem::path large = directory / "large.bin";
+	std::filesystem::path small = directory / "small.bin";
+	std::filesystem::path empty = directory / "empty.bin";
+	std::filesystem::path missing = directory / "missing.bin";
+	uint64_t largeDigest = Xxh64::Hash(WriteFile(large, FileHasher::kWindowBytes + 12345, 1).data(), FileHasher::kWindowBytes + 12345);
+	std::vector<uint8_t> smallBytes = WriteFile(small, 777, 2);
+	WriteFile(empty, 0, 3);
+
+	Completion completion;
+	std::shared_ptr<HashJob> job = FileHasher::Begin(
+		Paths({ large.wstring(), small.wstring(), empty.wstring(), missing.wstring() }), Completion::Callback, &completion);
+	CHECK(completion.Wait(*job));
+
+	FileHashResult result = job->Get(0);
+	CHECK(result.status == HashStatus::Done);
+	CHECK_EQ(result.size, (uint64_t)FileHasher::kWindowBytes + 12345);
+	CHECK_EQ(result.digest, largeDigest);
+	CHECK(result.mtime > 0);
+	result = job->Get(1);
+	CHECK(result.status == HashStatus::Done);
+	CHECK_EQ(result.digest, Xxh64::Hash(smallBytes.data(), smallBytes.size()));
+	result = job->Get(2);
+	CHECK(result.status == HashStatus::Done);
+	CHECK_EQ(result.size, 0u);
+	CHECK_EQ(result.digest, 0xEF46DB3751D8E999ull);
+	CHECK(job->Get(3).status == HashStatus::Failed);
+	CHECK(completion.calls <= 1);
+}
+
+static void TestCancel(const std::filesystem::path& directory) {
+	std::vector<std::wstring> paths;
+	for (int i = 0; i < 8; i++) {
+		std::filesystem::path path = directory / ("cancel" + std::to_string(i) + ".bin");
+		WriteFile(path, 4 * 1024 * 1024, 10 + i);
+		paths.push_back(path.wstring());
+	}
+	Completion completion;
+	std::shared_ptr<HashJob> job = FileHasher::Begin(Paths(paths), Completion::Callback, &completion);
+	job->Cancel();
+	CHECK(completion.Wait(*job));
+	// 取消前已完成的文件保留结果，其余为 Cancelled，不会停在中间状态
+	for (size_t i = 0; i < job->Count(); i++) {
+		HashStatus status = job->Get(i).status;
+		CHECK(status == HashStatus::Done || status == HashStatus::Cancelled);
+	}
+	CHECK(job->Get(job->Count() - 1).status == HashStatus::Cancelled);
+}
+
+// 哈希期间文件被截断：结果为 Failed（或截断前已完成），不会使进程崩溃 (SIGBUS)
+static void TestTruncate(const std::filesystem::path& directory) {
+	std::filesystem::path path = directory / "truncated.bin";
+	WriteFile(path, 3 * FileHasher::kWindowBytes, 30);
+	Completion completion;
+	std::shared_ptr<HashJob> job = FileHasher::Begin(Paths({ path.wstring() }), Completion::Callback, &completion);
+	std::filesystem::resize_file(path, 4096);
+	CHECK(completion.Wait(*job));
+	HashStatus status = job->Get(0).status;
+	CHECK(status == HashStatus::Failed || status == HashStatus::Done);
+}
+
+// 只请求停止时不等待线程退出，之后提交的任务直接取消；Stop 完成后线程池可以再次启动
+static void TestRequestStop(const std::filesystem::path& directory) {
+	std::filesystem::path path = directory / "restart.bin";
+	std::vector<uint8_t> bytes = WriteFile(path, 5000, 20);
+	FileHasher::RequestStop();
+	FileHasher::RequestStop();
+	std::shared_ptr<HashJob> rejected = FileHasher::Begin(Paths({ path.wstring() }), nullptr, nullptr);
+	CHECK(rejected->Cancelled());
+	FileHasher::Stop();
+
+	Completion completion;
+	std::shared_ptr<HashJob> job = FileHasher::Begin(Paths({ path.wstring() }), Completion::Callback, &completion);
+	CHECK(!job->Cancelled());
+	CHECK(completion.Wait(*job));
+	CHECK(job->Get(0).status == HashStatus::Done);
+	CHECK_EQ(job->Get(0).digest, Xxh64::Hash(bytes.data(), bytes.size()));
+}
+
+int main() {
+	TestVectors();
+	TestStreaming();
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / ("filedrop-hash-" + std::to_string(std::random_device()()));
+	std::filesystem::create_directories(directory);
+	TestBackgroundHash(directory);
+	TestCancel(directory);
+	TestTruncate(directory);
+	TestRequestStop(directory);
+	FileHasher::Stop();
+	std::filesystem::remove_all(directory);
+	return CheckResult("FileHasherTest");
+}
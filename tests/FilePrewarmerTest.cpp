@@ -0,0 +1,113 @@
+﻿#include "Check.h"
+#include "FilePrewarmer.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 文件预热：取走的视图与文件内容一致、可写且不写回文件；取走后文件被截断，访问视图不会使进程崩溃 (SIGBUS)；
+// 映射后被修改的文件与超过大小限制的文件不会交给调用方
+
+static std::vector<uint8_t> WriteFile(const std::filesystem::path& path, size_t size, uint32_t seed) {
+	std::vector<uint8_t> bytes(size);
+	std::mt19937 random(seed);
+	for (uint8_t& byte : bytes) byte = (uint8_t)random();
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out.write((const char*)bytes.data(), (std::streamsize)bytes.size());
+	return bytes;
+}
+
+static std::shared_ptr<MatchedPaths> Paths(const std::vector<std::filesystem::path>& paths) {
+	std::shared_ptr<MatchedPaths> result = std::make_shared<MatchedPaths>(0);
+	for (const std::filesystem::path& path : paths) {
+		std::wstring wide = path.wstring();
+		result->Add(wide.c_str(), wide.size());
+	}
+	return result;
+}
+
+// 等到已处理（映射或跳过）的文件数达到 count
+static bool WaitProcessed(unsigned long long count) {
+	for (int i = 0; i < 5000; i++) {
+		PrewarmStats stats = FilePrewarmer::GetStats();
+		if (stats.files + stats.skipped >= count) return true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return false;
+}
+
+static void TestTakeAndTruncate(const std::filesystem::path& directory) {
+	std::filesystem::path path = directory / "drawing.pdf";
+	std::vector<uint8_t> bytes = WriteFile(path, 3 * 1024 * 1024 + 17, 1);
+	PrewarmStats before = FilePrewarmer::GetStats();
+	FilePrewarmer::Prewarm(Paths({ path }));
+	CHECK(WaitProcessed(before.files + before.skipped + 1));
+
+	std::shared_ptr<MappedFile> file = FilePrewarmer::Take(path.wstring());
+	CHECK(file != nullptr);
+	if (!file) return;
+	CHECK_EQ(file->Size(), bytes.size());
+	// 每个文件只能取走一次
+	CHECK(FilePrewarmer::Take(path.wstring()) == nullptr);
+
+	// 文件被其他程序截断后，视图仍可完整访问
+	std::filesystem::resize_file(path, 100);
+	uint8_t* data = const_cast<uint8_t*>(file->Data());
+	CHECK(std::equal(bytes.begin(), bytes.end(), data));
+	// 写入只修改私有副本
+	data[0] ^= 0xFF;
+	data[file->Size() - 1] ^= 0xFF;
+	std::ifstream in(path, std::ios::binary);
+	char first = 0;
+	in.read(&first, 1);
+	CHECK_EQ((uint8_t)first, bytes[0]);
+	file.reset();
+}
+
+static void TestChangedFile(const std::filesystem::path& directory) {
+	std::filesystem::path path = directory / "changed.pdf";
+	WriteFile(path, 4096, 2);
+	PrewarmStats before = FilePrewarmer::GetStats();
+	FilePrewarmer::Prewarm(Paths({ path }));
+	CHECK(WaitProcessed(before.files + before.skipped + 1));
+	// 映射之后文件被改写，内容已不可信
+	WriteFile(path, 8192, 3);
+	CHECK(FilePrewarmer::Take(path.wstring()) == nullptr);
+	CHECK_EQ(FilePrewarmer::GetStats().evicted, before.evicted + 1);
+}
+
+static void TestLimits(const std::filesystem::path& directory) {
+	std::filesystem::path small = directory / "small.pdf";
+	std::filesystem::path large = directory / "large.pdf";
+	WriteFile(small, 1000, 4);
+	WriteFile(large, 200000, 5);
+	FilePrewarmer::SetLimits({ 0, 100000, 0 });
+	PrewarmStats before = FilePrewarmer::GetStats();
+	FilePrewarmer::Prewarm(Paths({ small, large, directory / "missing.pdf" }));
+	CHECK(WaitProcessed(before.files + before.skipped + 3));
+	PrewarmStats after = FilePrewarmer::GetStats();
+	CHECK_EQ(after.files, before.files + 1);
+	CHECK_EQ(after.skipped, before.skipped + 2);
+	CHECK_EQ(after.bytes, 1000u);
+	CHECK(FilePrewarmer::Take(large.wstring()) == nullptr);
+
+	// 释放缓存后不能再取走
+	FilePrewarmer::Clear();
+	CHECK_EQ(FilePrewarmer::GetStats().bytes, 0u);
+	CHECK(FilePrewarmer::Take(small.wstring()) == nullptr);
+	FilePrewarmer::SetLimits({ FilePrewarmer::kDefaultMaxBytes, FilePrewarmer::kDefaultMaxFileBytes, FilePrewarmer::kDefaultRetainMillis });
+}
+
+int main() {
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / ("filedrop-prewarm-" + std::to_string(std::random_device()()));
+	std::filesystem::create_directories(directory);
+	TestTakeAndTruncate(directory);
+	TestChangedFile(directory);
+	TestLimits(directory);
+	FilePrewarmer::Stop();
+	std::filesystem::remove_all(directory);
+	return CheckResult("FilePrewarmerTest");
+}
@@ -0,0 +1,133 @@
+﻿#include "Check.h"
+#include "HookWatchdog.h"
+
+// 注入的时钟：1 毫秒 = 1000 刻度，时间只在测试中手动推进
+static uint64_t g_now = 1000000;
+
+struct FakeClock {
+	uint64_t Now() const { return g_now; }
+	uint64_t FromMillis(uint32_t ms) const { return (uint64_t)ms * 1000; }
+};
+
+typedef HookWatchdog<FakeClock> Watchdog;
+
+// 超时 300ms、预算 100ms、10 秒内 3 次超出预算降级、30 秒无超出恢复、光标移动 1 秒无调用视为失效
+static const Watchdog::Config kConfig = { 300, 100, 3, 10000, 30000, 1000 };
+
+static void Advance(uint32_t ms) {
+	g_now += (uint64_t)ms * 1000;
+}
+
+static void Call(Watchdog& watchdog, uint32_t ms, uint32_t queuedMillis = 0) {
+	uint64_t start = watchdog.Enter();
+	Advance(ms);
+	watchdog.Exit(start, queuedMillis);
+}
+
+static void TestCountsAndMax() {
+	Watchdog watchdog;
+	watchdog.Configure(kConfig);
+	Call(watchdog, 1);
+	Call(watchdog, 100);
+	Call(watchdog, 40);
+	HookHealth health = watchdog.Health();
+	CHECK_EQ(health.calls, 3u);
+	// 恰好等于预算不算超出
+	CHECK_EQ(health.overruns, 0u);
+	CHECK_EQ(health.maxTicks, 100000u);
+	CHECK(!health.degraded);
+	CHECK(!watchdog.Check(false));
+}
+
+static void TestDegradeAndRecover() {
+	Watchdog watchdog;
+	watchdog.Configure(kConfig);
+	Call(watchdog, 150);
+	Advance(1000);
+	Call(watchdog, 150);
+	CHECK(!watchdog.Degraded());
+	Advance(1000);
+	Call(watchdog, 150);
+	CHECK(watchdog.Degraded());
+	CHECK_EQ(watchdog.Health().degradations, 1u);
+	// 已降级时继续超出预算不重复计数
+	Call(watchdog, 150);
+	CHECK_EQ(watchdog.Health().degradations, 1u);
+	CHECK_EQ(watchdog.Health().overruns, 4u);
+	// 超出预算但未超时，不需要重新安装
+	CHECK(!watchdog.Check(false));
+
+	// 距最后一次超出不足 30 秒时保持降级
+	Advance(29000);
+	watchdog.Check(false);
+	CHECK(watchdog.Degraded());
+	Advance(2000);
+	watchdog.Check(false);
+	CHECK(!watchdog.Degraded());
+	CHECK(!watchdog.Health().degraded);
+
+	// 恢复后重新计数
+	Call(watchdog, 150);
+	Call(watchdog, 150);
+	CHECK(!watchdog.Degraded());
+	Call(watchdog, 150);
+	CHECK(watchdog.Degraded());
+	CHECK_EQ(watchdog.Health().degradations, 2u);
+}
+
+static void TestSparseOverrunsDoNotDegrade() {
+	Watchdog watchdog;
+	watchdog.Configure(kConfig);
+	// 每 6 秒一次，任意 10 秒窗口内最多两次
+	for (int i = 0; i < 10; i++) {
+		Call(watchdog, 150);
+		Advance(6000);
+	}
+	CHECK_EQ(watchdog.Health().overruns, 10u);
+	CHECK(!watchdog.Degraded());
+}
+
+static void TestTimeoutRequestsReinstall() {
+	Watchdog watchdog;
+	watchdog.Configure(kConfig);
+	Call(watchdog, 301);
+	CHECK_EQ(watchdog.Health().timeouts, 1u);
+	CHECK(watchdog.Check(false));
+	// 重新安装前每次检查都要求重新安装
+	CHECK(watchdog.Check(false));
+	watchdog.OnReinstalled();
+	CHECK_EQ(watchdog.Health().reinstalls, 1u);
+	CHECK(!watchdog.Check(false));
+
+	// 排队时间同样计入：回调本身只用了 10ms
+	Call(watchdog, 10, 295);
+	CHECK_EQ(watchdog.Health().timeouts, 2u);
+	CHECK_EQ(watchdog.Health().maxTicks, 305000u);
+	CHECK(watchdog.Check(false));
+}
+
+static void TestSilentUnhook() {
+	Watchdog watchdog;
+	watchdog.Configure(kConfig);
+	Call(watchdog, 1);
+	Advance(500);
+	CHECK(!watchdog.Check(true));
+	Advance(1000);
+	// 光标没有移动时钩子不被调用是正常的
+	CHECK(!watchdog.Check(false));
+	CHECK(watchdog.Check(true));
+	watchdog.OnReinstalled();
+	CHECK(!watchdog.Check(true));
+	Call(watchdog, 1);
+	Advance(900);
+	CHECK(!watchdog.Check(true));
+}
+
+int main() {
+	TestCountsAndMax();
+	TestDegradeAndRecover();
+	TestSparseOverrunsDoNotDegrade();
+	TestTimeoutRequestsReinstall();
+	TestSilentUnhook();
+	return CheckResult("HookWatchdogTest");
+}
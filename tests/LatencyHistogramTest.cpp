@@ -0,0 +1,126 @@
+﻿#include "Check.h"
+#include "LatencyHistogram.h"
+#include "PipelineStats.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+// 代表值不小于原值，且相对误差不超过 1/16
+static void TestBucketError() {
+	size_t previous = 0;
+	for (uint64_t value = 0; value < (1ull << 22); value += 1 + value / 97) {
+		size_t index = LatencyHistogram::BucketIndex(value);
+		CHECK(index < LatencyHistogram::kBucketCount);
+		CHECK(index >= previous);
+		previous = index;
+		uint64_t highest = LatencyHistogram::BucketHighestValue(index);
+		CHECK(highest >= value);
+		CHECK(highest - value <= value / LatencyHistogram::kSubBucketCount);
+	}
+	// 小值精确
+	for (uint64_t value = 0; value < 2 * LatencyHistogram::kSubBucketCount; value++) {
+		CHECK_EQ(LatencyHistogram::BucketHighestValue(LatencyHistogram::BucketIndex(value)), value);
+	}
+	// 超出范围的值计入最后一个桶
+	CHECK_EQ(LatencyHistogram::BucketIndex(~0ull), LatencyHistogram::kBucketCount - 1);
+}
+
+static uint64_t ExactPercentile(std::vector<uint64_t> values, unsigned percent) {
+	std::sort(values.begin(), values.end());
+	size_t rank = (values.size() * percent + 99) / 100;
+	return values[rank == 0 ? 0 : rank - 1];
+}
+
+static bool Near(uint64_t estimate, uint64_t exact) {
+	return estimate >= exact && estimate - exact <= exact / LatencyHistogram::kSubBucketCount;
+}
+
+static void TestPercentiles() {
+	std::mt19937_64 random(13);
+	// 对数均匀分布，覆盖 1 微秒到约 1 秒
+	std::uniform_real_distribution<double> exponent(0.0, 20.0);
+	std::vector<uint64_t> values;
+	LatencyHistogram histogram;
+	for (int i = 0; i < 100000; i++) {
+		uint64_t value = (uint64_t)std::pow(2.0, exponent(random));
+		values.push_back(value);
+		histogram.Record(value);
+	}
+	LatencySummary summary = histogram.Summarize(false);
+	CHECK_EQ(summary.count, values.size());
+	CHECK_EQ(summary.max, *std::max_element(values.begin(), values.end()));
+	CHECK(Near(summary.p50, ExactPercentile(values, 50)));
+	CHECK(Near(summary.p90, ExactPercentile(values, 90)));
+	CHECK(Near(summary.p99, ExactPercentile(values, 99)));
+
+	// 不重置时窗口保留，重置后清空
+	CHECK_EQ(histogram.Summarize(true).count, values.size());
+	LatencySummary empty = histogram.Summarize(false);
+	CHECK_EQ(empty.count, 0u);
+	CHECK_EQ(empty.max, 0u);
+	CHECK_EQ(empty.p99, 0u);
+}
+
+static void TestSingleValue() {
+	LatencyHistogram histogram;
+	histogram.Record(1000);
+	LatencySummary summary = histogram.Summarize(true);
+	CHECK_EQ(summary.count, 1u);
+	// 代表值被实际最大值截断
+	CHECK_EQ(summary.p50, 1000u);
+	CHECK_EQ(summary.p99, 1000u);
+	CHECK_EQ(summary.max, 1000u);
+}
+
+static void TestConcurrentRecord() {
+	LatencyHistogram histogram;
+	const int kThreads = 4;
+	const int kPerThread = 100000;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < kThreads; t++) {
+		threads.emplace_back([&histogram, t]() {
+			for (int i = 0; i < kPerThread; i++) {
+				histogram.Record((uint64_t)(t * 1000 + i % 1000));
+			}
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	LatencySummary summary = histogram.Summarize(true);
+	CHECK_EQ(summary.count, (uint64_t)kThreads * kPerThread);
+	CHECK_EQ(summary.max, (uint64_t)(kThreads * 1000 - 1));
+}
+
+static void TestPipelineStats() {
+	for (int i = 0; i < (int)PipelineStage::Count; i++) {
+		const char* name = PipelineStats::StageName((PipelineStage)i);
+		CHECK(name != nullptr && std::strlen(name) > 0);
+		PipelineStats::Summarize((PipelineStage)i, true);
+	}
+	int64_t start = PipelineStats::Now();
+	int64_t perMilli = PipelineStats::TicksPerSecond() / 1000;
+	PipelineStats::Record(PipelineStage::Detect, start, start + 5 * perMilli);
+	// 结束早于开始（时钟回退）或起点未记录时忽略
+	PipelineStats::Record(PipelineStage::Detect, start, start - perMilli);
+	PipelineStats::Record(PipelineStage::Detect, 0, start);
+	LatencySummary summary = PipelineStats::Summarize(PipelineStage::Detect, true);
+	CHECK_EQ(summary.count, 1u);
+	CHECK_EQ(summary.max, 5000u);
+	{
+		StageTimer timer(PipelineStage::Classify);
+	}
+	CHECK_EQ(PipelineStats::Summarize(PipelineStage::Classify, true).count, 1u);
+}
+
+int main() {
+	TestBucketError();
+	TestPercentiles();
+	TestSingleValue();
+	TestConcurrentRecord();
+	TestPipelineStats();
+	return CheckResult("LatencyHistogramTest");
+}
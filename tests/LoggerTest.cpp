@@ -0,0 +1,144 @@
+﻿#include "Check.h"
+#include "Logger.h"
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::atomic<int> g_notifyCount(0);
+
+static void CountNotify() {
+	g_notifyCount++;
+}
+
+static void CollectRecord(void* context, const LogRecord& record) {
+	static_cast<std::vector<LogRecord>*>(context)->push_back(record);
+}
+
+static std::vector<LogRecord> DrainAll() {
+	std::vector<LogRecord> records;
+	while (Logger::Drain(CollectRecord, &records, 256) > 0) {
+	}
+	return records;
+}
+
+static int g_evaluated = 0;
+
+static std::wstring Evaluate(const wchar_t* text) {
+	g_evaluated++;
+	return text;
+}
+
+static void TestRecordContents() {
+	Logger::SetLevel(LogLevel::Debug);
+	Logger::Write(LogLevel::Info, L"拖拽开始 C:\\文档\\a.pdf");
+	Logger::Write(LogLevel::Error, std::wstring(L"failed"));
+	std::vector<LogRecord> records = DrainAll();
+	CHECK_EQ(records.size(), 2u);
+	if (records.size() == 2) {
+		const char expected[] = u8"拖拽开始 C:\\文档\\a.pdf";
+		CHECK(records[0].level == LogLevel::Info);
+		CHECK(records[0].timestamp > 0);
+		CHECK_EQ(records[0].length, sizeof(expected) - 1);
+		CHECK(std::memcmp(records[0].text, expected, sizeof(expected) - 1) == 0);
+		CHECK(records[1].level == LogLevel::Error);
+		CHECK(std::string(records[1].text, records[1].length) == "failed");
+	}
+}
+
+static void TestLevelFilter() {
+	Logger::SetLevel(LogLevel::Info);
+	g_evaluated = 0;
+	// 未启用的级别不构造日志字符串
+	LOG_DEBUG(Evaluate(L"hidden"));
+	LOG_INFO(Evaluate(L"shown"));
+	CHECK_EQ(g_evaluated, 1);
+	CHECK(!Logger::IsEnabled(LogLevel::Debug));
+	CHECK(Logger::IsEnabled(LogLevel::Error));
+
+	Logger::SetLevel(LogLevel::Off);
+	LOG_ERROR(Evaluate(L"off"));
+	CHECK_EQ(g_evaluated, 1);
+	CHECK_EQ(DrainAll().size(), 1u);
+}
+
+static void TestTruncation() {
+	Logger::SetLevel(LogLevel::Info);
+	// 每个字符 3 字节，超出记录长度时在完整字符处截断
+	Logger::Write(LogLevel::Info, std::wstring(1000, L'中'));
+	std::vector<LogRecord> records = DrainAll();
+	CHECK_EQ(records.size(), 1u);
+	if (records.size() == 1) {
+		CHECK(records[0].length <= LogRecord::kMaxText);
+		CHECK(records[0].length > LogRecord::kMaxText - 3);
+		CHECK_EQ(records[0].length % 3, 0u);
+	}
+}
+
+static void TestFullRing() {
+	Logger::SetLevel(LogLevel::Info);
+	Logger::TakeDroppedCount();
+	g_notifyCount = 0;
+	Logger::SetNotify(CountNotify);
+	for (int i = 0; i < 1100; i++) {
+		Logger::Write(LogLevel::Info, L"x");
+	}
+	// 队列容量为 1024，多出的记录丢弃并计数，不阻塞写入线程；只有写入成功时才通知
+	CHECK_EQ(Logger::TakeDroppedCount(), 76u);
+	CHECK_EQ(Logger::TakeDroppedCount(), 0u);
+	CHECK_EQ(g_notifyCount.load(), 1024);
+	CHECK_EQ(DrainAll().size(), 1024u);
+	Logger::SetNotify(nullptr);
+}
+
+// 多个线程同时写入、一个线程取出：每条记录要么取出要么计入丢弃，同一线程的记录保持顺序
+static void TestConcurrentProducers() {
+	const int kProducers = 4;
+	const int kPerProducer = 20000;
+	Logger::SetLevel(LogLevel::Info);
+	Logger::TakeDroppedCount();
+
+	std::atomic<int> running(kProducers);
+	std::vector<std::thread> producers;
+	for (int p = 0; p < kProducers; p++) {
+		producers.emplace_back([&, p]() {
+			for (int i = 0; i < kPerProducer; i++) {
+				Logger::Write(LogLevel::Info, std::to_wstring(p) + L" " + std::to_wstring(i));
+			}
+			running--;
+		});
+	}
+
+	std::vector<int> last(kProducers, -1);
+	long received = 0;
+	bool ordered = true;
+	auto consume = [&]() {
+		for (const LogRecord& record : DrainAll()) {
+			std::string text(record.text, record.length);
+			int producer = std::stoi(text);
+			int sequence = std::stoi(text.substr(text.find(' ') + 1));
+			ordered = ordered && sequence > last[producer];
+			last[producer] = sequence;
+			received++;
+		}
+	};
+	while (running.load() > 0) {
+		consume();
+	}
+	for (std::thread& producer : producers) {
+		producer.join();
+	}
+	consume();
+	CHECK(ordered);
+	CHECK_EQ(received + (long)Logger::TakeDroppedCount(), (long)kProducers * kPerProducer);
+}
+
+int main() {
+	TestRecordContents();
+	TestLevelFilter();
+	TestTruncation();
+	TestFullRing();
+	TestConcurrentProducers();
+	return CheckResult("LoggerTest");
+}
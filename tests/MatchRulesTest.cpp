@@ -0,0 +1,150 @@
+﻿#include "Check.h"
+#include "MatchRules.h"
+#include "Snapshot.h"
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+// 匹配规则：扩展名、文件名通配符与排除规则，通配符与逐字符回溯的参考实现对拍；
+// 快照发布期间读取方只会看到完整的规则
+
+static MatchRules Rules(std::set<std::wstring> extensions, std::vector<std::wstring> globs, std::vector<std::wstring> exclusions) {
+	MatchRuleSet set;
+	set.extensions = extensions;
+	set.globs = globs;
+	set.exclusions = exclusions;
+	return MatchRules(set);
+}
+
+static void TestGlobs() {
+	MatchRules rules = Rules({}, { L"report_*.xlsx", L"IMG_????.jpg", L"Makefile" }, {});
+	CHECK(rules.Matches(L"C:\\Finance\\report_2024.xlsx"));
+	CHECK(rules.Matches(L"C:\\Finance\\REPORT_.XLSX"));
+	CHECK(rules.Matches(L"D:/share/report_q1_final.xlsx"));
+	CHECK(!rules.Matches(L"C:\\Finance\\report_2024.xls"));
+	CHECK(!rules.Matches(L"C:\\Finance\\myreport_2024.xlsx"));
+	// 通配符只作用于文件名，不匹配目录
+	CHECK(!rules.Matches(L"C:\\report_x\\notes.xlsx.bak"));
+	CHECK(rules.Matches(L"C:\\Photos\\IMG_0042.jpg"));
+	CHECK(!rules.Matches(L"C:\\Photos\\IMG_042.jpg"));
+	CHECK(!rules.Matches(L"C:\\Photos\\IMG_00042.jpg"));
+	// 不含通配符的模式表示完整的文件名
+	CHECK(rules.Matches(L"C:\\src\\makefile"));
+	CHECK(!rules.Matches(L"C:\\src\\Makefile.am"));
+	CHECK(rules.Matches(L"E:Makefile"));
+	CHECK(!rules.Matches(L""));
+	CHECK(!rules.Matches(nullptr, 0));
+}
+
+static void TestExclusions() {
+	MatchRules rules = Rules({ L".docx", L".xlsx" }, { L"draft*" }, { L"~$*", L"*.tmp.docx" });
+	CHECK(rules.Matches(L"C:\\Work\\plan.docx"));
+	CHECK(!rules.Matches(L"C:\\Work\\~$plan.docx"));
+	CHECK(!rules.Matches(L"C:\\Work\\plan.tmp.docx"));
+	CHECK(rules.Matches(L"C:\\Work\\draft notes.txt"));
+	CHECK(!rules.Matches(L"C:\\Work\\~$draft.txt"));
+	CHECK(!rules.Matches(L"C:\\Work\\notes.txt"));
+	// 排除规则同样只看文件名
+	CHECK(rules.Matches(L"C:\\~$backup\\plan.docx"));
+
+	MatchRules empty = Rules({}, {}, { L"*" });
+	CHECK(empty.Empty());
+	CHECK(!empty.Matches(L"C:\\Work\\plan.docx"));
+}
+
+// 参考实现：逐字符递归
+static bool ReferenceGlob(const std::wstring& pattern, size_t p, const std::wstring& name, size_t s) {
+	if (p == pattern.size()) {
+		return s == name.size();
+	}
+	if (pattern[p] == L'*') {
+		for (size_t i = s; i <= name.size(); i++) {
+			if (ReferenceGlob(pattern, p + 1, name, i)) return true;
+		}
+		return false;
+	}
+	if (s == name.size()) {
+		return false;
+	}
+	if (pattern[p] != L'?' && ExtensionMatcher::FoldAscii(pattern[p]) != ExtensionMatcher::FoldAscii(name[s])) {
+		return false;
+	}
+	return ReferenceGlob(pattern, p + 1, name, s + 1);
+}
+
+static void TestGlobAgainstReference() {
+	std::mt19937 random(20240611);
+	const wchar_t patternChars[] = L"ab*?A";
+	const wchar_t nameChars[] = L"abB";
+	unsigned long checked = 0;
+	for (int round = 0; round < 3000; round++) {
+		std::wstring pattern;
+		size_t patternLength = 1 + random() % 7;
+		for (size_t i = 0; i < patternLength; i++) pattern.push_back(patternChars[random() % 5]);
+		MatchRules rules = Rules({}, { pattern }, {});
+		for (int n = 0; n < 20; n++) {
+			std::wstring name;
+			size_t nameLength = random() % 9;
+			for (size_t i = 0; i < nameLength; i++) name.push_back(nameChars[random() % 3]);
+			bool expected = ReferenceGlob(pattern, 0, name, 0);
+			bool actual = rules.Matches(L"C:\\dir\\" + name);
+			if (expected != actual) {
+				std::printf("  pattern \"%ls\" name \"%ls\": expected %d\n", pattern.c_str(), name.c_str(), expected);
+			}
+			CHECK_EQ(actual, expected);
+			checked++;
+		}
+	}
+	CHECK_EQ(checked, 60000ul);
+}
+
+// 写入方交替发布两套规则，读取方每次看到的规则必须是其中之一的完整状态
+static void TestConcurrentPublish() {
+	SnapshotCell<MatchRules> cell;
+	MatchRuleSet pdf;
+	pdf.extensions = { L".pdf" };
+	MatchRuleSet report;
+	report.globs = { L"report_*.xlsx" };
+	cell.Publish(std::make_shared<const MatchRules>(pdf));
+
+	std::atomic<bool> stop(false);
+	std::atomic<unsigned long> torn(0);
+	std::atomic<unsigned long> reads(0);
+	std::atomic<int> started(0);
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 4; t++) {
+		readers.emplace_back([&]() {
+			SnapshotReader<MatchRules> reader;
+			unsigned long count = 0;
+			while (!stop.load(std::memory_order_relaxed)) {
+				const MatchRules& rules = reader.Get(cell);
+				bool a = rules.Matches(L"C:\\a.pdf");
+				bool b = rules.Matches(L"C:\\report_1.xlsx");
+				if (a == b) torn.fetch_add(1);
+				if (count++ == 0) started.fetch_add(1);
+			}
+			reads.fetch_add(count);
+		});
+	}
+	// 单核机器上读取线程可能在写入方发布完之前都没有运行，先等每个读取线程读到一次
+	while (started.load() < 4) {
+		std::this_thread::yield();
+	}
+	for (int i = 0; i < 20000; i++) {
+		cell.Publish(std::make_shared<const MatchRules>(i % 2 == 0 ? report : pdf));
+	}
+	stop = true;
+	for (std::thread& reader : readers) reader.join();
+	CHECK_EQ(torn.load(), 0ul);
+	CHECK(reads.load() > 0);
+	CHECK_EQ(cell.Version(), 20001u);
+}
+
+int main() {
+	TestGlobs();
+	TestExclusions();
+	TestGlobAgainstReference();
+	TestConcurrentPublish();
+	return CheckResult("MatchRulesTest");
+}
@@ -0,0 +1,258 @@
+﻿#include "Check.h"
+#include "DragTracker.h"
+#include "MouseStream.h"
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// 录制 -> 回放 -> 拖拽状态机：事件流编解码无损，且 DragTracker 与原钩子过程的阈值判断
+// 产生相同的检测/释放序列
+
+static const uint32_t kMouseMove = 0x0200;
+static const uint32_t kLButtonDown = 0x0201;
+static const uint32_t kLButtonUp = 0x0202;
+static const uint32_t kRButtonDown = 0x0204;
+static const uint32_t kRButtonUp = 0x0205;
+static const uint32_t kMouseWheel = 0x020A;
+static const uint32_t kXButtonDown = 0x020B;
+
+// 检测/释放发生在第几条记录
+struct DragSignal {
+	bool release;
+	size_t index;
+	bool operator==(const DragSignal& other) const { return release == other.release && index == other.index; }
+};
+
+// 原 MouseHookProc 的阈值判断：越过阈值时请求检测，检测过的拖拽在松开左键时释放
+class LegacyHook
+{
+public:
+	LegacyHook(int minDragX, int minDragY) : m_minDragX(minDragX), m_minDragY(minDragY) {}
+
+	void Feed(const MouseRecord& record, size_t index) {
+		switch (record.message)
+		{
+		case kLButtonDown:
+			m_down = true;
+			m_dragging = false;
+			m_detectionCalled = false;
+			m_startX = record.x;
+			m_startY = record.y;
+			break;
+		case kMouseMove:
+			if (m_down) {
+				if (!m_dragging && (std::abs(record.x - m_startX) >= m_minDragX || std::abs(record.y - m_startY) >= m_minDragY)) {
+					m_dragging = true;
+				}
+				if (m_dragging && !m_detectionCalled) {
+					signals.push_back({ false, index });
+					m_detectionCalled = true;
+				}
+			}
+			break;
+		case kLButtonUp:
+			if (m_dragging && m_detectionCalled) {
+				signals.push_back({ true, index });
+			}
+			m_down = false;
+			m_dragging = false;
+			m_detectionCalled = false;
+			break;
+		}
+	}
+
+	std::vector<DragSignal> signals;
+
+private:
+	int m_minDragX;
+	int m_minDragY;
+	bool m_down = false;
+	bool m_dragging = false;
+	bool m_detectionCalled = false;
+	int32_t m_startX = 0;
+	int32_t m_startY = 0;
+};
+
+// 只跟踪左键，检测结果总是立即返回
+struct RecordingPolicy {
+	static const uint32_t kButtons = kDragButtonLeft;
+	int thresholdX;
+	int thresholdY;
+	size_t index = 0;
+	uint32_t started = 0;
+	bool pending = false;
+	std::vector<DragSignal>* signals = nullptr;
+
+	int ThresholdX() const { return thresholdX; }
+	int ThresholdY() const { return thresholdY; }
+	void OnPress(uint32_t, int32_t, int32_t) {}
+	void OnDragStart(uint32_t sequence, int32_t, int32_t) {
+		signals->push_back({ false, index });
+		started = sequence;
+		pending = true;
+	}
+	void OnRelease(uint32_t, int32_t, int32_t) { signals->push_back({ true, index }); }
+	void OnCancel(uint32_t) {}
+};
+
+static std::vector<DragSignal> RunTracker(const std::vector<uint8_t>& stream, int thresholdX, int thresholdY) {
+	std::vector<DragSignal> signals;
+	RecordingPolicy policy;
+	policy.thresholdX = thresholdX;
+	policy.thresholdY = thresholdY;
+	policy.signals = &signals;
+	DragTracker<RecordingPolicy> tracker(policy);
+	size_t index = 0;
+	MouseStream::Replay(stream.data(), stream.size(), [&](const MouseRecord& record) {
+		tracker.GetPolicy().index = index++;
+		PointerInput input;
+		if (DecodeMouseMessage(record.message, record.x, record.y, input)) {
+			tracker.Feed(input);
+		}
+		if (tracker.GetPolicy().pending) {
+			tracker.GetPolicy().pending = false;
+			tracker.AcceptResult(tracker.GetPolicy().started);
+		}
+	});
+	return signals;
+}
+
+// 模拟真实操作：点击、各种距离的拖拽、右键、滚轮和侧键，坐标可为负（多显示器），时间会回绕
+static std::vector<MouseRecord> GenerateGestures(size_t gestures, uint32_t seed) {
+	std::mt19937 random(seed);
+	std::vector<MouseRecord> records;
+	int32_t x = 800;
+	int32_t y = 600;
+	uint32_t time = 0xFFFFF000u;
+	auto emit = [&](uint32_t message, uint32_t flags) {
+		time += 1 + random() % 16;
+		records.push_back({ message, x, y, time, flags });
+	};
+	auto wander = [&](int steps, int step) {
+		for (int i = 0; i < steps; i++) {
+			x += (int32_t)(random() % (2 * step + 1)) - step;
+			y += (int32_t)(random() % (2 * step + 1)) - step;
+			x = x < -3000 ? -3000 : (x > 6000 ? 6000 : x);
+			y = y < -2000 ? -2000 : (y > 4000 ? 4000 : y);
+			emit(kMouseMove, random() % 50 == 0 ? 1u : 0u);
+		}
+	};
+	for (size_t g = 0; g < gestures; g++) {
+		wander(1 + random() % 20, 20);
+		switch (random() % 6)
+		{
+		case 0:
+		case 1:
+			// 左键拖拽，每步位移 0~6 像素，可能停在阈值以内
+			emit(kLButtonDown, 0);
+			wander(random() % 30, random() % 7);
+			emit(kLButtonUp, 0);
+			break;
+		case 2:
+			// 点击
+			emit(kLButtonDown, 0);
+			emit(kLButtonUp, 0);
+			break;
+		case 3:
+			// 右键拖拽，期间左键按下又松开
+			emit(kRButtonDown, 0);
+			wander(random() % 10, 8);
+			emit(kLButtonDown, 0);
+			wander(random() % 10, 8);
+			emit(kLButtonUp, 0);
+			emit(kRButtonUp, 0);
+			break;
+		case 4:
+			// 丢失的松开消息：连续两次按下
+			emit(kLButtonDown, 0);
+			wander(random() % 10, 5);
+			emit(kLButtonDown, 0);
+			wander(random() % 10, 5);
+			emit(kLButtonUp, 0);
+			break;
+		default:
+			emit(kMouseWheel, 120u << 16);
+			emit(kXButtonDown, 0);
+			emit(0x00FF, 0);
+			break;
+		}
+	}
+	return records;
+}
+
+static std::vector<uint8_t> Encode(const std::vector<MouseRecord>& records) {
+	MouseStreamWriter writer;
+	for (const MouseRecord& record : records) {
+		writer.Append(record);
+	}
+	return writer.Bytes();
+}
+
+static void TestRoundTrip() {
+	std::vector<MouseRecord> records = GenerateGestures(5000, 14);
+	std::vector<uint8_t> stream = Encode(records);
+	// 增量编码：平均每条记录远小于 MSLLHOOKSTRUCT 的 4 个字段
+	CHECK(stream.size() < records.size() * 6);
+	size_t index = 0;
+	bool same = true;
+	int64_t count = MouseStream::Replay(stream.data(), stream.size(), [&](const MouseRecord& record) {
+		const MouseRecord& expected = records[index++];
+		same = same && record.message == expected.message && record.x == expected.x && record.y == expected.y
+			&& record.time == expected.time && record.flags == expected.flags;
+	});
+	CHECK_EQ(count, (int64_t)records.size());
+	CHECK(same);
+}
+
+static void TestCorruptStreams() {
+	std::vector<uint8_t> stream = Encode(GenerateGestures(10, 15));
+	auto ignore = [](const MouseRecord&) {};
+	CHECK_EQ(MouseStream::Replay(stream.data(), 3, ignore), -1);
+	std::vector<uint8_t> badMagic = stream;
+	badMagic[0] = 'X';
+	CHECK_EQ(MouseStream::Replay(badMagic.data(), badMagic.size(), ignore), -1);
+	std::vector<uint8_t> badVersion = stream;
+	badVersion[MouseStream::kMagicSize] = MouseStream::kVersion + 1;
+	CHECK_EQ(MouseStream::Replay(badVersion.data(), badVersion.size(), ignore), -1);
+	// 截断在记录中间
+	CHECK_EQ(MouseStream::Replay(stream.data(), stream.size() - 1, ignore), -1);
+	// 只有文件头
+	CHECK_EQ(MouseStream::Replay(stream.data(), MouseStream::kHeaderSize, ignore), 0);
+}
+
+static void TestWriterLimit() {
+	MouseStreamWriter writer(256);
+	for (uint32_t i = 0; i < 1000; i++) {
+		writer.Append({ kMouseMove, (int32_t)i, (int32_t)i, i, 0 });
+	}
+	CHECK(writer.Bytes().size() <= 256);
+	CHECK_EQ(writer.Count() + writer.Dropped(), 1000u);
+	CHECK(writer.Dropped() > 0);
+	CHECK_EQ(MouseStream::Replay(writer.Bytes().data(), writer.Bytes().size(), [](const MouseRecord&) {}), (int64_t)writer.Count());
+}
+
+static void TestSameSignalsAsLegacyHook() {
+	const int thresholds[][2] = { { 4, 4 }, { 1, 1 }, { 10, 3 }, { 2, 8 } };
+	for (uint32_t seed = 1; seed <= 5; seed++) {
+		std::vector<MouseRecord> records = GenerateGestures(20000, seed);
+		std::vector<uint8_t> stream = Encode(records);
+		for (const auto& threshold : thresholds) {
+			LegacyHook legacy(threshold[0], threshold[1]);
+			for (size_t i = 0; i < records.size(); i++) {
+				legacy.Feed(records[i], i);
+			}
+			std::vector<DragSignal> signals = RunTracker(stream, threshold[0], threshold[1]);
+			CHECK(!legacy.signals.empty());
+			CHECK_EQ(signals.size(), legacy.signals.size());
+			CHECK(signals == legacy.signals);
+		}
+	}
+}
+
+int main() {
+	TestRoundTrip();
+	TestCorruptStreams();
+	TestWriterLimit();
+	TestSameSignalsAsLegacyHook();
+	return CheckResult("MouseReplayTest");
+}
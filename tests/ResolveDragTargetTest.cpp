@@ -0,0 +1,89 @@
+﻿#include "Check.h"
+#include "FileDetector.h"
+#include "Logger.h"
+#include "PipelineStats.h"
+#include "SimulatedDesktop.h"
+
+// 每次拖拽最多一次 UIA 命中测试：只在 Explorer 的文件显示区域内进行，桌面和非内容区域不做
+// 命中测试的延迟计入 UiaHitTest 阶段
+
+static const uint32_t kHitTestMicros = 300;
+
+struct Fixture {
+	SimulatedDesktop desktop;
+	DesktopWindow explorer;
+	DesktopWindow progman;
+
+	Fixture() {
+		DesktopWindow content = 0;
+		progman = desktop.AddDesktop({ 0, 0, 1920, 1080 });
+		explorer = desktop.AddExplorerWindow({ 100, 100, 1100, 800 }, &content);
+		desktop.AddFileItem(content, { 300, 148, 1100, 170 });
+		desktop.SetSelection(explorer, { { L"C:\\Work\\plan.pdf", false } });
+		desktop.SetSelection(progman, { { L"C:\\Users\\me\\Desktop\\notes.pdf", false } });
+		desktop.SetLatency(SimulatedCall::HitTest, kHitTestMicros);
+	}
+};
+
+static uint64_t HitTestsFor(Fixture& fixture, const DesktopPoint& pt, bool expectResolved) {
+	fixture.desktop.ResetCallCounts();
+	DragTarget target;
+	bool resolved = FileDetector::ResolveDragTarget(pt, target);
+	CHECK_EQ(resolved, expectResolved);
+	return fixture.desktop.CallCount(SimulatedCall::HitTest);
+}
+
+static void TestHitTestCalls() {
+	Fixture fixture;
+	FileDetector::SetThreadBackend(&fixture.desktop);
+
+	// Explorer 文件项上：一次命中测试后解析成功
+	CHECK_EQ(HitTestsFor(fixture, { 310, 150 }, true), 1u);
+	// Explorer 内容区域的空白处：一次命中测试，未落在文件项上
+	CHECK_EQ(HitTestsFor(fixture, { 310, 300 }, false), 1u);
+	// 导航树、地址栏和标题栏在祖先链分类时就被排除，不做命中测试
+	CHECK_EQ(HitTestsFor(fixture, { 150, 300 }, false), 0u);
+	CHECK_EQ(HitTestsFor(fixture, { 500, 120 }, false), 0u);
+	CHECK_EQ(HitTestsFor(fixture, { 110, 105 }, false), 0u);
+	// 桌面不做命中测试
+	CHECK_EQ(HitTestsFor(fixture, { 1500, 500 }, true), 0u);
+
+	// 重复拖拽不会产生额外的调用
+	fixture.desktop.ResetCallCounts();
+	for (int i = 0; i < 10; i++) {
+		DragTarget target;
+		SelectionMatch match = {};
+		CHECK(FileDetector::IsDraggingSupportedFile(DesktopPoint{ 310, 150 }, target, match) == ScanVerdict::Match);
+	}
+	CHECK_EQ(fixture.desktop.CallCount(SimulatedCall::HitTest), 10u);
+	CHECK_EQ(fixture.desktop.CallCount(SimulatedCall::WindowFromPoint), 10u);
+	CHECK_EQ(fixture.desktop.CallCount(SimulatedCall::FindView), 10u);
+
+	FileDetector::SetThreadBackend(NULL);
+}
+
+static void TestHitTestLatency() {
+	Fixture fixture;
+	FileDetector::SetThreadBackend(&fixture.desktop);
+	PipelineStats::Summarize(PipelineStage::UiaHitTest, true);
+	for (int i = 0; i < 20; i++) {
+		DragTarget target;
+		FileDetector::ResolveDragTarget({ 310, 150 }, target);
+	}
+	// 桌面上的拖拽不计入
+	DragTarget target;
+	FileDetector::ResolveDragTarget({ 1500, 500 }, target);
+
+	LatencySummary summary = PipelineStats::Summarize(PipelineStage::UiaHitTest, true);
+	CHECK_EQ(summary.count, 20u);
+	CHECK(summary.p50 >= kHitTestMicros);
+	FileDetector::SetThreadBackend(NULL);
+}
+
+int main() {
+	Logger::SetLevel(LogLevel::Off);
+	FileDetector::SetExtensions({ L".pdf" });
+	TestHitTestCalls();
+	TestHitTestLatency();
+	return CheckResult("ResolveDragTargetTest");
+}
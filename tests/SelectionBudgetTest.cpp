@@ -0,0 +1,134 @@
+﻿#include "Check.h"
+#include "FileDetector.h"
+#include "Logger.h"
+#include "SimulatedDesktop.h"
+#include <chrono>
+
+// 选中项扫描预算：10 万项的模拟文件夹，按项数或耗时截断，截断时给出 Inconclusive 而不是阻塞
+
+static const DesktopPoint kItemPoint = { 310, 150 };
+static const long kItemCount = 100000;
+
+struct Fixture {
+	SimulatedDesktop desktop;
+	DesktopWindow explorer;
+
+	Fixture() {
+		DesktopWindow content = 0;
+		explorer = desktop.AddExplorerWindow({ 100, 100, 1100, 800 }, &content);
+		desktop.AddFileItem(content, { 300, 148, 1100, 170 });
+		FileDetector::SetThreadBackend(&desktop);
+	}
+	~Fixture() {
+		FileDetector::SetThreadBackend(NULL);
+	}
+
+	// matchAt 为 -1 表示没有匹配项；folderAt 处是一个同样匹配扩展名的文件夹
+	void Select(long matchAt, long folderAt = -1) {
+		std::vector<SimulatedItem> items;
+		items.reserve(kItemCount);
+		for (long i = 0; i < kItemCount; i++) {
+			bool matched = i == matchAt || i == folderAt;
+			items.push_back({ L"D:\\Photos\\IMG_" + std::to_wstring(i) + (matched ? L".pdf" : L".jpg"), i == folderAt });
+		}
+		desktop.SetSelection(explorer, items);
+	}
+
+	ScanVerdict Detect(SelectionMatch& match) {
+		desktop.ResetCallCounts();
+		DragTarget target;
+		return FileDetector::IsDraggingSupportedFile(kItemPoint, target, match);
+	}
+};
+
+static void TestItemBudget() {
+	Fixture fixture;
+	FileDetector::SetScanBudget(2000, 0);
+
+	// 预算内没有匹配项：只检查 2000 项，无法给出结论
+	fixture.Select(-1);
+	SelectionMatch match = {};
+	CHECK(fixture.Detect(match) == ScanVerdict::Inconclusive);
+	CHECK_EQ(fixture.desktop.CallCount(SimulatedCall::ItemPath), 2000u);
+	CHECK_EQ(match.matchCount, 0);
+
+	// 截断的结果不缓存，再次拖拽重新扫描
+	CHECK(fixture.Detect(match) == ScanVerdict::Inconclusive);
+	CHECK_EQ(fixture.desktop.CallCount(SimulatedCall::ItemPath), 2000u);
+
+	// 预算内找到匹配项
+	fixture.Select(1500);
+	CHECK(fixture.Detect(match) == ScanVerdict::Match);
+	CHECK_EQ(fixture.desktop.CallCount(SimulatedCall::ItemPath), 2000u);
+	CHECK_EQ(match.matchCount, 1);
+	CHECK(match.paths && match.paths->Count() == 1);
+
+	// 匹配项在预算之外
+	fixture.Select(50000);
+	CHECK(fixture.Detect(match) == ScanVerdict::Inconclusive);
+}
+
+static void TestUnlimited() {
+	Fixture fixture;
+	FileDetector::SetScanBudget(0, 0);
+
+	// 不限预算时扫描全部 10 万项；只有扩展名匹配的项才查询是否为文件夹
+	fixture.Select(kItemCount - 1, 10);
+	SelectionMatch match = {};
+	CHECK(fixture.Detect(match) == ScanVerdict::Match);
+	CHECK_EQ(fixture.desktop.CallCount(SimulatedCall::ItemPath), (uint64_t)kItemCount);
+	CHECK_EQ(fixture.desktop.CallCount(SimulatedCall::ItemIsFolder), 2u);
+	CHECK_EQ(match.matchCount, 1);
+
+	// 完整的结果被缓存，选中项不变时不再扫描
+	CHECK(fixture.Detect(match) == ScanVerdict::Match);
+	CHECK_EQ(fixture.desktop.CallCount(SimulatedCall::ItemPath), 0u);
+
+	fixture.Select(-1);
+	CHECK(fixture.Detect(match) == ScanVerdict::NoMatch);
+	CHECK_EQ(fixture.desktop.CallCount(SimulatedCall::ItemPath), (uint64_t)kItemCount);
+}
+
+static void TestTimeBudget() {
+	Fixture fixture;
+	// 每项 20us，完整扫描需要 2 秒
+	fixture.desktop.SetLatency(SimulatedCall::ItemPath, 20);
+	FileDetector::SetScanBudget(0, 30);
+	fixture.Select(-1);
+
+	SelectionMatch match = {};
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	CHECK(fixture.Detect(match) == ScanVerdict::Inconclusive);
+	long long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	CHECK(fixture.desktop.CallCount(SimulatedCall::ItemPath) < (uint64_t)kItemCount / 10);
+	// 留出调度余量，仍远小于完整扫描的耗时
+	CHECK(elapsed < 500);
+}
+
+static void TestPathCap() {
+	Fixture fixture;
+	FileDetector::SetScanBudget(0, 0);
+	FileDetector::SetExtensions({ L".jpg" });
+	FileDetector::SetMaxPaths(100);
+	fixture.Select(-1);
+
+	// 计数覆盖所有匹配项，路径只保留前 100 个
+	SelectionMatch match = {};
+	CHECK(fixture.Detect(match) == ScanVerdict::Match);
+	CHECK_EQ(match.matchCount, kItemCount);
+	CHECK(match.paths && match.paths->Count() == 100);
+	CHECK(match.paths->PathAt(0) == L"D:\\Photos\\IMG_0.jpg");
+
+	FileDetector::SetMaxPaths(1000);
+	FileDetector::SetExtensions({ L".pdf" });
+}
+
+int main() {
+	Logger::SetLevel(LogLevel::Off);
+	FileDetector::SetExtensions({ L".pdf" });
+	TestItemBudget();
+	TestUnlimited();
+	TestTimeBudget();
+	TestPathCap();
+	return CheckResult("SelectionBudgetTest");
+}
@@ -0,0 +1,87 @@
+﻿#include "Check.h"
+#include "ShellAncestry.h"
+#include "SimulatedDesktop.h"
+#include <cwchar>
+
+static ShellClass Classify(const wchar_t* name) {
+	return ClassifyShellClassName(name, wcslen(name));
+}
+
+static void TestClassNames() {
+	CHECK(Classify(L"CabinetWClass") == ShellClass::Cabinet);
+	CHECK(Classify(L"SHELLDLL_DefView") == ShellClass::DefView);
+	CHECK(Classify(L"Progman") == ShellClass::Progman);
+	CHECK(Classify(L"WorkerW") == ShellClass::WorkerW);
+	CHECK(Classify(L"SearchEditBoxWrapperClass") == ShellClass::SearchBox);
+	CHECK(Classify(L"Address Band Root") == ShellClass::AddressBand);
+	CHECK(Classify(L"TravelBand") == ShellClass::TravelBand);
+	// 前缀、大小写不同或多出字符都不算
+	CHECK(Classify(L"Cabinet") == ShellClass::Other);
+	CHECK(Classify(L"CabinetWClassX") == ShellClass::Other);
+	CHECK(Classify(L"progman") == ShellClass::Other);
+	CHECK(Classify(L"") == ShellClass::Other);
+	CHECK(ClassifyShellClassName(L"WorkerWX", 7) == ShellClass::WorkerW);
+}
+
+static WindowAncestry Walk(SimulatedDesktop& desktop, const DesktopPoint& pt) {
+	WindowAncestry ancestry;
+	WalkShellAncestry(desktop, desktop.WindowFromPoint(pt), ancestry);
+	return ancestry;
+}
+
+static void TestWalk() {
+	SimulatedDesktop desktop;
+	DesktopWindow progman = desktop.AddDesktop({ 0, 0, 1920, 1080 });
+	DesktopWindow explorer = desktop.AddExplorerWindow({ 100, 100, 1100, 800 });
+
+	// 文件显示区域：DirectUIHWND > SHELLDLL_DefView > ShellTabWindowClass > CabinetWClass
+	desktop.ResetCallCounts();
+	WindowAncestry ancestry = Walk(desktop, { 600, 400 });
+	CHECK_EQ(ancestry.shellWindow, explorer);
+	CHECK(!ancestry.isDesktop);
+	CHECK(ancestry.isContentArea);
+	// 一次遍历：每层一次类名查询，到 Shell 父窗口为止
+	CHECK_EQ(desktop.CallCount(SimulatedCall::ClassName), 4u);
+	CHECK_EQ(desktop.CallCount(SimulatedCall::Parent), 3u);
+
+	// 地址栏先于 Shell 父窗口判定为非内容区域
+	ancestry = Walk(desktop, { 500, 120 });
+	CHECK_EQ(ancestry.shellWindow, explorer);
+	CHECK(!ancestry.isContentArea);
+
+	// 导航树和标题栏直接到达 CabinetWClass
+	ancestry = Walk(desktop, { 150, 300 });
+	CHECK_EQ(ancestry.shellWindow, explorer);
+	CHECK(!ancestry.isContentArea);
+	ancestry = Walk(desktop, { 110, 105 });
+	CHECK_EQ(ancestry.shellWindow, explorer);
+	CHECK(!ancestry.isContentArea);
+
+	// 桌面
+	ancestry = Walk(desktop, { 1500, 500 });
+	CHECK_EQ(ancestry.shellWindow, progman);
+	CHECK(ancestry.isDesktop);
+	CHECK(ancestry.isContentArea);
+
+	// 不属于任何 Shell 窗口
+	DesktopWindow other = desktop.AddWindow(0, L"Chrome_WidgetWin_1", { 1200, 0, 1900, 600 });
+	desktop.AddWindow(other, L"SHELLDLL_DefView", { 1200, 0, 1900, 600 });
+	ancestry = Walk(desktop, { 1300, 300 });
+	CHECK_EQ(ancestry.shellWindow, 0u);
+	CHECK(!ancestry.isDesktop);
+
+	// WorkerW 承载的桌面
+	DesktopWindow workerW = desktop.AddWindow(0, L"WorkerW", { 0, 900, 1920, 1080 });
+	DesktopWindow defView = desktop.AddWindow(workerW, L"SHELLDLL_DefView", { 0, 900, 1920, 1080 });
+	desktop.AddWindow(defView, L"SysListView32", { 0, 900, 1920, 1080 });
+	ancestry = Walk(desktop, { 10, 1000 });
+	CHECK_EQ(ancestry.shellWindow, workerW);
+	CHECK(ancestry.isDesktop);
+	CHECK(ancestry.isContentArea);
+}
+
+int main() {
+	TestClassNames();
+	TestWalk();
+	return CheckResult("ShellAncestryTest");
+}
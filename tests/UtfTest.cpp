@@ -0,0 +1,211 @@
+﻿#include "Check.h"
+#include "Utf.h"
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+// UTF-8 与 UTF-16/UTF-32 的转换：已知向量、非法序列的位置、输出空间不足、U+FFFD 替换（按最大子部分），
+// 以及随机文本与逐字符参考实现的对拍，覆盖 16 个单元一块的 ASCII 快速路径的各个边界
+
+static std::u16string Utf16(const char* utf8) {
+	std::u16string output(std::strlen(utf8), u'\0');
+	TranscodeResult result = Utf8ToUtf16(utf8, std::strlen(utf8), &output[0], output.size());
+	CHECK(!result.invalid);
+	output.resize(result.written);
+	return output;
+}
+
+static std::string Utf8(const std::u16string& utf16) {
+	std::string output(utf16.size() * kMaxUtf8PerUtf16, '\0');
+	TranscodeResult result = Utf16ToUtf8(utf16.data(), utf16.size(), &output[0], output.size());
+	CHECK(!result.invalid);
+	CHECK_EQ(result.read, utf16.size());
+	output.resize(result.written);
+	return output;
+}
+
+static void TestVectors() {
+	CHECK(Utf16("") == u"");
+	CHECK(Utf16("C:\\Work\\plan.pdf") == u"C:\\Work\\plan.pdf");
+	CHECK(Utf16("caf\xC3\xA9") == u"caf\u00E9");
+	CHECK(Utf16("\xE6\x96\x87\xE4\xBB\xB6.txt") == u"\u6587\u4EF6.txt");
+	CHECK(Utf16("\xF0\x9F\x93\x84") == u"\U0001F4C4");
+	CHECK(Utf16("\xF4\x8F\xBF\xBF") == u"\U0010FFFF");
+	CHECK(Utf8(u"\u6587\u4EF6.txt") == "\xE6\x96\x87\xE4\xBB\xB6.txt");
+	CHECK(Utf8(u"\U0001F4C4 a") == "\xF0\x9F\x93\x84 a");
+	CHECK(Utf8(u"\u07FF\u0800\uFFFF") == "\xDF\xBF\xE0\xA0\x80\xEF\xBF\xBF");
+
+	// UTF-32
+	char32_t wide[8];
+	TranscodeResult result = Utf8ToUtf32("\xF0\x9F\x93\x84x", 5, wide, 8);
+	CHECK(!result.invalid);
+	CHECK_EQ(result.written, 2u);
+	CHECK(wide[0] == U'\U0001F4C4' && wide[1] == U'x');
+	char bytes[16];
+	const char32_t code[] = { U'\u00E9', U'\U0010FFFF' };
+	result = Utf32ToUtf8(code, 2, bytes, sizeof(bytes));
+	CHECK(!result.invalid);
+	CHECK(std::string(bytes, result.written) == "\xC3\xA9\xF4\x8F\xBF\xBF");
+}
+
+// 严格转换在第一个非法序列前停下，read 指向它
+static size_t InvalidAt(const std::string& input) {
+	std::vector<char16_t> output(input.size() + 1);
+	TranscodeResult result = Utf8ToUtf16(input.data(), input.size(), output.data(), output.size());
+	return result.invalid ? result.read : std::string::npos;
+}
+
+static void TestInvalidUtf8() {
+	CHECK_EQ(InvalidAt("abc\x80"), 3u);
+	// 过长编码
+	CHECK_EQ(InvalidAt("ab\xC0\x80"), 2u);
+	CHECK_EQ(InvalidAt("\xC1\xBF"), 0u);
+	CHECK_EQ(InvalidAt("\xE0\x80\x80"), 0u);
+	CHECK_EQ(InvalidAt("\xF0\x8F\xBF\xBF"), 0u);
+	// 编码的代理与超出 U+10FFFF
+	CHECK_EQ(InvalidAt("x\xED\xA0\x80"), 1u);
+	CHECK_EQ(InvalidAt("\xF4\x90\x80\x80"), 0u);
+	CHECK_EQ(InvalidAt("\xF5\x80\x80\x80"), 0u);
+	// 截断
+	CHECK_EQ(InvalidAt("\xE6\x96"), 0u);
+	CHECK_EQ(InvalidAt("0123456789abcdef\xF0\x9F\x93"), 16u);
+	// ASCII 块之后的非法字节，以及块内的非法字节
+	CHECK_EQ(InvalidAt("0123456789abcdef0123456789abcde\xFF"), 31u);
+	CHECK_EQ(InvalidAt("0123456\xFF" "89abcdef"), 7u);
+	CHECK_EQ(InvalidAt("0123456789abcdef"), std::string::npos);
+
+	// UTF-16 的孤立代理
+	char output[32];
+	const char16_t lowFirst[] = { u'a', 0xDC00, u'b' };
+	TranscodeResult result = Utf16ToUtf8(lowFirst, 3, output, sizeof(output));
+	CHECK(result.invalid);
+	CHECK_EQ(result.read, 1u);
+	const char16_t highLast[] = { u'a', u'b', 0xD83D };
+	result = Utf16ToUtf8(highLast, 3, output, sizeof(output));
+	CHECK(result.invalid);
+	CHECK_EQ(result.read, 2u);
+	CHECK_EQ(result.written, 2u);
+	const char32_t outOfRange[] = { 0x110000 };
+	CHECK(Utf32ToUtf8(outOfRange, 1, output, sizeof(output)).invalid);
+}
+
+static void TestCapacity() {
+	// 空间不足时停在完整字符之前，invalid 为 false
+	char16_t output[4];
+	TranscodeResult result = Utf8ToUtf16("abcdef", 6, output, 4);
+	CHECK(!result.invalid);
+	CHECK_EQ(result.read, 4u);
+	CHECK_EQ(result.written, 4u);
+	result = Utf8ToUtf16("abc\xF0\x9F\x93\x84", 7, output, 4);
+	CHECK(!result.invalid);
+	CHECK_EQ(result.read, 3u);
+	CHECK_EQ(result.written, 3u);
+
+	char bytes[5];
+	result = Utf16ToUtf8(u"ab\u6587", 3, bytes, 4);
+	CHECK(!result.invalid);
+	CHECK_EQ(result.read, 2u);
+	CHECK_EQ(result.written, 2u);
+
+	// 宽松转换在完整字符处截断
+	CHECK_EQ(WideToUtf8Lossy(L"ab\u6587", 3, bytes, 4), 2u);
+}
+
+static void TestLossy() {
+	// 每个最大子部分替换为一个 U+FFFD
+	std::wstring wide;
+	std::string input = "a\xF0\x80\x80" "b\xE1\x80" "c\xED\xA0\x80" "d\xC3";
+	AppendWide(wide, input.data(), input.size());
+	CHECK(wide == L"a\uFFFD\uFFFD\uFFFDb\uFFFDc\uFFFD\uFFFD\uFFFDd\uFFFD");
+
+	std::string utf8 = "prefix:";
+	std::wstring path = L"C:\\\u6587\u4EF6\\report.pdf";
+	AppendUtf8(utf8, path.data(), path.size());
+	CHECK(utf8 == "prefix:C:\\\xE6\x96\x87\xE4\xBB\xB6\\report.pdf");
+
+	std::wstring roundTrip = L"x";
+	AppendWide(roundTrip, utf8.data() + 7, utf8.size() - 7);
+	CHECK(roundTrip == L"x" + path);
+}
+
+// 参考实现：逐个码点编码
+static void EncodeReference(char32_t code, std::string& utf8, std::u16string& utf16) {
+	if (code < 0x80) {
+		utf8 += (char)code;
+	}
+	else if (code < 0x800) {
+		utf8 += (char)(0xC0 | (code >> 6));
+		utf8 += (char)(0x80 | (code & 0x3F));
+	}
+	else if (code < 0x10000) {
+		utf8 += (char)(0xE0 | (code >> 12));
+		utf8 += (char)(0x80 | ((code >> 6) & 0x3F));
+		utf8 += (char)(0x80 | (code & 0x3F));
+	}
+	else {
+		utf8 += (char)(0xF0 | (code >> 18));
+		utf8 += (char)(0x80 | ((code >> 12) & 0x3F));
+		utf8 += (char)(0x80 | ((code >> 6) & 0x3F));
+		utf8 += (char)(0x80 | (code & 0x3F));
+	}
+	if (code < 0x10000) {
+		utf16 += (char16_t)code;
+	}
+	else {
+		utf16 += (char16_t)(0xD800 + ((code - 0x10000) >> 10));
+		utf16 += (char16_t)(0xDC00 + ((code - 0x10000) & 0x3FF));
+	}
+}
+
+static void TestRandomAgainstReference() {
+	std::mt19937 random(2025);
+	for (int round = 0; round < 20000; round++) {
+		// 以 ASCII 为主，随机插入多字节字符，使其落在 16 单元块的不同位置
+		std::string utf8;
+		std::u16string utf16;
+		std::u32string utf32;
+		size_t count = random() % 70;
+		for (size_t i = 0; i < count; i++) {
+			char32_t code;
+			switch (random() % 8) {
+			case 0: code = 0x80 + random() % (0x800 - 0x80); break;
+			case 1: code = 0x800 + random() % (0xD800 - 0x800); break;
+			case 2: code = 0xE000 + random() % (0x10000 - 0xE000); break;
+			case 3: code = 0x10000 + random() % (0x110000 - 0x10000); break;
+			default: code = random() % 0x80; break;
+			}
+			EncodeReference(code, utf8, utf16);
+			utf32 += code;
+		}
+
+		std::vector<char16_t> decoded16(utf8.size() + 1);
+		TranscodeResult result = Utf8ToUtf16(utf8.data(), utf8.size(), decoded16.data(), decoded16.size());
+		CHECK(!result.invalid && result.read == utf8.size());
+		CHECK(std::u16string(decoded16.data(), result.written) == utf16);
+
+		std::vector<char32_t> decoded32(utf8.size() + 1);
+		result = Utf8ToUtf32(utf8.data(), utf8.size(), decoded32.data(), decoded32.size());
+		CHECK(!result.invalid && result.read == utf8.size());
+		CHECK(std::u32string(decoded32.data(), result.written) == utf32);
+
+		std::string encoded(utf16.size() * kMaxUtf8PerUtf16 + 1, '\0');
+		result = Utf16ToUtf8(utf16.data(), utf16.size(), &encoded[0], encoded.size());
+		CHECK(!result.invalid && result.read == utf16.size());
+		CHECK(encoded.substr(0, result.written) == utf8);
+
+		encoded.assign(utf32.size() * kMaxUtf8PerUtf32 + 1, '\0');
+		result = Utf32ToUtf8(utf32.data(), utf32.size(), &encoded[0], encoded.size());
+		CHECK(!result.invalid && result.read == utf32.size());
+		CHECK(encoded.substr(0, result.written) == utf8);
+	}
+}
+
+int main() {
+	TestVectors();
+	TestInvalidUtf8();
+	TestCapacity();
+	TestLossy();
+	TestRandomAgainstReference();
+	return CheckResult("UtfTest");
+}
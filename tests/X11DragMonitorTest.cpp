@@ -0,0 +1,301 @@
+﻿#include "Check.h"
+#include "X11DragMonitor.h"
+#include "MatchedPaths.h"
+#include "PipelineStats.h"
+#include <X11/Xlib.h>
+#include <X11/extensions/XTest.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 在 X 服务器（通常为 Xvfb）上端到端验证 X11DragMonitor：用 XTest 模拟鼠标，由第二个连接充当拖拽源，
+// 持有 XdndSelection 并应答 text/uri-list 转换；同时测量越过阈值到得出检测结果的延迟
+// 没有可用的显示或缺少 XTest 扩展时返回 77，ctest 记为跳过
+
+static const int kSkipped = 77;
+static const int kWaitMillis = 2000;
+
+// 在监视线程上收集事件
+struct Collector {
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::vector<DragEvent> events;
+
+	static void Sink(void* context, const DragEvent& event) {
+		Collector* collector = static_cast<Collector*>(context);
+		std::lock_guard<std::mutex> lock(collector->mutex);
+		collector->events.push_back(event);
+		collector->changed.notify_all();
+	}
+
+	// 等待第 index 个事件，超时返回 false
+	bool Wait(size_t index, DragEvent& event, int millis = kWaitMillis) {
+		std::unique_lock<std::mutex> lock(mutex);
+		if (!changed.wait_for(lock, std::chrono::milliseconds(millis), [&]() { return events.size() > index; })) {
+			return false;
+		}
+		event = events[index];
+		return true;
+	}
+
+	size_t Count() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return events.size();
+	}
+};
+
+// 拖拽源：模拟鼠标并持有 XdndSelection
+class DragSource
+{
+public:
+	~DragSource() {
+		if (m_display != nullptr) {
+			XDestroyWindow(m_display, m_window);
+			XCloseDisplay(m_display);
+		}
+	}
+
+	bool Open() {
+		m_display = XOpenDisplay(nullptr);
+		if (m_display == nullptr) {
+			return false;
+		}
+		int event, error, major, minor;
+		if (!XTestQueryExtension(m_display, &event, &error, &major, &minor)) {
+			return false;
+		}
+		m_window = XCreateSimpleWindow(m_display, DefaultRootWindow(m_display), 0, 0, 1, 1, 0, 0, 0);
+		m_xdndSelection = XInternAtom(m_display, "XdndSelection", False);
+		m_uriList = XInternAtom(m_display, "text/uri-list", False);
+		return true;
+	}
+
+	void MoveTo(int x, int y) {
+		XTestFakeMotionEvent(m_display, -1, x, y, CurrentTime);
+		XSync(m_display, False);
+	}
+
+	void Press(int x, int y) {
+		MoveTo(x, y);
+		XTestFakeButtonEvent(m_display, 1, True, CurrentTime);
+		XSync(m_display, False);
+	}
+
+	void Release() {
+		XTestFakeButtonEvent(m_display, 1, False, CurrentTime);
+		XSync(m_display, False);
+	}
+
+	// 拖拽源在越过阈值后取得 XdndSelection，返回取得的时间
+	int64_t TakeSelection() {
+		XSetSelectionOwner(m_display, m_xdndSelection, m_window, CurrentTime);
+		XSync(m_display, False);
+		return PipelineStats::Now();
+	}
+
+	// 等待一个 text/uri-list 转换请求
+	bool WaitRequest(XSelectionRequestEvent& request, int millis = kWaitMillis) {
+		int64_t deadline = PipelineStats::Now() + (int64_t)millis * PipelineStats::TicksPerSecond() / 1000;
+		for (;;) {
+			while (XPending(m_display) > 0) {
+				XEvent event;
+				XNextEvent(m_display, &event);
+				if (event.type == SelectionRequest && event.xselectionrequest.selection == m_xdndSelection
+					&& event.xselectionrequest.target == m_uriList) {
+					request = event.xselectionrequest;
+					return true;
+				}
+			}
+			int64_t remaining = deadline - PipelineStats::Now();
+			if (remaining <= 0) {
+				return false;
+			}
+			pollfd fd = { ConnectionNumber(m_display), POLLIN, 0 };
+			poll(&fd, 1, (int)(remaining * 1000 / PipelineStats::TicksPerSecond()) + 1);
+		}
+	}
+
+	void Answer(const XSelectionRequestEvent& request, const std::string& uriList) {
+		XChangeProperty(m_display, request.requestor, request.property, m_uriList, 8, PropModeReplace,
+			(const unsigned char*)uriList.data(), (int)uriList.size());
+		XEvent notify = {};
+		notify.xselection.type = SelectionNotify;
+		notify.xselection.requestor = request.requestor;
+		notify.xselection.selection = request.selection;
+		notify.xselection.target = request.target;
+		notify.xselection.property = request.property;
+		notify.xselection.time = request.time;
+		XSendEvent(m_display, request.requestor, False, NoEventMask, &notify);
+		XSync(m_display, False);
+	}
+
+private:
+	Display* m_display = nullptr;
+	Window m_window = 0;
+	Atom m_xdndSelection = 0;
+	Atom m_uriList = 0;
+};
+
+static std::string g_directory;
+
+static std::string CreateFile(const char* name) {
+	std::string path = g_directory + "/" + name;
+	FILE* file = std::fopen(path.c_str(), "wb");
+	if (file != nullptr) {
+		std::fputs("test", file);
+		std::fclose(file);
+	}
+	return path;
+}
+
+static std::wstring Wide(const std::string& path) {
+	return std::wstring(path.begin(), path.end());
+}
+
+static bool HasPath(const DragEvent& event, const std::string& path) {
+	return event.paths && event.paths->Count() == 1 && event.paths->PathAt(0) == Wide(path);
+}
+
+// 每次拖拽：按下、移动不足阈值、越过阈值、拖拽源取得选择并应答，等待 Supported，释放后等待 Released
+static void TestDetectionLatency(DragSource& source, Collector& collector, int drags) {
+	std::string pdf = CreateFile("report.pdf");
+	std::string txt = CreateFile("notes.txt");
+	std::string uriList = "file://" + pdf + "\r\n" + "# comment\r\n" + "file://" + txt + "\r\n";
+	std::vector<double> fromThreshold;
+	std::vector<double> fromSelection;
+	for (int i = 0; i < drags; i++) {
+		size_t first = collector.Count();
+		source.Press(100, 100);
+		source.MoveTo(103, 100);
+		source.MoveTo(120, 100);
+		int64_t owned = source.TakeSelection();
+		XSelectionRequestEvent request;
+		bool requested = source.WaitRequest(request);
+		CHECK(requested);
+		if (!requested) {
+			source.Release();
+			return;
+		}
+		source.Answer(request, uriList);
+
+		DragEvent supported;
+		bool received = collector.Wait(first, supported);
+		CHECK(received);
+		if (received) {
+			CHECK(supported.kind == DragEventKind::Supported);
+			CHECK(supported.shell == DragShellKind::Xdnd);
+			CHECK_EQ(supported.matchCount, 1);
+			CHECK(HasPath(supported, pdf));
+			CHECK(supported.originTicks != 0);
+			fromThreshold.push_back(PipelineStats::TicksToMillis(supported.ticks - supported.originTicks));
+			fromSelection.push_back(PipelineStats::TicksToMillis(supported.ticks - owned));
+		}
+		source.Release();
+		DragEvent released;
+		received = collector.Wait(first + 1, released);
+		CHECK(received);
+		if (received) {
+			CHECK(released.kind == DragEventKind::Released);
+			CHECK(HasPath(released, pdf));
+		}
+	}
+
+	if (!fromThreshold.empty()) {
+		std::sort(fromThreshold.begin(), fromThreshold.end());
+		std::sort(fromSelection.begin(), fromSelection.end());
+		std::printf("detection latency over %zu drags: threshold -> Supported p50 %.3f ms, max %.3f ms; "
+			"selection owned -> Supported p50 %.3f ms, max %.3f ms\n", fromThreshold.size(),
+			fromThreshold[fromThreshold.size() / 2], fromThreshold.back(),
+			fromSelection[fromSelection.size() / 2], fromSelection.back());
+	}
+}
+
+// 上一次拖拽的转换应答在新的拖拽开始后才到达：必须丢弃，新的拖拽只能得到自己的文件列表
+static void TestStaleAnswerIsDropped(DragSource& source, Collector& collector) {
+	std::string oldPdf = CreateFile("old.pdf");
+	std::string newPdf = CreateFile("new.pdf");
+	size_t first = collector.Count();
+
+	source.Press(200, 200);
+	source.MoveTo(230, 200);
+	source.TakeSelection();
+	XSelectionRequestEvent oldRequest;
+	bool requested = source.WaitRequest(oldRequest);
+	CHECK(requested);
+	if (!requested) {
+		source.Release();
+		return;
+	}
+	// 未应答就释放并开始新的拖拽
+	source.Release();
+	source.Press(400, 400);
+	source.MoveTo(430, 400);
+	source.TakeSelection();
+	// 上一个转换未应答前不会发出新的请求
+	XSelectionRequestEvent newRequest;
+	CHECK(!source.WaitRequest(newRequest, 200));
+
+	source.Answer(oldRequest, "file://" + oldPdf + "\r\n");
+	requested = source.WaitRequest(newRequest);
+	CHECK(requested);
+	if (requested) {
+		source.Answer(newRequest, "file://" + newPdf + "\r\n");
+	}
+	DragEvent supported;
+	bool received = collector.Wait(first, supported);
+	CHECK(received);
+	if (received) {
+		CHECK(supported.kind == DragEventKind::Supported);
+		CHECK(HasPath(supported, newPdf));
+	}
+	source.Release();
+	DragEvent released;
+	received = collector.Wait(first + 1, released);
+	CHECK(received);
+	if (received) {
+		CHECK(released.kind == DragEventKind::Released);
+		CHECK(HasPath(released, newPdf));
+	}
+	// 被丢弃的应答不产生任何事件
+	CHECK_EQ(collector.Count(), first + 2);
+}
+
+int main() {
+	DragSource source;
+	if (!source.Open()) {
+		std::printf("X11DragMonitorTest: no X display with XTest, skipped\n");
+		return kSkipped;
+	}
+	if (!X11DragMonitor::Start()) {
+		std::printf("X11DragMonitorTest: XInput2 or XFixes unavailable, skipped\n");
+		return kSkipped;
+	}
+	char directory[] = "/tmp/filedrop-x11-XXXXXX";
+	if (mkdtemp(directory) == nullptr) {
+		return 1;
+	}
+	g_directory = directory;
+
+	Collector collector;
+	X11DragMonitor::AddEventSink(Collector::Sink, &collector);
+	X11DragMonitor::SetExtensions({ L".pdf" });
+	// 等待监视线程开始接收事件
+	usleep(100 * 1000);
+
+	TestDetectionLatency(source, collector, 50);
+	TestStaleAnswerIsDropped(source, collector);
+
+	X11DragMonitor::RemoveEventSink(Collector::Sink, &collector);
+	X11DragMonitor::Stop();
+	std::string cleanup = "rm -rf '" + g_directory + "'";
+	int removed = std::system(cleanup.c_str());
+	(void)removed;
+	return CheckResult("X11DragMonitorTest");
+}